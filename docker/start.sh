@@ -9,6 +9,7 @@ echo "环境配置:"
 echo "  主机: ${UDP_HOST:-0.0.0.0}"
 echo "  端口: ${UDP_PORT:-8888}"
 echo "  日志级别: ${LOG_LEVEL:-INFO}"
+echo "  服务器: ${UDP_SERVER:-cpp}"
 echo ""
 
 # 检查网络连接性
@@ -23,7 +24,6 @@ mkdir -p /app/logs
 # 显示系统信息
 echo "系统信息:"
 echo "  操作系统: $(cat /etc/os-release | grep PRETTY_NAME | cut -d '"' -f2)"
-echo "  Python版本: $(python3 --version)"
 echo "  容器时间: $(date)"
 echo ""
 
@@ -31,5 +31,8 @@ echo "======================================"
 echo "启动UDP服务器..."
 echo "======================================"
 
-# 启动UDP服务器
-exec python3 /app/udp_server.py 
\ No newline at end of file
+# 启动UDP服务器，UDP_SERVER=python时使用旧版Python服务器
+if [ "${UDP_SERVER:-cpp}" = "python" ]; then
+    exec python3 /app/udp_server.py
+fi
+exec /app/udp2docker_server 
@@ -0,0 +1,388 @@
+/**
+ * UDP2Docker服务器（C++实现）
+ *
+ * 在容器中接收来自宿主机的UDP消息，行为与udp_server.py相同：
+ * 心跳回复heartbeat_ack，文本DATA回复data_received，CONTROL命令回复执行结果，
+ * 非协议的文本消息回复"收到消息: ..."，回复均为UTF-8文本。
+ *
+ * 接收使用SO_REUSEPORT分片（每个分片一个线程）和批量零拷贝接收，每个分片有独立的
+ * MessageProtocol，协议消息经过完整的校验、解压和容器帧拆分。
+ *
+ * 环境变量：
+ *   UDP_HOST / UDP_PORT      监听地址，默认0.0.0.0:8888
+ *   LOG_LEVEL                日志级别，默认INFO；逐包日志为DEBUG级别
+ *   UDP_LOG_FILE             日志文件，默认/app/logs/udp_server.log，为空时只输出到控制台
+ *   UDP_SHARDS               接收分片数，默认0（硬件线程数）
+ *   UDP_ACK_DATA             为0时不回复DATA消息（压测时只接收）
+ *   UDP_STATS_INTERVAL       统计输出间隔（秒），默认30
+ *   UDP_CONFIG               可选的配置文件（socket.*等配置项，见README），监听地址仍以上面的变量为准
+ *   UDP_METRICS_PORT         设置后启动指标导出：Prometheus监听端口，或StatsD服务器端口
+ *   UDP_METRICS_FORMAT       prometheus（默认，GET /metrics）或statsd
+ *   UDP_METRICS_HOST         Prometheus监听地址（默认0.0.0.0），或StatsD服务器地址
+ */
+
+#include "udp2docker/udp_client_group.h"
+#include "udp2docker/message_protocol.h"
+#include "udp2docker/config_manager.h"
+#include "udp2docker/logger.h"
+#include "udp2docker/metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace udp2docker;
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void on_signal(int) {
+    g_stop = true;
+}
+
+string_t env_or(const char* name, const string_t& fallback) {
+    const char* value = std::getenv(name);
+    return value != nullptr ? string_t(value) : fallback;
+}
+
+int env_int(const char* name, int fallback) {
+    const char* value = std::getenv(name);
+    if (value == nullptr || *value == '\0') {
+        return fallback;
+    }
+    try {
+        return std::stoi(value);
+    } catch (const std::exception&) {
+        LOG_WARN_F("Ignoring invalid {}={}", name, value);
+        return fallback;
+    }
+}
+
+/**
+ * @brief 检查数据是否为合法的UTF-8（不接受超长编码和代理区码点）
+ */
+bool is_utf8(BufferView data) {
+    size_t i = 0;
+    while (i < data.size) {
+        byte lead = data.data[i];
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        }
+        
+        size_t length = 0;
+        uint32_t code_point = 0;
+        if ((lead & 0xE0) == 0xC0) {
+            length = 2;
+            code_point = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length = 3;
+            code_point = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length = 4;
+            code_point = lead & 0x07;
+        } else {
+            return false;
+        }
+        if (i + length > data.size) {
+            return false;
+        }
+        for (size_t k = 1; k < length; ++k) {
+            byte next = data.data[i + k];
+            if ((next & 0xC0) != 0x80) {
+                return false;
+            }
+            code_point = (code_point << 6) | (next & 0x3F);
+        }
+        
+        static constexpr uint32_t MIN_CODE_POINT[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (code_point < MIN_CODE_POINT[length] || code_point > 0x10FFFF ||
+            (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+/**
+ * @brief 合法UTF-8文本的前max_chars个字符
+ */
+std::string_view utf8_prefix(std::string_view text, size_t max_chars) {
+    size_t chars = 0;
+    size_t i = 0;
+    while (i < text.size() && chars < max_chars) {
+        ++i;
+        while (i < text.size() && (static_cast<byte>(text[i]) & 0xC0) == 0x80) {
+            ++i;
+        }
+        ++chars;
+    }
+    return text.substr(0, i);
+}
+
+string_t iso_time_now() {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &local);
+    return text;
+}
+
+std::string_view as_text(BufferView data) {
+    return std::string_view(reinterpret_cast<const char*>(data.data), data.size);
+}
+
+/**
+ * @brief 单个分片的消息处理，只在该分片的接收线程中调用
+ */
+class ShardHandler {
+public:
+    ShardHandler(UdpClient& socket, bool ack_data) : socket_(socket), ack_data_(ack_data) {}
+    
+    void on_packet(const PacketView& packet) {
+        // 魔数匹配的数据报按协议消息处理，解析失败计为错误，不再当作文本
+        uint32_t magic = 0;
+        if (packet.data.size >= sizeof(magic)) {
+            std::memcpy(&magic, packet.data.data, sizeof(magic));
+        }
+        if (magic != MessageHeader().magic_number) {
+            handle_text(packet.data, packet.from);
+            return;
+        }
+        
+        auto result = protocol_.deserialize_each(packet.data, [&](const MessageView& view) {
+            handle_message(view, packet.from);
+        });
+        if (!result.is_success()) {
+            protocol_errors_.fetch_add(1, std::memory_order_relaxed);
+            LOG_DEBUG_F("Malformed protocol datagram from {} ({} bytes)", packet.from.to_string(), packet.data.size);
+        }
+    }
+    
+    uint64_t protocol_errors() const { return protocol_errors_.load(std::memory_order_relaxed); }
+    uint64_t replies() const { return replies_.load(std::memory_order_relaxed); }
+
+private:
+    UdpClient& socket_;
+    MessageProtocol protocol_;
+    bool ack_data_;
+    std::atomic<uint64_t> protocol_errors_{0};
+    std::atomic<uint64_t> replies_{0};
+    string_t response_;                  // 回复文本的复用缓冲区
+    
+    void handle_message(const MessageView& view, const Endpoint& from) {
+        const MessageHeader& header = view.header;
+        LOG_DEBUG_F("Protocol message from {} - type: {}, priority: {}, sequence: {}",
+                    from.to_string(), static_cast<int>(header.type), static_cast<int>(header.priority),
+                    header.sequence_id);
+        
+        switch (header.type) {
+        case MessageType::HEARTBEAT:
+            reply("heartbeat_ack", from);
+            break;
+        case MessageType::DATA:
+            if (is_utf8(view.payload)) {
+                LOG_DEBUG_F("Data message: {}", as_text(view.payload));
+                if (ack_data_) {
+                    reply("data_received", from);
+                }
+            } else {
+                LOG_DEBUG_F("Binary data message, {} bytes", view.payload.size);
+            }
+            break;
+        case MessageType::CONTROL:
+            if (is_utf8(view.payload)) {
+                handle_control(as_text(view.payload), from);
+            } else {
+                LOG_WARN("Unable to decode control command");
+            }
+            break;
+        case MessageType::RESPONSE:
+            LOG_DEBUG("Response message received");
+            break;
+        case MessageType::MESSAGE_ERROR:
+            if (is_utf8(view.payload)) {
+                LOG_WARN_F("Error message from {}: {}", from.to_string(), as_text(view.payload));
+            } else {
+                LOG_WARN_F("Binary error message from {}", from.to_string());
+            }
+            break;
+        default:
+            LOG_DEBUG_F("Ignoring message type {}", static_cast<int>(header.type));
+            break;
+        }
+    }
+    
+    void handle_control(std::string_view command, const Endpoint& from) {
+        LOG_INFO_F("Control command from {}: {}", from.to_string(), command);
+        
+        // 与Python版本相同，只模拟执行docker命令
+        response_.clear();
+        if (command.substr(0, 6) == "docker") {
+            response_.append("模拟执行: ").append(command);
+            response_.append("\n状态: 成功\n时间: ").append(iso_time_now());
+        } else {
+            response_.append("未知命令: ").append(command);
+        }
+        reply(response_, from);
+    }
+    
+    void handle_text(BufferView data, const Endpoint& from) {
+        if (!is_utf8(data)) {
+            LOG_DEBUG_F("Binary message from {}, {} bytes", from.to_string(), data.size);
+            return;
+        }
+        
+        LOG_DEBUG_F("Text message from {}: {}", from.to_string(), as_text(data));
+        response_.assign("收到消息: ");
+        response_.append(utf8_prefix(as_text(data), 50)).append("...");
+        reply(response_, from);
+    }
+    
+    void reply(std::string_view text, const Endpoint& from) {
+        BufferView data(reinterpret_cast<const byte*>(text.data()), text.size());
+        if (socket_.send_to(data, from) == ErrorCode::SUCCESS) {
+            replies_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+void log_statistics(UdpClientGroup& group, const std::vector<std::unique_ptr<ShardHandler>>& handlers,
+                    std::chrono::steady_clock::time_point started) {
+    UdpClient::Statistics stats = group.get_statistics();
+    uint64_t protocol_errors = 0;
+    uint64_t replies = 0;
+    for (const auto& handler : handlers) {
+        protocol_errors += handler->protocol_errors();
+        replies += handler->replies();
+    }
+    
+    auto uptime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started);
+    LOG_INFO_F("Server statistics - uptime: {}s, messages received: {}, bytes received: {}, replies: {}, errors: {}",
+               uptime.count(), stats.packets_received, stats.bytes_received, replies,
+               stats.receive_errors + protocol_errors);
+}
+
+} // anonymous namespace
+
+int main() {
+    std::signal(SIGTERM, on_signal);
+    std::signal(SIGINT, on_signal);
+    
+    LogLevel level = string_to_level(env_or("LOG_LEVEL", "INFO")).value_or(LogLevel::INFO);
+    LoggerManager::set_global_level(level);
+    
+    // 控制台输出与文件输出都在后台线程完成，接收线程只复制日志参数
+    Logger& logger = LoggerManager::get_logger();
+    string_t log_file = env_or("UDP_LOG_FILE", "/app/logs/udp_server.log");
+    std::error_code ignored;
+    if (!log_file.empty() && std::filesystem::is_directory(std::filesystem::path(log_file).parent_path(), ignored)) {
+        logger.set_file_output(log_file);
+        logger.set_file_buffering();
+        logger.set_target(LogTarget::CONSOLE_AND_FILE);
+    }
+    logger.enable_async(4096);
+    
+    string_t host = env_or("UDP_HOST", "0.0.0.0");
+    int port = env_int("UDP_PORT", 8888);
+    LOG_INFO("Starting UDP2Docker server...");
+    LOG_INFO_F("Configuration - host: {}, port: {}", host, port);
+    
+    // 默认值面向高包率：大批量接收、较大的接收缓冲区、不发送保活
+    UdpConfig base;
+    base.enable_keep_alive = false;
+    base.receive_batch_size = 64;
+    base.receive_buffer_size = 8 * 1024 * 1024;
+    
+    UdpGroupConfig group_config;
+    group_config.client = base;
+    string_t config_file = env_or("UDP_CONFIG", "");
+    if (!config_file.empty()) {
+        ConfigManager settings;
+        if (settings.load_config(config_file) == ErrorCode::SUCCESS) {
+            group_config.client = make_udp_config(*settings.snapshot(), base);
+        } else {
+            LOG_WARN_F("Unable to load {}, using defaults", config_file);
+        }
+    }
+    group_config.client.local_host = host;
+    group_config.client.local_port = port;
+    group_config.shard_count = static_cast<size_t>(std::max(env_int("UDP_SHARDS", 0), 0));
+    
+    UdpClientGroup group(group_config);
+    if (group.initialize() != ErrorCode::SUCCESS) {
+        LOG_FATAL_F("Failed to bind {}:{}", host, port);
+        LoggerManager::shutdown();
+        return 1;
+    }
+    
+    bool ack_data = env_int("UDP_ACK_DATA", 1) != 0;
+    std::vector<std::unique_ptr<ShardHandler>> handlers;
+    for (size_t i = 0; i < group.shard_count(); ++i) {
+        handlers.push_back(std::make_unique<ShardHandler>(group.shard(i), ack_data));
+        ShardHandler* handler = handlers.back().get();
+        ErrorCode result = group.shard(i).start_receive_batch_async(
+            [handler](const PacketView& packet) { handler->on_packet(packet); },
+            [](ErrorCode error_code, const string_t& error_message) {
+                LOG_ERROR_F("Receive error {}: {}", static_cast<int>(error_code), error_message);
+            });
+        if (result != ErrorCode::SUCCESS) {
+            LOG_FATAL_F("Failed to start receiving on shard {}", i);
+            group.stop_receive_async();
+            LoggerManager::shutdown();
+            return 1;
+        }
+    }
+    LOG_INFO_F("UDP server listening on {}:{} with {} receive shards", host, group.get_local_port(),
+               group.shard_count());
+    
+    std::unique_ptr<MetricsExporter> exporter;
+    if (!env_or("UDP_METRICS_PORT", "").empty()) {
+        MetricsExporterConfig metrics;
+        metrics.port = env_int("UDP_METRICS_PORT", metrics.port);
+        metrics.host = env_or("UDP_METRICS_HOST", metrics.host);
+        if (env_or("UDP_METRICS_FORMAT", "prometheus") == "statsd") {
+            metrics.format = MetricsFormat::STATSD;
+        }
+        exporter = std::make_unique<MetricsExporter>(metrics);
+        if (exporter->start() != ErrorCode::SUCCESS) {
+            LOG_WARN("Metrics exporter disabled");
+            exporter.reset();
+        }
+    }
+    
+    auto started = std::chrono::steady_clock::now();
+    auto interval = std::chrono::seconds(std::max(env_int("UDP_STATS_INTERVAL", 30), 1));
+    auto next_report = started + interval;
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (std::chrono::steady_clock::now() >= next_report) {
+            log_statistics(group, handlers, started);
+            next_report += interval;
+        }
+    }
+    
+    LOG_INFO("Shutting down UDP server...");
+    exporter.reset();
+    group.stop_receive_async();
+    log_statistics(group, handlers, started);
+    group.close();
+    LOG_INFO("UDP server stopped");
+    LoggerManager::shutdown();
+    return 0;
+}
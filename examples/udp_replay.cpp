@@ -0,0 +1,164 @@
+/**
+ * UDP2Docker抓包回放工具
+ *
+ * 把UdpClient::start_capture()（或client.capture_file配置项）记录的抓包文件按原始时间间隔
+ * 重新发往指定目标，用于复现问题或以真实流量压测容器端服务器。
+ *
+ * 用法：
+ *   udp2docker_replay <抓包文件> <目标地址> <目标端口> [选项]
+ *
+ * 选项：
+ *   --speed N      回放速率倍数，默认1；0为不等待尽快发送
+ *   --batch N      每次send_batch()最多发送的数据报数，默认64
+ *   --received     同时回放抓到的接收记录
+ *   --received-only 只回放接收记录
+ *   --loop N       重复回放N次，默认1
+ *   --info         只打印文件中的记录统计，不发送
+ */
+
+#include "udp2docker/udp_client.h"
+#include "udp2docker/capture.h"
+#include "udp2docker/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace udp2docker;
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void on_signal(int) {
+    g_stop = true;
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <capture-file> <host> <port>"
+              << " [--speed N] [--batch N] [--received | --received-only] [--loop N] [--info]" << std::endl;
+}
+
+// 打印文件中的记录数、方向和时间跨度
+void print_info(CaptureReader& reader) {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t bytes = 0;
+    uint64_t truncated = 0;
+    uint64_t first = 0;
+    uint64_t last = 0;
+    
+    CaptureRecord record;
+    while (reader.next(record)) {
+        if (sent + received == 0) {
+            first = record.timestamp_ns;
+        }
+        last = record.timestamp_ns;
+        (record.direction == CaptureDirection::SENT ? sent : received)++;
+        bytes += record.data.size;
+        if (record.original_length > record.data.size) {
+            ++truncated;
+        }
+    }
+    reader.rewind();
+    
+    std::cout << "Records:   " << sent + received << " (sent " << sent << ", received " << received << ")" << std::endl;
+    std::cout << "Bytes:     " << bytes << " (" << truncated << " truncated)" << std::endl;
+    std::cout << "Duration:  " << static_cast<double>(last - first) / 1e9 << " s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    string_t path = argv[1];
+    string_t host = argv[2];
+    int port = std::atoi(argv[3]);
+    ReplayConfig config;
+    int loops = 1;
+    bool info_only = false;
+    
+    for (int i = 4; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--speed") == 0 && has_value) {
+            config.speed = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--batch") == 0 && has_value) {
+            config.batch_size = static_cast<size_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::strcmp(argv[i], "--loop") == 0 && has_value) {
+            loops = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--received") == 0) {
+            config.replay_received = true;
+        } else if (std::strcmp(argv[i], "--received-only") == 0) {
+            config.replay_sent = false;
+            config.replay_received = true;
+        } else if (std::strcmp(argv[i], "--info") == 0) {
+            info_only = true;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (port <= 0 || port > 65535 || config.speed < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    CaptureReader reader;
+    if (reader.open(path) != ErrorCode::SUCCESS) {
+        std::cerr << "Cannot open capture file: " << path << std::endl;
+        return 1;
+    }
+    
+    if (info_only) {
+        print_info(reader);
+        return 0;
+    }
+    
+    UdpConfig client_config;
+    client_config.server_host = host;
+    client_config.server_port = port;
+    UdpClient client(client_config);
+    if (client.initialize() != ErrorCode::SUCCESS) {
+        std::cerr << "Cannot initialize UDP client" << std::endl;
+        return 1;
+    }
+    
+    std::signal(SIGTERM, on_signal);
+    std::signal(SIGINT, on_signal);
+    
+    ReplayStatistics total;
+    for (int loop = 0; loop < loops && !g_stop; ++loop) {
+        reader.rewind();
+        auto result = replay_capture(reader, client, host, port, config, &g_stop);
+        if (!result.is_success()) {
+            std::cerr << "Replay failed: " << static_cast<int>(result.error_code()) << std::endl;
+            return 1;
+        }
+        const ReplayStatistics& stats = result.value();
+        total.packets += stats.packets;
+        total.bytes += stats.bytes;
+        total.truncated += stats.truncated;
+        total.failed += stats.failed;
+        total.elapsed_ns += stats.elapsed_ns;
+    }
+    
+    double seconds = static_cast<double>(total.elapsed_ns) / 1e9;
+    std::cout << "Packets:   " << total.packets << " (" << total.failed << " failed, "
+              << total.truncated << " truncated)" << std::endl;
+    std::cout << "Bytes:     " << total.bytes << std::endl;
+    std::cout << "Elapsed:   " << seconds << " s" << std::endl;
+    if (seconds > 0) {
+        std::cout << "Rate:      " << static_cast<double>(total.packets) / seconds << " pps" << std::endl;
+    }
+    
+    return total.failed > 0 ? 2 : 0;
+}
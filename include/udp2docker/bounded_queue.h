@@ -0,0 +1,155 @@
+#pragma once
+
+#include "common.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace udp2docker {
+
+// 缓存行大小，用于隔离生产者和消费者频繁修改的计数器
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief 有界无锁队列（多生产者/多消费者）
+ *
+ * 基于预分配的环形槽位数组，每个槽位带有序列号（Dmitry Vyukov的有界MPMC算法）：
+ * - 入队和出队各只需一次CAS，没有互斥锁
+ * - 容量在构造时确定并向上取整为2的幂，运行期间不再分配内存
+ * - 元素以移动方式入队和出队
+ *
+ * 队列本身不提供阻塞语义，满/空时由调用方决定等待、丢弃或报错。
+ */
+template<typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 队列容量（向上取整为2的幂，最小为2）
+     */
+    explicit BoundedQueue(size_t capacity)
+        : capacity_(round_up_pow2(capacity))
+        , mask_(capacity_ - 1)
+        , slots_(new Slot[capacity_])
+        , enqueue_pos_(0)
+        , dequeue_pos_(0)
+    {
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    ~BoundedQueue() {
+        T discarded;
+        while (try_pop(discarded)) {
+        }
+        delete[] slots_;
+    }
+    
+    // 禁用拷贝构造和赋值
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+    
+    /**
+     * @brief 尝试入队
+     * @param value 要入队的元素，成功时被移走，失败时保持不变
+     * @return 队列已满返回false
+     */
+    bool try_push(T& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        
+        while (true) {
+            slot = &slots_[pos & mask_];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        slot->value = std::move(value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool try_push(T&& value) {
+        return try_push(value);
+    }
+    
+    /**
+     * @brief 尝试出队
+     * @param value 出队元素的存放位置
+     * @return 队列为空返回false
+     */
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        
+        while (true) {
+            slot = &slots_[pos & mask_];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        value = std::move(slot->value);
+        slot->value = T();
+        slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+    
+    /**
+     * @brief 获取近似元素数量（并发修改时仅供参考）
+     */
+    size_t approx_size() const {
+        size_t enqueued = enqueue_pos_.load(std::memory_order_acquire);
+        size_t dequeued = dequeue_pos_.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+    
+    bool approx_empty() const { return approx_size() == 0; }
+    
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+    
+    const size_t capacity_;
+    const size_t mask_;
+    Slot* const slots_;
+    
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos_;
+};
+
+} // namespace udp2docker
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "common.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace udp2docker {
+
+class BufferPool;
+
+namespace detail {
+
+// 池化缓冲区的块头，数据区紧跟在块头之后
+struct alignas(16) BufferBlock {
+    std::atomic<uint32_t> references;
+    uint32_t size_class;          // 所属尺寸等级
+    size_t capacity;              // 数据区字节数
+    BufferPool* pool;             // 所属缓冲池，超大块或线程退出后分配的块为nullptr
+    BufferBlock* next;            // 空闲链表
+    
+    byte* bytes() { return reinterpret_cast<byte*>(this + 1); }
+};
+
+// 引用计数归零后把块还给所属缓冲池
+void release_block(BufferBlock* block);
+
+} // namespace detail
+
+/**
+ * @brief 池化的引用计数缓冲区
+ *
+ * 数据位于BufferPool分配的块中，块头内嵌引用计数，拷贝只增加计数、不复制数据，
+ * 最后一个引用释放时块回到所属线程的缓冲池，不经过malloc/free。
+ * 数据前预留headroom字节，外层协议头可以用prepend()直接写在数据前面。
+ *
+ * 引用计数是线程安全的，同一个块可以在线程之间传递和释放；数据本身不加保护，
+ * 多个引用共享同一个块，修改数据或调用prepend()前应确认unique()。
+ */
+class PooledBuffer {
+public:
+    static constexpr size_t DEFAULT_HEADROOM = 64;   // 足够容纳消息头和分片头
+    
+    PooledBuffer() noexcept : block_(nullptr), offset_(0), size_(0) {}
+    
+    /**
+     * @brief 从当前线程的缓冲池分配
+     * @param size 数据长度（内容未初始化）
+     * @param headroom 数据前预留的字节数
+     */
+    static PooledBuffer allocate(size_t size, size_t headroom = DEFAULT_HEADROOM);
+    
+    /**
+     * @brief 分配并复制数据，例如保留PacketView中的数据包
+     */
+    static PooledBuffer copy_of(BufferView data, size_t headroom = DEFAULT_HEADROOM);
+    
+    PooledBuffer(const PooledBuffer& other) noexcept
+        : block_(other.block_), offset_(other.offset_), size_(other.size_) {
+        if (block_ != nullptr) {
+            block_->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : block_(other.block_), offset_(other.offset_), size_(other.size_) {
+        other.block_ = nullptr;
+        other.offset_ = 0;
+        other.size_ = 0;
+    }
+    
+    PooledBuffer& operator=(const PooledBuffer& other) noexcept {
+        if (this != &other) {
+            PooledBuffer copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+    
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+        if (this != &other) {
+            reset();
+            swap(other);
+        }
+        return *this;
+    }
+    
+    ~PooledBuffer() { reset(); }
+    
+    /**
+     * @brief 释放引用，之后为空缓冲区
+     */
+    void reset() noexcept {
+        if (block_ != nullptr && block_->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            detail::release_block(block_);
+        }
+        block_ = nullptr;
+        offset_ = 0;
+        size_ = 0;
+    }
+    
+    void swap(PooledBuffer& other) noexcept {
+        std::swap(block_, other.block_);
+        std::swap(offset_, other.offset_);
+        std::swap(size_, other.size_);
+    }
+    
+    byte* data() { return block_ != nullptr ? block_->bytes() + offset_ : nullptr; }
+    const byte* data() const { return block_ != nullptr ? block_->bytes() + offset_ : nullptr; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    
+    /**
+     * @brief 数据前还可以prepend()的字节数
+     */
+    size_t headroom() const { return offset_; }
+    
+    /**
+     * @brief 数据后还可以扩展的字节数
+     */
+    size_t tailroom() const { return block_ != nullptr ? block_->capacity - offset_ - size_ : 0; }
+    
+    /**
+     * @brief 在块的容量范围内改变数据长度（向后扩展或截短）
+     * @return 超出容量返回false，长度不变
+     */
+    bool resize(size_t size) {
+        if (size > size_ + tailroom()) {
+            return false;
+        }
+        size_ = size;
+        return true;
+    }
+    
+    /**
+     * @brief 把数据起点向前移动bytes字节，用于在数据前写入协议头
+     * @return 新的数据起点；预留空间不足返回nullptr
+     */
+    byte* prepend(size_t bytes) {
+        if (bytes > offset_) {
+            return nullptr;
+        }
+        offset_ -= bytes;
+        size_ += bytes;
+        return data();
+    }
+    
+    /**
+     * @brief 去掉数据前bytes字节（例如解析完外层协议头），去掉的部分成为预留空间
+     */
+    void trim_front(size_t bytes) {
+        bytes = std::min(bytes, size_);
+        offset_ += bytes;
+        size_ -= bytes;
+    }
+    
+    BufferView view() const { return BufferView(data(), size_); }
+    
+    /**
+     * @brief 复制为buffer_t（传给仍使用buffer_t的接口）
+     */
+    buffer_t to_vector() const { return buffer_t(data(), data() + size_); }
+    
+    uint32_t use_count() const {
+        return block_ != nullptr ? block_->references.load(std::memory_order_acquire) : 0;
+    }
+    
+    bool unique() const { return use_count() == 1; }
+
+private:
+    friend class BufferPool;
+    
+    PooledBuffer(detail::BufferBlock* block, size_t offset, size_t size) noexcept
+        : block_(block), offset_(offset), size_(size) {}
+    
+    detail::BufferBlock* block_;
+    size_t offset_;
+    size_t size_;
+};
+
+/**
+ * @brief 每线程的slab缓冲池
+ *
+ * 块按容量分为几个尺寸等级，每个等级从一次申请的slab中切分，释放后进入空闲链表复用，
+ * 稳定运行时分配和释放都不调用malloc。超过最大等级的请求直接向系统申请。
+ *
+ * 每个线程第一次调用local()时创建自己的缓冲池。在所属线程中释放的块直接进入空闲链表；
+ * 在其他线程中释放的块（例如发送线程释放业务线程分配的数据报）无锁地压入远程链表，
+ * 所属线程的空闲链表用完时整体取回。线程退出后缓冲池在最后一个块释放时销毁。
+ */
+class BufferPool {
+public:
+    static constexpr size_t SIZE_CLASSES = 4;
+    static constexpr size_t SLAB_BYTES = 256 * 1024;   // 每次向系统申请的slab大小
+    
+    /**
+     * @brief 各尺寸等级块的数据区容量（含预留空间）
+     */
+    static constexpr std::array<size_t, SIZE_CLASSES> CLASS_CAPACITY = {
+        256, 2048, 16384, MAX_BUFFER_SIZE + 512
+    };
+    
+    /**
+     * @brief 统计信息
+     */
+    struct Statistics {
+        uint64_t allocations = 0;        // 分配次数
+        uint64_t reused = 0;             // 从空闲链表复用的次数
+        uint64_t slabs = 0;              // 向系统申请的slab数
+        uint64_t oversized = 0;          // 超过最大等级、直接向系统申请的分配
+        uint64_t remote_releases = 0;    // 在其他线程释放、经远程链表归还的块
+        size_t outstanding = 0;          // 尚未释放的块
+    };
+    
+    /**
+     * @brief 当前线程的缓冲池（不应在线程退出过程中调用）
+     */
+    static BufferPool& local();
+    
+    // 禁用拷贝构造和赋值
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    
+    /**
+     * @brief 分配缓冲区，只能在所属线程中调用
+     * @param size 数据长度（内容未初始化）
+     * @param headroom 数据前预留的字节数
+     */
+    PooledBuffer allocate(size_t size, size_t headroom = PooledBuffer::DEFAULT_HEADROOM);
+    
+    /**
+     * @brief 统计信息，只能在所属线程中调用
+     */
+    Statistics get_statistics() const;
+
+private:
+    friend class PooledBuffer;
+    friend void detail::release_block(detail::BufferBlock* block);
+    class ThreadHandle;
+    
+    BufferPool();
+    ~BufferPool();
+    
+    // 以下空闲链表和统计只由所属线程访问
+    std::array<detail::BufferBlock*, SIZE_CLASSES> free_;
+    std::vector<void*> slabs_;
+    Statistics stats_;
+    
+    std::array<std::atomic<detail::BufferBlock*>, SIZE_CLASSES> remote_;
+    std::atomic<uint64_t> remote_releases_;
+    std::atomic<size_t> references_;       // 未释放的块数，所属线程存活期间另加1
+    
+    static detail::BufferBlock* allocate_unpooled(size_t capacity);
+    detail::BufferBlock* take(size_t size_class);
+    void refill(size_t size_class);
+    void release(detail::BufferBlock* block);
+    void unreference();
+};
+
+} // namespace udp2docker
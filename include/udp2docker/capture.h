@@ -0,0 +1,221 @@
+#pragma once
+
+#include "common.h"
+#include "endpoint.h"
+#include "statistics.h"
+#include <atomic>
+#include <mutex>
+
+namespace udp2docker {
+
+class UdpClient;
+
+// 抓包记录的方向
+enum class CaptureDirection : uint16_t {
+    SENT = 1,
+    RECEIVED = 2
+};
+
+// 抓包配置
+struct CaptureConfig {
+    string_t path;                           // 抓包文件，已存在时覆盖
+    size_t capacity_bytes = 64 * 1024 * 1024;  // 数据区大小，写满后覆盖最旧的记录
+    size_t snap_length = 0;                  // 每个数据报最多保存的字节数，0为完整保存
+    bool capture_sent = true;
+    bool capture_received = true;
+};
+
+/**
+ * @brief 抓包文件中的一条记录
+ *
+ * data指向CaptureReader的映射区域，在读取器关闭前有效。
+ */
+struct CaptureRecord {
+    CaptureDirection direction = CaptureDirection::SENT;
+    uint64_t timestamp_ns = 0;       // monotonic_ns()时间，与文件头中的起始时间相减得到相对时间
+    Endpoint peer;                   // 发送的目标或接收的来源
+    uint32_t original_length = 0;    // 数据报原始长度，超过snap_length时data被截断
+    BufferView data;
+};
+
+/**
+ * @brief 内存映射的抓包环形文件写入器
+ *
+ * 文件由64字节文件头和固定大小的数据区组成。数据区是环形的，记录按8字节对齐、不跨越
+ * 数据区末尾；写满后从最旧的记录开始覆盖。文件头中的head/tail为累计字节位置，每条记录
+ * 写完后更新，进程崩溃时已写入的记录仍保留在文件中。
+ *
+ * 写入只是一次加锁的内存复制，不产生系统调用；脏页由内核在后台写回。线程安全。
+ */
+class CaptureWriter {
+public:
+    /**
+     * @brief 写入统计
+     */
+    struct Statistics {
+        uint64_t records = 0;        // 写入的记录数
+        uint64_t bytes = 0;          // 写入的数据字节数（截断后）
+        uint64_t overwritten = 0;    // 数据区写满后被覆盖的记录数
+    };
+    
+    CaptureWriter();
+    
+    /**
+     * @brief 析构函数，关闭文件
+     */
+    ~CaptureWriter();
+    
+    // 禁用拷贝构造和赋值
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+    
+    /**
+     * @brief 创建抓包文件并映射到内存
+     * @return 打开前先关闭当前文件；容量过小返回INVALID_PARAMETER，文件无法创建或映射返回SOCKET_INIT_FAILED
+     */
+    ErrorCode open(const CaptureConfig& config);
+    
+    /**
+     * @brief 写回脏页并关闭文件，之后的write()被忽略
+     */
+    void close();
+    
+    bool is_open() const;
+    
+    /**
+     * @brief 追加一条记录，parts依次拼接为数据报（与send_gather()相同）
+     * @param direction 方向，配置中未启用的方向被忽略
+     * @param peer 对端
+     * @param parts 数据片段
+     * @param count 片段数量
+     * @param timestamp_ns monotonic_ns()时间
+     */
+    void write(CaptureDirection direction, const Endpoint& peer, const BufferView* parts, size_t count,
+               uint64_t timestamp_ns);
+    
+    void write(CaptureDirection direction, const Endpoint& peer, BufferView data, uint64_t timestamp_ns) {
+        write(direction, peer, &data, 1, timestamp_ns);
+    }
+    
+    /**
+     * @brief 同步写回脏页（msync），不影响后续写入
+     */
+    void flush();
+    
+    Statistics get_statistics() const;
+
+private:
+    mutable std::mutex mutex_;
+    CaptureConfig config_;
+    byte* mapping_;
+    size_t mapping_size_;
+    Statistics stats_;
+#ifdef _WIN32
+    void* file_;
+    void* file_mapping_;
+#else
+    int file_;
+#endif
+    
+    void unmap();
+};
+
+/**
+ * @brief 抓包文件读取器
+ *
+ * 只读映射文件，从最旧的记录依次读取到打开时的最新记录。
+ * 写入器仍在覆盖的文件读到的记录可能不完整，应在停止抓包后读取。
+ */
+class CaptureReader {
+public:
+    CaptureReader();
+    
+    /**
+     * @brief 析构函数，关闭文件
+     */
+    ~CaptureReader();
+    
+    // 禁用拷贝构造和赋值
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+    
+    /**
+     * @brief 打开并映射抓包文件
+     * @return 文件无法打开返回SOCKET_INIT_FAILED，格式不正确返回PROTOCOL_ERROR
+     */
+    ErrorCode open(const string_t& path);
+    
+    void close();
+    
+    bool is_open() const { return mapping_ != nullptr; }
+    
+    /**
+     * @brief 读取下一条记录
+     * @return 没有更多记录或记录损坏时返回false
+     */
+    bool next(CaptureRecord& record);
+    
+    /**
+     * @brief 回到第一条记录
+     */
+    void rewind() { position_ = tail_; }
+    
+    /**
+     * @brief 抓包开始时的monotonic_ns()和系统时间（纪元以来的纳秒）
+     */
+    uint64_t start_monotonic_ns() const { return start_monotonic_ns_; }
+    uint64_t start_realtime_ns() const { return start_realtime_ns_; }
+
+private:
+    byte* mapping_;
+    size_t mapping_size_;
+    uint64_t capacity_;
+    uint64_t head_;
+    uint64_t tail_;
+    uint64_t position_;
+    uint64_t start_monotonic_ns_;
+    uint64_t start_realtime_ns_;
+#ifdef _WIN32
+    void* file_;
+    void* file_mapping_;
+#else
+    int file_;
+#endif
+};
+
+// 回放配置
+struct ReplayConfig {
+    double speed = 1.0;              // 1为原始速率，2为两倍速，0为不等待尽快发送
+    size_t batch_size = 64;          // 每次send_batch()最多发送的数据报数
+    bool replay_sent = true;         // 回放抓到的发送记录
+    bool replay_received = false;    // 回放抓到的接收记录（压测接收端时使用）
+};
+
+// 回放结果
+struct ReplayStatistics {
+    uint64_t packets = 0;            // 发送成功的数据报
+    uint64_t bytes = 0;
+    uint64_t truncated = 0;          // 抓包时被截断、按截断后的长度发送的数据报
+    uint64_t failed = 0;             // 发送失败的数据报
+    uint64_t elapsed_ns = 0;
+};
+
+/**
+ * @brief 将抓包文件中的数据报通过UdpClient::send_batch()发往同一目标
+ *
+ * 按记录之间的原始时间间隔（除以speed）调度，已到发送时间的记录合并为一批发送；
+ * 落后于计划时不等待，尽快追上。
+ *
+ * @param reader 已打开的读取器，从当前位置开始读取
+ * @param client 已初始化的客户端
+ * @param target_host 目标地址，为空时发往客户端的默认服务器
+ * @param target_port 目标端口，为0时使用默认端口
+ * @param config 回放配置
+ * @param stop 非空且变为true时提前结束
+ */
+Result<ReplayStatistics> replay_capture(CaptureReader& reader, UdpClient& client,
+                                        const string_t& target_host, int target_port,
+                                        const ReplayConfig& config = ReplayConfig{},
+                                        const std::atomic<bool>* stop = nullptr);
+
+} // namespace udp2docker
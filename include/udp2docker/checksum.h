@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+
+namespace udp2docker {
+
+/**
+ * @brief 计算CRC32校验和（IEEE 802.3多项式，反射形式0xEDB88320）
+ *
+ * 实现在首次调用时根据CPU特性选择：
+ * - x86/x64：PCLMULQDQ折叠（需要SSE4.1）
+ * - ARMv8：CRC32指令
+ * - 其他：slice-by-8查表
+ *
+ * 所有实现结果一致，与协议早期的逐位算法兼容。
+ *
+ * @param data 数据
+ * @param size 数据长度
+ * @return 校验和
+ */
+uint32_t crc32(const byte* data, size_t size);
+
+/**
+ * @brief 计算CRC32校验和
+ * @param data 数据视图
+ * @return 校验和
+ */
+uint32_t crc32(BufferView data);
+
+/**
+ * @brief 获取当前使用的CRC32实现名称
+ * @return "pclmul"、"armv8-crc"或"slice-by-8"
+ */
+const char* crc32_implementation();
+
+/**
+ * @brief 增量CRC32计算，适用于分散在多个片段中的数据
+ *
+ * 对片段依次调用update()的结果与对拼接后数据调用crc32()相同。
+ */
+class Crc32 {
+public:
+    Crc32() : state_(0xFFFFFFFF) {}
+    
+    void update(const byte* data, size_t size);
+    void update(BufferView data) { update(data.data, data.size); }
+    
+    uint32_t value() const { return ~state_; }
+    void reset() { state_ = 0xFFFFFFFF; }
+
+private:
+    uint32_t state_;
+};
+
+namespace detail {
+
+// 使用未取反的内部状态更新CRC，供测试对比各实现
+uint32_t crc32_update(uint32_t state, const byte* data, size_t size);
+uint32_t crc32_update_slice8(uint32_t state, const byte* data, size_t size);
+
+} // namespace detail
+
+} // namespace udp2docker
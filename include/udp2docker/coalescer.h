@@ -0,0 +1,140 @@
+#pragma once
+
+#include "common.h"
+#include "fragmentation.h"
+#include "message_protocol.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace udp2docker {
+
+class UdpClient;
+
+/**
+ * @brief 小消息合并配置
+ */
+struct CoalescingConfig {
+    size_t max_datagram_size = DEFAULT_PATH_MTU - IP_UDP_OVERHEAD;  // 合并后数据报的长度上限
+    std::chrono::microseconds flush_delay{200};   // 第一条消息进入后最多等待的时间
+    Priority flush_priority = Priority::HIGH;     // 不低于该优先级的消息立即发出
+};
+
+// 接收合并后数据报的函数
+using DatagramSink = std::function<ErrorCode(BufferView datagram)>;
+
+/**
+ * @brief 小消息合并器（类似Nagle算法）
+ *
+ * 把多条消息序列化后首尾相接地放进一个BATCH容器帧，一个数据报、一次系统调用发出，
+ * 省掉每条消息的UDP/IP头。满足以下任一条件时发出：
+ * - 再放一条就会超过max_datagram_size；
+ * - 第一条消息进入后已过flush_delay（由后台线程或flush_if_due()触发）；
+ * - 消息优先级不低于flush_priority。
+ * 只有一条消息时直接发出该消息，不加容器头。接收方用MessageProtocol::deserialize_each解包。
+ *
+ * 所有方法都是线程安全的。序列化使用构造时传入的MessageProtocol，
+ * 合并器使用期间不应在其他线程中同时使用该协议对象发送。
+ */
+class MessageCoalescer {
+public:
+    using clock_t = std::chrono::steady_clock;
+    
+    /**
+     * @brief 统计信息
+     */
+    struct Statistics {
+        uint64_t messages = 0;           // 进入合并器的消息
+        uint64_t datagrams = 0;          // 发出的数据报
+        uint64_t size_flushes = 0;       // 因长度上限触发的发送
+        uint64_t deadline_flushes = 0;   // 因等待超时触发的发送
+        uint64_t priority_flushes = 0;   // 因高优先级消息触发的发送
+        uint64_t oversized = 0;          // 超过上限、单独发出的消息
+    };
+    
+    /**
+     * @brief 构造函数
+     * @param protocol 序列化使用的协议对象，生命周期需长于本对象
+     * @param sink 数据报发送函数
+     * @param config 合并配置
+     */
+    MessageCoalescer(MessageProtocol& protocol, DatagramSink sink,
+                     const CoalescingConfig& config = CoalescingConfig());
+    
+    /**
+     * @brief 发送到UdpClient的默认服务器
+     */
+    MessageCoalescer(MessageProtocol& protocol, UdpClient& client,
+                     const CoalescingConfig& config = CoalescingConfig());
+    
+    /**
+     * @brief 析构函数，停止后台线程并发出剩余的消息
+     */
+    ~MessageCoalescer();
+    
+    // 禁用拷贝构造和赋值
+    MessageCoalescer(const MessageCoalescer&) = delete;
+    MessageCoalescer& operator=(const MessageCoalescer&) = delete;
+    
+    /**
+     * @brief 加入一条消息
+     * @param message 要发送的消息
+     * @return 序列化失败返回INVALID_PARAMETER；触发发送时返回发送结果
+     */
+    ErrorCode add(const Message& message);
+    
+    /**
+     * @brief 立即发出已合并的消息
+     */
+    ErrorCode flush();
+    
+    /**
+     * @brief 等待时间已到时发出已合并的消息（未启动后台线程时由调用方周期调用）
+     */
+    ErrorCode flush_if_due(clock_t::time_point now = clock_t::now());
+    
+    /**
+     * @brief 启动后台线程，按flush_delay自动发出
+     */
+    void start();
+    
+    /**
+     * @brief 停止后台线程并发出剩余的消息
+     */
+    void stop();
+    
+    /**
+     * @brief 尚未发出的消息数
+     */
+    size_t pending_messages() const;
+    
+    Statistics get_statistics() const;
+    
+    const CoalescingConfig& get_config() const { return config_; }
+
+private:
+    CoalescingConfig config_;
+    MessageProtocol& protocol_;
+    DatagramSink sink_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable armed_;
+    buffer_t buffer_;                // 容器头 + 已合并的消息帧
+    buffer_t scratch_;               // 单条消息的序列化缓冲区
+    size_t used_;                    // 容器负载已用字节
+    size_t count_;                   // 已合并的消息数
+    Priority priority_;              // 已合并消息的最高优先级
+    clock_t::time_point deadline_;
+    Statistics stats_;
+    
+    std::thread flusher_;
+    bool running_;
+    
+    ErrorCode flush_locked();
+    void flusher_loop();
+};
+
+} // namespace udp2docker
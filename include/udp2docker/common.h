@@ -24,11 +24,32 @@ using buffer_t = std::vector<byte>;
 using string_t = std::string;
 using time_point_t = std::chrono::system_clock::time_point;
 
+#ifdef _WIN32
+using socket_handle_t = SOCKET;
+#else
+using socket_handle_t = int;
+#endif
+
 // 常量定义
 constexpr int DEFAULT_PORT = 8888;
 constexpr size_t MAX_BUFFER_SIZE = 65536;
 constexpr int DEFAULT_TIMEOUT_MS = 5000;
 constexpr const char* DEFAULT_HOST = "127.0.0.1";
+constexpr size_t MAX_GATHER_PARTS = 16;
+
+// 只读字节视图（C++17下std::span<const byte>的轻量替代）
+struct BufferView {
+    const byte* data = nullptr;
+    size_t size = 0;
+    
+    BufferView() = default;
+    BufferView(const byte* d, size_t s) : data(d), size(s) {}
+    BufferView(const buffer_t& buffer) : data(buffer.data()), size(buffer.size()) {}
+    
+    bool empty() const { return size == 0; }
+    const byte* begin() const { return data; }
+    const byte* end() const { return data + size; }
+};
 
 // 错误码定义
 enum class ErrorCode {
@@ -41,7 +62,8 @@ enum class ErrorCode {
     INVALID_ADDRESS,
     TIMEOUT,
     INVALID_PARAMETER,
-    PROTOCOL_ERROR
+    PROTOCOL_ERROR,
+    QUEUE_FULL
 };
 
 // 消息类型定义
@@ -50,7 +72,8 @@ enum class MessageType {
     DATA = 2,
     CONTROL = 3,
     RESPONSE = 4,
-    MESSAGE_ERROR = 5
+    MESSAGE_ERROR = 5,
+    BATCH = 6               // 容器帧，负载是多个首尾相接的完整消息帧
 };
 
 // 消息优先级
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <memory>
+
+namespace udp2docker {
+
+// 负载压缩算法，取值写入消息头标志位的低4位
+enum class CompressionType : uint8_t {
+    NONE = 0,
+    LZ4 = 1,     // 低延迟，内置LZ4块格式实现
+    ZSTD = 2     // 高压缩率，需要编译时找到libzstd
+};
+
+constexpr size_t COMPRESSION_TYPE_COUNT = 3;
+
+/**
+ * @brief 压缩编解码器接口
+ *
+ * 编解码器只处理原始块数据，原始长度等帧信息由MessageProtocol负责。
+ * 同一个编解码器对象可以被多个线程同时使用，内部工作状态按线程缓存。
+ */
+class Codec {
+public:
+    virtual ~Codec() = default;
+    
+    /**
+     * @brief 获取压缩算法类型
+     */
+    virtual CompressionType type() const = 0;
+    
+    /**
+     * @brief 获取压缩算法名称
+     */
+    virtual const char* name() const = 0;
+    
+    /**
+     * @brief 压缩数据
+     * @param input 输入数据
+     * @param input_size 输入长度
+     * @param output 输出缓冲区
+     * @param output_capacity 输出缓冲区容量
+     * @return 压缩后的长度，输出缓冲区放不下（数据不可压缩）返回INVALID_PARAMETER
+     */
+    virtual Result<size_t> compress(const byte* input, size_t input_size,
+                                    byte* output, size_t output_capacity) = 0;
+    
+    /**
+     * @brief 解压缩数据
+     * @param input 压缩数据
+     * @param input_size 压缩数据长度
+     * @param output 输出缓冲区
+     * @param output_capacity 输出缓冲区容量（即原始长度）
+     * @return 解压后的长度，数据损坏返回PROTOCOL_ERROR
+     */
+    virtual Result<size_t> decompress(const byte* input, size_t input_size,
+                                      byte* output, size_t output_capacity) = 0;
+    
+    /**
+     * @brief 设置字典（收发双方必须使用相同的字典）
+     *
+     * 对大量短小、重复的消息，字典能显著提高压缩率。
+     *
+     * @param dictionary 字典内容，为空表示不使用字典
+     * @return 设置结果
+     */
+    virtual ErrorCode set_dictionary(const buffer_t& dictionary) = 0;
+};
+
+/**
+ * @brief 创建编解码器
+ * @param type 压缩算法
+ * @param level 压缩级别（0表示算法默认值，LZ4忽略该参数）
+ * @return 编解码器，算法不可用返回nullptr
+ */
+std::unique_ptr<Codec> create_codec(CompressionType type, int level = 0);
+
+/**
+ * @brief 检查压缩算法在当前构建中是否可用
+ */
+bool is_codec_available(CompressionType type);
+
+/**
+ * @brief 从样本消息训练字典（仅zstd可用）
+ * @param samples 样本消息
+ * @param dictionary_size 字典最大长度
+ * @return 字典内容，不支持或样本不足返回错误
+ */
+Result<buffer_t> train_compression_dictionary(const std::vector<buffer_t>& samples,
+                                              size_t dictionary_size = 16 * 1024);
+
+// 辅助函数
+string_t compression_type_to_string(CompressionType type);
+
+} // namespace udp2docker
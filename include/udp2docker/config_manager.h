@@ -1,10 +1,14 @@
 #pragma once
 
 #include "common.h"
+#include <atomic>
 #include <map>
+#include <memory>
 #include <optional>
 #include <functional>
 #include <mutex>
+#include <type_traits>
+#include <unordered_map>
 
 namespace udp2docker {
 
@@ -36,8 +40,151 @@ struct ConfigItem {
     std::vector<string_t> as_list() const;
 };
 
+/**
+ * @brief 预先解析好的配置值
+ */
+struct ConfigValue {
+    ConfigItem item;
+    int int_value = 0;
+    bool bool_value = false;
+    double double_value = 0.0;
+    
+    ConfigValue() = default;
+    explicit ConfigValue(const ConfigItem& source)
+        : item(source)
+        , int_value(source.as_int())
+        , bool_value(source.as_bool())
+        , double_value(source.as_double()) {}
+};
+
+/**
+ * @brief 不可变的配置快照
+ *
+ * 每次修改配置（set、reload等）都会生成新的快照并原子地替换当前快照。
+ * 读取方持有快照的shared_ptr，期间看到的是同一版本的完整配置，
+ * 旧快照在最后一个读取方释放后回收。数值在生成快照时解析，读取时不再解析。
+ */
+class ConfigSnapshot {
+public:
+    /**
+     * @brief 查找配置值
+     * @return 不存在返回nullptr，指针在快照存活期间有效
+     */
+    const ConfigValue* find(const string_t& key) const {
+        auto it = values_.find(key);
+        return it != values_.end() ? &it->second : nullptr;
+    }
+    
+    bool has(const string_t& key) const { return values_.count(key) != 0; }
+    
+    string_t get_string(const string_t& key, const string_t& default_value = "") const {
+        const ConfigValue* value = find(key);
+        return value ? value->item.value : default_value;
+    }
+    
+    int get_int(const string_t& key, int default_value = 0) const {
+        const ConfigValue* value = find(key);
+        return value ? value->int_value : default_value;
+    }
+    
+    bool get_bool(const string_t& key, bool default_value = false) const {
+        const ConfigValue* value = find(key);
+        return value ? value->bool_value : default_value;
+    }
+    
+    double get_double(const string_t& key, double default_value = 0.0) const {
+        const ConfigValue* value = find(key);
+        return value ? value->double_value : default_value;
+    }
+    
+    size_t size() const { return values_.size(); }
+    
+    /**
+     * @brief 快照版本号，每次发布递增
+     */
+    uint64_t version() const { return version_; }
+
+private:
+    friend class ConfigManager;
+    
+    std::unordered_map<string_t, ConfigValue> values_;
+    uint64_t version_ = 0;
+};
+
+/**
+ * @brief 单个配置键的已解析值，发布快照时更新，供ConfigHandle无锁读取
+ */
+struct ConfigCell {
+    std::atomic<bool> present{false};
+    std::atomic<int> int_value{0};
+    std::atomic<bool> bool_value{false};
+    std::atomic<double> double_value{0.0};
+    
+    void store(const ConfigValue* value) {
+        if (!value) {
+            present.store(false, std::memory_order_release);
+            return;
+        }
+        int_value.store(value->int_value, std::memory_order_relaxed);
+        bool_value.store(value->bool_value, std::memory_order_relaxed);
+        double_value.store(value->double_value, std::memory_order_relaxed);
+        present.store(true, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief 类型化的配置句柄
+ *
+ * 由ConfigManager::int_handle()等方法解析一次键名，之后每次读取只是
+ * 一次原子加载，不加锁、不查表、不解析。配置修改后立即可见。
+ * 句柄不能比创建它的ConfigManager活得更久。
+ *
+ * @tparam T int、bool或double
+ */
+template<typename T>
+class ConfigHandle {
+    static_assert(std::is_same<T, int>::value || std::is_same<T, bool>::value || std::is_same<T, double>::value,
+                  "ConfigHandle supports int, bool and double");
+
+public:
+    ConfigHandle() = default;
+    
+    /**
+     * @brief 读取当前值，配置项不存在时返回默认值
+     */
+    T get() const {
+        if (!cell_ || !cell_->present.load(std::memory_order_acquire)) {
+            return default_value_;
+        }
+        if constexpr (std::is_same<T, int>::value) {
+            return cell_->int_value.load(std::memory_order_relaxed);
+        } else if constexpr (std::is_same<T, bool>::value) {
+            return cell_->bool_value.load(std::memory_order_relaxed);
+        } else {
+            return cell_->double_value.load(std::memory_order_relaxed);
+        }
+    }
+    
+    T operator*() const { return get(); }
+    
+    /**
+     * @brief 配置项当前是否存在
+     */
+    bool has_value() const { return cell_ && cell_->present.load(std::memory_order_acquire); }
+
+private:
+    friend class ConfigManager;
+    
+    ConfigHandle(const ConfigCell* cell, T default_value) : cell_(cell), default_value_(default_value) {}
+    
+    const ConfigCell* cell_ = nullptr;
+    T default_value_{};
+};
+
 // 配置变更回调
 using ConfigChangeCallback = std::function<void(const string_t& key, const ConfigItem& old_value, const ConfigItem& new_value)>;
+// 变更订阅标识，0表示无效
+using ConfigSubscription = uint64_t;
 
 /**
  * @brief 配置管理器类，负责应用程序配置的读取、存储和管理
@@ -48,6 +195,9 @@ using ConfigChangeCallback = std::function<void(const string_t& key, const Confi
  * - 配置验证和类型转换
  * - 配置变更通知
  * - 支持多种配置文件格式（JSON、INI、YAML）
+ *
+ * 修改都在config_mutex_下进行并发布新的ConfigSnapshot；get_*系列读取当前快照，
+ * 不获取config_mutex_。热路径上应使用int_handle()等创建的句柄。
  */
 class ConfigManager {
 public:
@@ -64,6 +214,12 @@ public:
     
     /**
      * @brief 加载配置文件
+     * 
+     * 当前配置由以编程方式设置的配置项（默认值、set()、环境变量、import_config()）
+     * 和文件内容组成，同一键以文件为准。重新加载时用新文件内容替换上次文件的内容，
+     * 从文件中删除的键恢复为编程设置的值或被移除，并通知订阅者。
+     * 文件不存在时保持当前配置，解析失败时返回错误且不修改配置。
+     * 
      * @param config_file 配置文件路径
      * @return 加载结果
      */
@@ -208,6 +364,24 @@ public:
      */
     void unregister_change_callback();
     
+    /**
+     * @brief 订阅配置变更，可以有多个订阅者
+     *
+     * set()以及load_config()/reload()/import_config()/load_from_environment()
+     * 改变了某个键的值时，回调在新快照发布之后、不持有内部锁时依次调用，
+     * 回调中可以读写配置。
+     *
+     * @param callback 回调函数
+     * @return 订阅标识
+     */
+    ConfigSubscription subscribe(ConfigChangeCallback callback);
+    
+    /**
+     * @brief 取消订阅（不等待正在执行的回调返回）
+     * @param id subscribe()返回的标识
+     */
+    void unsubscribe(ConfigSubscription id);
+    
     /**
      * @brief 设置默认配置
      */
@@ -239,21 +413,74 @@ public:
      * @return 导入结果
      */
     ErrorCode import_config(const string_t& config_str, const string_t& format = "json");
+    
+    /**
+     * @brief 获取当前配置快照（不加锁）
+     * @return 当前快照，持有期间内容不变
+     */
+    std::shared_ptr<const ConfigSnapshot> snapshot() const;
+    
+    /**
+     * @brief 创建整数配置句柄
+     * @param key 配置键，可以尚不存在
+     * @param default_value 配置项不存在时的值
+     */
+    ConfigHandle<int> int_handle(const string_t& key, int default_value = 0);
+    
+    /**
+     * @brief 创建布尔配置句柄
+     */
+    ConfigHandle<bool> bool_handle(const string_t& key, bool default_value = false);
+    
+    /**
+     * @brief 创建浮点数配置句柄
+     */
+    ConfigHandle<double> double_handle(const string_t& key, double default_value = 0.0);
 
 private:
     string_t config_file_;
-    std::map<string_t, ConfigItem> config_items_;
+    std::map<string_t, ConfigItem> config_items_;    // 当前配置：overlay_items_叠加file_items_
+    std::map<string_t, ConfigItem> overlay_items_;   // 以编程方式设置的配置项
+    std::map<string_t, ConfigItem> file_items_;      // 最近一次加载的配置文件内容
     mutable std::mutex config_mutex_;
     ConfigChangeCallback change_callback_;
     
+    // 当前快照，通过std::atomic_load/atomic_store读写；以下成员由config_mutex_保护
+    std::shared_ptr<const ConfigSnapshot> snapshot_;
+    uint64_t snapshot_version_;
+    std::unordered_map<string_t, std::unique_ptr<ConfigCell>> cells_;
+    
+    struct Change {
+        string_t key;
+        ConfigItem old_value;
+        ConfigItem new_value;
+    };
+    
+    std::mutex subscribers_mutex_;
+    std::vector<std::pair<ConfigSubscription, ConfigChangeCallback>> subscribers_;
+    ConfigSubscription next_subscription_;
+    
+    /**
+     * @brief 由config_items_生成新快照并发布，同时更新句柄（需持有config_mutex_）
+     */
+    void publish_locked();
+    
+    ConfigCell* cell_locked(const string_t& key);
+    
     // 私有方法
-    ErrorCode load_json_config(const string_t& file_path);
-    ErrorCode load_ini_config(const string_t& file_path);
+    ErrorCode load_json_config(const string_t& file_path, std::map<string_t, ConfigItem>& items) const;
+    ErrorCode load_ini_config(const string_t& file_path, std::map<string_t, ConfigItem>& items) const;
     ErrorCode save_json_config(const string_t& file_path) const;
     ErrorCode save_ini_config(const string_t& file_path) const;
     
     string_t get_file_extension(const string_t& file_path) const;
     void notify_change(const string_t& key, const ConfigItem& old_value, const ConfigItem& new_value);
+    void notify_changes(const std::vector<Change>& changes);
+    
+    /**
+     * @brief 比较修改前后的配置，列出值发生变化的键（需持有config_mutex_）
+     */
+    std::vector<Change> diff_locked(const std::map<string_t, ConfigItem>& before) const;
     
     // JSON解析辅助方法
     std::optional<std::map<string_t, ConfigItem>> parse_json(const string_t& json_str) const;
@@ -273,6 +500,7 @@ public:
     
 private:
     static std::unique_ptr<ConfigManager> instance_;
+    static std::atomic<ConfigManager*> current_;   // 已创建时instance()直接返回，不加锁
     static std::mutex instance_mutex_;
 };
 
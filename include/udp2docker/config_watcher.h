@@ -0,0 +1,129 @@
+#pragma once
+
+#include "common.h"
+#include "config_manager.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace udp2docker {
+
+class UdpClient;
+class Logger;
+
+// 重新加载完成后的通知
+using ConfigReloadCallback = std::function<void(ErrorCode result)>;
+
+/**
+ * @brief 配置文件监视器
+ *
+ * 监视ConfigManager的配置文件所在目录（Linux下为inotify，Windows下为
+ * ReadDirectoryChangesW，其他平台按修改时间轮询），文件被写入、替换或
+ * 重新挂载（例如Kubernetes ConfigMap的..data符号链接切换）后，等待debounce
+ * 时间内不再有新的变化再调用ConfigManager::reload()，编辑器一次保存产生的
+ * 多个事件只触发一次加载。
+ *
+ * 加载在监视线程中进行，变化的键通过ConfigManager的订阅者分发；attach()把
+ * UdpClient和Logger登记为订阅者，对应配置变化时在线生效。
+ */
+class ConfigWatcher {
+public:
+    /**
+     * @brief 构造函数
+     * @param config 被监视的配置管理器，需已设置配置文件路径，生命周期需长于本对象
+     * @param debounce 最后一次文件事件之后等待的时间
+     */
+    explicit ConfigWatcher(ConfigManager& config,
+                           std::chrono::milliseconds debounce = std::chrono::milliseconds(200));
+    
+    /**
+     * @brief 析构函数，停止监视并取消attach()登记的订阅
+     */
+    ~ConfigWatcher();
+    
+    // 禁用拷贝构造和赋值
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+    
+    /**
+     * @brief 开始监视
+     * @return 没有配置文件路径返回INVALID_PARAMETER，无法建立监视返回SOCKET_INIT_FAILED
+     */
+    ErrorCode start();
+    
+    /**
+     * @brief 停止监视，等待监视线程退出
+     */
+    void stop();
+    
+    bool is_running() const { return running_; }
+    
+    /**
+     * @brief 设置每次重新加载后的回调（在监视线程中调用）
+     */
+    void set_reload_callback(ConfigReloadCallback callback);
+    
+    /**
+     * @brief server.host/server.port和client.*超时、重试、心跳配置变化时调用UdpClient::update_config
+     *
+     * 只有这些设置真正改变时才更新，超时变化只调整套接字选项，不重建套接字。
+     *
+     * @param client UDP客户端，生命周期需长于本对象
+     */
+    void attach(UdpClient& client);
+    
+    /**
+     * @brief log.level变化时调用Logger::set_level
+     *
+     * LOG_*宏使用LoggerManager::get_logger()返回的默认日志器。
+     *
+     * @param logger 日志器，生命周期需长于本对象
+     */
+    void attach(Logger& logger);
+    
+    /**
+     * @brief 已完成的重新加载次数
+     */
+    uint64_t reload_count() const { return reload_count_.load(); }
+
+private:
+    ConfigManager& config_;
+    std::chrono::milliseconds debounce_;
+    string_t directory_;
+    string_t file_name_;
+    
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::atomic<uint64_t> reload_count_;
+    
+    std::mutex callback_mutex_;
+    ConfigReloadCallback reload_callback_;
+    std::vector<ConfigSubscription> subscriptions_;
+
+#ifdef _WIN32
+    void* directory_handle_;
+    void* stop_event_;
+#elif defined(__linux__)
+    int inotify_fd_;
+    int wakeup_fd_;
+#else
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+#endif
+    
+    // 私有方法
+    ErrorCode open_watch();
+    void close_watch();
+    void watch_loop();
+    void reload();
+    
+    /**
+     * @brief 目录事件中的文件名是否与配置文件相关
+     */
+    bool is_relevant(const string_t& name) const;
+};
+
+} // namespace udp2docker
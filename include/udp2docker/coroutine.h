@@ -0,0 +1,354 @@
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "udp2docker/coroutine.h requires C++20 coroutines (configure with -DUDP2DOCKER_WITH_COROUTINES=ON)"
+#endif
+
+#include "common.h"
+#include "endpoint.h"
+#include "event_loop.h"
+#include "message_protocol.h"
+#include "udp_client.h"
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace udp2docker {
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+// Task结束时恢复等待它的协程（对称转移，不增加调用栈深度）
+struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+        std::coroutine_handle<> next = handle.promise().continuation;
+        return next ? next : std::noop_coroutine();
+    }
+    
+    void await_resume() noexcept {}
+};
+
+// Task的promise公共部分
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+    
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+    
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+    
+    T take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    
+    void take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief 惰性启动的协程任务
+ *
+ * 创建后不执行，被co_await时才开始运行，结束后恢复等待方。
+ * 只能移动，析构时销毁协程帧。顶层任务用AsyncClient::spawn()启动。
+ *
+ * @tparam T 结果类型
+ */
+template<typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+    
+    Task() noexcept = default;
+    explicit Task(handle_type handle) noexcept : handle_(handle) {}
+    
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+    
+    bool valid() const { return static_cast<bool>(handle_); }
+    bool done() const { return !handle_ || handle_.done(); }
+    
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            handle_type handle;
+            
+            bool await_ready() noexcept { return !handle || handle.done(); }
+            
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            
+            T await_resume() { return handle.promise().take(); }
+        };
+        return Awaiter{handle_};
+    }
+    
+    auto operator co_await() & noexcept { return std::move(*this).operator co_await(); }
+
+private:
+    handle_type handle_;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/**
+ * @brief 协程收到的消息
+ */
+struct ReceivedMessage {
+    Message message;
+    Endpoint from;
+};
+
+/**
+ * @brief 基于协程的异步客户端
+ *
+ * 接管UdpClient的异步接收，所有协程都在UdpClient的事件循环线程上运行和恢复，不创建额外的线程；
+ * 挂起的协程只占用自己的协程帧，等待状态保存在帧内的awaiter中。
+ *
+ * - co_await send(message)：序列化后立即发送（UDP发送不会长时间阻塞），返回发送结果；
+ * - co_await receive(timeout)：取下一条消息，没有时挂起直到收到或超时；
+ * - co_await request(message, timeout)：发送后等待RESPONSE，按元数据response_to与请求的
+ *   sequence_id匹配（MessageProtocol::create_response_message的格式），超时返回TIMEOUT。
+ *   匹配到请求的RESPONSE不会再交给receive()。
+ *
+ * 非线程安全：除构造、start()、spawn()和close()外，所有方法只能在事件循环线程中调用，
+ * 也就是在spawn()启动的协程里使用。
+ */
+class AsyncClient {
+public:
+    /**
+     * @brief 统计信息
+     */
+    struct Statistics {
+        uint64_t received = 0;             // 收到的消息（含响应）
+        uint64_t responses = 0;            // 匹配到请求的响应
+        uint64_t timeouts = 0;             // 超时的请求和接收
+        uint64_t dropped = 0;              // 没有协程等待、收件队列已满而丢弃的消息
+        uint64_t invalid = 0;              // 无法解析的数据报
+    };
+    
+    // 等待中的协程，保存在挂起协程帧内的awaiter中
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        Result<ReceivedMessage> result{ErrorCode::TIMEOUT};
+        TimerId timer = 0;
+        uint32_t sequence_id = 0;
+    };
+    
+    /**
+     * @brief co_await send()的结果，总是立即就绪
+     */
+    struct SendAwaiter {
+        ErrorCode result;
+        
+        bool await_ready() const noexcept { return true; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        ErrorCode await_resume() const noexcept { return result; }
+    };
+    
+    /**
+     * @brief co_await receive()
+     */
+    class ReceiveAwaiter {
+    public:
+        ReceiveAwaiter(AsyncClient& client, std::chrono::milliseconds timeout)
+            : client_(client), timeout_(timeout) {}
+        
+        bool await_ready() { return client_.take_queued(waiter_); }
+        void await_suspend(std::coroutine_handle<> handle) { client_.wait_receive(waiter_, handle, timeout_); }
+        Result<ReceivedMessage> await_resume() { return std::move(waiter_.result); }
+    
+    private:
+        AsyncClient& client_;
+        std::chrono::milliseconds timeout_;
+        Waiter waiter_;
+    };
+    
+    /**
+     * @brief co_await request()
+     */
+    class RequestAwaiter {
+    public:
+        RequestAwaiter(AsyncClient& client, ErrorCode sent, uint32_t sequence_id, std::chrono::milliseconds timeout)
+            : client_(client), sent_(sent), timeout_(timeout) {
+            waiter_.sequence_id = sequence_id;
+            if (sent != ErrorCode::SUCCESS) {
+                waiter_.result = Result<ReceivedMessage>(sent);
+            }
+        }
+        
+        bool await_ready() const noexcept { return sent_ != ErrorCode::SUCCESS; }
+        void await_suspend(std::coroutine_handle<> handle) { client_.wait_response(waiter_, handle, timeout_); }
+        Result<ReceivedMessage> await_resume() { return std::move(waiter_.result); }
+    
+    private:
+        AsyncClient& client_;
+        ErrorCode sent_;
+        std::chrono::milliseconds timeout_;
+        Waiter waiter_;
+    };
+    
+    /**
+     * @brief 构造函数
+     * @param client UDP客户端，需已初始化且尚未启动异步接收，生命周期需长于本对象
+     * @param loop 运行协程的事件循环；为空时创建并在start()中启动一个私有的事件循环
+     * @param inbox_capacity 没有协程等待时缓存的消息数上限
+     */
+    explicit AsyncClient(UdpClient& client, std::shared_ptr<EventLoop> loop = nullptr,
+                         size_t inbox_capacity = 1024);
+    
+    /**
+     * @brief 析构函数，调用close()
+     */
+    ~AsyncClient();
+    
+    // 禁用拷贝构造和赋值
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+    
+    /**
+     * @brief 开始接收并启动私有的事件循环
+     */
+    ErrorCode start();
+    
+    /**
+     * @brief 停止接收，仍在等待的协程以SOCKET_RECEIVE_FAILED恢复（在事件循环线程中，
+     *        事件循环已停止时在调用线程中），之后的receive()/request()立即返回该错误
+     */
+    void close();
+    
+    /**
+     * @brief 在事件循环线程中启动一个顶层协程，不等待其结束；协程抛出的异常记录日志后丢弃
+     */
+    void spawn(Task<void> task);
+    
+    /**
+     * @brief 发送消息到默认服务器（序列化到池化缓冲区后同步发送）
+     */
+    SendAwaiter send(const Message& message);
+    
+    /**
+     * @brief 发送消息到指定端点
+     */
+    SendAwaiter send(const Message& message, const Endpoint& to);
+    
+    /**
+     * @brief 接收下一条消息
+     * @param timeout 等待时间，0表示一直等待
+     */
+    ReceiveAwaiter receive(std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+        return ReceiveAwaiter(*this, timeout);
+    }
+    
+    /**
+     * @brief 发送请求并等待对应的RESPONSE
+     * @param message 请求消息，sequence_id为0时分配一个新的序列号
+     * @param timeout 等待响应的时间，0表示一直等待
+     * @param to 目标端点，无效时发送到默认服务器
+     * @return 响应消息；发送失败返回发送的错误码，同一序列号已有请求在等待返回INVALID_PARAMETER
+     */
+    RequestAwaiter request(Message message, std::chrono::milliseconds timeout, const Endpoint& to = Endpoint());
+    
+    /**
+     * @brief 序列化/反序列化使用的协议对象（压缩、加密等在start()之前设置）
+     */
+    MessageProtocol& protocol() { return protocol_; }
+    
+    EventLoop& event_loop() { return *loop_; }
+    
+    size_t pending_requests() const { return requests_.size(); }
+    size_t queued_messages() const { return inbox_.size(); }
+    Statistics get_statistics() const { return stats_; }
+
+private:
+    UdpClient& client_;
+    std::shared_ptr<EventLoop> loop_;
+    bool owns_loop_;
+    bool started_;
+    bool closed_;
+    size_t inbox_capacity_;
+    MessageProtocol protocol_;
+    
+    std::deque<ReceivedMessage> inbox_;                   // 没有协程等待时收到的消息
+    std::deque<Waiter*> receivers_;                       // 等待receive()的协程，先来先得
+    std::unordered_map<uint32_t, Waiter*> requests_;      // 等待响应的请求，按sequence_id索引
+    std::vector<std::coroutine_handle<>> ready_;          // 本批数据包处理完后要恢复的协程
+    Statistics stats_;
+    
+    ErrorCode send_message(const Message& message, const Endpoint& to);
+    bool take_queued(Waiter& waiter);
+    void wait_receive(Waiter& waiter, std::coroutine_handle<> handle, std::chrono::milliseconds timeout);
+    void wait_response(Waiter& waiter, std::coroutine_handle<> handle, std::chrono::milliseconds timeout);
+    void expire_receive(Waiter* waiter);
+    void expire_request(uint32_t sequence_id);
+    void on_packet(const PacketView& packet);
+    void deliver(const MessageView& view, const Endpoint& from);
+    void complete(Waiter& waiter, Result<ReceivedMessage> result);
+    void resume_ready();
+    void fail_all();
+};
+
+} // namespace udp2docker
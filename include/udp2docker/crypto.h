@@ -0,0 +1,123 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <memory>
+
+// OpenSSL上下文前置声明，避免在公共头文件中引入OpenSSL
+struct evp_cipher_ctx_st;
+
+namespace udp2docker {
+
+// AEAD加密算法，取值写入消息头标志位的4-7位
+enum class CipherType : uint8_t {
+    NONE = 0,
+    AES_256_GCM = 1,          // 有AES-NI/ARMv8 Crypto扩展时首选
+    CHACHA20_POLY1305 = 2     // 无AES硬件加速的平台上更快
+};
+
+constexpr size_t AEAD_KEY_SIZE = 32;
+constexpr size_t AEAD_NONCE_SIZE = 12;
+constexpr size_t AEAD_TAG_SIZE = 16;
+
+/**
+ * @brief AEAD认证加密
+ *
+ * 基于OpenSSL EVP接口，由OpenSSL根据CPU选择AES-NI、ARMv8 Crypto等硬件加速实现。
+ * 密钥扩展在创建时完成一次，之后每条消息只需设置新的nonce。
+ * 加解密均支持原地操作（输入输出可以指向同一缓冲区）。
+ *
+ * 该类不是线程安全的，每个线程应使用独立的实例。
+ */
+class AeadCipher {
+public:
+    /**
+     * @brief 创建AEAD实例
+     * @param type 加密算法
+     * @param key 密钥（AEAD_KEY_SIZE字节）
+     * @return AEAD实例，算法不可用返回nullptr
+     */
+    static std::unique_ptr<AeadCipher> create(CipherType type, const byte* key);
+    
+    ~AeadCipher();
+    
+    // 禁用拷贝构造和赋值
+    AeadCipher(const AeadCipher&) = delete;
+    AeadCipher& operator=(const AeadCipher&) = delete;
+    
+    CipherType type() const { return type_; }
+    
+    /**
+     * @brief 加密并计算认证标签
+     * @param nonce nonce（AEAD_NONCE_SIZE字节，同一密钥下不得重复）
+     * @param aad 附加认证数据（只认证不加密）
+     * @param plaintext 明文
+     * @param ciphertext 密文输出，长度与明文相同
+     * @param tag 认证标签输出（AEAD_TAG_SIZE字节）
+     * @return 成功返回true
+     */
+    bool seal(const byte* nonce, BufferView aad, BufferView plaintext, byte* ciphertext, byte* tag);
+    
+    /**
+     * @brief 加密分散在多个片段中的明文
+     * 
+     * 结果与对拼接后的明文调用seal()相同，密文连续写入ciphertext。
+     * 
+     * @param nonce nonce
+     * @param aad 附加认证数据
+     * @param parts 明文片段
+     * @param count 片段数量
+     * @param ciphertext 密文输出，长度为各片段长度之和
+     * @param tag 认证标签输出
+     * @return 成功返回true
+     */
+    bool seal(const byte* nonce, BufferView aad, const BufferView* parts, size_t count,
+              byte* ciphertext, byte* tag);
+    
+    /**
+     * @brief 校验认证标签并解密
+     * @param nonce nonce
+     * @param aad 附加认证数据
+     * @param ciphertext 密文
+     * @param tag 认证标签
+     * @param plaintext 明文输出，长度与密文相同
+     * @return 认证失败或解密失败返回false
+     */
+    bool open(const byte* nonce, BufferView aad, BufferView ciphertext, const byte* tag, byte* plaintext);
+
+private:
+    AeadCipher(CipherType type, evp_cipher_ctx_st* encrypt_ctx, evp_cipher_ctx_st* decrypt_ctx);
+    
+    CipherType type_;
+    evp_cipher_ctx_st* encrypt_ctx_;
+    evp_cipher_ctx_st* decrypt_ctx_;
+};
+
+/**
+ * @brief 检查加密算法在当前构建中是否可用
+ */
+bool is_cipher_available(CipherType type);
+
+/**
+ * @brief 从口令派生AEAD密钥（PBKDF2-HMAC-SHA256）
+ *
+ * 派生较慢，应只在设置密钥时调用一次。
+ *
+ * @param passphrase 口令
+ * @param key 密钥输出（AEAD_KEY_SIZE字节）
+ * @return 派生结果
+ */
+ErrorCode derive_encryption_key(const string_t& passphrase, byte* key);
+
+/**
+ * @brief 生成密码学安全的随机数
+ * @param out 输出缓冲区
+ * @param size 字节数
+ * @return 成功返回true
+ */
+bool secure_random_bytes(byte* out, size_t size);
+
+// 辅助函数
+string_t cipher_type_to_string(CipherType type);
+
+} // namespace udp2docker
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+
+namespace udp2docker {
+
+/**
+ * @brief IPv4/IPv6套接字端点（地址+端口）
+ *
+ * 以紧凑的二进制形式保存（24字节），拷贝和比较都不涉及字符串，
+ * 接收路径上每个数据包的来源用它表示，只有调用host()/to_string()时才格式化。
+ * 双栈套接字上收到的IPv4映射地址（::ffff:a.b.c.d）统一还原为IPv4端点。
+ */
+class Endpoint {
+public:
+    Endpoint() = default;
+    
+    /**
+     * @brief 从套接字地址构造
+     * @param addr 套接字地址（sockaddr_in或sockaddr_in6）
+     * @param length 地址长度
+     * @return 端点，地址族不支持时返回无效端点
+     */
+    static Endpoint from_sockaddr(const sockaddr* addr, size_t length);
+    
+    /**
+     * @brief 解析IP字面量（不做DNS解析）
+     * @param host IPv4或IPv6地址文本，IPv6可带方括号
+     * @param port 端口
+     * @return 端点，不是IP字面量返回空
+     */
+    static std::optional<Endpoint> parse(const string_t& host, int port);
+    
+    /**
+     * @brief 指定地址族的任意地址（0.0.0.0或::）
+     */
+    static Endpoint any(bool ipv6, int port);
+    
+    bool valid() const { return family_ != 0; }
+    bool is_ipv4() const { return family_ == 4; }
+    bool is_ipv6() const { return family_ == 6; }
+    
+    int port() const { return port_; }
+    uint32_t scope_id() const { return scope_id_; }
+    
+    /**
+     * @brief 端口替换为port的副本
+     */
+    Endpoint with_port(int port) const {
+        Endpoint result = *this;
+        result.port_ = static_cast<uint16_t>(port);
+        return result;
+    }
+    
+    /**
+     * @brief 地址的原始字节（IPv4为4字节，IPv6为16字节）
+     */
+    const byte* address() const { return address_; }
+    size_t address_size() const { return is_ipv4() ? 4 : (is_ipv6() ? 16 : 0); }
+    
+    /**
+     * @brief 格式化地址文本
+     */
+    string_t host() const;
+    
+    /**
+     * @brief 将地址文本写入out，复用out已有的容量
+     */
+    void format_host(string_t& out) const;
+    
+    /**
+     * @brief 格式化为"host:port"，IPv6地址带方括号
+     */
+    string_t to_string() const;
+    
+    /**
+     * @brief 转换为套接字地址
+     * @param out 输出
+     * @param socket_ipv6 目标套接字是否为AF_INET6；为true时IPv4端点写成IPv4映射地址
+     * @return 地址长度，端点无效或IPv6端点用于IPv4套接字时返回0
+     */
+    socklen_t to_sockaddr(sockaddr_storage& out, bool socket_ipv6) const;
+    
+    bool operator==(const Endpoint& other) const {
+        return family_ == other.family_ && port_ == other.port_ && scope_id_ == other.scope_id_ &&
+               std::memcmp(address_, other.address_, sizeof(address_)) == 0;
+    }
+    bool operator!=(const Endpoint& other) const { return !(*this == other); }
+    
+    size_t hash() const;
+
+private:
+    uint8_t family_ = 0;         // 0无效，4为IPv4，6为IPv6
+    uint16_t port_ = 0;          // 主机字节序
+    uint32_t scope_id_ = 0;      // IPv6链路本地地址的接口索引
+    byte address_[16] = {};      // IPv4只使用前4字节
+};
+
+} // namespace udp2docker
+
+namespace std {
+
+template<>
+struct hash<udp2docker::Endpoint> {
+    size_t operator()(const udp2docker::Endpoint& endpoint) const { return endpoint.hash(); }
+};
+
+} // namespace std
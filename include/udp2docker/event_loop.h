@@ -0,0 +1,182 @@
+#pragma once
+
+#include "common.h"
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <queue>
+
+namespace udp2docker {
+
+using IoHandler = std::function<void()>;
+using TimerTask = std::function<void()>;
+using TimerId = uint64_t;
+
+/**
+ * @brief 事件循环（Reactor），负责套接字可读事件和定时器的分发
+ *
+ * 该类提供了一个单线程的事件驱动模型：
+ * - Linux下使用epoll，BSD/macOS下使用kqueue，Windows下使用WSAPoll
+ * - 停止和投递任务通过eventfd/自管道唤醒，不依赖超时轮询
+ * - 一个事件循环线程可以同时服务多个UdpClient
+ * - 单次/周期定时器
+ *
+ * 所有回调都在事件循环线程中执行，回调中不应长时间阻塞。
+ */
+class EventLoop {
+public:
+    /**
+     * @brief 构造函数
+     */
+    EventLoop();
+    
+    /**
+     * @brief 析构函数，会停止正在运行的事件循环线程
+     */
+    ~EventLoop();
+    
+    // 禁用拷贝构造和赋值
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+    
+    /**
+     * @brief 检查事件循环是否创建成功
+     * @return 底层多路复用器可用返回true
+     */
+    bool is_valid() const;
+    
+    /**
+     * @brief 注册套接字可读事件
+     *
+     * 事件为水平触发，处理函数应读取到EAGAIN或自行限制单次处理量。
+     *
+     * @param socket 套接字
+     * @param handler 可读时调用的处理函数
+     * @return 注册结果
+     */
+    ErrorCode add_reader(socket_handle_t socket, IoHandler handler);
+    
+    /**
+     * @brief 注销套接字可读事件
+     *
+     * 从其他线程调用时，会等待正在执行的处理函数返回后才返回，
+     * 因此返回后可以安全地释放处理函数引用的对象。
+     *
+     * @param socket 套接字
+     */
+    void remove_reader(socket_handle_t socket);
+    
+    /**
+     * @brief 延迟执行一次任务
+     * @param delay 延迟时间
+     * @param task 任务
+     * @return 定时器ID
+     */
+    TimerId run_after(std::chrono::milliseconds delay, TimerTask task);
+    
+    /**
+     * @brief 周期执行任务
+     * @param interval 执行间隔
+     * @param task 任务
+     * @return 定时器ID
+     */
+    TimerId run_every(std::chrono::milliseconds interval, TimerTask task);
+    
+    /**
+     * @brief 取消定时器
+     *
+     * 与remove_reader相同，从其他线程调用时会等待正在执行的任务结束。
+     *
+     * @param id 定时器ID
+     */
+    void cancel_timer(TimerId id);
+    
+    /**
+     * @brief 投递任务到事件循环线程执行
+     * @param task 任务
+     */
+    void post(std::function<void()> task);
+    
+    /**
+     * @brief 在当前线程运行事件循环，直到stop()被调用
+     */
+    void run();
+    
+    /**
+     * @brief 启动后台线程运行事件循环
+     * @return 启动结果
+     */
+    ErrorCode start();
+    
+    /**
+     * @brief 设置start()启动的线程绑定的CPU
+     *
+     * 需在start()之前调用，仅Linux下生效，其他平台忽略。
+     *
+     * @param cpu CPU编号，-1表示不绑定
+     */
+    void set_cpu_affinity(int cpu) { cpu_affinity_ = cpu; }
+    
+    /**
+     * @brief 停止事件循环，如果由start()启动则等待线程退出
+     */
+    void stop();
+    
+    /**
+     * @brief 检查事件循环是否正在运行
+     */
+    bool is_running() const;
+    
+    /**
+     * @brief 检查当前线程是否为事件循环线程
+     */
+    bool in_loop_thread() const;
+
+private:
+    struct Timer {
+        std::chrono::milliseconds interval{0};
+        std::shared_ptr<TimerTask> task;
+    };
+    
+    using TimerEntry = std::pair<std::chrono::steady_clock::time_point, TimerId>;
+
+#ifdef _WIN32
+    SOCKET wakeup_socket_;
+#elif defined(__linux__)
+    int poll_fd_;
+    int wakeup_fd_;
+#else
+    int poll_fd_;
+    int wakeup_pipe_[2];
+#endif
+    
+    std::atomic<bool> running_;
+    std::atomic<bool> stop_requested_;
+    std::atomic<std::thread::id> loop_thread_id_;
+    std::thread thread_;
+    int cpu_affinity_;
+    
+    mutable std::mutex mutex_;
+    std::map<socket_handle_t, std::shared_ptr<IoHandler>> readers_;
+    std::map<TimerId, Timer> timers_;
+    std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timer_queue_;
+    std::vector<std::function<void()>> pending_tasks_;
+    TimerId next_timer_id_;
+    
+    // 私有方法
+    void run_loop();
+    void apply_cpu_affinity();
+    int poll_events(int timeout_ms, std::vector<socket_handle_t>& ready);
+    int next_timeout_ms();
+    void run_expired_timers();
+    void run_pending_tasks();
+    void wakeup();
+    void drain_wakeup();
+    void wait_for_loop();
+    TimerId add_timer(std::chrono::milliseconds delay, std::chrono::milliseconds interval, TimerTask task);
+};
+
+} // namespace udp2docker
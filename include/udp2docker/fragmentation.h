@@ -0,0 +1,248 @@
+#pragma once
+
+#include "common.h"
+#include "endpoint.h"
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+
+namespace udp2docker {
+
+// 分片头魔数，与消息头魔数（0x55AA55AA）区分
+constexpr uint32_t FRAGMENT_MAGIC = 0x55AA5AA5;
+constexpr size_t FRAGMENT_HEADER_SIZE = 24;
+// 默认路径MTU（以太网）
+constexpr size_t DEFAULT_PATH_MTU = 1500;
+// IP头和UDP头的开销，按IPv6（40字节）+UDP（8字节）计算，IPv4下留有余量
+constexpr size_t IP_UDP_OVERHEAD = 48;
+// 允许的最小路径MTU：IPv4主机必须能接收的576字节数据报。分片器不区分地址族，
+// IPv6链路MTU不小于1280，该下限对两种地址族都安全
+constexpr size_t MIN_PATH_MTU = 576;
+// 单个消息的最大分片数（分片下标为uint16）
+constexpr size_t MAX_FRAGMENT_COUNT = 65535;
+
+/**
+ * @brief 分片头结构（24字节）
+ *
+ * 每个分片数据报以分片头开始，后面是完整消息帧的一段字节。
+ * 接收方按来源端点和message_id归并分片，按offset写入重组缓冲区。
+ */
+struct FragmentHeader {
+    uint32_t magic_number = FRAGMENT_MAGIC;
+    uint16_t version = 1;
+    uint16_t flags = 0;            // 保留
+    uint32_t message_id = 0;       // 发送方内唯一的消息标识
+    uint16_t index = 0;            // 分片下标，从0开始
+    uint16_t count = 0;            // 分片总数
+    uint32_t offset = 0;           // 本分片在完整帧中的偏移
+    uint32_t total_size = 0;       // 完整帧的长度
+    
+    /**
+     * @brief 序列化到out（至少FRAGMENT_HEADER_SIZE字节）
+     */
+    void serialize_to(byte* out) const;
+    
+    /**
+     * @brief 从数据报开头解析分片头
+     * @param data 数据报
+     * @return 分片头，不是分片或长度不足返回空
+     */
+    static std::optional<FragmentHeader> parse(BufferView data);
+    
+    /**
+     * @brief 数据报是否以分片头开始
+     */
+    static bool is_fragment(BufferView data);
+};
+
+/**
+ * @brief 发送方分片器
+ *
+ * 把MessageProtocol序列化后的完整帧按路径MTU切分为等长分片（最后一个可以较短），
+ * 分片长度一致，可直接交给UdpClient::send_batch用sendmmsg/GSO一次发出。
+ * 不超过一个数据报的帧原样输出，不加分片头也不复制。
+ * 非线程安全，每个发送线程使用各自的实例。
+ */
+class Fragmenter {
+public:
+    explicit Fragmenter(size_t path_mtu = DEFAULT_PATH_MTU);
+    
+    /**
+     * @brief 设置路径MTU
+     * @param mtu IP层MTU（字节）
+     * @return 设置结果，小于MIN_PATH_MTU或大于MAX_BUFFER_SIZE返回INVALID_PARAMETER
+     */
+    ErrorCode set_path_mtu(size_t mtu);
+    
+    size_t get_path_mtu() const { return path_mtu_; }
+    
+    /**
+     * @brief 单个数据报的最大长度（MTU减去IP/UDP头）
+     */
+    size_t max_datagram_size() const { return path_mtu_ - IP_UDP_OVERHEAD; }
+    
+    /**
+     * @brief 每个分片携带的帧字节数
+     */
+    size_t max_fragment_payload() const { return max_datagram_size() - FRAGMENT_HEADER_SIZE; }
+    
+    /**
+     * @brief 可分片发送的最大帧长度
+     */
+    size_t max_frame_size() const { return max_fragment_payload() * MAX_FRAGMENT_COUNT; }
+    
+    /**
+     * @brief 帧是否需要分片
+     */
+    bool needs_fragmentation(size_t frame_size) const { return frame_size > max_datagram_size(); }
+    
+    /**
+     * @brief 切分一个完整帧
+     *
+     * 分片写入内部缓冲区，datagrams中的视图在下一次调用之前有效。
+     * 帧不需要分片时datagrams只包含指向frame本身的一个视图。
+     *
+     * @param frame 完整消息帧
+     * @param datagrams 输出的数据报视图（先清空）
+     * @return 切分结果，帧超过max_frame_size()返回INVALID_PARAMETER
+     */
+    ErrorCode fragment(BufferView frame, std::vector<BufferView>& datagrams);
+
+private:
+    size_t path_mtu_;
+    uint32_t next_message_id_;
+    buffer_t storage_;   // 分片的复用缓冲区，各分片首尾相接
+};
+
+/**
+ * @brief 重组表配置
+ */
+struct ReassemblyConfig {
+    size_t max_buffered_bytes = 64 * 1024 * 1024;   // 所有未完成消息占用的内存上限
+    size_t max_pending_messages = 1024;             // 同时重组的消息数上限
+    size_t max_message_size = 16 * 1024 * 1024;     // 单个消息（完整帧）的长度上限
+    int timeout_ms = 5000;                          // 从收到第一个分片起的重组超时
+};
+
+/**
+ * @brief 分片处理结果
+ */
+enum class ReassemblyResult {
+    NOT_FRAGMENT,   // 不是分片，按普通消息处理
+    PENDING,        // 已缓存，等待其余分片
+    COMPLETE,       // 消息已重组完成
+    DUPLICATE,      // 重复分片，已忽略
+    REJECTED        // 分片无效或超出内存限制
+};
+
+/**
+ * @brief 接收方分片重组表
+ *
+ * 以（来源端点, message_id）为键缓存未完成的消息，收到第一个分片时按total_size
+ * 一次性分配缓冲区，各分片按偏移直接写入，用位图记录已收到的下标。
+ * 内存受max_buffered_bytes和max_pending_messages约束，超出时淘汰最早开始的消息；
+ * 超过timeout_ms仍未完成的消息被丢弃，丢失一个分片只损失这一条消息。
+ * 非线程安全，每个接收线程（分片）使用各自的实例。
+ */
+class ReassemblyTable {
+public:
+    using clock_t = std::chrono::steady_clock;
+    
+    /**
+     * @brief 重组统计信息
+     */
+    struct Statistics {
+        uint64_t fragments_received = 0;
+        uint64_t messages_completed = 0;
+        uint64_t duplicates = 0;
+        uint64_t rejected = 0;
+        uint64_t expired = 0;           // 超时丢弃的消息数
+        uint64_t evicted = 0;           // 因内存限制淘汰的消息数
+        size_t pending_messages = 0;
+        size_t buffered_bytes = 0;
+    };
+    
+    explicit ReassemblyTable(const ReassemblyConfig& config = ReassemblyConfig());
+    
+    /**
+     * @brief 处理一个收到的数据报
+     *
+     * 返回COMPLETE时frame指向重组好的完整帧，可交给MessageProtocol::deserialize_view，
+     * 视图在下一次调用add()之前有效。
+     *
+     * @param datagram 收到的数据报
+     * @param from 来源端点
+     * @param frame 输出：完整帧
+     * @return 处理结果
+     */
+    ReassemblyResult add(BufferView datagram, const Endpoint& from, BufferView& frame) {
+        return add(datagram, from, frame, clock_t::now());
+    }
+    
+    /**
+     * @brief 处理一个收到的数据报（指定当前时间）
+     */
+    ReassemblyResult add(BufferView datagram, const Endpoint& from, BufferView& frame,
+                         clock_t::time_point now);
+    
+    /**
+     * @brief 丢弃已超时的消息
+     * @return 丢弃的消息数
+     */
+    size_t expire(clock_t::time_point now = clock_t::now());
+    
+    /**
+     * @brief 丢弃所有未完成的消息
+     */
+    void clear();
+    
+    Statistics get_statistics() const;
+    
+    const ReassemblyConfig& get_config() const { return config_; }
+
+private:
+    struct Key {
+        Endpoint from;
+        uint32_t message_id;
+        
+        bool operator==(const Key& other) const {
+            return message_id == other.message_id && from == other.from;
+        }
+    };
+    
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return key.from.hash() ^ (static_cast<size_t>(key.message_id) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+    
+    struct Entry {
+        buffer_t data;
+        std::vector<uint64_t> received;  // 已收到分片的位图
+        uint32_t total_size = 0;
+        uint16_t count = 0;
+        uint16_t received_count = 0;
+        size_t received_bytes = 0;
+        clock_t::time_point deadline;
+        std::list<Key>::iterator order;  // 在order_中的位置
+    };
+    
+    ReassemblyConfig config_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    std::list<Key> order_;               // 按开始时间排序，最早的在前
+    size_t buffered_bytes_;
+    buffer_t completed_;                 // 最近一次重组完成的帧
+    Statistics stats_;
+    
+    /**
+     * @brief 为新消息腾出空间
+     * @return 限制内放不下返回false
+     */
+    bool make_room(size_t bytes);
+    
+    void erase(std::unordered_map<Key, Entry, KeyHash>::iterator entry);
+};
+
+} // namespace udp2docker
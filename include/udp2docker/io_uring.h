@@ -0,0 +1,158 @@
+#pragma once
+
+#include "common.h"
+#include "udp_client.h"
+#include <vector>
+
+namespace udp2docker {
+
+/**
+ * @brief 基于io_uring的数据报接收器（仅Linux，需要6.0及以上内核）
+ *
+ * 在套接字上提交一个多次触发（IORING_RECV_MULTISHOT）的RECVMSG请求，数据报由内核
+ * 直接写入预先注册的提供缓冲区环（IORING_REGISTER_PBUF_RING），稳定接收时不再为每批
+ * 数据包调用recvmmsg。完成事件通过注册到io_uring的eventfd通知，UdpClient把该eventfd
+ * 交给EventLoop监视。
+ *
+ * reap()把完成队列中的数据包填入ReceiveRing，数据直接指向提供缓冲区，
+ * 处理完后调用recycle()归还缓冲区。缓冲区用尽时内核结束多次触发请求，recycle()会重新提交。
+ *
+ * 非线程安全。除open()和close()外所有方法都应在事件循环线程中调用：
+ * 网络完成事件以task_work的形式在提交请求的线程上执行，请求需由该线程提交。
+ */
+class IoUringReceiver {
+public:
+    /**
+     * @brief 统计信息
+     */
+    struct Statistics {
+        uint64_t completions = 0;        // 处理的完成事件
+        uint64_t packets = 0;            // 接收到的数据包
+        uint64_t arms = 0;               // 提交（含重新提交）多次触发请求的次数
+        uint64_t buffer_exhausted = 0;   // 因提供缓冲区用尽结束请求的次数
+    };
+    
+    /**
+     * @brief 构造函数
+     * @param buffer_count 提供缓冲区数量，向上取整为2的幂
+     * @param buffer_size 每个缓冲区可容纳的负载字节数
+     * @param receive_control 是否接收控制消息（内核时间戳）
+     */
+    IoUringReceiver(size_t buffer_count, size_t buffer_size = MAX_BUFFER_SIZE, bool receive_control = false);
+    
+    /**
+     * @brief 析构函数，取消未完成的请求并释放io_uring
+     */
+    ~IoUringReceiver();
+    
+    // 禁用拷贝构造和赋值
+    IoUringReceiver(const IoUringReceiver&) = delete;
+    IoUringReceiver& operator=(const IoUringReceiver&) = delete;
+    
+    /**
+     * @brief 检查当前系统能否创建io_uring
+     */
+    static bool is_supported();
+    
+    /**
+     * @brief 创建io_uring、注册提供缓冲区环和eventfd
+     * @param socket 接收数据的UDP套接字
+     * @return 系统不支持或资源不足返回SOCKET_INIT_FAILED
+     */
+    ErrorCode open(socket_handle_t socket);
+    
+    /**
+     * @brief 取消未完成的请求并释放所有资源
+     */
+    void close();
+    
+    bool is_open() const { return ring_fd_ >= 0; }
+    
+    /**
+     * @brief 完成事件通知用的eventfd，可读表示完成队列中有新事件
+     */
+    int event_fd() const { return event_fd_; }
+    
+    /**
+     * @brief 提交多次触发的接收请求（已提交时不做任何事）
+     */
+    ErrorCode arm();
+    
+    /**
+     * @brief 清除eventfd通知，应在一次唤醒开始时、调用reap()之前调用
+     */
+    void acknowledge();
+    
+    /**
+     * @brief 把完成队列中的数据包填入ring，最多ring.capacity()个
+     *
+     * 数据包视图指向提供缓冲区，在调用recycle()之前有效。
+     *
+     * @return 本次填入的数据包数
+     */
+    size_t reap(ReceiveRing& ring);
+    
+    /**
+     * @brief 归还上一次reap()占用的缓冲区，请求已结束时重新提交
+     */
+    void recycle();
+    
+    /**
+     * @brief 完成队列中是否还有未处理的事件
+     */
+    bool pending() const;
+    
+    /**
+     * @brief 再次触发eventfd通知（单次唤醒未处理完完成队列时使用）
+     */
+    void notify();
+    
+    /**
+     * @brief 请求因缓冲区用尽以外的原因失败（例如内核不支持多次触发的RECVMSG），不会再重新提交
+     */
+    bool failed() const { return failed_; }
+    
+    Statistics get_statistics() const { return stats_; }
+
+private:
+    size_t buffer_count_;
+    size_t buffer_size_;
+    size_t control_size_;
+    socket_handle_t socket_;
+    int ring_fd_;
+    int event_fd_;
+    bool armed_;
+    bool failed_;
+    Statistics stats_;
+    
+    buffer_t storage_;                       // 所有提供缓冲区
+    std::vector<uint16_t> consumed_;         // 上一次reap()占用的缓冲区编号
+    uint16_t buffer_tail_;
+    
+    // 内核共享的环（mmap）
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* sqes_;
+    size_t sqes_size_;
+    void* buffer_ring_;
+    size_t buffer_ring_size_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    void* cqes_;
+#ifdef __linux__
+    msghdr message_;                         // 多次触发请求的名字和控制消息长度
+#endif
+    
+    byte* buffer(uint16_t id) { return storage_.data() + id * slot_size(); }
+    size_t slot_size() const;
+    void* next_sqe();
+    ErrorCode enter(unsigned to_submit, unsigned min_complete);
+    void provide(uint16_t id);
+    void publish_buffers();
+};
+
+} // namespace udp2docker
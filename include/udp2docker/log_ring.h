@@ -0,0 +1,311 @@
+#pragma once
+
+#include "common.h"
+#include "bounded_queue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+namespace udp2docker {
+namespace detail {
+
+// 参数类型标签，与参数值一起写入日志环，由后台线程解码
+enum class LogArgType : uint8_t {
+    INT = 0,
+    UINT = 1,
+    DOUBLE = 2,
+    BOOL = 3,
+    CHAR = 4,
+    STRING = 5,
+    POINTER = 6
+};
+
+template<typename T>
+struct always_false : std::false_type {};
+
+template<typename T>
+inline std::string_view log_arg_text(const T& value) {
+    if constexpr (std::is_array_v<T>) {
+        return std::string_view(value);   // 字符串字面量不会为空
+    } else if constexpr (std::is_pointer_v<T>) {
+        return value != nullptr ? std::string_view(value) : std::string_view("(null)");
+    } else {
+        return std::string_view(value);
+    }
+}
+
+/**
+ * @brief 计算参数编码后的字节数
+ */
+template<typename T>
+inline size_t encoded_log_arg_size(const T& value) {
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same_v<D, bool> || std::is_same_v<D, char>) {
+        return 2;
+    } else if constexpr (std::is_arithmetic_v<D> || std::is_enum_v<D>) {
+        return 1 + sizeof(uint64_t);
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        return 1 + sizeof(uint32_t) + log_arg_text(value).size();
+    } else if constexpr (std::is_pointer_v<D>) {
+        return 1 + sizeof(uint64_t);
+    } else {
+        static_assert(always_false<T>::value, "Unsupported log argument type");
+        return 0;
+    }
+}
+
+/**
+ * @brief 将参数编码到out，字符串参数按值复制
+ * @return 写入后的位置
+ */
+template<typename T>
+inline byte* encode_log_arg(byte* out, const T& value) {
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same_v<D, bool>) {
+        out[0] = static_cast<byte>(LogArgType::BOOL);
+        out[1] = value ? 1 : 0;
+        return out + 2;
+    } else if constexpr (std::is_same_v<D, char>) {
+        out[0] = static_cast<byte>(LogArgType::CHAR);
+        out[1] = static_cast<byte>(value);
+        return out + 2;
+    } else if constexpr (std::is_floating_point_v<D>) {
+        double number = static_cast<double>(value);
+        out[0] = static_cast<byte>(LogArgType::DOUBLE);
+        std::memcpy(out + 1, &number, sizeof(number));
+        return out + 1 + sizeof(number);
+    } else if constexpr (std::is_arithmetic_v<D> || std::is_enum_v<D>) {
+        using I = std::conditional_t<std::is_enum_v<D>, std::underlying_type<D>, std::common_type<D>>;
+        using U = typename I::type;
+        uint64_t bits;
+        if constexpr (std::is_signed_v<U>) {
+            int64_t number = static_cast<int64_t>(value);
+            out[0] = static_cast<byte>(LogArgType::INT);
+            std::memcpy(&bits, &number, sizeof(bits));
+        } else {
+            out[0] = static_cast<byte>(LogArgType::UINT);
+            bits = static_cast<uint64_t>(value);
+        }
+        std::memcpy(out + 1, &bits, sizeof(bits));
+        return out + 1 + sizeof(bits);
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        std::string_view text = log_arg_text(value);
+        uint32_t size = static_cast<uint32_t>(text.size());
+        out[0] = static_cast<byte>(LogArgType::STRING);
+        std::memcpy(out + 1, &size, sizeof(size));
+        std::memcpy(out + 1 + sizeof(size), text.data(), text.size());
+        return out + 1 + sizeof(size) + text.size();
+    } else {
+        uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+        out[0] = static_cast<byte>(LogArgType::POINTER);
+        std::memcpy(out + 1, &address, sizeof(address));
+        return out + 1 + sizeof(address);
+    }
+}
+
+/**
+ * @brief 按格式串展开编码后的参数
+ *
+ * 格式串中的每个"{}"依次替换为一个参数，多余的参数被忽略。
+ *
+ * @param format 格式串
+ * @param args 编码后的参数
+ * @param size 参数字节数
+ * @return 格式化后的消息
+ */
+string_t format_log_args(const char* format, const byte* args, size_t size);
+
+/**
+ * @brief 单生产者/单消费者日志环
+ *
+ * 每个写日志的线程独占一个日志环，后台线程是唯一的消费者，
+ * 写入只需要一次release存储，没有锁和CAS，也不分配内存。
+ *
+ * 存储划分为固定大小（一个缓存行）的槽位，一条记录占用若干个连续槽位：
+ * 记录头 + 消息文本或编码后的参数。到达末尾放不下时写入填充记录并回绕。
+ */
+class LogRing {
+public:
+    static constexpr size_t SLOT_SIZE = CACHE_LINE_SIZE;
+    
+    // 记录头，file/function/format必须指向静态存储（如__FILE__、字符串字面量）
+    struct Entry {
+        uint32_t slots;          // 占用的槽位数
+        uint8_t level;           // LogLevel，PADDING表示填充记录
+        uint8_t has_format;      // 1表示数据是format对应的编码参数，0表示消息文本
+        uint16_t reserved;
+        int32_t line;
+        uint32_t data_size;
+        int64_t timestamp;       // system_clock纪元以来的时钟周期数
+        const char* file;
+        const char* function;
+        const char* format;
+        
+        const byte* data() const { return reinterpret_cast<const byte*>(this + 1); }
+    };
+    
+    static constexpr uint8_t PADDING = 0xFF;
+    
+    /**
+     * @brief 构造函数
+     * @param slot_count 槽位数（向上取整为2的幂，最小为16）
+     */
+    explicit LogRing(size_t slot_count)
+        : capacity_(round_up_pow2(slot_count))
+        , mask_(capacity_ - 1)
+        , slots_(new Slot[capacity_])
+        , thread_id_(std::this_thread::get_id())
+        , closed_(false)
+        , write_pos_(0)
+        , cached_read_pos_(0)
+        , pending_pos_(0)
+        , dropped_(0)
+        , read_pos_(0)
+        , cached_write_pos_(0)
+    {
+    }
+    
+    ~LogRing() {
+        delete[] slots_;
+    }
+    
+    // 禁用拷贝构造和赋值
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+    
+    /**
+     * @brief 单条记录可携带的最大数据字节数
+     */
+    size_t max_data_size() const { return capacity_ / 2 * SLOT_SIZE - sizeof(Entry); }
+    
+    /**
+     * @brief 预留一条记录（仅生产者线程调用）
+     * @param data_size 数据字节数，不得超过max_data_size()
+     * @return 记录头，空间不足返回nullptr；填好后调用commit()
+     */
+    Entry* try_reserve(size_t data_size) {
+        size_t needed = (sizeof(Entry) + data_size + SLOT_SIZE - 1) / SLOT_SIZE;
+        size_t pos = write_pos_.load(std::memory_order_relaxed);
+        size_t till_end = capacity_ - (pos & mask_);
+        size_t padding = till_end < needed ? till_end : 0;
+        
+        if (pos + padding + needed - cached_read_pos_ > capacity_) {
+            cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+            if (pos + padding + needed - cached_read_pos_ > capacity_) {
+                return nullptr;
+            }
+        }
+        
+        if (padding != 0) {
+            Entry* filler = entry_at(pos);
+            filler->slots = static_cast<uint32_t>(padding);
+            filler->level = PADDING;
+            pos += padding;
+        }
+        
+        Entry* entry = entry_at(pos);
+        entry->slots = static_cast<uint32_t>(needed);
+        pending_pos_ = pos + needed;
+        return entry;
+    }
+    
+    /**
+     * @brief 发布try_reserve()预留的记录（仅生产者线程调用）
+     */
+    void commit() {
+        write_pos_.store(pending_pos_, std::memory_order_release);
+    }
+    
+    /**
+     * @brief 查看最早的一条记录（仅消费者线程调用）
+     * @return 记录头，处理完后调用release()；没有记录返回nullptr
+     */
+    const Entry* peek() {
+        size_t pos = read_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            if (pos == cached_write_pos_) {
+                cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+                if (pos == cached_write_pos_) {
+                    return nullptr;
+                }
+            }
+            
+            const Entry* entry = entry_at(pos);
+            if (entry->level != PADDING) {
+                return entry;
+            }
+            pos += entry->slots;
+            read_pos_.store(pos, std::memory_order_release);
+        }
+    }
+    
+    /**
+     * @brief 释放peek()返回的记录（仅消费者线程调用）
+     */
+    void release(const Entry* entry) {
+        read_pos_.store(read_pos_.load(std::memory_order_relaxed) + entry->slots, std::memory_order_release);
+    }
+    
+    bool empty() const {
+        return read_pos_.load(std::memory_order_acquire) == write_pos_.load(std::memory_order_acquire);
+    }
+    
+    // 已写入、尚未被消费的槽位数（任意线程调用，近似值）
+    size_t used_slots() const {
+        size_t read = read_pos_.load(std::memory_order_acquire);
+        return write_pos_.load(std::memory_order_acquire) - read;
+    }
+    
+    // 丢弃计数只由生产者线程修改
+    void record_drop() { dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    
+    // 关闭后生产者不再使用该日志环
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+    
+    std::thread::id thread_id() const { return thread_id_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct alignas(SLOT_SIZE) Slot {
+        byte data[SLOT_SIZE];
+    };
+    
+    static_assert(sizeof(Entry) <= SLOT_SIZE, "Log entry header must fit in one slot");
+    
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 16;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+    
+    Entry* entry_at(size_t pos) const {
+        return reinterpret_cast<Entry*>(slots_[pos & mask_].data);
+    }
+    
+    const size_t capacity_;
+    const size_t mask_;
+    Slot* const slots_;
+    const std::thread::id thread_id_;
+    std::atomic<bool> closed_;
+    
+    // 生产者
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> write_pos_;
+    size_t cached_read_pos_;
+    size_t pending_pos_;
+    std::atomic<uint64_t> dropped_;
+    
+    // 消费者
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> read_pos_;
+    size_t cached_write_pos_;
+};
+
+} // namespace detail
+} // namespace udp2docker
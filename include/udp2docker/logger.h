@@ -1,16 +1,18 @@
 #pragma once
 
 #include "common.h"
+#include "log_ring.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <map>
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace udp2docker {
 
@@ -27,6 +29,7 @@ enum class LogLevel {
 
 // 辅助函数声明
 string_t level_to_string(LogLevel level);
+std::optional<LogLevel> string_to_level(const string_t& name);  // 不区分大小写，不认识的名称返回空
 string_t extract_filename(const string_t& path);
 void replace_all(string_t& str, const string_t& from, const string_t& to);
 
@@ -37,6 +40,12 @@ enum class LogTarget {
     CONSOLE_AND_FILE = 3
 };
 
+// 异步日志缓冲区满时的处理策略
+enum class LogOverflowPolicy {
+    DROP,    // 丢弃新日志并计数（默认，写日志的线程永不阻塞）
+    BLOCK    // 等待后台线程腾出空间
+};
+
 // 日志记录结构
 struct LogRecord {
     LogLevel level;
@@ -61,7 +70,7 @@ struct LogRecord {
  * 该类提供了完整的日志记录功能：
  * - 多个日志级别（TRACE到FATAL）
  * - 多种输出目标（控制台、文件）
- * - 异步日志记录（高性能）
+ * - 异步日志记录（每线程无锁日志环，后台线程格式化）
  * - 日志格式化和过滤
  * - 日志文件轮转
  * - 线程安全
@@ -109,6 +118,17 @@ public:
      */
     void set_file_output(const string_t& file_path, size_t max_size_mb = 100, size_t max_files = 5);
     
+    /**
+     * @brief 设置文件输出缓冲
+     * 
+     * 启用后日志先追加到内存缓冲区，缓冲区达到阈值、后台刷新间隔到期
+     * 或写入ERROR/FATAL日志时才写入文件并刷新。
+     * 
+     * @param buffer_size 缓冲区大小（字节），0表示每行立即写入并刷新（默认）
+     * @param flush_interval_ms 后台刷新间隔（毫秒），0表示不定时刷新
+     */
+    void set_file_buffering(size_t buffer_size = 64 * 1024, int flush_interval_ms = 1000);
+    
     /**
      * @brief 设置日志格式
      * @param pattern 格式模式字符串
@@ -126,55 +146,88 @@ public:
     
     /**
      * @brief 启用异步日志
-     * @param buffer_size 缓冲区大小
+     * 
+     * 每个写日志的线程首次写入时分配一个独立的日志环，之后写日志只复制参数，
+     * 不加锁也不分配内存，格式化和输出在后台线程完成。
+     * 
+     * @param buffer_size 每个线程可缓冲的日志条数（按每条128字节预分配）
+     * @param policy 缓冲区满时的处理策略
      */
-    void enable_async(size_t buffer_size = 1000);
+    void enable_async(size_t buffer_size = 1000, LogOverflowPolicy policy = LogOverflowPolicy::DROP);
     
     /**
      * @brief 禁用异步日志
      */
     void disable_async();
     
+    /**
+     * @brief 获取异步模式下丢弃的日志条数
+     * @return 丢弃条数
+     */
+    uint64_t get_dropped_count() const;
+    
+    /**
+     * @brief 获取异步模式下各线程日志环中尚未写出的字节数（近似值）
+     */
+    size_t get_async_backlog_bytes() const;
+    
     /**
      * @brief 记录日志
      * @param level 日志级别
      * @param message 消息内容
-     * @param file 文件名
+     * @param file 文件名（异步模式下只保存指针，必须是静态字符串，如__FILE__）
      * @param line 行号
-     * @param function 函数名
+     * @param function 函数名（同file）
      */
     void log(LogLevel level, const string_t& message,
-             const string_t& file = "", int line = 0, const string_t& function = "");
+             const char* file = "", int line = 0, const char* function = "");
+    
+    /**
+     * @brief 记录格式化日志，格式化推迟到后台线程
+     * 
+     * 格式串中的每个"{}"依次替换为一个参数。异步模式下参数以二进制形式复制，
+     * 字符串参数按值复制，格式串只保存指针，必须是字符串字面量。
+     * 
+     * @param level 日志级别
+     * @param file 文件名（静态字符串）
+     * @param line 行号
+     * @param function 函数名（静态字符串）
+     * @param format 格式串（字符串字面量）
+     * @param args 参数（整数、浮点数、布尔、字符、字符串、指针）
+     */
+    template<typename... Args>
+    void logf(LogLevel level, const char* file, int line, const char* function,
+              const char* format, const Args&... args);
     
     /**
      * @brief TRACE级别日志
      */
-    void trace(const string_t& message, const string_t& file = "", int line = 0, const string_t& function = "");
+    void trace(const string_t& message, const char* file = "", int line = 0, const char* function = "");
     
     /**
      * @brief DEBUG级别日志
      */
-    void debug(const string_t& message, const string_t& file = "", int line = 0, const string_t& function = "");
+    void debug(const string_t& message, const char* file = "", int line = 0, const char* function = "");
     
     /**
      * @brief INFO级别日志
      */
-    void info(const string_t& message, const string_t& file = "", int line = 0, const string_t& function = "");
+    void info(const string_t& message, const char* file = "", int line = 0, const char* function = "");
     
     /**
      * @brief WARN级别日志
      */
-    void warn(const string_t& message, const string_t& file = "", int line = 0, const string_t& function = "");
+    void warn(const string_t& message, const char* file = "", int line = 0, const char* function = "");
     
     /**
      * @brief ERROR级别日志
      */
-    void error(const string_t& message, const string_t& file = "", int line = 0, const string_t& function = "");
+    void error(const string_t& message, const char* file = "", int line = 0, const char* function = "");
     
     /**
      * @brief FATAL级别日志
      */
-    void fatal(const string_t& message, const string_t& file = "", int line = 0, const string_t& function = "");
+    void fatal(const string_t& message, const char* file = "", int line = 0, const char* function = "");
     
     /**
      * @brief 检查指定级别是否启用
@@ -210,20 +263,42 @@ private:
     
     mutable std::mutex log_mutex_;
     std::ofstream file_stream_;
+    uint64_t file_bytes_;        // 当前文件大小（含未刷新的缓冲），用于判断轮转，不再每行stat
+    
+    // 文件缓冲相关（受log_mutex_保护）
+    string_t file_buffer_;
+    size_t file_buffer_limit_;   // 0表示不缓冲
+    int flush_interval_ms_;
+    bool flush_stop_;
+    std::condition_variable flush_condition_;
+    std::thread flush_thread_;
     
     // 异步日志相关
     std::atomic<bool> async_enabled_;
     std::atomic<bool> should_stop_;
-    std::queue<LogRecord> log_queue_;
-    mutable std::mutex queue_mutex_;
-    std::condition_variable queue_condition_;
+    std::atomic<uint64_t> async_session_;  // 每次启用异步时更新，用于识别线程缓存的日志环
+    std::vector<std::shared_ptr<detail::LogRing>> rings_;
+    mutable std::mutex rings_mutex_;
+    std::mutex wakeup_mutex_;
+    std::condition_variable wakeup_condition_;
     std::thread async_thread_;
     size_t buffer_size_;
+    LogOverflowPolicy overflow_policy_;
+    std::atomic<uint64_t> retired_dropped_;  // 已回收日志环的丢弃计数
+    uint64_t metrics_collector_;             // MetricsRegistry::global()中的采集回调
     
     // 私有方法
+    detail::LogRing* thread_ring();
+    detail::LogRing::Entry* reserve_entry(detail::LogRing*& ring, size_t data_size);
+    bool drain_rings();
+    void write_entry(const detail::LogRing& ring, const detail::LogRing::Entry& entry);
     void write_log(const LogRecord& record);
     void console_output(const string_t& formatted_message, LogLevel level);
-    void file_output(const string_t& formatted_message);
+    void file_output(const string_t& formatted_message, LogLevel level);
+    void flush_file_buffer();
+    void stop_flush_thread();
+    void flush_worker();
+    void open_file_stream();
     void async_worker();
     string_t get_current_timestamp() const;
     bool should_rotate() const;
@@ -231,48 +306,141 @@ private:
     string_t get_rotated_filename(size_t index) const;
 };
 
+template<typename... Args>
+void Logger::logf(LogLevel level, const char* file, int line, const char* function,
+                  const char* format, const Args&... args) {
+    if (!is_enabled(level)) {
+        return;
+    }
+    
+    size_t data_size = (size_t(0) + ... + detail::encoded_log_arg_size(args));
+    
+    if (async_enabled_.load(std::memory_order_acquire)) {
+        detail::LogRing* ring = nullptr;
+        detail::LogRing::Entry* entry = reserve_entry(ring, data_size);
+        if (entry != nullptr) {
+            entry->level = static_cast<uint8_t>(level);
+            entry->has_format = 1;
+            entry->line = line;
+            entry->data_size = static_cast<uint32_t>(data_size);
+            entry->timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+            entry->file = file;
+            entry->function = function;
+            entry->format = format;
+            byte* out = const_cast<byte*>(entry->data());
+            ((out = detail::encode_log_arg(out, args)), ...);
+            ring->commit();
+            return;
+        }
+        if (ring != nullptr && data_size <= ring->max_data_size()) {
+            return;
+        }
+        // 参数过大，在当前线程格式化后按普通消息处理
+    }
+    
+    buffer_t encoded(data_size);
+    byte* out = encoded.data();
+    ((out = detail::encode_log_arg(out, args)), ...);
+    (void)out;
+    log(level, detail::format_log_args(format, encoded.data(), encoded.size()), file, line, function);
+}
+
 // 全局日志管理器
 class LoggerManager {
 public:
+    /**
+     * @brief 获取日志器，首次调用时创建
+     * 
+     * 日志器创建后在进程生命周期内保持有效（shutdown()也不销毁），
+     * 调用点可以缓存返回的引用。
+     */
     static Logger& get_logger(const string_t& name = "default");
     static void set_global_level(LogLevel level);
     static void set_global_pattern(const string_t& pattern);
     static void shutdown();
     
+    /**
+     * @brief 快速判断是否可能有日志器输出该级别，不加锁
+     * 
+     * 返回false时所有日志器都不会输出该级别；返回true时仍需检查具体日志器。
+     */
+    static bool may_log(LogLevel level) {
+        return static_cast<int>(level) >= level_floor_.load(std::memory_order_relaxed);
+    }
+    
+    // 日志器级别降低时调用，保证may_log()不会漏掉日志
+    static void lower_level_floor(LogLevel level);
+    
 private:
     static std::map<string_t, std::unique_ptr<Logger>> loggers_;
     static std::mutex manager_mutex_;
     static LogLevel global_level_;
     static string_t global_pattern_;
+    static std::atomic<int> level_floor_;  // 所有日志器级别的下限
 };
 
+// 编译期日志级别下限（LogLevel的数值），低于该级别的日志调用连同消息构造一起被编译器移除。
+// 可通过CMake选项UDP2DOCKER_MIN_LOG_LEVEL指定，默认Release构建移除TRACE/DEBUG。
+#ifndef UDP2DOCKER_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define UDP2DOCKER_MIN_LOG_LEVEL 2
+#else
+#define UDP2DOCKER_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+// 先检查级别再求值消息表达式；调用点缓存默认日志器的引用，不再每次加锁查找
+#define UDP2DOCKER_LOG_AT(level, msg) do { \
+    if (static_cast<int>(level) >= UDP2DOCKER_MIN_LOG_LEVEL) { \
+        static udp2docker::Logger& udp2docker_site_logger_ = udp2docker::LoggerManager::get_logger(); \
+        if (udp2docker_site_logger_.is_enabled(level)) { \
+            udp2docker_site_logger_.log(level, msg, __FILE__, __LINE__, __FUNCTION__); \
+        } \
+    } \
+} while (0)
+
+#define UDP2DOCKER_LOGF_AT(level, ...) do { \
+    if (static_cast<int>(level) >= UDP2DOCKER_MIN_LOG_LEVEL) { \
+        static udp2docker::Logger& udp2docker_site_logger_ = udp2docker::LoggerManager::get_logger(); \
+        if (udp2docker_site_logger_.is_enabled(level)) { \
+            udp2docker_site_logger_.logf(level, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__); \
+        } \
+    } \
+} while (0)
+
+// 日志器名称可能在运行时变化，不缓存引用，先用不加锁的may_log()过滤
+#define UDP2DOCKER_LOGGER_AT(logger, level, msg) do { \
+    if (static_cast<int>(level) >= UDP2DOCKER_MIN_LOG_LEVEL && udp2docker::LoggerManager::may_log(level)) { \
+        udp2docker::Logger& udp2docker_named_logger_ = udp2docker::LoggerManager::get_logger(logger); \
+        if (udp2docker_named_logger_.is_enabled(level)) { \
+            udp2docker_named_logger_.log(level, msg, __FILE__, __LINE__, __FUNCTION__); \
+        } \
+    } \
+} while (0)
+
 // 便捷宏定义
-#define LOG_TRACE(msg) udp2docker::LoggerManager::get_logger().trace(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_DEBUG(msg) udp2docker::LoggerManager::get_logger().debug(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_INFO(msg) udp2docker::LoggerManager::get_logger().info(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_WARN(msg) udp2docker::LoggerManager::get_logger().warn(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_ERROR(msg) udp2docker::LoggerManager::get_logger().error(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOG_FATAL(msg) udp2docker::LoggerManager::get_logger().fatal(msg, __FILE__, __LINE__, __FUNCTION__)
+#define LOG_TRACE(msg) UDP2DOCKER_LOG_AT(udp2docker::LogLevel::TRACE, msg)
+#define LOG_DEBUG(msg) UDP2DOCKER_LOG_AT(udp2docker::LogLevel::DEBUG, msg)
+#define LOG_INFO(msg) UDP2DOCKER_LOG_AT(udp2docker::LogLevel::INFO, msg)
+#define LOG_WARN(msg) UDP2DOCKER_LOG_AT(udp2docker::LogLevel::WARN, msg)
+#define LOG_ERROR(msg) UDP2DOCKER_LOG_AT(udp2docker::LogLevel::LOG_ERROR, msg)
+#define LOG_FATAL(msg) UDP2DOCKER_LOG_AT(udp2docker::LogLevel::FATAL, msg)
 
 // 带日志器名称的宏
-#define LOGGER_TRACE(logger, msg) udp2docker::LoggerManager::get_logger(logger).trace(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOGGER_DEBUG(logger, msg) udp2docker::LoggerManager::get_logger(logger).debug(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOGGER_INFO(logger, msg) udp2docker::LoggerManager::get_logger(logger).info(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOGGER_WARN(logger, msg) udp2docker::LoggerManager::get_logger(logger).warn(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOGGER_ERROR(logger, msg) udp2docker::LoggerManager::get_logger(logger).error(msg, __FILE__, __LINE__, __FUNCTION__)
-#define LOGGER_FATAL(logger, msg) udp2docker::LoggerManager::get_logger(logger).fatal(msg, __FILE__, __LINE__, __FUNCTION__)
-
-// 格式化日志宏
-#define LOG_INFO_F(format, ...) do { \
-    std::stringstream ss; \
-    ss << format; \
-    LOG_INFO(ss.str()); \
-} while(0)
+#define LOGGER_TRACE(logger, msg) UDP2DOCKER_LOGGER_AT(logger, udp2docker::LogLevel::TRACE, msg)
+#define LOGGER_DEBUG(logger, msg) UDP2DOCKER_LOGGER_AT(logger, udp2docker::LogLevel::DEBUG, msg)
+#define LOGGER_INFO(logger, msg) UDP2DOCKER_LOGGER_AT(logger, udp2docker::LogLevel::INFO, msg)
+#define LOGGER_WARN(logger, msg) UDP2DOCKER_LOGGER_AT(logger, udp2docker::LogLevel::WARN, msg)
+#define LOGGER_ERROR(logger, msg) UDP2DOCKER_LOGGER_AT(logger, udp2docker::LogLevel::LOG_ERROR, msg)
+#define LOGGER_FATAL(logger, msg) UDP2DOCKER_LOGGER_AT(logger, udp2docker::LogLevel::FATAL, msg)
 
-#define LOG_ERROR_F(format, ...) do { \
-    std::stringstream ss; \
-    ss << format; \
-    LOG_ERROR(ss.str()); \
-} while(0)
+// 格式化日志宏，格式串中的"{}"依次替换为参数，格式化推迟到输出时
+// 例如：LOG_DEBUG_F("Sending {} bytes to {}:{}", size, host, port);
+#define LOG_TRACE_F(...) UDP2DOCKER_LOGF_AT(udp2docker::LogLevel::TRACE, __VA_ARGS__)
+#define LOG_DEBUG_F(...) UDP2DOCKER_LOGF_AT(udp2docker::LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO_F(...) UDP2DOCKER_LOGF_AT(udp2docker::LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARN_F(...) UDP2DOCKER_LOGF_AT(udp2docker::LogLevel::WARN, __VA_ARGS__)
+#define LOG_ERROR_F(...) UDP2DOCKER_LOGF_AT(udp2docker::LogLevel::LOG_ERROR, __VA_ARGS__)
+#define LOG_FATAL_F(...) UDP2DOCKER_LOGF_AT(udp2docker::LogLevel::FATAL, __VA_ARGS__)
 
 } // namespace udp2docker 
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "common.h"
-#include <map>
+#include "buffer_pool.h"
+#include "compression.h"
+#include "crypto.h"
+#include "metadata.h"
+#include <functional>
 #include <optional>
 
 namespace udp2docker {
@@ -16,11 +20,32 @@ struct MessageHeader {
     uint32_t timestamp = 0;                // 时间戳
     uint32_t payload_size = 0;             // 负载大小
     uint32_t checksum = 0;                 // 校验和
+    uint16_t flags = 0;                    // 标志位（0-3位压缩算法，4-7位加密算法，8位元数据，9位可靠投递）
+    uint16_t metadata_size = 0;            // 元数据段大小（计入payload_size）
+    
+    // 标志位定义
+    static constexpr uint16_t FLAG_COMPRESSION_MASK = 0x000F;
+    static constexpr uint16_t FLAG_CIPHER_MASK = 0x00F0;
+    static constexpr int FLAG_CIPHER_SHIFT = 4;
+    static constexpr uint16_t FLAG_METADATA = 0x0100;
+    static constexpr uint16_t FLAG_RELIABLE = 0x0200;   // 需要确认，sequence_id属于可靠序列号空间
+    
+    CompressionType compression() const {
+        return static_cast<CompressionType>(flags & FLAG_COMPRESSION_MASK);
+    }
+    
+    CipherType cipher() const {
+        return static_cast<CipherType>((flags & FLAG_CIPHER_MASK) >> FLAG_CIPHER_SHIFT);
+    }
     
     // 序列化和反序列化
     buffer_t serialize() const;
     bool deserialize(const buffer_t& data);
     
+    // 原地序列化和反序列化，out/data至少header_size()字节
+    void serialize_to(byte* out) const;
+    bool deserialize(const byte* data, size_t size);
+    
     // 计算头部大小
     static constexpr size_t header_size() { return 32; }
 };
@@ -29,7 +54,7 @@ struct MessageHeader {
 struct Message {
     MessageHeader header;
     buffer_t payload;
-    std::map<string_t, string_t> metadata;  // 元数据
+    MetadataMap metadata;  // 元数据
     
     Message() = default;
     Message(MessageType type, const buffer_t& data, Priority priority = Priority::NORMAL);
@@ -42,6 +67,52 @@ struct Message {
     bool is_valid() const;
 };
 
+// 消息只读视图，负载指向接收缓冲区，仅在缓冲区有效期间可用
+struct MessageView {
+    MessageHeader header;
+    BufferView payload;
+    MetadataReader metadata;  // 元数据在访问时才解析
+    
+    // 复制为独立的消息（损坏的元数据被丢弃）
+    Message to_message() const;
+};
+
+// 分散/聚集发送的消息片段（头部 + 元数据 + 负载），可直接传给UdpClient::send_gather
+struct MessageParts {
+    BufferView parts[3];
+    size_t count = 0;
+    
+    size_t total_size() const;
+};
+
+/**
+ * @brief 容器帧（BATCH）负载的迭代器
+ *
+ * 负载由多个首尾相接的完整消息帧组成，每帧长度由其消息头的payload_size确定，
+ * 不需要额外的长度前缀。返回的帧是负载的切片，不复制。
+ */
+class BatchReader {
+public:
+    explicit BatchReader(BufferView body) : body_(body), offset_(0), failed_(false) {}
+    
+    /**
+     * @brief 取出下一个消息帧
+     * @param frame 输出：完整消息帧（头部+消息体）
+     * @return 没有更多帧或格式错误返回false
+     */
+    bool next(BufferView& frame);
+    
+    /**
+     * @brief 是否因格式错误而停止
+     */
+    bool failed() const { return failed_; }
+
+private:
+    BufferView body_;
+    size_t offset_;
+    bool failed_;
+};
+
 /**
  * @brief 消息协议类，负责消息的序列化和反序列化
  * 
@@ -77,6 +148,93 @@ public:
      */
     std::optional<Message> deserialize(const buffer_t& data);
     
+    /**
+     * @brief 将消息直接序列化到调用方提供的缓冲区
+     * 
+     * 头部原地写入，负载只复制一次，不产生堆分配。
+     * 
+     * @param message 要序列化的消息
+     * @param out 输出缓冲区
+     * @param capacity 输出缓冲区容量
+     * @return 写入的字节数，缓冲区不足返回INVALID_PARAMETER
+     */
+    Result<size_t> serialize_into(const Message& message, byte* out, size_t capacity);
+    
+    /**
+     * @brief 将消息序列化到池化缓冲区
+     * 
+     * 输出帧从当前线程的BufferPool分配，发送完释放后回到缓冲池，不经过malloc。
+     * 
+     * @param message 要序列化的消息
+     * @param headroom 帧前预留的字节数，供外层协议头使用
+     * @return 序列化后的帧，失败返回INVALID_PARAMETER
+     */
+    Result<PooledBuffer> serialize_pooled(const Message& message,
+                                          size_t headroom = PooledBuffer::DEFAULT_HEADROOM);
+    
+    /**
+     * @brief 把池化缓冲区中的负载原地封装为完整的消息帧
+     * 
+     * 未启用压缩和加密时消息头直接写入负载前的预留空间，负载不复制；
+     * 需要压缩或加密、预留空间不足或缓冲区被共享时，编码到新的池化缓冲区。
+     * 
+     * @param buffer 输入为负载，成功后为消息帧
+     * @param type 消息类型
+     * @param priority 消息优先级
+     * @return 负载过大返回INVALID_PARAMETER，buffer不变
+     */
+    ErrorCode frame(PooledBuffer& buffer, MessageType type, Priority priority = Priority::NORMAL);
+    
+    /**
+     * @brief 将消息序列化为分散/聚集片段
+     * 
+     * 头部写入header_out，负载片段直接引用message.payload，
+     * 元数据编码到协议对象内部的缓冲区，在下一次序列化之前有效。
+     * 发送完成之前不得修改或释放消息。
+     * 
+     * @param message 要序列化的消息
+     * @param header_out 头部缓冲区，至少MessageHeader::header_size()字节
+     * @param parts 输出的消息片段
+     * @return 序列化结果
+     */
+    ErrorCode serialize_parts(const Message& message, byte* header_out, MessageParts& parts);
+    
+    /**
+     * @brief 反序列化为消息视图，负载不复制
+     * 
+     * 压缩或加密的消息解码后存放在协议对象内部的缓冲区中，
+     * 视图在下一次序列化或反序列化之前有效。
+     * 元数据不在这里解析，通过view.metadata按需读取。
+     * 
+     * @param data 字节流数据
+     * @return 消息视图，失败返回空
+     */
+    std::optional<MessageView> deserialize_view(BufferView data);
+    
+    /**
+     * @brief 反序列化数据报中的所有消息
+     * 
+     * 普通消息调用一次visitor；容器帧（BATCH）逐个解出其中的消息，
+     * 未压缩未加密的消息的负载直接指向data，不复制。
+     * 视图只在visitor调用期间有效。
+     * 
+     * @param data 数据报
+     * @param visitor 每条消息调用一次
+     * @return 解出的消息数；数据报无效返回PROTOCOL_ERROR（容器中之前的消息已交给visitor）
+     */
+    Result<size_t> deserialize_each(BufferView data, const std::function<void(const MessageView&)>& visitor);
+    
+    /**
+     * @brief 为容器帧写入消息头
+     * 
+     * 容器帧不压缩不加密，其中的每条消息已各自编码。
+     * 
+     * @param body 容器负载（首尾相接的消息帧）
+     * @param priority 容器的优先级
+     * @param header_out 头部缓冲区，至少MessageHeader::header_size()字节
+     */
+    void write_batch_header(BufferView body, Priority priority, byte* header_out);
+    
     /**
      * @brief 创建心跳消息
      * @return 心跳消息
@@ -136,12 +294,56 @@ public:
      */
     void set_compression_enabled(bool enable);
     
+    /**
+     * @brief 设置压缩算法
+     * 
+     * 接收方根据消息头标志位选择解压算法，不需要启用压缩。
+     * 
+     * @param type 压缩算法
+     * @param level 压缩级别（0表示算法默认值）
+     * @return 设置结果，算法在当前构建中不可用返回INVALID_PARAMETER
+     */
+    ErrorCode set_compression(CompressionType type, int level = 0);
+    
+    /**
+     * @brief 设置压缩阈值，小于该长度的负载不压缩
+     * @param bytes 阈值字节数
+     */
+    void set_compression_threshold(size_t bytes);
+    
+    /**
+     * @brief 设置压缩字典（收发双方必须相同）
+     * @param type 压缩算法
+     * @param dictionary 字典内容，为空表示不使用字典
+     * @return 设置结果
+     */
+    ErrorCode set_compression_dictionary(CompressionType type, const buffer_t& dictionary);
+    
     /**
      * @brief 设置是否启用加密
+     * 
+     * 使用AEAD认证加密，消息头作为附加认证数据，认证标签取代CRC校验和。
+     * 密钥派生和密钥扩展只在这里做一次。启用后拒绝未加密的消息。
+     * 
      * @param enable 是否启用
-     * @param key 加密密钥（可选）
+     * @param key 加密口令（首次启用或更换算法时必须提供）
+     * @param cipher 加密算法
+     * @return 设置结果，OpenSSL不可用或口令为空返回INVALID_PARAMETER
+     */
+    ErrorCode set_encryption_enabled(bool enable, const string_t& key = "",
+                                     CipherType cipher = CipherType::AES_256_GCM);
+    
+    /**
+     * @brief 设置每个nonce盐最多加密的消息数
+     * 
+     * nonce由8字节随机盐和4字节计数器组成，计数器达到该值时重新生成盐并从头计数。
+     * 默认在32位计数器耗尽时更换。重新生成盐失败时加密序列化返回错误，
+     * 不会发出nonce重复的帧。
+     * 
+     * @param messages 每个盐的消息数
+     * @return 设置结果，为0返回INVALID_PARAMETER
      */
-    void set_encryption_enabled(bool enable, const string_t& key = "");
+    ErrorCode set_nonce_salt_interval(uint32_t messages);
     
     /**
      * @brief 获取下一个序列号
@@ -171,22 +373,50 @@ public:
      * @return 最大消息大小
      */
     size_t get_max_message_size() const;
+    
+    /**
+     * @brief 设置最大消息大小
+     * 
+     * 默认是一个数据报的上限（MAX_BUFFER_SIZE）。超过一个数据报的消息
+     * 需要经Fragmenter分片发送，接收方用ReassemblyTable重组后再反序列化。
+     * 
+     * @param bytes 负载的最大字节数（收发双方都应设置）
+     * @return 设置结果，为0返回INVALID_PARAMETER
+     */
+    ErrorCode set_max_message_size(size_t bytes);
 
 private:
     uint32_t sequence_counter_;
     uint16_t protocol_version_;
     bool compression_enabled_;
+    CompressionType compression_type_;
+    size_t compression_threshold_;
+    std::unique_ptr<Codec> codecs_[COMPRESSION_TYPE_COUNT];  // 按CompressionType索引
     bool encryption_enabled_;
-    string_t encryption_key_;
+    std::unique_ptr<AeadCipher> cipher_;
+    byte nonce_salt_[8];
+    uint32_t nonce_counter_;
+    uint32_t nonce_salt_interval_;  // 每个盐加密的消息数上限
     size_t max_message_size_;
+    buffer_t encoded_payload_;  // 压缩/加密后负载的复用缓冲区
+    buffer_t encrypted_payload_;  // serialize_parts加密负载的复用缓冲区
+    buffer_t decoded_payload_;  // deserialize_view解码负载的复用缓冲区
+    buffer_t metadata_buffer_;  // 元数据编码的复用缓冲区
     
     // 私有方法
+    ErrorCode prepare_header(const Message& message, BufferView& metadata,
+                             BufferView& payload, MessageHeader& header);
     uint32_t calculate_checksum(const buffer_t& data);
+    uint32_t calculate_checksum(const byte* data, size_t size);
     uint32_t get_timestamp();
-    buffer_t compress_data(const buffer_t& data);
-    buffer_t decompress_data(const buffer_t& data);
-    buffer_t encrypt_data(const buffer_t& data);
-    buffer_t decrypt_data(const buffer_t& data);
+    Codec* get_codec(CompressionType type);
+    bool compress_data(BufferView input, buffer_t& output);
+    bool decompress_data(CompressionType type, BufferView input, buffer_t& output);
+    ErrorCode write_payload(const MessageHeader& header, const byte* header_bytes,
+                            BufferView metadata, BufferView payload, byte* out);
+    bool decrypt_payload(const byte* header_bytes, const MessageHeader& header,
+                         BufferView payload, buffer_t& output);
+    bool next_nonce(byte* nonce);
     
     // 字节序转换
     template<typename T>
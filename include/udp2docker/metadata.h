@@ -0,0 +1,175 @@
+#pragma once
+
+#include "common.h"
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace udp2docker {
+
+// 元数据段最大长度（消息头中以uint16记录）
+constexpr size_t MAX_METADATA_SIZE = 0xFFFF;
+
+/**
+ * @brief 消息元数据容器
+ *
+ * 替代std::map<string_t, string_t>：所有键值连续存放在同一块存储中，
+ * 条目索引是一个小的扁平数组，添加条目不会为每个键值单独分配内存。
+ * 条目数量通常很少，查找采用线性扫描，保持插入顺序。
+ */
+class MetadataMap {
+public:
+    using Entry = std::pair<std::string_view, std::string_view>;
+    
+    class const_iterator {
+    public:
+        const_iterator(const MetadataMap* map, size_t index) : map_(map), index_(index) {}
+        
+        Entry operator*() const { return map_->entry(index_); }
+        const_iterator& operator++() { ++index_; return *this; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+    
+    private:
+        const MetadataMap* map_;
+        size_t index_;
+    };
+    
+    MetadataMap() = default;
+    
+    /**
+     * @brief 设置键值，已存在的键会被覆盖
+     * @param key 键
+     * @param value 值
+     */
+    void set(std::string_view key, std::string_view value);
+    
+    /**
+     * @brief 查找键对应的值
+     * @param key 键
+     * @return 值（指向内部存储，修改容器后失效），不存在返回空
+     */
+    std::optional<std::string_view> get(std::string_view key) const;
+    
+    /**
+     * @brief 获取键对应的值
+     * @param key 键
+     * @param default_value 默认值
+     * @return 值的副本
+     */
+    string_t get_string(std::string_view key, const string_t& default_value = "") const;
+    
+    bool contains(std::string_view key) const { return find_index(key) != npos; }
+    
+    /**
+     * @brief 删除键
+     * @param key 键
+     * @return 键存在返回true
+     */
+    bool erase(std::string_view key);
+    
+    void clear();
+    
+    /**
+     * @brief 预留空间
+     * @param entries 条目数
+     * @param bytes 键值总字节数
+     */
+    void reserve(size_t entries, size_t bytes);
+    
+    size_t size() const { return slots_.size(); }
+    bool empty() const { return slots_.empty(); }
+    
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, slots_.size()); }
+    
+    bool operator==(const MetadataMap& other) const;
+    bool operator!=(const MetadataMap& other) const { return !(*this == other); }
+
+private:
+    struct Slot {
+        uint32_t key_offset;
+        uint32_t key_size;
+        uint32_t value_offset;
+        uint32_t value_size;
+    };
+    
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    
+    std::vector<Slot> slots_;
+    string_t storage_;
+    size_t garbage_bytes_ = 0;   // 被覆盖或删除的键值占用的字节
+    
+    Entry entry(size_t index) const;
+    size_t find_index(std::string_view key) const;
+    uint32_t append(std::string_view text);
+    void compact();
+};
+
+/**
+ * @brief 元数据段的惰性读取器
+ *
+ * 直接在接收缓冲区中解析TLV编码，不复制也不分配内存。
+ * 不读取元数据的接收方不会产生任何解析开销。
+ */
+class MetadataReader {
+public:
+    MetadataReader() = default;
+    explicit MetadataReader(BufferView data) : data_(data) {}
+    
+    bool empty() const { return data_.empty(); }
+    
+    /**
+     * @brief 原始TLV字节
+     */
+    BufferView data() const { return data_; }
+    
+    /**
+     * @brief 查找键对应的值
+     * @param key 键
+     * @return 值（指向接收缓冲区），不存在或数据损坏返回空
+     */
+    std::optional<std::string_view> find(std::string_view key) const;
+    
+    /**
+     * @brief 解码全部条目
+     * @param out 输出容器（追加）
+     * @return 数据损坏返回false
+     */
+    bool decode(MetadataMap& out) const;
+    
+    /**
+     * @brief 读取下一个条目
+     * @param offset 读取位置，成功后前移
+     * @param key 键输出
+     * @param value 值输出
+     * @return 没有更多条目或数据损坏返回false
+     */
+    bool next(size_t& offset, std::string_view& key, std::string_view& value) const;
+
+private:
+    BufferView data_;
+};
+
+/**
+ * @brief 将元数据编码为TLV格式
+ *
+ * 每个条目为：键标签(1字节) [自定义键长度(1字节) + 键] 值长度(varint) + 值。
+ * 标签为预定义键的ID时省略键文本，为0时后跟自定义键。
+ *
+ * @param metadata 元数据
+ * @param out 输出缓冲区（覆盖）
+ * @return 编码结果，超过MAX_METADATA_SIZE或自定义键超过255字节返回INVALID_PARAMETER
+ */
+ErrorCode encode_metadata(const MetadataMap& metadata, buffer_t& out);
+
+/**
+ * @brief 获取预定义键的ID
+ * @param key 键
+ * @return 键ID（1-127），不是预定义键返回0
+ */
+uint8_t metadata_key_id(std::string_view key);
+
+} // namespace udp2docker
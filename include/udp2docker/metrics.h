@@ -0,0 +1,291 @@
+#pragma once
+
+#include "common.h"
+#include "endpoint.h"
+#include "statistics.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace udp2docker {
+
+class ConfigSnapshot;
+
+// 指标类型
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    SUMMARY         // 延迟分布，以分位数、_sum和_count导出，单位为秒
+};
+
+// 指标标签（名称, 值）
+using MetricLabels = std::vector<std::pair<string_t, string_t>>;
+
+/**
+ * @brief 单调递增计数器
+ *
+ * 按线程分条累加（与UdpClient统计相同），增加计数只是一次relaxed原子加法，
+ * 不同线程之间不竞争同一个缓存行。
+ */
+class Counter {
+public:
+    Counter() = default;
+    
+    // 禁用拷贝构造和赋值
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+    
+    void increment(uint64_t amount = 1) {
+        stripes_[detail::stats_stripe_index()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+    
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const auto& stripe : stripes_) {
+            total += stripe.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Stripe {
+        std::atomic<uint64_t> value{0};
+    };
+    
+    std::array<Stripe, STATS_STRIPES> stripes_;
+};
+
+/**
+ * @brief 可增可减的瞬时值
+ */
+class Gauge {
+public:
+    Gauge() : value_(0) {}
+    
+    // 禁用拷贝构造和赋值
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+    
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t amount) { value_.fetch_add(amount, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_;
+};
+
+/**
+ * @brief 一次采集得到的指标值
+ */
+struct MetricSample {
+    MetricType type = MetricType::GAUGE;
+    string_t name;
+    string_t help;
+    MetricLabels labels;
+    double value = 0.0;              // COUNTER/GAUGE的值
+    HistogramSnapshot histogram;     // SUMMARY的分布（纳秒）
+};
+
+/**
+ * @brief 采集回调写入指标值的接口
+ */
+class MetricsWriter {
+public:
+    explicit MetricsWriter(std::vector<MetricSample>& samples) : samples_(samples) {}
+    
+    void counter(const string_t& name, const string_t& help, uint64_t value, MetricLabels labels = {});
+    void gauge(const string_t& name, const string_t& help, double value, MetricLabels labels = {});
+    void summary(const string_t& name, const string_t& help, HistogramSnapshot snapshot, MetricLabels labels = {});
+
+private:
+    std::vector<MetricSample>& samples_;
+};
+
+// 采集回调，在collect()中调用，用于导出对象已有的统计（例如UdpClient::get_statistics()）
+using MetricsCollector = std::function<void(MetricsWriter& writer)>;
+using CollectorId = uint64_t;
+
+/**
+ * @brief 指标注册表
+ *
+ * 两种指标来源：
+ * - counter()/gauge()/histogram()注册的指标对象，由热路径直接更新，对象在注册表的
+ *   生命周期内保持有效，调用点可以缓存返回的引用（同名同标签重复注册返回同一个对象）；
+ * - add_collector()注册的采集回调，只在采集时读取，热路径上没有任何开销。
+ *
+ * 注册和采集是线程安全的。
+ */
+class MetricsRegistry {
+public:
+    /**
+     * @brief 进程级的注册表，库内部的指标都注册在这里
+     */
+    static MetricsRegistry& global();
+    
+    MetricsRegistry();
+    ~MetricsRegistry();
+    
+    // 禁用拷贝构造和赋值
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+    
+    /**
+     * @brief 获取或创建计数器
+     * @param name 指标名称（Prometheus命名规则，计数器以_total结尾）
+     * @param help 说明
+     * @param labels 标签
+     */
+    Counter& counter(const string_t& name, const string_t& help, const MetricLabels& labels = {});
+    
+    /**
+     * @brief 获取或创建瞬时值
+     */
+    Gauge& gauge(const string_t& name, const string_t& help, const MetricLabels& labels = {});
+    
+    /**
+     * @brief 获取或创建延迟直方图，记录的单位为纳秒，导出时换算为秒
+     */
+    LatencyHistogram& histogram(const string_t& name, const string_t& help, const MetricLabels& labels = {});
+    
+    /**
+     * @brief 注册采集回调
+     * @return 回调编号，对象销毁前应调用remove_collector()
+     */
+    CollectorId add_collector(MetricsCollector collector);
+    
+    /**
+     * @brief 注销采集回调，返回后回调不会再被调用
+     */
+    void remove_collector(CollectorId id);
+    
+    /**
+     * @brief 采集全部指标，按名称排序
+     */
+    std::vector<MetricSample> collect() const;
+    
+    /**
+     * @brief 以Prometheus文本格式（0.0.4）输出全部指标
+     */
+    string_t render_prometheus() const;
+
+private:
+    struct Entry {
+        MetricType type;
+        string_t name;
+        string_t help;
+        MetricLabels labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+    
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::map<CollectorId, MetricsCollector> collectors_;
+    CollectorId next_collector_id_;
+    
+    Entry& find_or_create(MetricType type, const string_t& name, const string_t& help, const MetricLabels& labels);
+    Entry& create_entry(MetricType type, const string_t& name, const string_t& help, const MetricLabels& labels);
+};
+
+/**
+ * @brief 以Prometheus文本格式输出指标值
+ */
+string_t format_prometheus(const std::vector<MetricSample>& samples);
+
+// 指标导出方式
+enum class MetricsFormat {
+    PROMETHEUS,     // 在host:port上提供HTTP GET /metrics
+    STATSD          // 每push_interval_ms向host:port推送StatsD数据报
+};
+
+// 导出器配置
+struct MetricsExporterConfig {
+    MetricsFormat format = MetricsFormat::PROMETHEUS;
+    string_t host = "0.0.0.0";           // Prometheus的监听地址，或StatsD服务器地址
+    int port = 9464;                     // Prometheus为0时由系统选择端口
+    int push_interval_ms = 10000;        // StatsD推送间隔
+    string_t statsd_prefix = "udp2docker";
+    size_t max_datagram_size = 1400;     // 每个StatsD数据报的最大字节数
+};
+
+/**
+ * @brief 从配置快照读取导出器配置（metrics.format/host/port/push_interval_ms/statsd_prefix）
+ */
+MetricsExporterConfig make_metrics_exporter_config(const ConfigSnapshot& config,
+                                                   const MetricsExporterConfig& base = MetricsExporterConfig{});
+
+/**
+ * @brief 后台导出线程
+ *
+ * Prometheus方式下监听TCP端口，逐个处理抓取请求；StatsD方式下按间隔推送，
+ * 计数器发送与上次推送的差值（|c），瞬时值和延迟分位数发送当前值（|g，延迟单位毫秒）。
+ * StatsD没有标签，标签以".名称_值"追加到指标名。
+ */
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const MetricsExporterConfig& config = MetricsExporterConfig{},
+                             MetricsRegistry& registry = MetricsRegistry::global());
+    
+    /**
+     * @brief 析构函数，停止导出线程
+     */
+    ~MetricsExporter();
+    
+    // 禁用拷贝构造和赋值
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+    
+    /**
+     * @brief 创建套接字并启动导出线程
+     * @return 地址无效返回INVALID_ADDRESS，监听失败返回SOCKET_BIND_FAILED
+     */
+    ErrorCode start();
+    
+    /**
+     * @brief 停止导出线程并关闭套接字
+     */
+    void stop();
+    
+    bool is_running() const { return running_.load(); }
+    
+    /**
+     * @brief Prometheus方式下实际监听的端口
+     */
+    int get_port() const { return port_; }
+    
+    /**
+     * @brief 把一次采集格式化为StatsD数据报（更新计数器的上次推送值）
+     */
+    std::vector<string_t> format_statsd(const std::vector<MetricSample>& samples);
+    
+    /**
+     * @brief 立即推送一次（StatsD方式）
+     */
+    void push();
+
+private:
+    MetricsExporterConfig config_;
+    MetricsRegistry& registry_;
+    socket_handle_t socket_;
+    int port_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::map<string_t, uint64_t> last_counters_;   // 计数器上次推送的值
+    Endpoint statsd_endpoint_;
+    std::mutex push_mutex_;                         // 保护last_counters_
+    std::mutex wakeup_mutex_;
+    std::condition_variable wakeup_;
+    
+    void serve_prometheus();
+    void run_statsd();
+    void handle_scrape(socket_handle_t connection);
+    void close_socket();
+};
+
+} // namespace udp2docker
@@ -0,0 +1,338 @@
+#pragma once
+
+#include "common.h"
+#include "endpoint.h"
+#include "message_protocol.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace udp2docker {
+
+class UdpClient;
+
+// 确认位图的宽度，也是发送窗口的上限
+constexpr size_t SACK_BITMAP_BITS = 64;
+
+/**
+ * @brief 哈希时间轮
+ *
+ * 槽位按tick划分，超过一圈的定时器记录到期tick，在对应槽位上多转几圈。
+ * 不支持删除：调用方在到期时自行判断定时器是否仍然有效（惰性取消），
+ * 这样重传定时器的重置只是一次追加。非线程安全。
+ */
+class TimerWheel {
+public:
+    using clock_t = std::chrono::steady_clock;
+    
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10),
+                        size_t slot_count = 256);
+    
+    /**
+     * @brief 登记一个定时器
+     * @param deadline 到期时间，已过期的在下一次advance()时触发
+     * @param token 调用方定义的标识
+     */
+    void schedule(clock_t::time_point deadline, uint64_t token);
+    
+    /**
+     * @brief 推进到now，把到期的定时器追加到expired
+     */
+    void advance(clock_t::time_point now, std::vector<uint64_t>& expired);
+    
+    size_t size() const { return size_; }
+    
+    std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+    struct Item {
+        uint64_t token;
+        uint64_t expiry_tick;
+    };
+    
+    std::vector<std::vector<Item>> slots_;
+    std::chrono::milliseconds tick_;
+    clock_t::time_point origin_;
+    uint64_t current_tick_;   // 下一个待处理的tick
+    size_t size_;
+};
+
+/**
+ * @brief RTT估计器（RFC 6298）
+ *
+ * 平滑RTT和RTT偏差按1/8、1/4的增益更新，RTO = SRTT + 4 * RTTVAR，
+ * 并限制在[min_rto, max_rto]之间。重传过的消息不采样（Karn算法）。
+ */
+class RttEstimator {
+public:
+    RttEstimator(std::chrono::milliseconds initial_rto, std::chrono::milliseconds min_rto,
+                 std::chrono::milliseconds max_rto);
+    
+    void add_sample(std::chrono::microseconds rtt);
+    
+    std::chrono::microseconds rto() const { return rto_; }
+    std::chrono::microseconds smoothed_rtt() const { return srtt_; }
+    bool has_sample() const { return has_sample_; }
+
+private:
+    std::chrono::microseconds srtt_;
+    std::chrono::microseconds rttvar_;
+    std::chrono::microseconds rto_;
+    std::chrono::microseconds min_rto_;
+    std::chrono::microseconds max_rto_;
+    bool has_sample_;
+};
+
+/**
+ * @brief 选择性确认
+ *
+ * cumulative之前的序列号全部收到；bitmap第i位表示cumulative + 1 + i已收到。
+ * 编码在RESPONSE消息的元数据中（"ack"、"sack"），可随应用的响应捎带。
+ */
+struct AckInfo {
+    uint32_t cumulative = 0;
+    uint64_t bitmap = 0;
+    
+    /**
+     * @brief 序列号是否被确认
+     */
+    bool acknowledges(uint32_t sequence_id) const;
+    
+    void write_to(MetadataMap& metadata) const;
+    
+    static std::optional<AckInfo> read_from(const MetadataReader& metadata);
+};
+
+/**
+ * @brief 可靠投递配置
+ */
+struct ReliabilityConfig {
+    size_t window_size = SACK_BITMAP_BITS;       // 每个对端未确认消息数上限（不超过64）
+    size_t max_retries = 3;                      // 超过后放弃并报告TIMEOUT
+    int initial_rto_ms = 200;
+    int min_rto_ms = 20;
+    int max_rto_ms = 5000;
+    int ack_delay_ms = 0;                        // 延迟确认，期间发出的RESPONSE会捎带确认；0为立即确认
+    int timer_tick_ms = 10;                      // 时间轮精度
+    uint32_t reliable_types = 1u << static_cast<int>(MessageType::CONTROL);  // 按MessageType取位
+};
+
+// 发送数据报的函数，ReliableChannel通过它发出消息、重传和确认
+using DatagramSender = std::function<ErrorCode(BufferView datagram, const Endpoint& peer)>;
+// 可靠消息的投递结果：确认后为SUCCESS，重传耗尽为TIMEOUT
+using DeliveryCallback = std::function<void(uint32_t sequence_id, const Endpoint& peer, ErrorCode result)>;
+// 交给应用的消息（已去重），视图在回调返回前有效
+using ReliableMessageCallback = std::function<void(const MessageView& message, const Endpoint& from)>;
+
+/**
+ * @brief 可选的可靠投递层
+ *
+ * - 发送：reliable_types中的消息（默认只有CONTROL）使用每个对端独立的序列号，
+ *   置FLAG_RELIABLE后进入发送窗口，按RTT估计的超时在时间轮上重传，
+ *   直到被确认或重传max_retries次；其他消息（如DATA）直接发出，不做确认。
+ * - 接收：按序列号去重，以RESPONSE消息回复累计确认+64位选择性确认位图，
+ *   发送方只重传位图中缺失的消息。可靠消息在元数据"base"中携带发送方最早未确认的
+ *   序列号，接收方第一次收到某个对端的消息时从这里开始窗口。只保证不重复，不保证顺序。
+ *
+ * 收发各用一个MessageProtocol，通过configure_protocol()统一设置压缩/加密。
+ * tick()需要周期性调用（例如EventLoop::run_every），驱动重传和延迟确认。
+ * 所有方法都是线程安全的；回调中可以调用send()。
+ */
+class ReliableChannel {
+public:
+    using clock_t = std::chrono::steady_clock;
+    
+    /**
+     * @brief 统计信息
+     */
+    struct Statistics {
+        uint64_t reliable_sent = 0;
+        uint64_t unreliable_sent = 0;
+        uint64_t retransmissions = 0;
+        uint64_t delivered = 0;         // 收到确认的可靠消息
+        uint64_t timed_out = 0;         // 重传耗尽的可靠消息
+        uint64_t window_full = 0;       // 因窗口已满被拒绝的发送
+        uint64_t duplicates = 0;        // 接收方丢弃的重复消息
+        uint64_t acks_sent = 0;
+        uint64_t acks_received = 0;
+    };
+    
+    /**
+     * @brief 构造函数
+     * @param sender 数据报发送函数
+     * @param config 可靠投递配置
+     */
+    explicit ReliableChannel(DatagramSender sender, const ReliabilityConfig& config = ReliabilityConfig());
+    
+    /**
+     * @brief 通过UdpClient收发，重传次数取UdpConfig::max_retries
+     * @param client UDP客户端，生命周期需长于本对象
+     * @param config 可靠投递配置（max_retries被覆盖）
+     */
+    explicit ReliableChannel(UdpClient& client, ReliabilityConfig config = ReliabilityConfig());
+    
+    // 禁用拷贝构造和赋值
+    ReliableChannel(const ReliableChannel&) = delete;
+    ReliableChannel& operator=(const ReliableChannel&) = delete;
+    
+    /**
+     * @brief 以相同方式设置收发两个MessageProtocol（压缩、加密、最大消息大小等）
+     */
+    void configure_protocol(const std::function<void(MessageProtocol&)>& configure);
+    
+    /**
+     * @brief 设置投递结果回调（在不持有内部锁时调用）
+     */
+    void set_delivery_callback(DeliveryCallback callback);
+    
+    /**
+     * @brief 发送消息
+     *
+     * 可靠消息的sequence_id被替换为该对端的可靠序列号；RESPONSE消息会捎带
+     * 对该对端尚未发出的确认。
+     *
+     * @param message 要发送的消息
+     * @param peer 对端
+     * @return 消息的序列号；窗口已满返回QUEUE_FULL
+     */
+    Result<uint32_t> send(const Message& message, const Endpoint& peer);
+    
+    /**
+     * @brief 处理收到的数据报
+     *
+     * 处理其中的确认，为可靠消息回复确认，把新的消息交给callback。
+     * 只携带确认、没有负载的RESPONSE不交给应用。
+     *
+     * @param datagram 收到的数据报
+     * @param from 来源端点
+     * @param callback 应用消息回调
+     * @return 处理结果，无法解析返回PROTOCOL_ERROR
+     */
+    ErrorCode on_datagram(BufferView datagram, const Endpoint& from, const ReliableMessageCallback& callback);
+    
+    /**
+     * @brief 推进时间：重传超时的消息，发出到期的延迟确认
+     */
+    void tick(clock_t::time_point now = clock_t::now());
+    
+    /**
+     * @brief 对端未确认的可靠消息数
+     */
+    size_t in_flight(const Endpoint& peer) const;
+    
+    /**
+     * @brief 对端的平滑RTT，尚无样本返回0
+     */
+    std::chrono::microseconds smoothed_rtt(const Endpoint& peer) const;
+    
+    Statistics get_statistics() const;
+    
+    const ReliabilityConfig& get_config() const { return config_; }
+
+private:
+    struct Pending {
+        Endpoint peer;
+        uint32_t sequence_id = 0;
+        buffer_t frame;
+        clock_t::time_point sent_at;
+        clock_t::time_point deadline;
+        std::chrono::microseconds rto{0};
+        size_t retries = 0;
+    };
+    
+    // 发送方每个对端的状态（tx_mutex_保护）
+    struct SendState {
+        uint32_t next_sequence = 0;
+        std::unordered_map<uint32_t, uint64_t> in_flight;  // 序列号 -> pending_中的标识
+        RttEstimator rtt;
+        
+        explicit SendState(const ReliabilityConfig& config);
+    };
+    
+    // 接收方每个对端的状态（ack_mutex_保护）
+    struct ReceiveState {
+        uint32_t next_expected = 0;     // 之前的序列号都已收到
+        uint64_t bitmap = 0;            // next_expected之后已收到的序列号
+        bool ack_pending = false;
+        clock_t::time_point ack_deadline;
+    };
+    
+    enum class ReceiveOutcome {
+        NEW,
+        DUPLICATE,
+        OUT_OF_WINDOW     // 超出确认位图，不确认也不投递，等待发送方重传
+    };
+    
+    struct Delivery {
+        uint32_t sequence_id;
+        Endpoint peer;
+        ErrorCode result;
+    };
+    
+    ReliabilityConfig config_;
+    DatagramSender sender_;
+    
+    mutable std::mutex tx_mutex_;
+    MessageProtocol tx_protocol_;
+    std::unordered_map<Endpoint, SendState> send_states_;
+    std::unordered_map<uint64_t, Pending> pending_;
+    uint64_t next_pending_id_;
+    TimerWheel timers_;
+    std::vector<uint64_t> expired_;      // tick()的复用缓冲区
+    DeliveryCallback delivery_callback_;
+    
+    std::mutex rx_mutex_;
+    MessageProtocol rx_protocol_;
+    
+    mutable std::mutex ack_mutex_;   // 叶子锁，持有期间不获取其他锁
+    std::unordered_map<Endpoint, ReceiveState> receive_states_;
+    
+    struct Counters {
+        std::atomic<uint64_t> reliable_sent{0};
+        std::atomic<uint64_t> unreliable_sent{0};
+        std::atomic<uint64_t> retransmissions{0};
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> timed_out{0};
+        std::atomic<uint64_t> window_full{0};
+        std::atomic<uint64_t> duplicates{0};
+        std::atomic<uint64_t> acks_sent{0};
+        std::atomic<uint64_t> acks_received{0};
+    };
+    Counters counters_;
+    
+    bool is_reliable(MessageType type) const {
+        return (config_.reliable_types & (1u << static_cast<int>(type))) != 0;
+    }
+    
+    /**
+     * @brief 更新接收窗口并登记待发的确认
+     * @param window_base 消息携带的发送方窗口起点（元数据"base"）
+     * @param has_base 消息是否携带窗口起点，旧版本的对端不携带
+     * @param ack_now 输出：是否需要立即确认
+     */
+    ReceiveOutcome record_received(const Endpoint& from, uint32_t sequence_id, uint32_t window_base, bool has_base,
+                                   clock_t::time_point now, bool& ack_now);
+    
+    /**
+     * @brief next_expected已收到，前移接收窗口
+     */
+    static void advance_window(ReceiveState& state);
+    
+    /**
+     * @brief 取出对端待发的确认（清除延迟确认标记）
+     */
+    std::optional<AckInfo> take_ack(const Endpoint& peer, bool force);
+    
+    void send_ack(const Endpoint& peer, const AckInfo& ack);
+    
+    void handle_ack(const Endpoint& from, const AckInfo& ack, clock_t::time_point now,
+                    std::vector<Delivery>& deliveries);
+    
+    void notify(const std::vector<Delivery>& deliveries);
+    
+    SendState& send_state(const Endpoint& peer);
+};
+
+} // namespace udp2docker
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "common.h"
+#include "bounded_queue.h"
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace udp2docker {
+
+// 优先级数量（Priority::LOW..CRITICAL）
+constexpr size_t PRIORITY_LEVELS = 4;
+
+/**
+ * @brief 优先级在数组中的下标（LOW为0，CRITICAL为3），非法值按NORMAL处理
+ */
+inline size_t priority_index(Priority priority) {
+    int value = static_cast<int>(priority);
+    return (value >= 1 && value <= static_cast<int>(PRIORITY_LEVELS)) ? static_cast<size_t>(value - 1) : 1;
+}
+
+/**
+ * @brief 从序列化后的消息头读取优先级
+ * @param data 待发送的数据报
+ * @return 消息头中的优先级；不是协议消息（例如分片）返回NORMAL
+ */
+Priority classify_priority(BufferView data);
+
+/**
+ * @brief 令牌桶限速器
+ *
+ * 令牌按rate匀速补充，最多积累burst字节。超过burst的数据包在桶满时放行，
+ * 令牌余额变为负数，相当于向后借用。非线程安全。
+ */
+class TokenBucket {
+public:
+    using clock_t = std::chrono::steady_clock;
+    
+    /**
+     * @brief 构造函数
+     * @param rate_bytes_per_sec 速率，0表示不限速
+     * @param burst_bytes 桶容量
+     */
+    TokenBucket(double rate_bytes_per_sec = 0.0, size_t burst_bytes = 0);
+    
+    bool unlimited() const { return rate_ <= 0.0; }
+    
+    /**
+     * @brief 尝试消耗令牌
+     * @param bytes 数据包大小
+     * @param now 当前时间
+     * @param wait 输出：令牌不足时距离可以发送的时间
+     * @return 可以发送返回true（已扣除令牌）
+     */
+    bool try_consume(size_t bytes, clock_t::time_point now, std::chrono::nanoseconds& wait);
+
+private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    clock_t::time_point last_refill_;
+    bool started_;
+};
+
+/**
+ * @brief 发送调度配置
+ *
+ * 各数组按priority_index()索引（LOW, NORMAL, HIGH, CRITICAL）。
+ */
+struct SchedulerConfig {
+    size_t queue_capacity = 1024;                                // 每个优先级队列的容量
+    std::array<uint32_t, PRIORITY_LEVELS> weights = {1, 4, 16, 0};  // 加权公平份额，CRITICAL为严格优先不使用权重
+    size_t quantum_bytes = 4096;                                 // 每轮每单位权重的发送额度，0按1处理
+    std::array<double, PRIORITY_LEVELS> rate_limits = {0, 0, 0, 0};  // 每个优先级的速率上限（字节/秒），0为不限速
+    std::array<size_t, PRIORITY_LEVELS> burst_bytes = {65536, 65536, 65536, 65536};  // 令牌桶容量
+};
+
+/**
+ * @brief 按优先级调度的发送队列
+ *
+ * 每个优先级一个有界无锁队列，生产者入队不加锁。出队时：
+ * - CRITICAL严格优先，只要有数据（且未被限速）就先发；
+ * - LOW/NORMAL/HIGH按赤字轮询（DRR）加权公平调度，按字节计费，
+ *   高优先级获得更多带宽但不会饿死低优先级；
+ * - 配置了速率上限的优先级经令牌桶放行，被限速时让出给其他优先级。
+ *
+ * 出队一侧由一把互斥锁保护调度状态，多个发送线程可以同时调用try_pop()。
+ *
+ * @tparam T 队列元素类型
+ */
+template<typename T>
+class PriorityScheduler {
+public:
+    using clock_t = std::chrono::steady_clock;
+    
+    explicit PriorityScheduler(const SchedulerConfig& config)
+        : config_(config)
+        , cursor_(PRIORITY_LEVELS - 2)
+        , turn_started_(false)
+        , rate_limited_(false)
+        , freed_(false)
+    {
+        for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+            queues_[i] = std::make_unique<BoundedQueue<Entry>>(config.queue_capacity);
+            buckets_[i] = TokenBucket(config.rate_limits[i], config.burst_bytes[i]);
+            deficits_[i] = 0;
+            rate_limited_ = rate_limited_ || !buckets_[i].unlimited();
+        }
+        // 额度为0时赤字永远不增长，try_pop()会在锁内无限轮询
+        config_.quantum_bytes = std::max<size_t>(config_.quantum_bytes, 1);
+    }
+    
+    // 禁用拷贝构造和赋值
+    PriorityScheduler(const PriorityScheduler&) = delete;
+    PriorityScheduler& operator=(const PriorityScheduler&) = delete;
+    
+    /**
+     * @brief 尝试入队
+     * @param value 元素，成功时被移走
+     * @param priority 优先级
+     * @param bytes 计费字节数
+     * @return 该优先级队列已满返回false
+     */
+    bool try_push(T& value, Priority priority, size_t bytes) {
+        Entry entry{std::move(value), bytes};
+        if (queues_[priority_index(priority)]->try_push(entry)) {
+            return true;
+        }
+        value = std::move(entry.value);
+        return false;
+    }
+    
+    /**
+     * @brief 按调度策略取出下一个元素
+     * @param value 输出
+     * @param wait 输出：返回false且有数据被限速时，距离最早可以发送的时间；否则为0
+     * @param ignore_limits 为true时忽略速率限制（用于关闭前排空队列）
+     * @param freed 输出（可选）：是否有元素移出了优先级队列，即队列腾出了空位。
+     *              被限速时队首也会移出队列，返回false时仍可能为true
+     * @return 取到元素返回true
+     */
+    bool try_pop(T& value, std::chrono::nanoseconds& wait, bool ignore_limits = false, bool* freed = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        freed_ = false;
+        bool popped = pop_locked(value, wait, ignore_limits);
+        if (freed) {
+            *freed = freed_;
+        }
+        return popped;
+    }
+    
+    /**
+     * @brief 近似元素总数（含已取出待发的队首）
+     */
+    size_t approx_size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+            total += queues_[i]->approx_size();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& head : heads_) {
+            total += head ? 1 : 0;
+        }
+        return total;
+    }
+    
+    bool approx_empty() const { return approx_size() == 0; }
+    
+    /**
+     * @brief 某个优先级队列是否还有空位
+     */
+    bool has_space(Priority priority) const {
+        const auto& queue = queues_[priority_index(priority)];
+        return queue->approx_size() < queue->capacity();
+    }
+
+private:
+    struct Entry {
+        T value;
+        size_t bytes = 0;
+    };
+    
+    SchedulerConfig config_;
+    std::array<std::unique_ptr<BoundedQueue<Entry>>, PRIORITY_LEVELS> queues_;
+    
+    mutable std::mutex mutex_;   // 保护以下出队调度状态
+    std::array<std::optional<Entry>, PRIORITY_LEVELS> heads_;   // 已出队但尚未发出的队首
+    std::array<TokenBucket, PRIORITY_LEVELS> buckets_;
+    std::array<int64_t, PRIORITY_LEVELS> deficits_;
+    size_t cursor_;              // 当前轮到的优先级（仅LOW..HIGH）
+    bool turn_started_;
+    bool rate_limited_;          // 是否有优先级配置了限速
+    bool freed_;                 // 本次try_pop()是否从队列中移出过元素
+    
+    // 调用方持有mutex_
+    bool pop_locked(T& value, std::chrono::nanoseconds& wait, bool ignore_limits) {
+        wait = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds limited_wait = std::chrono::nanoseconds::max();
+        bool limited = false;
+        clock_t::time_point now = rate_limited_ && !ignore_limits ? clock_t::now() : clock_t::time_point();
+        
+        constexpr size_t critical = PRIORITY_LEVELS - 1;
+        if (admit(critical, now, ignore_limits, limited_wait, limited)) {
+            return take(critical, value);
+        }
+        
+        // 赤字轮询：每个优先级轮到时增加quantum * weight的额度，额度够发队首就发
+        size_t idle_visits = 0;
+        while (idle_visits < critical * 2) {
+            size_t index = cursor_;
+            if (!turn_started_) {
+                deficits_[index] += static_cast<int64_t>(config_.quantum_bytes) * std::max<uint32_t>(config_.weights[index], 1);
+                turn_started_ = true;
+            }
+            
+            if (!peek(index)) {
+                // 空队列不积累额度
+                deficits_[index] = 0;
+                next_turn();
+                ++idle_visits;
+                continue;
+            }
+            
+            if (deficits_[index] >= static_cast<int64_t>(heads_[index]->bytes)) {
+                if (admit(index, now, ignore_limits, limited_wait, limited)) {
+                    deficits_[index] -= static_cast<int64_t>(heads_[index]->bytes);
+                    return take(index, value);
+                }
+                // 被限速时不继续积累额度，放行后不会突发
+                deficits_[index] = static_cast<int64_t>(heads_[index]->bytes);
+                next_turn();
+                ++idle_visits;
+                continue;
+            }
+            
+            // 额度不足，保留赤字到下一轮
+            next_turn();
+            idle_visits = 0;
+        }
+        
+        if (limited) {
+            wait = limited_wait;
+        }
+        return false;
+    }
+    
+    bool peek(size_t index) {
+        if (!heads_[index]) {
+            Entry entry;
+            if (!queues_[index]->try_pop(entry)) {
+                return false;
+            }
+            heads_[index] = std::move(entry);
+            freed_ = true;
+        }
+        return true;
+    }
+    
+    bool admit(size_t index, clock_t::time_point now, bool ignore_limits,
+               std::chrono::nanoseconds& wait, bool& limited) {
+        if (!peek(index)) {
+            return false;
+        }
+        if (ignore_limits || buckets_[index].unlimited()) {
+            return true;
+        }
+        
+        std::chrono::nanoseconds delay(0);
+        if (buckets_[index].try_consume(heads_[index]->bytes, now, delay)) {
+            return true;
+        }
+        limited = true;
+        wait = std::min(wait, delay);
+        return false;
+    }
+    
+    bool take(size_t index, T& value) {
+        value = std::move(heads_[index]->value);
+        heads_[index].reset();
+        return true;
+    }
+    
+    void next_turn() {
+        // 从高到低轮询：HIGH -> NORMAL -> LOW -> HIGH
+        cursor_ = cursor_ == 0 ? PRIORITY_LEVELS - 2 : cursor_ - 1;
+        turn_started_ = false;
+    }
+};
+
+} // namespace udp2docker
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "common.h"
+#include "bounded_queue.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace udp2docker {
+
+/**
+ * @brief 低精度的当前时间
+ *
+ * Linux下读取CLOCK_REALTIME_COARSE（精度为一个时钟节拍，通常1-4毫秒），
+ * 开销远低于system_clock::now()，用于每个数据包都要更新的活动时间戳。
+ * 其他平台退化为system_clock::now()。
+ */
+time_point_t coarse_now();
+
+/**
+ * @brief 单调时钟的纳秒读数，用于测量耗时
+ */
+inline uint64_t monotonic_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+namespace detail {
+
+/**
+ * @brief 当前线程使用的计数器分条下标
+ *
+ * 线程首次调用时按顺序分配，线程数不超过分条数时每个线程独占一个分条。
+ */
+size_t stats_stripe_index();
+
+} // namespace detail
+
+// 统计计数器分条数
+constexpr size_t STATS_STRIPES = 16;
+
+/**
+ * @brief 直方图快照
+ */
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts;   // 各桶计数，下标含义见LatencyHistogram
+    uint64_t count = 0;
+    uint64_t max = 0;
+    
+    /**
+     * @brief 计算分位数
+     * @param quantile 分位（0-1），例如0.99
+     * @return 分位数所在桶的上界（纳秒），没有样本返回0
+     */
+    uint64_t percentile(double quantile) const;
+    
+    /**
+     * @brief 以各桶中点估算的平均值（纳秒）
+     */
+    double mean() const;
+    
+    /**
+     * @brief 累加另一个快照
+     */
+    void merge(const HistogramSnapshot& other);
+};
+
+/**
+ * @brief HDR风格的延迟直方图
+ *
+ * 桶按对数-线性划分：每个2的幂区间再均分为16个子桶，相对误差不超过6.25%，
+ * 覆盖1纳秒到约9分钟。记录一个样本只是一次relaxed原子加法，没有锁，
+ * 可由多个线程同时记录；读取快照时不会阻塞记录方。
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 16;
+    static constexpr size_t MAX_MAGNITUDE = 39;
+    static constexpr size_t BUCKET_COUNT = (MAX_MAGNITUDE - 2) * SUB_BUCKETS;
+    
+    LatencyHistogram();
+    
+    // 禁用拷贝构造和赋值
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+    
+    /**
+     * @brief 记录一个样本
+     * @param value_ns 耗时（纳秒），超出范围的值计入最后一个桶
+     */
+    void record(uint64_t value_ns) {
+        buckets_[bucket_index(value_ns)].fetch_add(1, std::memory_order_relaxed);
+        if (value_ns > max_.load(std::memory_order_relaxed)) {
+            update_max(value_ns);
+        }
+    }
+    
+    HistogramSnapshot snapshot() const;
+    
+    void reset();
+    
+    /**
+     * @brief 复制另一个直方图的计数（用于对象移动，不应与记录并发）
+     */
+    void assign(const LatencyHistogram& other);
+    
+    /**
+     * @brief 计算样本所在的桶
+     */
+    static size_t bucket_index(uint64_t value);
+    
+    /**
+     * @brief 桶的取值上界（不含）
+     */
+    static uint64_t bucket_upper_bound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> max_;
+    
+    void update_max(uint64_t value);
+};
+
+} // namespace udp2docker
@@ -1,27 +1,192 @@
 #pragma once
 
 #include "common.h"
+#include "buffer_pool.h"
+#include "event_loop.h"
+#include "bounded_queue.h"
+#include "send_scheduler.h"
+#include "statistics.h"
+#include "endpoint.h"
+#include "metrics.h"
+#include "capture.h"
+#include <array>
 #include <functional>
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <list>
+#include <optional>
 #include <queue>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace udp2docker {
 
+// 异步发送队列满时的处理策略
+enum class BackpressurePolicy {
+    BLOCK,      // 阻塞调用方直到队列有空位
+    DROP,       // 丢弃新数据包并计入统计，回调收到QUEUE_FULL
+    FAIL        // 立即返回QUEUE_FULL，不调用回调
+};
+
+// 套接字地址族
+enum class IpFamily {
+    AUTO,       // 优先使用IPv6双栈套接字（IPV6_V6ONLY=0），系统不支持IPv6时退回IPv4
+    IPV4,       // 仅IPv4
+    IPV6        // 仅IPv6（IPV6_V6ONLY=1）
+};
+
+// 路径MTU发现方式（IP_MTU_DISCOVER/IPV6_MTU_DISCOVER，仅Linux）
+enum class PathMtuDiscovery {
+    SYSTEM,     // 不修改，使用系统默认
+    DONT,       // 不设置DF，超过路径MTU的数据报由路由器分片
+    DO,         // 设置DF，超过路径MTU的发送返回EMSGSIZE，配合Fragmenter使用
+    PROBE       // 设置DF并忽略已知的路径MTU，用于主动探测
+};
+
+// 内核接收时间戳（SO_TIMESTAMPING，仅Linux批量接收）
+enum class ReceiveTimestamps {
+    NONE,
+    SOFTWARE,   // 协议栈收到数据包时的软件时间戳
+    HARDWARE    // 网卡硬件时间戳，需要事先通过SIOCSHWTSTAMP开启网卡的时间戳功能
+};
+
+// 异步接收使用的I/O引擎
+enum class IoEngine {
+    SOCKET,     // 事件循环监视套接字，可读时recvmmsg批量接收
+    IO_URING    // io_uring多次触发的RECVMSG和提供缓冲区环（仅Linux 6.0+），不可用时退回SOCKET
+};
+
 // UDP连接配置结构
 struct UdpConfig {
     string_t server_host = DEFAULT_HOST;
     int server_port = DEFAULT_PORT;
     int timeout_ms = DEFAULT_TIMEOUT_MS;
-    size_t max_retries = 3;
+    size_t max_retries = 3;              // ReliableChannel重传可靠消息的最大次数
     bool enable_keep_alive = true;
     int keep_alive_interval_ms = 30000;
+    bool enable_gso = true;              // 批量发送时尝试使用UDP GSO（仅Linux）
+    size_t receive_batch_size = 16;      // 异步接收时每次系统调用最多接收的数据包数
+    size_t max_batches_per_wakeup = 64;  // 事件循环每次唤醒最多连续接收的批次数，保证多客户端间公平
+    size_t send_queue_capacity = 4096;   // 异步发送队列容量
+    size_t send_worker_threads = 1;      // 异步发送工作线程数
+    BackpressurePolicy send_backpressure = BackpressurePolicy::BLOCK;
+    bool enable_priority_scheduling = false;  // 异步发送按消息头优先级调度（CRITICAL严格优先，其余加权公平）
+    SchedulerConfig scheduler;           // 优先级调度的队列容量、权重和限速，启用时取代send_queue_capacity
+    string_t local_host = "";            // 绑定的本地地址（IPv4或IPv6字面量），为空表示任意地址
+    int local_port = 0;                  // 绑定的本地端口，为0、local_host为空且未启用reuse_port时不显式绑定
+    bool reuse_port = false;             // 设置SO_REUSEPORT，允许多个套接字绑定同一端口由内核分流
+    int receive_cpu = -1;                // 自建事件循环时接收线程绑定的CPU（仅Linux），-1表示不绑定
+    int incoming_cpu = -1;               // 设置SO_INCOMING_CPU（仅Linux），尽力而为的提示：SO_REUSEPORT组内内核按哈希选择套接字，
+                                         // 基本不参考该值，真正按CPU分流需用UdpClientGroup的ReuseportSteering::CPU_BPF
+    bool enable_latency_histograms = true;  // 记录发送系统调用和接收回调的耗时分布
+    bool enable_metrics = true;          // 初始化后在MetricsRegistry::global()中导出统计、发送队列深度和延迟分布（标签port为本地端口）
+    bool connect_default_peer = false;   // 将套接字connect()到默认服务器，发送时内核不再逐包查路由；之后只能收到该对端的数据
+    size_t address_cache_size = 64;      // 显式目标主机名解析结果的LRU缓存条目数（未命中时在调用线程上同步解析）
+    int address_cache_ttl_ms = 60000;    // 缓存条目的有效期，过期后仍使用旧地址并在后台重新解析；0为永不过期
+    IpFamily ip_family = IpFamily::AUTO;
+    int receive_buffer_size = 0;         // SO_RCVBUF字节数，0为系统默认；内核实际值见get_receive_buffer_size()
+    int send_buffer_size = 0;            // SO_SNDBUF字节数，0为系统默认
+    int busy_poll_us = 0;                // SO_BUSY_POLL：阻塞接收时在网卡队列上忙等的微秒数，0为不启用（仅Linux）
+    int dscp = -1;                       // 所有数据包的DSCP（0-63，写入IP_TOS/IPV6_TCLASS高6位），-1为不设置
+    std::array<int, PRIORITY_LEVELS> priority_dscp = {-1, -1, -1, -1};  // 按消息头优先级覆盖dscp，-1为沿用dscp（单包发送，仅POSIX）
+    ReceiveTimestamps receive_timestamps = ReceiveTimestamps::NONE;
+    PathMtuDiscovery mtu_discovery = PathMtuDiscovery::SYSTEM;
+    IoEngine io_engine = IoEngine::SOCKET;
+    size_t io_uring_buffers = 64;        // io_uring提供缓冲区数量（2的幂），每个可容纳MAX_BUFFER_SIZE字节的数据报
+    string_t capture_file = "";          // 非空时initialize()后开始抓包（见start_capture()）
+    size_t capture_capacity_mb = 64;     // 抓包环形文件的数据区大小
+};
+
+class ConfigSnapshot;
+class IoUringReceiver;
+
+/**
+ * @brief 从配置快照读取UdpConfig
+ *
+ * 读取server.host/port、client.*和socket.*配置项（见README配置项说明），
+ * 快照中没有的配置项保持base中的值。
+ *
+ * @param config 配置快照（ConfigManager::snapshot()）
+ * @param base 基础配置
+ */
+UdpConfig make_udp_config(const ConfigSnapshot& config, const UdpConfig& base = UdpConfig{});
+
+/**
+ * @brief 接收数据报的只读视图
+ * 
+ * 数据指向ReceiveRing中的槽位，仅在同一个ReceiveRing下一次接收之前有效。
+ */
+struct PacketView {
+    BufferView data;
+    Endpoint from;
+    bool truncated = false;              // 数据报超过槽位大小被截断
+    uint64_t kernel_timestamp_ns = 0;    // 内核接收时间戳（CLOCK_REALTIME纪元以来的纳秒），未启用receive_timestamps时为0
+    
+    string_t from_host() const { return from.host(); }
+    int from_port() const { return from.port(); }
+};
+
+/**
+ * @brief 预分配的接收槽位环
+ * 
+ * 所有槽位在构造时一次性分配，之后的每次批量接收都复用这些槽位，
+ * 接收路径上不再产生内存分配。Linux下配合recvmmsg一次系统调用填充多个槽位。
+ */
+class ReceiveRing {
+public:
+    /**
+     * @brief 构造函数
+     * @param slot_count 槽位数量（单次最多接收的数据包数）
+     * @param slot_size 每个槽位的大小
+     */
+    explicit ReceiveRing(size_t slot_count = 16, size_t slot_size = MAX_BUFFER_SIZE);
+    
+    size_t capacity() const { return slot_count_; }
+    size_t slot_size() const { return slot_size_; }
+    
+    /**
+     * @brief 最近一次接收到的数据包数量
+     */
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    
+    const PacketView& operator[](size_t index) const { return packets_[index]; }
+    const PacketView* begin() const { return packets_.data(); }
+    const PacketView* end() const { return packets_.data() + count_; }
+
+private:
+    friend class UdpClient;
+    friend class IoUringReceiver;
+    
+    byte* slot(size_t index) { return storage_.data() + index * slot_size_; }
+    
+    size_t slot_count_;
+    size_t slot_size_;
+    size_t count_;
+    buffer_t storage_;
+    std::vector<PacketView> packets_;
+    std::vector<sockaddr_storage> names_;
+#ifdef __linux__
+    // 每个槽位的控制消息缓冲区，足够容纳一个SCM_TIMESTAMPING
+    static constexpr size_t CONTROL_WORDS = 8;
+    
+    /**
+     * @brief 从控制消息中取出SCM_TIMESTAMPING时间戳（纳秒），没有时返回0
+     */
+    static uint64_t kernel_timestamp(const msghdr& header);
+    
+    std::vector<mmsghdr> msgs_;
+    std::vector<iovec> iovs_;
+    std::vector<uint64_t> controls_;
+#endif
 };
 
 // 消息回调函数类型
 using MessageCallback = std::function<void(const buffer_t&, const string_t& from_host, int from_port)>;
+using EndpointCallback = std::function<void(const buffer_t&, const Endpoint& from)>;
+using PacketCallback = std::function<void(const PacketView& packet)>;
 using ErrorCallback = std::function<void(ErrorCode error_code, const string_t& error_message)>;
 
 /**
@@ -29,7 +194,7 @@ using ErrorCallback = std::function<void(ErrorCode error_code, const string_t& e
  * 
  * 该类提供了完整的UDP客户端功能，包括：
  * - 发送和接收UDP数据包
- * - 异步通信支持
+ * - 异步通信支持（基于事件循环，可多个客户端共享一个线程）
  * - 连接管理和错误处理
  * - 心跳保持连接
  */
@@ -74,6 +239,11 @@ public:
     /**
      * @brief 同步发送数据
      * @param data 要发送的数据
+     * 显式的target_host为主机名时查address_cache_size的缓存，未命中时在调用线程上
+     * 同步解析（getaddrinfo可能阻塞数秒）。对延迟敏感的线程（发送线程、事件循环）
+     * 应使用IP字面量、默认服务器，或预先发送一次让主机名进入缓存。缓存条目超过
+     * address_cache_ttl_ms后在后台重新解析，期间继续使用旧地址。
+     * 
      * @param target_host 目标主机（可选，默认使用配置中的主机）
      * @param target_port 目标端口（可选，默认使用配置中的端口）
      * @return 发送结果
@@ -82,6 +252,17 @@ public:
                    const string_t& target_host = "", 
                    int target_port = 0);
     
+    /**
+     * @brief 同步发送池化缓冲区中的数据
+     * @param data 要发送的数据
+     * @param target_host 目标主机（可选，默认使用配置中的主机）
+     * @param target_port 目标端口（可选，默认使用配置中的端口）
+     * @return 发送结果
+     */
+    ErrorCode send(const PooledBuffer& data,
+                   const string_t& target_host = "",
+                   int target_port = 0);
+    
     /**
      * @brief 同步发送字符串数据
      * @param message 要发送的字符串
@@ -93,17 +274,98 @@ public:
                          const string_t& target_host = "",
                          int target_port = 0);
     
+    /**
+     * @brief 批量发送数据包
+     * 
+     * Linux下使用sendmmsg一次系统调用发送多个数据包；当数据包长度一致且内核
+     * 支持UDP_SEGMENT时使用GSO进一步合并。其他平台退化为逐包发送。
+     * 目标地址只解析一次，统计信息每批更新一次。
+     * 
+     * @param packets 数据包数组
+     * @param count 数据包数量
+     * @param target_host 目标主机
+     * @param target_port 目标端口
+     * @return 成功发送的数据包数量；若一个都未发送成功则返回错误码
+     */
+    Result<size_t> send_batch(const BufferView* packets, size_t count,
+                              const string_t& target_host = "",
+                              int target_port = 0);
+    
+    /**
+     * @brief 批量发送数据包
+     * @param packets 数据包列表
+     * @param target_host 目标主机
+     * @param target_port 目标端口
+     * @return 成功发送的数据包数量
+     */
+    Result<size_t> send_batch(const std::vector<buffer_t>& packets,
+                              const string_t& target_host = "",
+                              int target_port = 0);
+    
+    /**
+     * @brief 分散/聚集发送，多个片段组成一个数据报
+     * 
+     * 可与MessageProtocol::serialize_parts配合使用，头部和负载无需拼接。
+     * 
+     * @param parts 片段数组（最多MAX_GATHER_PARTS个）
+     * @param count 片段数量
+     * @param target_host 目标主机（为空则使用配置中的服务器地址）
+     * @param target_port 目标端口（为0则使用配置中的服务器端口）
+     * @return 发送结果
+     */
+    ErrorCode send_gather(const BufferView* parts, size_t count,
+                          const string_t& target_host = "",
+                          int target_port = 0);
+    
+    /**
+     * @brief 发送到二进制端点，不经过主机名解析
+     * 
+     * 适合回复EndpointCallback/PacketView中的来源地址。
+     * 
+     * @param data 要发送的数据
+     * @param target 目标端点
+     * @return 发送结果，IPv6端点用于IPv4套接字时返回INVALID_ADDRESS
+     */
+    ErrorCode send_to(BufferView data, const Endpoint& target);
+    
     /**
      * @brief 异步发送数据
+     * 
+     * 数据以移动方式进入有界无锁发送队列，由固定数量的发送线程处理。
+     * 队列满时按config.send_backpressure处理。回调在发送线程中执行。
+     * 启用enable_priority_scheduling时，按数据中消息头的优先级进入对应的队列，
+     * 高优先级的控制消息不会排在大量DATA之后。
+     * close()会先发送完队列中剩余的数据再关闭套接字；close()开始后的调用和
+     * 与close()竞争未能发出的请求以SOCKET_SEND_FAILED完成。
+     * 回调总会被调用一次，入队失败时以返回的错误码同步调用。
+     * 
+     * @param data 要发送的数据（调用方可std::move传入以避免拷贝）
+     * @param callback 发送完成回调
+     * @param target_host 目标主机
+     * @param target_port 目标端口
+     * @return 入队结果，DROP/FAIL策略下队列满返回QUEUE_FULL
+     */
+    ErrorCode send_async(buffer_t data,
+                         std::function<void(ErrorCode)> callback,
+                         const string_t& target_host = "",
+                         int target_port = 0);
+    
+    /**
+     * @brief 异步发送池化缓冲区中的数据
+     * 
+     * 入队只移动引用，发送线程发送完释放最后一个引用时块回到分配线程的缓冲池，
+     * 整个过程不经过malloc。其他行为与buffer_t版本相同。
+     * 
      * @param data 要发送的数据
      * @param callback 发送完成回调
      * @param target_host 目标主机
      * @param target_port 目标端口
+     * @return 入队结果
      */
-    void send_async(const buffer_t& data,
-                    std::function<void(ErrorCode)> callback,
-                    const string_t& target_host = "",
-                    int target_port = 0);
+    ErrorCode send_async(PooledBuffer data,
+                         std::function<void(ErrorCode)> callback,
+                         const string_t& target_host = "",
+                         int target_port = 0);
     
     /**
      * @brief 同步接收数据
@@ -114,6 +376,38 @@ public:
      */
     Result<size_t> receive(buffer_t& buffer, string_t& from_host, int& from_port);
     
+    /**
+     * @brief 同步接收数据，来源以二进制端点返回
+     * @param buffer 接收数据的缓冲区
+     * @param from 发送方端点（输出参数）
+     * @return 接收结果，成功返回接收到的字节数
+     */
+    Result<size_t> receive(buffer_t& buffer, Endpoint& from);
+    
+    /**
+     * @brief 批量接收数据到预分配的槽位环
+     * 
+     * 阻塞直到至少收到一个数据包（受超时设置约束），然后在不阻塞的前提下
+     * 尽可能填满ring。接收结果通过ring[i]以视图形式访问。
+     * 
+     * @param ring 接收槽位环
+     * @return 接收到的数据包数量
+     */
+    Result<size_t> receive_batch(ReceiveRing& ring);
+    
+    /**
+     * @brief 指定异步接收使用的事件循环
+     * 
+     * 多个UdpClient可以共享同一个事件循环，由一个线程服务所有客户端。
+     * 调用方负责启动该事件循环（EventLoop::start或run）。未指定时，
+     * 启动异步接收会创建一个由本客户端私有的事件循环线程。
+     * 必须在启动异步接收之前调用。
+     * 
+     * @param loop 事件循环
+     * @return 设置结果
+     */
+    ErrorCode set_event_loop(std::shared_ptr<EventLoop> loop);
+    
     /**
      * @brief 启动异步接收模式
      * @param message_callback 消息接收回调
@@ -123,11 +417,75 @@ public:
     ErrorCode start_receive_async(MessageCallback message_callback,
                                  ErrorCallback error_callback = nullptr);
     
+    /**
+     * @brief 启动异步接收模式，来源以二进制端点传给回调
+     * 
+     * 与MessageCallback版本相比，每个数据包不再格式化来源地址字符串。
+     * 
+     * @param endpoint_callback 消息接收回调
+     * @param error_callback 错误处理回调
+     * @return 启动结果
+     */
+    ErrorCode start_receive_async(EndpointCallback endpoint_callback,
+                                 ErrorCallback error_callback = nullptr);
+    
+    /**
+     * @brief 启动批量异步接收模式
+     * 
+     * 每次系统调用最多接收config.receive_batch_size个数据包，回调收到的是
+     * 指向接收槽位的视图，回调返回后视图失效，需要保留的数据应自行拷贝。
+     * 
+     * @param packet_callback 数据包回调
+     * @param error_callback 错误处理回调
+     * @return 启动结果
+     */
+    ErrorCode start_receive_batch_async(PacketCallback packet_callback,
+                                       ErrorCallback error_callback = nullptr);
+    
     /**
      * @brief 停止异步接收
      */
     void stop_receive_async();
     
+    /**
+     * @brief 获取本地绑定端口
+     * @return 本地端口，套接字尚未绑定时返回0
+     */
+    int get_local_port() const;
+    
+    /**
+     * @brief 获取本地绑定端点
+     * @return 本地端点，未初始化时返回无效端点
+     */
+    Endpoint get_local_endpoint() const;
+    
+    /**
+     * @brief 内核实际使用的接收缓冲区大小
+     * @return 字节数（Linux下包含内核记账开销，为设置值的两倍），未初始化返回-1
+     */
+    int get_receive_buffer_size() const;
+    
+    /**
+     * @brief 内核实际使用的发送缓冲区大小
+     * @return 字节数，未初始化返回-1
+     */
+    int get_send_buffer_size() const;
+    
+    /**
+     * @brief 异步接收实际使用的I/O引擎（io_uring不可用时为SOCKET）
+     */
+    IoEngine get_io_engine() const;
+    
+    /**
+     * @brief 套接字是否为AF_INET6（含双栈）
+     */
+    bool uses_ipv6() const { return socket_ipv6_; }
+    
+    /**
+     * @brief 获取底层套接字句柄
+     */
+    socket_handle_t native_handle() const { return socket_; }
+    
     /**
      * @brief 设置超时时间
      * @param timeout_ms 超时时间（毫秒）
@@ -136,12 +494,17 @@ public:
     
     /**
      * @brief 获取当前配置
-     * @return UDP配置
+     * @return UDP配置的副本（包括已更新、下次initialize()才生效的设置）
      */
-    const UdpConfig& get_config() const;
+    UdpConfig get_config() const;
     
     /**
      * @brief 更新配置
+     *
+     * 不重建套接字：超时立即通过setsockopt生效，心跳设置变化时重新登记定时器，
+     * 默认服务器变化时重新解析。套接字选项、绑定地址等创建时确定的设置要重新
+     * initialize()才生效。可以在收发进行中从其他线程调用（例如ConfigWatcher）。
+     *
      * @param config 新的配置
      * @return 更新结果
      */
@@ -157,19 +520,106 @@ public:
         size_t bytes_received = 0;
         size_t send_errors = 0;
         size_t receive_errors = 0;
+        size_t send_queue_drops = 0;
         time_point_t last_activity;
     };
     
+    /**
+     * @brief 汇总各线程的计数
+     *
+     * 计数按线程分条累加，读取时不阻塞收发路径，各字段之间不保证是同一时刻的值。
+     * last_activity为低精度时钟的时间，误差在毫秒级。
+     */
     Statistics get_statistics() const;
     
     /**
-     * @brief 重置统计信息
+     * @brief 获取发送系统调用的耗时分布（纳秒）
+     *
+     * 批量发送时每次sendmmsg/sendmsg调用记录一个样本。
+     */
+    HistogramSnapshot get_send_latency() const;
+    
+    /**
+     * @brief 获取异步接收回调的耗时分布（纳秒）
+     */
+    HistogramSnapshot get_callback_latency() const;
+    
+    /**
+     * @brief 重置统计信息和延迟直方图
      */
     void reset_statistics();
+    
+    /**
+     * @brief 开始抓包
+     *
+     * 之后成功发送和接收的每个数据报连同时间戳和对端写入内存映射的环形文件（见CaptureWriter），
+     * 可用replay_capture()或udp2docker_replay回放。收发进行中也可以调用；未抓包时收发路径上
+     * 只多一次relaxed原子读取。
+     *
+     * @param config 抓包配置，已在抓包时先关闭原来的文件
+     */
+    ErrorCode start_capture(const CaptureConfig& config);
+    
+    /**
+     * @brief 停止抓包并关闭文件
+     */
+    void stop_capture();
+    
+    bool is_capturing() const { return capture_enabled_.load(std::memory_order_relaxed); }
+    
+    CaptureWriter::Statistics get_capture_statistics() const;
 
 private:
+    // 默认服务器地址的解析状态
+    enum class ResolveState : int {
+        UNRESOLVED,
+        RESOLVING,
+        READY,
+        FAILED
+    };
+    
+    // 解析后的发送目标，connected为true时目标是已连接的默认对端，发送时不携带地址
+    struct SendTarget {
+        sockaddr_storage addr{};
+        socklen_t length = 0;
+        bool connected = false;
+        uint64_t connection = 0;     // 连接时的connection_generation_
+        
+        const sockaddr* name() const { return connected ? nullptr : reinterpret_cast<const sockaddr*>(&addr); }
+        socklen_t name_length() const { return connected ? 0 : length; }
+    };
+    
+    // 异步发送请求
+    struct SendRequest {
+        buffer_t data;
+        PooledBuffer pooled;         // 非空时取代data
+        string_t target_host;
+        int target_port = 0;
+        std::function<void(ErrorCode)> callback;
+        
+        BufferView view() const { return pooled.empty() ? BufferView(data) : pooled.view(); }
+    };
+    
+    // 默认服务器及其解析结果，发布后不再修改；解析完成或update_config()时整体替换，
+    // 通过std::atomic_load/atomic_store读写
+    struct DefaultPeer {
+        string_t host;
+        int port = 0;
+        bool connect = false;
+        bool resolved = false;       // endpoint和target有效
+        Endpoint endpoint;
+        SendTarget target;
+    };
+    
     // 私有成员变量
+    // 创建时确定的设置在初始化期间不变，收发线程直接读取；在线更新的设置由读取它们的
+    // 模块的锁保护：心跳设置由keep_alive_mutex_，address_cache_size/ttl由address_cache_mutex_，
+    // 超时改读timeout_ms_，默认服务器改读default_peer_
     UdpConfig config_;
+    mutable std::mutex config_mutex_;            // 串行化initialize()和update_config()，保护以下两个成员
+    std::optional<UdpConfig> pending_config_;    // 已初始化时update_config()收到的完整配置，下次initialize()采用
+    bool config_live_;                           // 已初始化，update_config()在线应用设置
+    std::shared_ptr<const DefaultPeer> default_peer_;
     
 #ifdef _WIN32
     SOCKET socket_;
@@ -177,29 +627,146 @@ private:
 #else
     int socket_;
 #endif
+    bool socket_ipv6_;
+    std::array<int, PRIORITY_LEVELS> priority_tos_;   // 各优先级的TOS字节，-1为使用套接字默认值
+    bool priority_tos_enabled_;
     
     std::atomic<bool> is_initialized_;
     std::atomic<bool> is_receiving_;
-    std::atomic<bool> should_stop_;
+    std::atomic<bool> gso_supported_;
+    
+    // 按线程分条的统计计数器，每个分条独占一个缓存行
+    struct alignas(CACHE_LINE_SIZE) StatsStripe {
+        std::atomic<uint64_t> packets_sent{0};
+        std::atomic<uint64_t> packets_received{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> bytes_received{0};
+        std::atomic<uint64_t> send_errors{0};
+        std::atomic<uint64_t> receive_errors{0};
+        std::atomic<uint64_t> send_queue_drops{0};
+        std::atomic<int64_t> last_activity{0};   // system_clock纪元以来的时钟周期数
+        
+        void assign(const StatsStripe& other);
+    };
+    
+    std::array<StatsStripe, STATS_STRIPES> stats_;
+    LatencyHistogram send_latency_;
+    LatencyHistogram callback_latency_;
     
-    mutable std::mutex stats_mutex_;
-    Statistics stats_;
+    std::shared_ptr<EventLoop> event_loop_;
+    bool owns_event_loop_;
+    std::mutex keep_alive_mutex_;        // 保护keep_alive_timer_、心跳设置和is_receiving_的切换
+    TimerId keep_alive_timer_;
+    std::unique_ptr<ReceiveRing> receive_ring_;
+    std::unique_ptr<IoUringReceiver> io_uring_;
+    buffer_t receive_buffer_;
+    string_t receive_host_;
     
-    std::thread receive_thread_;
-    std::thread keep_alive_thread_;
+    std::unique_ptr<BoundedQueue<SendRequest>> send_queue_;
+    std::unique_ptr<PriorityScheduler<SendRequest>> send_scheduler_;
+    std::vector<std::thread> send_workers_;
+    std::mutex send_mutex_;
+    std::shared_mutex send_producers_mutex_;   // send_async()入队期间共享持有，stop_send_workers()释放队列前独占
+    std::condition_variable send_ready_;
+    std::condition_variable send_space_;
+    std::atomic<int> idle_send_workers_;
+    std::atomic<int> blocked_senders_;
+    std::atomic<bool> send_stopping_;        // close()开始后为true，拒绝新的异步发送，initialize()时复位
+    std::atomic<bool> send_workers_running_;
+    CollectorId metrics_collector_;      // 0为未注册
+    std::unique_ptr<CaptureWriter> capture_;   // 构造时创建，收发路径上不检查是否为空
+    std::atomic<bool> capture_enabled_;
     
     MessageCallback message_callback_;
+    EndpointCallback endpoint_callback_;
+    PacketCallback packet_callback_;
     ErrorCallback error_callback_;
     
+    // 默认服务器地址只解析一次，非IP字面量在后台线程中解析；结果发布在default_peer_中
+    std::atomic<ResolveState> default_state_;
+    std::atomic<bool> default_connected_;
+    std::shared_mutex connection_mutex_;     // 连接/解除连接时独占，不带地址的发送期间共享
+    uint64_t connection_generation_;         // 每次改变套接字的连接状态时递增，由connection_mutex_保护
+    std::atomic<int> timeout_ms_;            // config_.timeout_ms的副本，等待默认地址解析时读取
+    std::thread resolver_thread_;
+    std::mutex resolve_mutex_;
+    std::condition_variable resolve_ready_;
+    std::mutex publish_mutex_;               // 串行化默认服务器快照的发布，保护resolve_generation_
+    uint64_t resolve_generation_;            // 每次开始解析默认服务器时递增，旧代数的解析结果不发布
+    
+    // 显式目标主机名的LRU缓存，最近使用的在前
+    struct CachedAddress {
+        Endpoint endpoint;
+        std::chrono::steady_clock::time_point expires;
+        bool refreshing = false;     // 已交给刷新线程重新解析
+    };
+    using AddressCacheEntry = std::pair<string_t, CachedAddress>;
+    std::mutex address_cache_mutex_;     // 同时保护以下刷新状态
+    std::list<AddressCacheEntry> address_cache_;
+    std::unordered_map<string_t, std::list<AddressCacheEntry>::iterator> address_index_;
+    std::thread address_refresher_;      // 首次有条目过期时启动，close()时停止
+    std::condition_variable address_refresh_ready_;
+    std::vector<string_t> address_refresh_queue_;
+    bool address_refresher_stopping_;
+    
     // 私有方法
     ErrorCode init_socket();
+    ErrorCode bind_socket();
+    void apply_socket_options();
+    void apply_buffer_size(int option, int force_option, int requested, const char* name);
+    int socket_int_option(int level, int option) const;
+    int tos_for(BufferView first) const;
     void cleanup_socket();
-    void receive_loop();
-    void keep_alive_loop();
-    void update_stats_sent(size_t bytes);
-    void update_stats_received(size_t bytes);
+    ErrorCode begin_receive_async();
+    Result<size_t> receive_batch_impl(ReceiveRing& ring, bool non_blocking);
+    void handle_readable();
+    void prepare_receive_ring(size_t slot_size);
+    ErrorCode begin_io_uring_receive();
+    void handle_io_uring_readable();
+    void fall_back_to_socket_engine();
+    void send_keep_alive();
+    void apply_timeout(int timeout_ms);
+    std::shared_ptr<const DefaultPeer> default_peer() const { return std::atomic_load(&default_peer_); }
+    bool start_send_workers();
+    void stop_send_workers();
+    void send_worker();
+    ErrorCode send_view(BufferView data, const string_t& target_host, int target_port);
+    ErrorCode enqueue_send(SendRequest& request);
+    ErrorCode complete_send(SendRequest& request, ErrorCode result);
+    bool queue_try_push(SendRequest& request, Priority priority);
+    bool queue_has_space(Priority priority) const;
+    bool queue_empty() const;
+#ifdef __linux__
+    int send_batch_chunk(const BufferView* packets, size_t count, const SendTarget& target);
+#endif
+    void capture_sent(const BufferView* parts, size_t count, const SendTarget& target);
+    void capture_received(const ReceiveRing& ring);
+    void update_stats_sent(size_t bytes, size_t packets = 1);
+    void dispatch_packets(const ReceiveRing& ring);
+    void update_stats_received(size_t bytes, size_t packets = 1);
     void update_stats_error(bool is_send_error);
-    sockaddr_in create_address(const string_t& host, int port);
+    StatsStripe& local_stats() { return stats_[detail::stats_stripe_index()]; }
+    void touch_activity(StatsStripe& stripe);
+    uint64_t latency_start() const { return config_.enable_latency_histograms ? monotonic_ns() : 0; }
+    void record_latency(LatencyHistogram& histogram, uint64_t started);
+    std::thread start_default_resolution();   // 返回被取代的解析线程，由调用方释放config_mutex_后回收
+    void publish_default_address(const DefaultPeer& peer, uint64_t generation,
+                                 ErrorCode result, const Endpoint& endpoint);
+    void stop_resolver();
+    void join_stale_resolver(std::thread& resolver);
+    void register_metrics();
+    void unregister_metrics();
+    void collect_metrics(MetricsWriter& writer, const MetricLabels& labels);
+    ErrorCode wait_default_address();
+    ErrorCode resolve_target(const string_t& host, int port, SendTarget& target);
+    ErrorCode lookup_host(const string_t& host, Endpoint& endpoint);
+    void address_refresh_loop();
+    void stop_address_refresher();
+    ErrorCode make_target(const Endpoint& endpoint, SendTarget& target) const;
+    int resolve_family() const;
+    ErrorCode send_gather_target(const BufferView* parts, size_t count, const SendTarget& target);
+    // 发送期间锁定套接字的连接状态；目标的连接已失效时改为携带显式地址
+    std::shared_lock<std::shared_mutex> hold_connection(SendTarget& target);
 };
 
 } // namespace udp2docker 
\ No newline at end of file
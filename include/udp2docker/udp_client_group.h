@@ -0,0 +1,146 @@
+#pragma once
+
+#include "common.h"
+#include "udp_client.h"
+#include <memory>
+#include <vector>
+
+namespace udp2docker {
+
+// SO_REUSEPORT组内数据包分流方式
+enum class ReuseportSteering {
+    NONE,           // 内核按四元组哈希选择套接字
+    INCOMING_CPU,   // 每个套接字设置SO_INCOMING_CPU为其接收线程所在CPU，仅是提示（见UdpConfig::incoming_cpu），按CPU分流用CPU_BPF
+    CPU_BPF         // 挂载经典BPF程序，在分片i接收线程所在CPU上收到的数据包交给分片i（仅Linux）
+};
+
+// 分片客户端组配置
+//
+// CPU列表取自进程的亲和性掩码（受taskset/cpuset限制时编号不一定连续），分片i的接收线程
+// 绑定在列表中从first_cpu开始的第i个CPU上（依次循环）。CPU_BPF按同一映射转向，
+// 数据包在收到它的CPU上处理；只有分片数等于CPU数时每个CPU都有对应的分片，
+// CPU数多于分片数时其余CPU上的数据包按取模分给各分片（跨核处理），
+// 分片数多于CPU数时多出的分片与前面的分片共用CPU，收不到数据包。
+struct UdpGroupConfig {
+    UdpConfig client;                    // 每个分片的配置，local_port为0时由第一个分片选择端口
+    size_t shard_count = 0;              // 分片数，0表示使用可用CPU数
+    bool pin_threads = true;             // 将每个分片的接收线程绑定到一个CPU
+    int first_cpu = 0;                   // 第一个分片绑定的CPU编号，后续分片依次使用可用列表中的下一个CPU
+    ReuseportSteering steering = ReuseportSteering::NONE;
+};
+
+/**
+ * @brief 基于SO_REUSEPORT的多套接字接收分片
+ *
+ * 单个UdpClient只有一个套接字和一个接收线程，入站处理受限于单核。
+ * 该类创建N个绑定同一端口的UdpClient，内核在它们之间分流数据包，
+ * 每个分片拥有独立的事件循环线程并可绑定到不同的CPU。
+ *
+ * 回调约定与UdpClient相同，但会在各分片线程中并发调用，回调必须是线程安全的。
+ * 同一个对端的数据包总是落在同一分片（NONE方式）或同一CPU对应的分片，组内不保证全局顺序。
+ */
+class UdpClientGroup {
+public:
+    /**
+     * @brief 构造函数
+     * @param config 分片组配置
+     */
+    explicit UdpClientGroup(const UdpGroupConfig& config = UdpGroupConfig{});
+    
+    /**
+     * @brief 析构函数
+     */
+    ~UdpClientGroup();
+    
+    // 禁用拷贝构造和赋值
+    UdpClientGroup(const UdpClientGroup&) = delete;
+    UdpClientGroup& operator=(const UdpClientGroup&) = delete;
+    
+    /**
+     * @brief 创建并绑定全部分片
+     * @return 初始化结果，任一分片失败时已创建的分片会被关闭
+     */
+    ErrorCode initialize();
+    
+    /**
+     * @brief 关闭全部分片
+     */
+    void close();
+    
+    bool is_initialized() const { return !shards_.empty(); }
+    
+    /**
+     * @brief 在每个分片上启动异步接收
+     * @param message_callback 消息回调，在各分片线程中并发调用
+     * @param error_callback 错误处理回调
+     * @return 启动结果，任一分片失败时已启动的分片会被停止
+     */
+    ErrorCode start_receive_async(MessageCallback message_callback,
+                                  ErrorCallback error_callback = nullptr);
+    
+    /**
+     * @brief 在每个分片上启动异步接收，来源以二进制端点传给回调
+     * @param endpoint_callback 消息回调，在各分片线程中并发调用
+     * @param error_callback 错误处理回调
+     * @return 启动结果
+     */
+    ErrorCode start_receive_async(EndpointCallback endpoint_callback,
+                                  ErrorCallback error_callback = nullptr);
+    
+    /**
+     * @brief 在每个分片上启动批量零拷贝接收
+     * @param packet_callback 数据包回调，在各分片线程中并发调用
+     * @param error_callback 错误处理回调
+     * @return 启动结果
+     */
+    ErrorCode start_receive_batch_async(PacketCallback packet_callback,
+                                        ErrorCallback error_callback = nullptr);
+    
+    /**
+     * @brief 停止全部分片的异步接收
+     */
+    void stop_receive_async();
+    
+    size_t shard_count() const { return shards_.size(); }
+    
+    /**
+     * @brief 获取分片，可用于从对应线程回复数据
+     * @param index 分片下标
+     */
+    UdpClient& shard(size_t index) { return *shards_[index]; }
+    
+    /**
+     * @brief 获取共同绑定的本地端口
+     */
+    int get_local_port() const;
+    
+    /**
+     * @brief 汇总各分片的统计信息
+     *
+     * 逐个读取分片的无锁计数，组内没有共享锁，各分片热路径互不竞争。
+     */
+    UdpClient::Statistics get_statistics() const;
+    
+    /**
+     * @brief 合并各分片的发送耗时分布
+     */
+    HistogramSnapshot get_send_latency() const;
+    
+    /**
+     * @brief 合并各分片的回调耗时分布
+     */
+    HistogramSnapshot get_callback_latency() const;
+    
+    const UdpGroupConfig& get_config() const { return config_; }
+
+private:
+    UdpGroupConfig config_;
+    std::vector<std::unique_ptr<UdpClient>> shards_;
+    
+    ErrorCode attach_steering_program(const std::vector<int>& cpus, size_t first);
+    
+    template<typename Start>
+    ErrorCode start_all(Start start);
+};
+
+} // namespace udp2docker
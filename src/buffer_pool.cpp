@@ -0,0 +1,193 @@
+#include "udp2docker/buffer_pool.h"
+#include <cstring>
+#include <new>
+
+namespace udp2docker {
+
+namespace {
+
+// 当前线程的缓冲池；线程退出、缓冲池脱离线程后为nullptr
+thread_local BufferPool* t_pool = nullptr;
+thread_local bool t_pool_detached = false;
+
+constexpr size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+size_t size_class_for(size_t capacity) {
+    for (size_t i = 0; i < BufferPool::SIZE_CLASSES; ++i) {
+        if (capacity <= BufferPool::CLASS_CAPACITY[i]) {
+            return i;
+        }
+    }
+    return BufferPool::SIZE_CLASSES;
+}
+
+} // namespace
+
+/**
+ * @brief 线程退出时让缓冲池脱离线程
+ */
+class BufferPool::ThreadHandle {
+public:
+    ThreadHandle() : pool(new BufferPool()) {}
+    
+    ~ThreadHandle() {
+        t_pool = nullptr;
+        t_pool_detached = true;
+        pool->unreference();
+    }
+    
+    BufferPool* pool;
+};
+
+namespace detail {
+
+void release_block(BufferBlock* block) {
+    if (block->pool != nullptr) {
+        block->pool->release(block);
+        return;
+    }
+    block->~BufferBlock();
+    ::operator delete(block);
+}
+
+} // namespace detail
+
+PooledBuffer PooledBuffer::allocate(size_t size, size_t headroom) {
+    if (t_pool_detached) {
+        // 线程退出过程中（例如其他thread_local对象析构时）不再创建缓冲池
+        detail::BufferBlock* block = BufferPool::allocate_unpooled(size + headroom);
+        return PooledBuffer(block, headroom, size);
+    }
+    return BufferPool::local().allocate(size, headroom);
+}
+
+PooledBuffer PooledBuffer::copy_of(BufferView data, size_t headroom) {
+    PooledBuffer buffer = allocate(data.size, headroom);
+    if (!data.empty()) {
+        std::memcpy(buffer.data(), data.data, data.size);
+    }
+    return buffer;
+}
+
+BufferPool& BufferPool::local() {
+    if (t_pool == nullptr) {
+        static thread_local ThreadHandle handle;
+        t_pool = handle.pool;
+    }
+    return *t_pool;
+}
+
+BufferPool::BufferPool()
+    : remote_releases_(0)
+    , references_(1)
+{
+    for (size_t i = 0; i < SIZE_CLASSES; ++i) {
+        free_[i] = nullptr;
+        remote_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+BufferPool::~BufferPool() {
+    // 只在所有块都已释放后调用，slab中的块一起释放
+    for (void* slab : slabs_) {
+        ::operator delete(slab);
+    }
+}
+
+PooledBuffer BufferPool::allocate(size_t size, size_t headroom) {
+    size_t capacity = size + headroom;
+    size_t size_class = size_class_for(capacity);
+    ++stats_.allocations;
+    
+    detail::BufferBlock* block;
+    if (size_class == SIZE_CLASSES) {
+        ++stats_.oversized;
+        block = allocate_unpooled(capacity);
+    } else {
+        block = take(size_class);
+        references_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return PooledBuffer(block, headroom, size);
+}
+
+BufferPool::Statistics BufferPool::get_statistics() const {
+    Statistics stats = stats_;
+    stats.remote_releases = remote_releases_.load(std::memory_order_relaxed);
+    stats.outstanding = references_.load(std::memory_order_relaxed) - (t_pool == this ? 1 : 0);
+    return stats;
+}
+
+detail::BufferBlock* BufferPool::allocate_unpooled(size_t capacity) {
+    void* memory = ::operator new(sizeof(detail::BufferBlock) + capacity);
+    detail::BufferBlock* block = new (memory) detail::BufferBlock();
+    block->references.store(1, std::memory_order_relaxed);
+    block->size_class = static_cast<uint32_t>(SIZE_CLASSES);
+    block->capacity = capacity;
+    block->pool = nullptr;
+    block->next = nullptr;
+    return block;
+}
+
+detail::BufferBlock* BufferPool::take(size_t size_class) {
+    if (free_[size_class] == nullptr) {
+        // 整体取走远程链表，只有所属线程会取，不存在ABA问题
+        free_[size_class] = remote_[size_class].exchange(nullptr, std::memory_order_acquire);
+    }
+    if (free_[size_class] == nullptr) {
+        refill(size_class);
+    } else {
+        ++stats_.reused;
+    }
+    
+    detail::BufferBlock* block = free_[size_class];
+    free_[size_class] = block->next;
+    block->next = nullptr;
+    block->references.store(1, std::memory_order_relaxed);
+    return block;
+}
+
+void BufferPool::refill(size_t size_class) {
+    size_t capacity = CLASS_CAPACITY[size_class];
+    size_t stride = sizeof(detail::BufferBlock) + round_up(capacity, alignof(detail::BufferBlock));
+    size_t count = std::max<size_t>(SLAB_BYTES / stride, 1);
+    
+    byte* slab = static_cast<byte*>(::operator new(stride * count));
+    slabs_.push_back(slab);
+    ++stats_.slabs;
+    
+    for (size_t i = 0; i < count; ++i) {
+        detail::BufferBlock* block = new (slab + i * stride) detail::BufferBlock();
+        block->references.store(0, std::memory_order_relaxed);
+        block->size_class = static_cast<uint32_t>(size_class);
+        block->capacity = capacity;
+        block->pool = this;
+        block->next = free_[size_class];
+        free_[size_class] = block;
+    }
+}
+
+void BufferPool::release(detail::BufferBlock* block) {
+    size_t size_class = block->size_class;
+    if (t_pool == this) {
+        block->next = free_[size_class];
+        free_[size_class] = block;
+    } else {
+        detail::BufferBlock* head = remote_[size_class].load(std::memory_order_relaxed);
+        do {
+            block->next = head;
+        } while (!remote_[size_class].compare_exchange_weak(head, block, std::memory_order_release,
+                                                             std::memory_order_relaxed));
+        remote_releases_.fetch_add(1, std::memory_order_relaxed);
+    }
+    unreference();
+}
+
+void BufferPool::unreference() {
+    if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+} // namespace udp2docker
@@ -0,0 +1,589 @@
+#include "udp2docker/capture.h"
+#include "udp2docker/udp_client.h"
+#include "udp2docker/logger.h"
+#include "udp2docker/statistics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+constexpr char CAPTURE_MAGIC[8] = {'U', '2', 'D', 'C', 'A', 'P', '\0', '\1'};
+constexpr uint32_t CAPTURE_VERSION = 1;
+constexpr uint16_t RECORD_PAD = 0;
+constexpr size_t RECORD_ALIGNMENT = 8;
+
+// 文件头，head/tail为数据区中的累计字节位置（对capacity取模得到偏移）
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t capacity;
+    std::atomic<uint64_t> head;      // 下一条记录的位置，记录写完后更新
+    std::atomic<uint64_t> tail;      // 最旧记录的位置，覆盖前更新
+    uint64_t start_monotonic_ns;
+    uint64_t start_realtime_ns;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 64, "capture file header must be 64 bytes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "capture file positions must be lock-free");
+
+// 记录头，size含头部、数据和对齐填充；type为RECORD_PAD时只有size和type有效
+struct RecordHeader {
+    uint32_t size;
+    uint16_t type;
+    uint16_t family;                 // 0、4或6
+    uint64_t timestamp_ns;
+    uint32_t original_length;
+    uint32_t length;
+    uint32_t scope_id;
+    uint16_t port;
+    uint16_t reserved;
+    byte address[16];
+};
+
+static_assert(sizeof(RecordHeader) == 48, "capture record header must be 48 bytes");
+
+// 最大的记录（完整的64KB数据报）至多占用数据区的一半，保证填充到末尾后总能放下
+constexpr size_t MIN_CAPACITY = 2 * (sizeof(RecordHeader) + MAX_BUFFER_SIZE);
+
+size_t align_record(size_t size) {
+    return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+uint64_t realtime_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Endpoint make_endpoint(const RecordHeader& record) {
+    sockaddr_storage storage{};
+    if (record.family == 4) {
+        auto* addr = reinterpret_cast<sockaddr_in*>(&storage);
+        addr->sin_family = AF_INET;
+        addr->sin_port = htons(record.port);
+        std::memcpy(&addr->sin_addr, record.address, 4);
+        return Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(addr), sizeof(sockaddr_in));
+    }
+    if (record.family == 6) {
+        auto* addr = reinterpret_cast<sockaddr_in6*>(&storage);
+        addr->sin6_family = AF_INET6;
+        addr->sin6_port = htons(record.port);
+        addr->sin6_scope_id = record.scope_id;
+        std::memcpy(&addr->sin6_addr, record.address, 16);
+        return Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(addr), sizeof(sockaddr_in6));
+    }
+    return Endpoint();
+}
+
+} // anonymous namespace
+
+// ========== CaptureWriter ==========
+
+CaptureWriter::CaptureWriter()
+    : mapping_(nullptr)
+    , mapping_size_(0)
+#ifdef _WIN32
+    , file_(INVALID_HANDLE_VALUE)
+    , file_mapping_(nullptr)
+#else
+    , file_(-1)
+#endif
+{
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+ErrorCode CaptureWriter::open(const CaptureConfig& config) {
+    close();
+    
+    if (config.path.empty() || config.capacity_bytes < MIN_CAPACITY) {
+        LOG_ERROR_F("Invalid capture file '{}' or capacity {} (minimum {})", config.path,
+                    config.capacity_bytes, MIN_CAPACITY);
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    config_.capacity_bytes = align_record(config.capacity_bytes);
+    size_t size = sizeof(FileHeader) + config_.capacity_bytes;
+    
+#ifdef _WIN32
+    HANDLE file = CreateFileA(config_.path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR_F("Failed to create capture file {}: {}", config_.path, GetLastError());
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+                                        static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+    if (view == nullptr) {
+        LOG_ERROR_F("Failed to map capture file {}: {}", config_.path, GetLastError());
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    file_ = file;
+    file_mapping_ = mapping;
+#else
+    int file = ::open(config_.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        LOG_ERROR_F("Failed to create capture file {}: {}", config_.path, strerror(errno));
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    // 稀疏文件，只有写到的页面占用磁盘
+    void* view = MAP_FAILED;
+    if (ftruncate(file, static_cast<off_t>(size)) == 0) {
+        view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    }
+    if (view == MAP_FAILED) {
+        LOG_ERROR_F("Failed to map capture file {}: {}", config_.path, strerror(errno));
+        ::close(file);
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    file_ = file;
+#endif
+    
+    mapping_ = static_cast<byte*>(view);
+    mapping_size_ = size;
+    stats_ = Statistics();
+    
+    FileHeader* header = new (mapping_) FileHeader();
+    std::memcpy(header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header->version = CAPTURE_VERSION;
+    header->header_size = sizeof(FileHeader);
+    header->capacity = config_.capacity_bytes;
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->start_monotonic_ns = monotonic_ns();
+    header->start_realtime_ns = realtime_ns();
+    header->reserved = 0;
+    
+    LOG_INFO_F("Capturing to {} ({} bytes ring)", config_.path, config_.capacity_bytes);
+    return ErrorCode::SUCCESS;
+}
+
+void CaptureWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unmap();
+}
+
+bool CaptureWriter::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mapping_ != nullptr;
+}
+
+void CaptureWriter::write(CaptureDirection direction, const Endpoint& peer, const BufferView* parts, size_t count,
+                          uint64_t timestamp_ns) {
+    size_t original_length = 0;
+    for (size_t i = 0; i < count; ++i) {
+        original_length += parts[i].size;
+    }
+    size_t length = std::min(original_length, MAX_BUFFER_SIZE);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mapping_ == nullptr ||
+        (direction == CaptureDirection::SENT && !config_.capture_sent) ||
+        (direction == CaptureDirection::RECEIVED && !config_.capture_received)) {
+        return;
+    }
+    
+    if (config_.snap_length > 0) {
+        length = std::min(length, config_.snap_length);
+    }
+    size_t record_size = align_record(sizeof(RecordHeader) + length);
+    
+    FileHeader* header = reinterpret_cast<FileHeader*>(mapping_);
+    byte* data = mapping_ + sizeof(FileHeader);
+    uint64_t capacity = header->capacity;
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    
+    // 覆盖最旧的记录，直到[head, head + needed)可用；tail先于数据更新，读取方不会读到覆盖中的记录
+    auto reserve = [&](uint64_t needed) {
+        while (head + needed - tail > capacity) {
+            uint32_t size;
+            uint16_t type;
+            const byte* oldest = data + tail % capacity;
+            std::memcpy(&size, oldest, sizeof(size));
+            std::memcpy(&type, oldest + sizeof(size), sizeof(type));
+            if (type != RECORD_PAD) {
+                ++stats_.overwritten;
+            }
+            tail += size;
+        }
+        header->tail.store(tail, std::memory_order_release);
+    };
+    
+    // 记录不跨越数据区末尾，剩余空间不足时写一条填充记录
+    uint64_t offset = head % capacity;
+    if (capacity - offset < record_size) {
+        uint64_t padding = capacity - offset;
+        reserve(padding);
+        uint32_t size = static_cast<uint32_t>(padding);
+        uint16_t type = RECORD_PAD;
+        std::memcpy(data + offset, &size, sizeof(size));
+        std::memcpy(data + offset + sizeof(size), &type, sizeof(type));
+        head += padding;
+        offset = 0;
+    }
+    reserve(record_size);
+    
+    RecordHeader record{};
+    record.size = static_cast<uint32_t>(record_size);
+    record.type = static_cast<uint16_t>(direction);
+    record.family = peer.is_ipv4() ? 4 : (peer.is_ipv6() ? 6 : 0);
+    record.timestamp_ns = timestamp_ns;
+    record.original_length = static_cast<uint32_t>(original_length);
+    record.length = static_cast<uint32_t>(length);
+    record.scope_id = peer.scope_id();
+    record.port = static_cast<uint16_t>(peer.port());
+    std::memcpy(record.address, peer.address(), peer.address_size());
+    
+    byte* out = data + offset;
+    std::memcpy(out, &record, sizeof(record));
+    out += sizeof(record);
+    size_t remaining = length;
+    for (size_t i = 0; i < count && remaining > 0; ++i) {
+        size_t copied = std::min(parts[i].size, remaining);
+        std::memcpy(out, parts[i].data, copied);
+        out += copied;
+        remaining -= copied;
+    }
+    
+    header->head.store(head + record_size, std::memory_order_release);
+    ++stats_.records;
+    stats_.bytes += length;
+}
+
+void CaptureWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mapping_ == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(mapping_, mapping_size_);
+    FlushFileBuffers(file_);
+#else
+    msync(mapping_, mapping_size_, MS_SYNC);
+#endif
+}
+
+CaptureWriter::Statistics CaptureWriter::get_statistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// 私有方法实现
+void CaptureWriter::unmap() {
+    if (mapping_ == nullptr) {
+        return;
+    }
+    
+    // 数据区没有写满过时截掉未使用的部分
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(mapping_);
+    uint64_t used = header->head.load(std::memory_order_relaxed);
+    bool shrink = header->tail.load(std::memory_order_relaxed) == 0 && used < header->capacity;
+    uint64_t file_size = sizeof(FileHeader) + used;
+    
+#ifdef _WIN32
+    UnmapViewOfFile(mapping_);
+    CloseHandle(file_mapping_);
+    if (shrink) {
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(file_size);
+        SetFilePointerEx(file_, position, nullptr, FILE_BEGIN);
+        SetEndOfFile(file_);
+    }
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+    file_mapping_ = nullptr;
+#else
+    munmap(mapping_, mapping_size_);
+    if (shrink && ftruncate(file_, static_cast<off_t>(file_size)) != 0) {
+        LOG_WARN_F("Failed to truncate capture file {}", config_.path);
+    }
+    ::close(file_);
+    file_ = -1;
+#endif
+    
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    LOG_INFO_F("Capture file {} closed: {} records, {} overwritten", config_.path, stats_.records,
+               stats_.overwritten);
+}
+
+// ========== CaptureReader ==========
+
+CaptureReader::CaptureReader()
+    : mapping_(nullptr)
+    , mapping_size_(0)
+    , capacity_(0)
+    , head_(0)
+    , tail_(0)
+    , position_(0)
+    , start_monotonic_ns_(0)
+    , start_realtime_ns_(0)
+#ifdef _WIN32
+    , file_(INVALID_HANDLE_VALUE)
+    , file_mapping_(nullptr)
+#else
+    , file_(-1)
+#endif
+{
+}
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+ErrorCode CaptureReader::open(const string_t& path) {
+    close();
+    
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER file_size{};
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size)) {
+        LOG_ERROR_F("Failed to open capture file {}: {}", path, GetLastError());
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    size_t size = static_cast<size_t>(file_size.QuadPart);
+    HANDLE mapping = size >= sizeof(FileHeader)
+        ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        LOG_ERROR_F("Failed to map capture file {}", path);
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return ErrorCode::PROTOCOL_ERROR;
+    }
+    file_ = file;
+    file_mapping_ = mapping;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    struct stat info{};
+    if (file < 0 || fstat(file, &info) != 0) {
+        LOG_ERROR_F("Failed to open capture file {}: {}", path, strerror(errno));
+        if (file >= 0) {
+            ::close(file);
+        }
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* view = size >= sizeof(FileHeader) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+    if (view == MAP_FAILED) {
+        LOG_ERROR_F("Failed to map capture file {}", path);
+        ::close(file);
+        return ErrorCode::PROTOCOL_ERROR;
+    }
+    file_ = file;
+#endif
+    
+    mapping_ = static_cast<byte*>(view);
+    mapping_size_ = size;
+    
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(mapping_);
+    head_ = header->head.load(std::memory_order_acquire);
+    tail_ = header->tail.load(std::memory_order_acquire);
+    capacity_ = header->capacity;
+    
+    // 没有写满过的文件在关闭时被截短，只需要包含已写入的部分
+    uint64_t required = tail_ == 0 && head_ < capacity_ ? head_ : capacity_;
+    if (std::memcmp(header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+        header->version != CAPTURE_VERSION || header->header_size != sizeof(FileHeader) ||
+        capacity_ == 0 || tail_ > head_ || head_ - tail_ > capacity_ ||
+        size - sizeof(FileHeader) < required) {
+        LOG_ERROR_F("Invalid capture file {}", path);
+        close();
+        return ErrorCode::PROTOCOL_ERROR;
+    }
+    
+    start_monotonic_ns_ = header->start_monotonic_ns;
+    start_realtime_ns_ = header->start_realtime_ns;
+    position_ = tail_;
+    return ErrorCode::SUCCESS;
+}
+
+void CaptureReader::close() {
+    if (mapping_ == nullptr) {
+        return;
+    }
+    
+#ifdef _WIN32
+    UnmapViewOfFile(mapping_);
+    CloseHandle(file_mapping_);
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+    file_mapping_ = nullptr;
+#else
+    munmap(mapping_, mapping_size_);
+    ::close(file_);
+    file_ = -1;
+#endif
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+}
+
+bool CaptureReader::next(CaptureRecord& record) {
+    const byte* data = mapping_ + sizeof(FileHeader);
+    
+    while (mapping_ != nullptr && position_ < head_) {
+        uint64_t offset = position_ % capacity_;
+        uint32_t size;
+        uint16_t type;
+        std::memcpy(&size, data + offset, sizeof(size));
+        std::memcpy(&type, data + offset + sizeof(size), sizeof(type));
+        if (size < RECORD_ALIGNMENT || size % RECORD_ALIGNMENT != 0 || size > capacity_ - offset ||
+            size > head_ - position_) {
+            LOG_WARN_F("Corrupt capture record at {}", position_);
+            position_ = head_;
+            return false;
+        }
+        
+        position_ += size;
+        if (type == RECORD_PAD) {
+            continue;
+        }
+        
+        RecordHeader header;
+        if (size < sizeof(header)) {
+            position_ = head_;
+            return false;
+        }
+        std::memcpy(&header, data + offset, sizeof(header));
+        if (header.length > size - sizeof(header)) {
+            position_ = head_;
+            return false;
+        }
+        
+        record.direction = static_cast<CaptureDirection>(header.type);
+        record.timestamp_ns = header.timestamp_ns;
+        record.peer = make_endpoint(header);
+        record.original_length = header.original_length;
+        record.data = BufferView(data + offset + sizeof(header), header.length);
+        return true;
+    }
+    return false;
+}
+
+// ========== 回放 ==========
+
+Result<ReplayStatistics> replay_capture(CaptureReader& reader, UdpClient& client,
+                                        const string_t& target_host, int target_port,
+                                        const ReplayConfig& config, const std::atomic<bool>* stop) {
+    if (!reader.is_open()) {
+        LOG_ERROR("Capture file not open");
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    if (!client.is_connected()) {
+        LOG_ERROR("UdpClient not initialized");
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    size_t batch_size = std::max<size_t>(config.batch_size, 1);
+    std::vector<BufferView> batch;
+    batch.reserve(batch_size);
+    
+    ReplayStatistics stats;
+    uint64_t started = monotonic_ns();
+    uint64_t first_timestamp = 0;
+    bool have_first = false;
+    
+    auto wanted = [&config](const CaptureRecord& record) {
+        return (record.direction == CaptureDirection::SENT && config.replay_sent) ||
+               (record.direction == CaptureDirection::RECEIVED && config.replay_received);
+    };
+    
+    CaptureRecord record;
+    bool pending = reader.next(record);
+    while (pending && !(stop && stop->load())) {
+        // 收集已到发送时间的记录，最多batch_size条
+        while (pending && batch.size() < batch_size) {
+            if (!wanted(record) || record.data.empty()) {
+                pending = reader.next(record);
+                continue;
+            }
+            if (!have_first) {
+                first_timestamp = record.timestamp_ns;
+                have_first = true;
+            }
+            
+            if (config.speed > 0) {
+                uint64_t offset = record.timestamp_ns > first_timestamp ? record.timestamp_ns - first_timestamp : 0;
+                uint64_t due = started + static_cast<uint64_t>(static_cast<double>(offset) / config.speed);
+                uint64_t now = monotonic_ns();
+                if (due > now) {
+                    if (!batch.empty()) {
+                        break;
+                    }
+                    // sleep_for的唤醒误差在几十微秒，最后一段忙等；长间隔分段睡眠以便及时响应stop
+                    uint64_t remaining = due - now;
+                    if (remaining > 200000) {
+                        uint64_t interval = std::min<uint64_t>(remaining - 100000, 100000000);
+                        std::this_thread::sleep_for(std::chrono::nanoseconds(interval));
+                    } else {
+                        std::this_thread::yield();
+                    }
+                    if (stop && stop->load()) {
+                        break;
+                    }
+                    continue;
+                }
+            }
+            
+            if (record.original_length > record.data.size) {
+                ++stats.truncated;
+            }
+            batch.push_back(record.data);
+            pending = reader.next(record);
+        }
+        
+        if (batch.empty()) {
+            continue;
+        }
+        
+        auto sent = client.send_batch(batch.data(), batch.size(), target_host, target_port);
+        size_t count = sent.is_success() ? sent.value() : 0;
+        for (size_t i = 0; i < count; ++i) {
+            stats.bytes += batch[i].size;
+        }
+        stats.packets += count;
+        stats.failed += batch.size() - count;
+        batch.clear();
+    }
+    
+    stats.elapsed_ns = monotonic_ns() - started;
+    return Result<ReplayStatistics>(std::move(stats));
+}
+
+} // namespace udp2docker
@@ -0,0 +1,328 @@
+#include "udp2docker/checksum.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define UDP2DOCKER_CRC32_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define UDP2DOCKER_TARGET_PCLMUL
+#else
+#define UDP2DOCKER_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#if defined(__ARM_FEATURE_CRC32)
+#define UDP2DOCKER_CRC32_ARM 1
+#define UDP2DOCKER_TARGET_CRC
+#include <arm_acle.h>
+#elif defined(__linux__) && (defined(__GNUC__) || defined(__clang__))
+// 编译器未默认启用CRC扩展时，按函数启用并在运行时检测
+#define UDP2DOCKER_CRC32_ARM 1
+#define UDP2DOCKER_CRC32_ARM_RUNTIME 1
+#ifdef __clang__
+#define UDP2DOCKER_TARGET_CRC __attribute__((target("crc")))
+#else
+#define UDP2DOCKER_TARGET_CRC __attribute__((target("+crc")))
+#endif
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+constexpr uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+
+// slice-by-8查表：tables[k][i]为字节i后跟k个零字节的CRC
+struct Crc32Tables {
+    uint32_t tables[8][256];
+};
+
+constexpr Crc32Tables make_crc32_tables() {
+    Crc32Tables result{};
+    
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : crc >> 1;
+        }
+        result.tables[0][i] = crc;
+    }
+    
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int slice = 1; slice < 8; ++slice) {
+            uint32_t previous = result.tables[slice - 1][i];
+            result.tables[slice][i] = (previous >> 8) ^ result.tables[0][previous & 0xFF];
+        }
+    }
+    
+    return result;
+}
+
+constexpr Crc32Tables CRC32_TABLES = make_crc32_tables();
+
+inline uint32_t load_le32(const byte* data) {
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+#ifdef UDP2DOCKER_CRC32_X86
+
+// PCLMULQDQ折叠至少需要64字节
+constexpr size_t PCLMUL_MIN_SIZE = 64;
+
+/**
+ * @brief 基于PCLMULQDQ的CRC32折叠（Intel白皮书《Fast CRC Computation for
+ *        Generic Polynomials Using PCLMULQDQ Instruction》中的反射域常量）
+ *
+ * 要求size >= 64且为16的倍数。
+ */
+UDP2DOCKER_TARGET_PCLMUL
+uint32_t crc32_update_pclmul_blocks(uint32_t crc, const byte* data, size_t size) {
+    alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+    alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+    alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+    
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+    
+    x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+    x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+    x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+    
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+    
+    data += 64;
+    size -= 64;
+    
+    // 并行折叠64字节块
+    while (size >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        
+        y5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+        y6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+        y7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+        y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+        
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        
+        data += 64;
+        size -= 64;
+    }
+    
+    // 折叠为128位
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+    
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+    
+    // 逐个折叠剩余的16字节块
+    while (size >= 16) {
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        
+        data += 16;
+        size -= 16;
+    }
+    
+    // 128位折叠为64位
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+    
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    
+    // Barrett约简为32位
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+uint32_t crc32_update_pclmul(uint32_t crc, const byte* data, size_t size) {
+    if (size >= PCLMUL_MIN_SIZE) {
+        size_t block_size = size & ~static_cast<size_t>(15);
+        crc = crc32_update_pclmul_blocks(crc, data, block_size);
+        data += block_size;
+        size -= block_size;
+    }
+    return detail::crc32_update_slice8(crc, data, size);
+}
+
+bool cpu_supports_pclmul() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    bool pclmul = (info[2] & (1 << 1)) != 0;
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    return pclmul && sse41;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+#endif // UDP2DOCKER_CRC32_X86
+
+#ifdef UDP2DOCKER_CRC32_ARM
+
+UDP2DOCKER_TARGET_CRC
+uint32_t crc32_update_armv8(uint32_t crc, const byte* data, size_t size) {
+    while (size > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0) {
+        crc = __crc32b(crc, *data++);
+        --size;
+    }
+    
+    while (size >= 8) {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        crc = __crc32d(crc, value);
+        data += 8;
+        size -= 8;
+    }
+    
+    while (size > 0) {
+        crc = __crc32b(crc, *data++);
+        --size;
+    }
+    
+    return crc;
+}
+
+bool cpu_supports_armv8_crc() {
+#ifdef UDP2DOCKER_CRC32_ARM_RUNTIME
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    return true;
+#endif
+}
+
+#endif // UDP2DOCKER_CRC32_ARM
+
+using Crc32UpdateFn = uint32_t (*)(uint32_t, const byte*, size_t);
+
+struct Crc32Implementation {
+    Crc32UpdateFn update;
+    const char* name;
+};
+
+Crc32Implementation select_crc32_implementation() {
+#ifdef UDP2DOCKER_CRC32_X86
+    if (cpu_supports_pclmul()) {
+        return {crc32_update_pclmul, "pclmul"};
+    }
+#endif
+#ifdef UDP2DOCKER_CRC32_ARM
+    if (cpu_supports_armv8_crc()) {
+        return {crc32_update_armv8, "armv8-crc"};
+    }
+#endif
+    return {detail::crc32_update_slice8, "slice-by-8"};
+}
+
+const Crc32Implementation& crc32_dispatch() {
+    static const Crc32Implementation implementation = select_crc32_implementation();
+    return implementation;
+}
+
+} // namespace
+
+namespace detail {
+
+uint32_t crc32_update_slice8(uint32_t crc, const byte* data, size_t size) {
+    const auto& tables = CRC32_TABLES.tables;
+    
+    while (size >= 8) {
+        uint32_t one = load_le32(data) ^ crc;
+        uint32_t two = load_le32(data + 4);
+        crc = tables[7][one & 0xFF] ^
+              tables[6][(one >> 8) & 0xFF] ^
+              tables[5][(one >> 16) & 0xFF] ^
+              tables[4][one >> 24] ^
+              tables[3][two & 0xFF] ^
+              tables[2][(two >> 8) & 0xFF] ^
+              tables[1][(two >> 16) & 0xFF] ^
+              tables[0][two >> 24];
+        data += 8;
+        size -= 8;
+    }
+    
+    while (size > 0) {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *data++) & 0xFF];
+        --size;
+    }
+    
+    return crc;
+}
+
+uint32_t crc32_update(uint32_t state, const byte* data, size_t size) {
+    if (size == 0) {
+        return state;
+    }
+    return crc32_dispatch().update(state, data, size);
+}
+
+} // namespace detail
+
+uint32_t crc32(const byte* data, size_t size) {
+    return ~detail::crc32_update(0xFFFFFFFF, data, size);
+}
+
+uint32_t crc32(BufferView data) {
+    return crc32(data.data, data.size);
+}
+
+const char* crc32_implementation() {
+    return crc32_dispatch().name;
+}
+
+void Crc32::update(const byte* data, size_t size) {
+    state_ = detail::crc32_update(state_, data, size);
+}
+
+} // namespace udp2docker
@@ -0,0 +1,174 @@
+#include "udp2docker/coalescer.h"
+#include "udp2docker/udp_client.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace udp2docker {
+
+MessageCoalescer::MessageCoalescer(MessageProtocol& protocol, DatagramSink sink, const CoalescingConfig& config)
+    : config_(config)
+    , protocol_(protocol)
+    , sink_(std::move(sink))
+    , used_(0)
+    , count_(0)
+    , priority_(Priority::LOW)
+    , running_(false)
+{
+    config_.max_datagram_size = std::max(config_.max_datagram_size, MessageHeader::header_size() * 2);
+    buffer_.resize(config_.max_datagram_size);
+    // 单条消息序列化时元数据段最多64KB
+    scratch_.resize(MAX_BUFFER_SIZE * 2);
+}
+
+MessageCoalescer::MessageCoalescer(MessageProtocol& protocol, UdpClient& client, const CoalescingConfig& config)
+    : MessageCoalescer(protocol, [&client](BufferView datagram) {
+                           return client.send_gather(&datagram, 1);
+                       }, config)
+{
+}
+
+MessageCoalescer::~MessageCoalescer() {
+    stop();
+    flush();
+}
+
+ErrorCode MessageCoalescer::add(const Message& message) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++stats_.messages;
+    
+    size_t capacity = buffer_.size() - MessageHeader::header_size();
+    auto serialized = protocol_.serialize_into(message, scratch_.data(), scratch_.size());
+    if (!serialized.is_success()) {
+        return serialized.error_code();
+    }
+    size_t frame_size = serialized.value();
+    
+    // 单条就放不下的消息不合并，保持原有顺序先发出已合并的部分
+    if (frame_size > capacity) {
+        ErrorCode result = flush_locked();
+        ++stats_.oversized;
+        ++stats_.datagrams;
+        ErrorCode sent = sink_(BufferView(scratch_.data(), frame_size));
+        return result != ErrorCode::SUCCESS ? result : sent;
+    }
+    
+    ErrorCode result = ErrorCode::SUCCESS;
+    if (used_ + frame_size > capacity) {
+        ++stats_.size_flushes;
+        result = flush_locked();
+    }
+    
+    std::memcpy(buffer_.data() + MessageHeader::header_size() + used_, scratch_.data(), frame_size);
+    used_ += frame_size;
+    if (count_++ == 0) {
+        priority_ = message.header.priority;
+        deadline_ = clock_t::now() + config_.flush_delay;
+        if (running_) {
+            armed_.notify_one();
+        }
+    } else if (static_cast<int>(message.header.priority) > static_cast<int>(priority_)) {
+        priority_ = message.header.priority;
+    }
+    
+    if (static_cast<int>(message.header.priority) >= static_cast<int>(config_.flush_priority)) {
+        ++stats_.priority_flushes;
+        ErrorCode flushed = flush_locked();
+        return result != ErrorCode::SUCCESS ? result : flushed;
+    }
+    return result;
+}
+
+ErrorCode MessageCoalescer::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flush_locked();
+}
+
+ErrorCode MessageCoalescer::flush_if_due(clock_t::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ == 0 || now < deadline_) {
+        return ErrorCode::SUCCESS;
+    }
+    ++stats_.deadline_flushes;
+    return flush_locked();
+}
+
+void MessageCoalescer::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    flusher_ = std::thread([this]() { flusher_loop(); });
+}
+
+void MessageCoalescer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    armed_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    flush();
+}
+
+size_t MessageCoalescer::pending_messages() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+MessageCoalescer::Statistics MessageCoalescer::get_statistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+ErrorCode MessageCoalescer::flush_locked() {
+    if (count_ == 0) {
+        return ErrorCode::SUCCESS;
+    }
+    
+    constexpr size_t header_size = MessageHeader::header_size();
+    BufferView datagram;
+    if (count_ == 1) {
+        // 只有一条消息时不需要容器头
+        datagram = BufferView(buffer_.data() + header_size, used_);
+    } else {
+        protocol_.write_batch_header(BufferView(buffer_.data() + header_size, used_), priority_, buffer_.data());
+        datagram = BufferView(buffer_.data(), header_size + used_);
+    }
+    
+    used_ = 0;
+    count_ = 0;
+    ++stats_.datagrams;
+    
+    ErrorCode result = sink_(datagram);
+    if (result != ErrorCode::SUCCESS) {
+        LOG_WARN_F("Failed to send coalesced datagram of {} bytes", datagram.size);
+    }
+    return result;
+}
+
+void MessageCoalescer::flusher_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (count_ == 0) {
+            armed_.wait(lock, [this]() { return !running_ || count_ != 0; });
+            continue;
+        }
+        
+        // 等待期间被发出（长度或优先级触发）时重新计算截止时间
+        auto deadline = deadline_;
+        if (armed_.wait_until(lock, deadline) == std::cv_status::timeout && count_ != 0 &&
+            clock_t::now() >= deadline_) {
+            ++stats_.deadline_flushes;
+            flush_locked();
+        }
+    }
+}
+
+} // namespace udp2docker
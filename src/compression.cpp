@@ -0,0 +1,498 @@
+#include "udp2docker/compression.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#ifdef UDP2DOCKER_HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+// LZ4块格式常量
+constexpr size_t LZ4_MIN_MATCH = 4;
+constexpr size_t LZ4_LAST_LITERALS = 5;     // 块末尾至少5字节为字面量
+constexpr size_t LZ4_MF_LIMIT = 12;         // 最后一个匹配必须在块末尾12字节之前开始
+constexpr size_t LZ4_MAX_OFFSET = 65535;
+constexpr int LZ4_HASH_LOG = 12;
+constexpr size_t LZ4_HASH_SIZE = 1 << LZ4_HASH_LOG;
+
+inline uint32_t read32(const byte* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t lz4_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+// 写入长度扩展字节（每个255表示继续）
+inline byte* write_length(byte* op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<byte>(length);
+    return op;
+}
+
+/**
+ * @brief 把字典中的位置加入哈希表
+ * @param hash_table LZ4_HASH_SIZE项的哈希表，调用前已清零
+ */
+void lz4_hash_prefix(uint32_t* hash_table, const byte* base, size_t prefix_size) {
+    if (prefix_size >= LZ4_MIN_MATCH) {
+        size_t start = prefix_size > LZ4_MAX_OFFSET ? prefix_size - LZ4_MAX_OFFSET : 0;
+        for (size_t pos = start; pos + LZ4_MIN_MATCH <= prefix_size; ++pos) {
+            hash_table[lz4_hash(read32(base + pos))] = static_cast<uint32_t>(pos);
+        }
+    }
+}
+
+/**
+ * @brief LZ4块压缩（贪心哈希匹配）
+ *
+ * 待压缩数据位于base + prefix_size处，之前的prefix_size字节为字典，
+ * 匹配可以引用字典中的内容。
+ *
+ * @param prefix_hashes 预先由lz4_hash_prefix()建立的字典哈希表，为空时现场建立
+ * @return 压缩后长度，输出缓冲区不足返回0
+ */
+size_t lz4_compress_block(const byte* base, size_t prefix_size, size_t input_size,
+                          byte* output, size_t output_capacity, const uint32_t* prefix_hashes = nullptr) {
+    thread_local uint32_t hash_table[LZ4_HASH_SIZE];
+    if (prefix_hashes != nullptr) {
+        std::memcpy(hash_table, prefix_hashes, sizeof(hash_table));
+    } else {
+        std::memset(hash_table, 0, sizeof(hash_table));
+        lz4_hash_prefix(hash_table, base, prefix_size);
+    }
+    
+    const byte* const input = base + prefix_size;
+    const byte* const input_end = input + input_size;
+    const byte* ip = input;
+    const byte* anchor = input;
+    byte* op = output;
+    byte* const output_end = output + output_capacity;
+    
+    if (input_size >= LZ4_MF_LIMIT + 1) {
+        const byte* const match_limit = input_end - LZ4_LAST_LITERALS;
+        const byte* const mf_limit = input_end - LZ4_MF_LIMIT;
+        unsigned misses = 0;
+        
+        while (ip < mf_limit) {
+            uint32_t sequence = read32(ip);
+            uint32_t hash = lz4_hash(sequence);
+            const byte* candidate = base + hash_table[hash];
+            hash_table[hash] = static_cast<uint32_t>(ip - base);
+            
+            if (candidate >= ip || static_cast<size_t>(ip - candidate) > LZ4_MAX_OFFSET ||
+                read32(candidate) != sequence) {
+                // 连续未命中时加大步长，快速跳过不可压缩数据
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            
+            // 向前扩展匹配
+            while (ip > anchor && candidate > base && ip[-1] == candidate[-1]) {
+                --ip;
+                --candidate;
+            }
+            
+            // 向后扩展匹配
+            size_t match_length = LZ4_MIN_MATCH;
+            while (ip + match_length < match_limit && ip[match_length] == candidate[match_length]) {
+                ++match_length;
+            }
+            
+            size_t literal_length = static_cast<size_t>(ip - anchor);
+            size_t needed = 1 + literal_length / 255 + 1 + literal_length + 2 +
+                            (match_length - LZ4_MIN_MATCH) / 255 + 1;
+            if (static_cast<size_t>(output_end - op) < needed) {
+                return 0;
+            }
+            
+            // 令牌 + 字面量
+            byte* token = op++;
+            if (literal_length >= 15) {
+                *token = 15 << 4;
+                op = write_length(op, literal_length - 15);
+            } else {
+                *token = static_cast<byte>(literal_length << 4);
+            }
+            std::memcpy(op, anchor, literal_length);
+            op += literal_length;
+            
+            // 偏移量（小端）+ 匹配长度
+            size_t offset = static_cast<size_t>(ip - candidate);
+            *op++ = static_cast<byte>(offset & 0xFF);
+            *op++ = static_cast<byte>(offset >> 8);
+            
+            size_t extra_match = match_length - LZ4_MIN_MATCH;
+            if (extra_match >= 15) {
+                *token |= 15;
+                op = write_length(op, extra_match - 15);
+            } else {
+                *token |= static_cast<byte>(extra_match);
+            }
+            
+            ip += match_length;
+            anchor = ip;
+            
+            // 补充匹配末尾附近的位置，提高后续命中率
+            if (ip < mf_limit) {
+                hash_table[lz4_hash(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+    
+    // 最后的字面量
+    size_t literal_length = static_cast<size_t>(input_end - anchor);
+    size_t needed = 1 + literal_length / 255 + 1 + literal_length;
+    if (static_cast<size_t>(output_end - op) < needed) {
+        return 0;
+    }
+    
+    byte* token = op++;
+    if (literal_length >= 15) {
+        *token = 15 << 4;
+        op = write_length(op, literal_length - 15);
+    } else {
+        *token = static_cast<byte>(literal_length << 4);
+    }
+    std::memcpy(op, anchor, literal_length);
+    op += literal_length;
+    
+    return static_cast<size_t>(op - output);
+}
+
+/**
+ * @brief LZ4块解压缩
+ * @return 解压后长度，数据损坏返回-1
+ */
+long lz4_decompress_block(const byte* input, size_t input_size,
+                          byte* output, size_t output_capacity,
+                          const byte* dictionary, size_t dictionary_size) {
+    const byte* ip = input;
+    const byte* const input_end = input + input_size;
+    byte* op = output;
+    byte* const output_end = output + output_capacity;
+    
+    while (ip < input_end) {
+        byte token = *ip++;
+        
+        // 字面量
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            byte extra;
+            do {
+                if (ip >= input_end) {
+                    return -1;
+                }
+                extra = *ip++;
+                literal_length += extra;
+            } while (extra == 255);
+        }
+        
+        if (literal_length > static_cast<size_t>(input_end - ip) ||
+            literal_length > static_cast<size_t>(output_end - op)) {
+            return -1;
+        }
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        
+        // 最后一个序列只有字面量
+        if (ip == input_end) {
+            break;
+        }
+        
+        if (input_end - ip < 2) {
+            return -1;
+        }
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0) {
+            return -1;
+        }
+        
+        size_t match_length = token & 0x0F;
+        if (match_length == 15) {
+            byte extra;
+            do {
+                if (ip >= input_end) {
+                    return -1;
+                }
+                extra = *ip++;
+                match_length += extra;
+            } while (extra == 255);
+        }
+        match_length += LZ4_MIN_MATCH;
+        
+        if (match_length > static_cast<size_t>(output_end - op)) {
+            return -1;
+        }
+        
+        size_t produced = static_cast<size_t>(op - output);
+        if (offset > produced) {
+            // 匹配起点位于字典中
+            size_t back = offset - produced;
+            if (back > dictionary_size) {
+                return -1;
+            }
+            const byte* source = dictionary + dictionary_size - back;
+            size_t from_dictionary = std::min(back, match_length);
+            std::memcpy(op, source, from_dictionary);
+            op += from_dictionary;
+            match_length -= from_dictionary;
+            
+            const byte* match = output;
+            while (match_length-- > 0) {
+                *op++ = *match++;
+            }
+        } else if (offset >= match_length) {
+            std::memcpy(op, op - offset, match_length);
+            op += match_length;
+        } else {
+            // 重叠复制（重复模式），必须逐字节
+            const byte* match = op - offset;
+            while (match_length-- > 0) {
+                *op++ = *match++;
+            }
+        }
+    }
+    
+    return static_cast<long>(op - output);
+}
+
+/**
+ * @brief 内置LZ4块格式编解码器
+ */
+class Lz4Codec : public Codec {
+public:
+    CompressionType type() const override { return CompressionType::LZ4; }
+    const char* name() const override { return "lz4"; }
+    
+    Result<size_t> compress(const byte* input, size_t input_size,
+                            byte* output, size_t output_capacity) override {
+        size_t compressed = 0;
+        
+        if (dictionary_.empty()) {
+            compressed = lz4_compress_block(input, 0, input_size, output, output_capacity);
+        } else {
+            // 字典与输入拼接后压缩，匹配可以回溯到字典内容。每个线程的窗口只在字典变化时
+            // 复制一次字典，之后每次只复制输入；字典的哈希表在set_dictionary()时建立
+            thread_local DictionaryWindow window;
+            if (window.dictionary_id != dictionary_id_) {
+                window.data.assign(dictionary_.begin(), dictionary_.end());
+                window.dictionary_id = dictionary_id_;
+            }
+            window.data.resize(dictionary_.size() + input_size);
+            std::memcpy(window.data.data() + dictionary_.size(), input, input_size);
+            compressed = lz4_compress_block(window.data.data(), dictionary_.size(), input_size,
+                                            output, output_capacity, dictionary_hashes_.data());
+        }
+        
+        if (compressed == 0) {
+            return ErrorCode::INVALID_PARAMETER;
+        }
+        return compressed;
+    }
+    
+    Result<size_t> decompress(const byte* input, size_t input_size,
+                              byte* output, size_t output_capacity) override {
+        long result = lz4_decompress_block(input, input_size, output, output_capacity,
+                                           dictionary_.data(), dictionary_.size());
+        if (result < 0) {
+            return ErrorCode::PROTOCOL_ERROR;
+        }
+        return static_cast<size_t>(result);
+    }
+    
+    ErrorCode set_dictionary(const buffer_t& dictionary) override {
+        // 只有最后64KB可以被匹配引用
+        size_t start = dictionary.size() > LZ4_MAX_OFFSET ? dictionary.size() - LZ4_MAX_OFFSET : 0;
+        dictionary_.assign(dictionary.begin() + static_cast<std::ptrdiff_t>(start), dictionary.end());
+        dictionary_hashes_.assign(LZ4_HASH_SIZE, 0);
+        lz4_hash_prefix(dictionary_hashes_.data(), dictionary_.data(), dictionary_.size());
+        
+        // 编号全局唯一，线程的窗口据此判断是否持有本字典
+        static std::atomic<uint64_t> next_dictionary_id{1};
+        dictionary_id_ = next_dictionary_id.fetch_add(1, std::memory_order_relaxed);
+        return ErrorCode::SUCCESS;
+    }
+
+private:
+    // 线程私有的压缩窗口：字典在前，输入拼接在后
+    struct DictionaryWindow {
+        uint64_t dictionary_id = 0;
+        buffer_t data;
+    };
+    
+    buffer_t dictionary_;
+    std::vector<uint32_t> dictionary_hashes_;    // 字典位置的哈希表，压缩时复制而不是重新建立
+    uint64_t dictionary_id_ = 0;
+};
+
+#ifdef UDP2DOCKER_HAVE_ZSTD
+
+constexpr int ZSTD_DEFAULT_LEVEL = 3;
+
+// 按线程复用的zstd上下文
+struct ZstdContexts {
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    ZSTD_DCtx* dctx = ZSTD_createDCtx();
+    
+    ~ZstdContexts() {
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+    }
+};
+
+ZstdContexts& zstd_contexts() {
+    thread_local ZstdContexts contexts;
+    return contexts;
+}
+
+/**
+ * @brief zstd编解码器，支持预先编译的字典
+ */
+class ZstdCodec : public Codec {
+public:
+    explicit ZstdCodec(int level)
+        : level_(level > 0 ? level : ZSTD_DEFAULT_LEVEL)
+    {}
+    
+    CompressionType type() const override { return CompressionType::ZSTD; }
+    const char* name() const override { return "zstd"; }
+    
+    Result<size_t> compress(const byte* input, size_t input_size,
+                            byte* output, size_t output_capacity) override {
+        ZSTD_CCtx* cctx = zstd_contexts().cctx;
+        size_t result = cdict_
+            ? ZSTD_compress_usingCDict(cctx, output, output_capacity, input, input_size, cdict_.get())
+            : ZSTD_compressCCtx(cctx, output, output_capacity, input, input_size, level_);
+        
+        if (ZSTD_isError(result)) {
+            return ErrorCode::INVALID_PARAMETER;
+        }
+        return result;
+    }
+    
+    Result<size_t> decompress(const byte* input, size_t input_size,
+                              byte* output, size_t output_capacity) override {
+        ZSTD_DCtx* dctx = zstd_contexts().dctx;
+        size_t result = ddict_
+            ? ZSTD_decompress_usingDDict(dctx, output, output_capacity, input, input_size, ddict_.get())
+            : ZSTD_decompressDCtx(dctx, output, output_capacity, input, input_size);
+        
+        if (ZSTD_isError(result)) {
+            return ErrorCode::PROTOCOL_ERROR;
+        }
+        return result;
+    }
+    
+    ErrorCode set_dictionary(const buffer_t& dictionary) override {
+        if (dictionary.empty()) {
+            cdict_.reset();
+            ddict_.reset();
+            return ErrorCode::SUCCESS;
+        }
+        
+        std::shared_ptr<ZSTD_CDict> cdict(ZSTD_createCDict(dictionary.data(), dictionary.size(), level_),
+                                          ZSTD_freeCDict);
+        std::shared_ptr<ZSTD_DDict> ddict(ZSTD_createDDict(dictionary.data(), dictionary.size()),
+                                          ZSTD_freeDDict);
+        if (!cdict || !ddict) {
+            LOG_ERROR("Failed to load zstd dictionary");
+            return ErrorCode::INVALID_PARAMETER;
+        }
+        
+        cdict_ = std::move(cdict);
+        ddict_ = std::move(ddict);
+        return ErrorCode::SUCCESS;
+    }
+
+private:
+    int level_;
+    std::shared_ptr<ZSTD_CDict> cdict_;
+    std::shared_ptr<ZSTD_DDict> ddict_;
+};
+
+#endif // UDP2DOCKER_HAVE_ZSTD
+
+} // namespace
+
+std::unique_ptr<Codec> create_codec(CompressionType type, int level) {
+    switch (type) {
+        case CompressionType::LZ4:
+            return std::make_unique<Lz4Codec>();
+#ifdef UDP2DOCKER_HAVE_ZSTD
+        case CompressionType::ZSTD:
+            return std::make_unique<ZstdCodec>(level);
+#endif
+        default:
+            (void)level;
+            return nullptr;
+    }
+}
+
+bool is_codec_available(CompressionType type) {
+    switch (type) {
+        case CompressionType::LZ4:
+            return true;
+#ifdef UDP2DOCKER_HAVE_ZSTD
+        case CompressionType::ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+Result<buffer_t> train_compression_dictionary(const std::vector<buffer_t>& samples,
+                                              size_t dictionary_size) {
+#ifdef UDP2DOCKER_HAVE_ZSTD
+    buffer_t joined;
+    std::vector<size_t> sample_sizes;
+    for (const auto& sample : samples) {
+        joined.insert(joined.end(), sample.begin(), sample.end());
+        sample_sizes.push_back(sample.size());
+    }
+    
+    buffer_t dictionary(dictionary_size);
+    size_t result = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(),
+                                          joined.data(), sample_sizes.data(),
+                                          static_cast<unsigned>(sample_sizes.size()));
+    if (ZDICT_isError(result)) {
+        LOG_ERROR("Dictionary training failed: " + std::string(ZDICT_getErrorName(result)));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    dictionary.resize(result);
+    return dictionary;
+#else
+    (void)samples;
+    (void)dictionary_size;
+    LOG_ERROR("Dictionary training requires zstd support");
+    return ErrorCode::INVALID_PARAMETER;
+#endif
+}
+
+string_t compression_type_to_string(CompressionType type) {
+    switch (type) {
+        case CompressionType::NONE: return "NONE";
+        case CompressionType::LZ4: return "LZ4";
+        case CompressionType::ZSTD: return "ZSTD";
+        default: return "UNKNOWN";
+    }
+}
+
+} // namespace udp2docker
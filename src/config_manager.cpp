@@ -50,6 +50,9 @@ std::vector<string_t> ConfigItem::as_list() const {
 // ConfigManager 实现
 ConfigManager::ConfigManager(const string_t& config_file)
     : config_file_(config_file)
+    , snapshot_(std::make_shared<ConfigSnapshot>())
+    , snapshot_version_(0)
+    , next_subscription_(1)
 {
     set_defaults();
     
@@ -61,29 +64,49 @@ ConfigManager::ConfigManager(const string_t& config_file)
 ConfigManager::~ConfigManager() = default;
 
 ErrorCode ConfigManager::load_config(const string_t& config_file) {
-    std::lock_guard<std::mutex> lock(config_mutex_);
-    
-    config_file_ = config_file;
-    
-    if (config_file_.empty()) {
-        return ErrorCode::INVALID_PARAMETER;
-    }
-    
-    std::ifstream file(config_file_);
-    if (!file.is_open()) {
-        return ErrorCode::SUCCESS; // 文件不存在不算错误，使用默认配置
+    ErrorCode result;
+    std::vector<Change> changes;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        
+        config_file_ = config_file;
+        
+        if (config_file_.empty()) {
+            return ErrorCode::INVALID_PARAMETER;
+        }
+        
+        std::ifstream file(config_file_);
+        if (!file.is_open()) {
+            return ErrorCode::SUCCESS; // 文件不存在不算错误，使用默认配置
+        }
+        
+        string_t extension = get_file_extension(config_file_);
+        std::map<string_t, ConfigItem> loaded;
+        
+        if (extension == "json") {
+            result = load_json_config(config_file_, loaded);
+        } else {
+            // 默认按INI格式处理
+            result = load_ini_config(config_file_, loaded);
+        }
+        if (result != ErrorCode::SUCCESS) {
+            return result;
+        }
+        
+        // 由编程设置的配置项和新文件内容重建，上次文件中有而这次没有的键随之消失
+        std::map<string_t, ConfigItem> before = std::move(config_items_);
+        file_items_ = std::move(loaded);
+        config_items_ = overlay_items_;
+        for (const auto& pair : file_items_) {
+            config_items_[pair.first] = pair.second;
+        }
+        
+        publish_locked();
+        changes = diff_locked(before);
     }
     
-    string_t extension = get_file_extension(config_file_);
-    
-    if (extension == "json") {
-        return load_json_config(config_file_);
-    } else if (extension == "ini") {
-        return load_ini_config(config_file_);
-    } else {
-        // 默认按INI格式处理
-        return load_ini_config(config_file_);
-    }
+    notify_changes(changes);
+    return result;
 }
 
 ErrorCode ConfigManager::save_config(const string_t& config_file) {
@@ -105,7 +128,8 @@ ErrorCode ConfigManager::save_config(const string_t& config_file) {
 }
 
 void ConfigManager::load_from_environment(const string_t& prefix) {
-    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::unique_lock<std::mutex> lock(config_mutex_);
+    std::map<string_t, ConfigItem> before = config_items_;
     
     // 这里简化实现，实际项目中可以遍历环境变量
     const char* env_vars[] = {
@@ -124,29 +148,32 @@ void ConfigManager::load_from_environment(const string_t& prefix) {
             
             ConfigItem item(ConfigType::STRING, env_value, "Environment variable");
             config_items_[key] = item;
+            overlay_items_[key] = item;
         }
     }
+    
+    publish_locked();
+    std::vector<Change> changes = diff_locked(before);
+    lock.unlock();
+    notify_changes(changes);
 }
 
 void ConfigManager::set(const string_t& key, const ConfigItem& item) {
-    std::lock_guard<std::mutex> lock(config_mutex_);
-    
-    auto old_item = config_items_.find(key);
     ConfigItem old_value;
-    
-    if (old_item != config_items_.end()) {
-        old_value = old_item->second;
-    }
-    
-    config_items_[key] = item;
-    
-    if (change_callback_) {
-        try {
-            change_callback_(key, old_value, item);
-        } catch (...) {
-            // 忽略回调异常
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        
+        auto old_item = config_items_.find(key);
+        if (old_item != config_items_.end()) {
+            old_value = old_item->second;
         }
+        
+        config_items_[key] = item;
+        overlay_items_[key] = item;
+        publish_locked();
     }
+    
+    notify_change(key, old_value, item);
 }
 
 void ConfigManager::set_string(const string_t& key, const string_t& value, const string_t& description) {
@@ -166,44 +193,44 @@ void ConfigManager::set_double(const string_t& key, double value, const string_t
 }
 
 std::optional<ConfigItem> ConfigManager::get(const string_t& key) const {
-    std::lock_guard<std::mutex> lock(config_mutex_);
-    
-    auto it = config_items_.find(key);
-    if (it != config_items_.end()) {
-        return it->second;
+    auto current = snapshot();
+    const ConfigValue* value = current->find(key);
+    if (value) {
+        return value->item;
     }
     
     return std::nullopt;
 }
 
 string_t ConfigManager::get_string(const string_t& key, const string_t& default_value) const {
-    auto item = get(key);
-    return item ? item->as_string() : default_value;
+    return snapshot()->get_string(key, default_value);
 }
 
 int ConfigManager::get_int(const string_t& key, int default_value) const {
-    auto item = get(key);
-    return item ? item->as_int() : default_value;
+    return snapshot()->get_int(key, default_value);
 }
 
 bool ConfigManager::get_bool(const string_t& key, bool default_value) const {
-    auto item = get(key);
-    return item ? item->as_bool() : default_value;
+    return snapshot()->get_bool(key, default_value);
 }
 
 double ConfigManager::get_double(const string_t& key, double default_value) const {
-    auto item = get(key);
-    return item ? item->as_double() : default_value;
+    return snapshot()->get_double(key, default_value);
 }
 
 bool ConfigManager::has(const string_t& key) const {
-    std::lock_guard<std::mutex> lock(config_mutex_);
-    return config_items_.find(key) != config_items_.end();
+    return snapshot()->has(key);
 }
 
 bool ConfigManager::remove(const string_t& key) {
     std::lock_guard<std::mutex> lock(config_mutex_);
-    return config_items_.erase(key) > 0;
+    overlay_items_.erase(key);
+    file_items_.erase(key);
+    if (config_items_.erase(key) == 0) {
+        return false;
+    }
+    publish_locked();
+    return true;
 }
 
 std::vector<string_t> ConfigManager::get_all_keys() const {
@@ -227,6 +254,9 @@ size_t ConfigManager::size() const {
 void ConfigManager::clear() {
     std::lock_guard<std::mutex> lock(config_mutex_);
     config_items_.clear();
+    overlay_items_.clear();
+    file_items_.clear();
+    publish_locked();
 }
 
 ErrorCode ConfigManager::validate() const {
@@ -242,15 +272,29 @@ ErrorCode ConfigManager::validate() const {
 }
 
 void ConfigManager::register_change_callback(ConfigChangeCallback callback) {
-    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
     change_callback_ = callback;
 }
 
 void ConfigManager::unregister_change_callback() {
-    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
     change_callback_ = nullptr;
 }
 
+ConfigSubscription ConfigManager::subscribe(ConfigChangeCallback callback) {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    ConfigSubscription id = next_subscription_++;
+    subscribers_.emplace_back(id, std::move(callback));
+    return id;
+}
+
+void ConfigManager::unsubscribe(ConfigSubscription id) {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(),
+                                      [id](const auto& subscriber) { return subscriber.first == id; }),
+                       subscribers_.end());
+}
+
 void ConfigManager::set_defaults() {
     set_string("server.host", DEFAULT_HOST, "UDP server host address");
     set_int("server.port", DEFAULT_PORT, "UDP server port");
@@ -280,31 +324,73 @@ string_t ConfigManager::export_config(const string_t& format) const {
 }
 
 ErrorCode ConfigManager::import_config(const string_t& config_str, const string_t& format) {
-    std::lock_guard<std::mutex> lock(config_mutex_);
+    std::unique_lock<std::mutex> lock(config_mutex_);
     
     try {
-        if (format == "json") {
-            auto parsed = parse_json(config_str);
-            if (parsed) {
-                config_items_ = *parsed;
-                return ErrorCode::SUCCESS;
-            }
-        } else {
-            auto parsed = parse_ini(config_str);
-            if (parsed) {
-                config_items_ = *parsed;
-                return ErrorCode::SUCCESS;
-            }
+        auto parsed = format == "json" ? parse_json(config_str) : parse_ini(config_str);
+        if (!parsed) {
+            return ErrorCode::PROTOCOL_ERROR;
         }
         
-        return ErrorCode::PROTOCOL_ERROR;
+        // 导入的内容替换全部配置，之后重新加载文件时叠加在它之上
+        std::map<string_t, ConfigItem> before = std::move(config_items_);
+        config_items_ = std::move(*parsed);
+        overlay_items_ = config_items_;
+        file_items_.clear();
+        publish_locked();
+        std::vector<Change> changes = diff_locked(before);
+        lock.unlock();
+        notify_changes(changes);
+        return ErrorCode::SUCCESS;
     } catch (...) {
         return ErrorCode::PROTOCOL_ERROR;
     }
 }
 
+std::shared_ptr<const ConfigSnapshot> ConfigManager::snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+ConfigHandle<int> ConfigManager::int_handle(const string_t& key, int default_value) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return ConfigHandle<int>(cell_locked(key), default_value);
+}
+
+ConfigHandle<bool> ConfigManager::bool_handle(const string_t& key, bool default_value) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return ConfigHandle<bool>(cell_locked(key), default_value);
+}
+
+ConfigHandle<double> ConfigManager::double_handle(const string_t& key, double default_value) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return ConfigHandle<double>(cell_locked(key), default_value);
+}
+
 // 私有方法实现
-ErrorCode ConfigManager::load_json_config(const string_t& file_path) {
+void ConfigManager::publish_locked() {
+    auto next = std::make_shared<ConfigSnapshot>();
+    next->values_.reserve(config_items_.size());
+    for (const auto& pair : config_items_) {
+        next->values_.emplace(pair.first, ConfigValue(pair.second));
+    }
+    next->version_ = ++snapshot_version_;
+    
+    for (auto& pair : cells_) {
+        pair.second->store(next->find(pair.first));
+    }
+    std::atomic_store(&snapshot_, std::shared_ptr<const ConfigSnapshot>(std::move(next)));
+}
+
+ConfigCell* ConfigManager::cell_locked(const string_t& key) {
+    auto& cell = cells_[key];
+    if (!cell) {
+        cell = std::make_unique<ConfigCell>();
+        cell->store(snapshot_->find(key));
+    }
+    return cell.get();
+}
+
+ErrorCode ConfigManager::load_json_config(const string_t& file_path, std::map<string_t, ConfigItem>& items) const {
     // 简化的JSON加载实现
     // 实际项目中应该使用成熟的JSON库如nlohmann/json
     
@@ -318,16 +404,14 @@ ErrorCode ConfigManager::load_json_config(const string_t& file_path) {
     
     auto parsed = parse_json(content);
     if (parsed) {
-        for (const auto& pair : *parsed) {
-            config_items_[pair.first] = pair.second;
-        }
+        items = std::move(*parsed);
         return ErrorCode::SUCCESS;
     }
     
     return ErrorCode::PROTOCOL_ERROR;
 }
 
-ErrorCode ConfigManager::load_ini_config(const string_t& file_path) {
+ErrorCode ConfigManager::load_ini_config(const string_t& file_path, std::map<string_t, ConfigItem>& items) const {
     std::ifstream file(file_path);
     if (!file.is_open()) {
         return ErrorCode::SOCKET_RECEIVE_FAILED;
@@ -338,9 +422,7 @@ ErrorCode ConfigManager::load_ini_config(const string_t& file_path) {
     
     auto parsed = parse_ini(content);
     if (parsed) {
-        for (const auto& pair : *parsed) {
-            config_items_[pair.first] = pair.second;
-        }
+        items = std::move(*parsed);
         return ErrorCode::SUCCESS;
     }
     
@@ -378,13 +460,53 @@ string_t ConfigManager::get_file_extension(const string_t& file_path) const {
 }
 
 void ConfigManager::notify_change(const string_t& key, const ConfigItem& old_value, const ConfigItem& new_value) {
-    if (change_callback_) {
-        try {
-            change_callback_(key, old_value, new_value);
-        } catch (...) {
-            // 忽略回调异常
+    notify_changes({Change{key, old_value, new_value}});
+}
+
+void ConfigManager::notify_changes(const std::vector<Change>& changes) {
+    if (changes.empty()) {
+        return;
+    }
+    
+    // 复制一份再调用，回调中可以订阅或取消订阅
+    std::vector<ConfigChangeCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        if (change_callback_) {
+            callbacks.push_back(change_callback_);
+        }
+        for (const auto& subscriber : subscribers_) {
+            callbacks.push_back(subscriber.second);
+        }
+    }
+    
+    for (const auto& change : changes) {
+        for (const auto& callback : callbacks) {
+            try {
+                callback(change.key, change.old_value, change.new_value);
+            } catch (...) {
+                // 忽略回调异常
+            }
+        }
+    }
+}
+
+std::vector<ConfigManager::Change> ConfigManager::diff_locked(const std::map<string_t, ConfigItem>& before) const {
+    std::vector<Change> changes;
+    for (const auto& pair : config_items_) {
+        auto old_item = before.find(pair.first);
+        if (old_item == before.end()) {
+            changes.push_back(Change{pair.first, ConfigItem(), pair.second});
+        } else if (old_item->second.value != pair.second.value) {
+            changes.push_back(Change{pair.first, old_item->second, pair.second});
+        }
+    }
+    for (const auto& pair : before) {
+        if (config_items_.find(pair.first) == config_items_.end()) {
+            changes.push_back(Change{pair.first, pair.second, ConfigItem()});
         }
     }
+    return changes;
 }
 
 std::optional<std::map<string_t, ConfigItem>> ConfigManager::parse_json(const string_t& json_str) const {
@@ -515,23 +637,33 @@ string_t ConfigManager::config_to_ini() const {
 
 // ConfigManagerSingleton 实现
 std::unique_ptr<ConfigManager> ConfigManagerSingleton::instance_;
+std::atomic<ConfigManager*> ConfigManagerSingleton::current_{nullptr};
 std::mutex ConfigManagerSingleton::instance_mutex_;
 
 ConfigManager& ConfigManagerSingleton::instance() {
+    ConfigManager* current = current_.load(std::memory_order_acquire);
+    if (current) {
+        return *current;
+    }
+    
     std::lock_guard<std::mutex> lock(instance_mutex_);
     if (!instance_) {
         instance_ = std::make_unique<ConfigManager>();
+        current_.store(instance_.get(), std::memory_order_release);
     }
     return *instance_;
 }
 
 void ConfigManagerSingleton::initialize(const string_t& config_file) {
     std::lock_guard<std::mutex> lock(instance_mutex_);
+    current_.store(nullptr, std::memory_order_release);
     instance_ = std::make_unique<ConfigManager>(config_file);
+    current_.store(instance_.get(), std::memory_order_release);
 }
 
 void ConfigManagerSingleton::destroy() {
     std::lock_guard<std::mutex> lock(instance_mutex_);
+    current_.store(nullptr, std::memory_order_release);
     instance_.reset();
 }
 
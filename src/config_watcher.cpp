@@ -0,0 +1,425 @@
+#include "udp2docker/config_watcher.h"
+#include "udp2docker/udp_client.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#else
+#include <filesystem>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+using watch_clock_t = std::chrono::steady_clock;
+
+// Kubernetes ConfigMap/Secret挂载通过原子替换该符号链接更新所有文件
+constexpr const char* MOUNT_DATA_LINK = "..data";
+
+int remaining_ms(watch_clock_t::time_point deadline) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - watch_clock_t::now());
+    return static_cast<int>(std::max<int64_t>(remaining.count(), 0));
+}
+
+int positive_or(int value, int fallback) {
+    return value > 0 ? value : fallback;
+}
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher(ConfigManager& config, std::chrono::milliseconds debounce)
+    : config_(config)
+    , debounce_(debounce)
+    , running_(false)
+    , reload_count_(0)
+#ifdef _WIN32
+    , directory_handle_(nullptr)
+    , stop_event_(nullptr)
+#elif defined(__linux__)
+    , inotify_fd_(-1)
+    , wakeup_fd_(-1)
+#endif
+{
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+    
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    for (ConfigSubscription id : subscriptions_) {
+        config_.unsubscribe(id);
+    }
+}
+
+ErrorCode ConfigWatcher::start() {
+    if (running_) {
+        return ErrorCode::SUCCESS;
+    }
+    
+    string_t path = config_.get_config_file();
+    if (path.empty()) {
+        LOG_ERROR("ConfigWatcher: no configuration file to watch");
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    size_t separator = path.find_last_of("/\\");
+    directory_ = separator == string_t::npos ? "." : path.substr(0, std::max<size_t>(separator, 1));
+    file_name_ = separator == string_t::npos ? path : path.substr(separator + 1);
+    
+    auto result = open_watch();
+    if (result != ErrorCode::SUCCESS) {
+        close_watch();
+        return result;
+    }
+    
+    running_ = true;
+    thread_ = std::thread([this]() { watch_loop(); });
+    
+    LOG_INFO_F("Watching configuration file {}", path);
+    return ErrorCode::SUCCESS;
+}
+
+void ConfigWatcher::stop() {
+    if (!running_) {
+        return;
+    }
+
+#ifdef _WIN32
+    running_ = false;
+    SetEvent(static_cast<HANDLE>(stop_event_));
+#elif defined(__linux__)
+    running_ = false;
+    uint64_t value = 1;
+    ssize_t ignored = write(wakeup_fd_, &value, sizeof(value));
+    (void)ignored;
+#else
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        running_ = false;
+    }
+    wait_cv_.notify_all();
+#endif
+    
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close_watch();
+}
+
+void ConfigWatcher::set_reload_callback(ConfigReloadCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    reload_callback_ = std::move(callback);
+}
+
+void ConfigWatcher::attach(UdpClient& client) {
+    ConfigManager& config = config_;
+    auto id = config_.subscribe([&config, &client](const string_t& key, const ConfigItem&, const ConfigItem&) {
+        if (key.compare(0, 7, "server.") != 0 && key.compare(0, 7, "client.") != 0) {
+            return;
+        }
+        
+        // 一次重新加载会逐键通知，第一次就按完整快照更新，之后的通知没有差异直接返回
+        // 只更新可以在线生效的设置，套接字选项要重新initialize()
+        const UdpConfig& current = client.get_config();
+        UdpConfig loaded = make_udp_config(*config.snapshot(), current);
+        UdpConfig updated = current;
+        updated.server_host = loaded.server_host;
+        updated.server_port = positive_or(loaded.server_port, current.server_port);
+        updated.timeout_ms = positive_or(loaded.timeout_ms, current.timeout_ms);
+        updated.max_retries = loaded.max_retries;
+        updated.enable_keep_alive = loaded.enable_keep_alive;
+        updated.keep_alive_interval_ms = positive_or(loaded.keep_alive_interval_ms, current.keep_alive_interval_ms);
+        
+        if (updated.server_host == current.server_host && updated.server_port == current.server_port &&
+            updated.timeout_ms == current.timeout_ms && updated.max_retries == current.max_retries &&
+            updated.enable_keep_alive == current.enable_keep_alive &&
+            updated.keep_alive_interval_ms == current.keep_alive_interval_ms) {
+            return;
+        }
+        client.update_config(updated);
+    });
+    
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    subscriptions_.push_back(id);
+}
+
+void ConfigWatcher::attach(Logger& logger) {
+    auto id = config_.subscribe([&logger](const string_t& key, const ConfigItem&, const ConfigItem& new_value) {
+        if (key != "log.level" || new_value.value.empty()) {
+            return;
+        }
+        
+        auto level = string_to_level(new_value.value);
+        if (!level) {
+            LOG_WARN_F("Ignoring unknown log level {}", new_value.value);
+            return;
+        }
+        if (*level != logger.get_level()) {
+            logger.set_level(*level);
+            LOG_INFO_F("Log level changed to {}", level_to_string(*level));
+        }
+    });
+    
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    subscriptions_.push_back(id);
+}
+
+void ConfigWatcher::reload() {
+    ErrorCode result = config_.reload();
+    reload_count_++;
+    
+    if (result == ErrorCode::SUCCESS) {
+        LOG_INFO("Configuration reloaded: " + config_.get_config_file());
+    } else {
+        LOG_WARN_F("Failed to reload configuration file {}", config_.get_config_file());
+    }
+    
+    ConfigReloadCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        callback = reload_callback_;
+    }
+    if (callback) {
+        callback(result);
+    }
+}
+
+bool ConfigWatcher::is_relevant(const string_t& name) const {
+    return name == file_name_ || name == MOUNT_DATA_LINK;
+}
+
+#ifdef _WIN32
+
+ErrorCode ConfigWatcher::open_watch() {
+    HANDLE directory = CreateFileA(directory_.c_str(), FILE_LIST_DIRECTORY,
+                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                   OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (directory == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("ConfigWatcher: failed to open directory " + directory_);
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    directory_handle_ = directory;
+    
+    stop_event_ = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    if (!stop_event_) {
+        LOG_ERROR("ConfigWatcher: CreateEvent failed");
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    return ErrorCode::SUCCESS;
+}
+
+void ConfigWatcher::close_watch() {
+    if (directory_handle_) {
+        CloseHandle(static_cast<HANDLE>(directory_handle_));
+        directory_handle_ = nullptr;
+    }
+    if (stop_event_) {
+        CloseHandle(static_cast<HANDLE>(stop_event_));
+        stop_event_ = nullptr;
+    }
+}
+
+void ConfigWatcher::watch_loop() {
+    HANDLE directory = static_cast<HANDLE>(directory_handle_);
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    alignas(DWORD) char buffer[16384];
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+    
+    bool issued = false;
+    bool pending = false;
+    watch_clock_t::time_point deadline;
+    
+    while (running_) {
+        if (!issued) {
+            ResetEvent(overlapped.hEvent);
+            if (!ReadDirectoryChangesW(directory, buffer, sizeof(buffer), FALSE, filter, nullptr, &overlapped, nullptr)) {
+                LOG_ERROR("ConfigWatcher: ReadDirectoryChangesW failed");
+                break;
+            }
+            issued = true;
+        }
+        
+        HANDLE handles[2] = {overlapped.hEvent, static_cast<HANDLE>(stop_event_)};
+        DWORD timeout = pending ? static_cast<DWORD>(remaining_ms(deadline)) : INFINITE;
+        DWORD waited = WaitForMultipleObjects(2, handles, FALSE, timeout);
+        if (waited == WAIT_OBJECT_0 + 1 || waited == WAIT_FAILED) {
+            break;
+        }
+        
+        if (waited == WAIT_OBJECT_0) {
+            issued = false;
+            DWORD bytes = 0;
+            if (GetOverlappedResult(directory, &overlapped, &bytes, FALSE)) {
+                // 0字节表示事件过多缓冲区溢出，按文件已变化处理
+                bool changed = bytes == 0;
+                for (DWORD offset = 0; bytes != 0;) {
+                    auto* info = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(buffer + offset);
+                    int wide_length = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+                    int length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, wide_length, nullptr, 0, nullptr, nullptr);
+                    string_t name(static_cast<size_t>(std::max(length, 0)), '\0');
+                    WideCharToMultiByte(CP_UTF8, 0, info->FileName, wide_length, &name[0], length, nullptr, nullptr);
+                    changed = changed || is_relevant(name);
+                    
+                    if (info->NextEntryOffset == 0) {
+                        break;
+                    }
+                    offset += info->NextEntryOffset;
+                }
+                
+                if (changed) {
+                    pending = true;
+                    deadline = watch_clock_t::now() + debounce_;
+                }
+            }
+        }
+        
+        if (pending && watch_clock_t::now() >= deadline) {
+            pending = false;
+            reload();
+        }
+    }
+    
+    if (issued) {
+        DWORD bytes = 0;
+        CancelIo(directory);
+        GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+    }
+    CloseHandle(overlapped.hEvent);
+}
+
+#elif defined(__linux__)
+
+ErrorCode ConfigWatcher::open_watch() {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        LOG_ERROR("ConfigWatcher: inotify_init1 failed: " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    // 监视目录而不是文件：编辑器和挂载卷通常以重命名替换文件，文件本身的监视会失效
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+    if (inotify_add_watch(inotify_fd_, directory_.c_str(), mask) < 0) {
+        LOG_ERROR("ConfigWatcher: failed to watch " + directory_ + ": " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        LOG_ERROR("ConfigWatcher: eventfd failed: " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    return ErrorCode::SUCCESS;
+}
+
+void ConfigWatcher::close_watch() {
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
+}
+
+void ConfigWatcher::watch_loop() {
+    alignas(struct inotify_event) char buffer[4096];
+    bool pending = false;
+    watch_clock_t::time_point deadline;
+    
+    while (running_) {
+        pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wakeup_fd_, POLLIN, 0}};
+        int ready = poll(fds, 2, pending ? remaining_ms(deadline) : -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("ConfigWatcher: poll failed: " + std::string(strerror(errno)));
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        
+        if (fds[0].revents & POLLIN) {
+            bool changed = false;
+            ssize_t length;
+            while ((length = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+                for (char* cursor = buffer; cursor < buffer + length;) {
+                    auto* event = reinterpret_cast<struct inotify_event*>(cursor);
+                    changed = changed || (event->mask & IN_Q_OVERFLOW) != 0 ||
+                              (event->len > 0 && is_relevant(event->name));
+                    cursor += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            
+            if (changed) {
+                pending = true;
+                deadline = watch_clock_t::now() + debounce_;
+            }
+        }
+        
+        if (pending && watch_clock_t::now() >= deadline) {
+            pending = false;
+            reload();
+        }
+    }
+}
+
+#else
+
+ErrorCode ConfigWatcher::open_watch() {
+    return ErrorCode::SUCCESS;
+}
+
+void ConfigWatcher::close_watch() {
+}
+
+void ConfigWatcher::watch_loop() {
+    namespace fs = std::filesystem;
+    
+    // 没有目录事件通知时按修改时间轮询，两次检查之间没有变化才重新加载
+    fs::path path(config_.get_config_file());
+    auto modified_time = [&path]() {
+        std::error_code error;
+        return fs::last_write_time(path, error);
+    };
+    
+    auto last_seen = modified_time();
+    bool pending = false;
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    while (running_) {
+        wait_cv_.wait_for(lock, debounce_, [this]() { return !running_; });
+        if (!running_) {
+            break;
+        }
+        
+        auto current = modified_time();
+        if (current != last_seen) {
+            last_seen = current;
+            pending = true;
+            continue;
+        }
+        
+        if (pending) {
+            pending = false;
+            lock.unlock();
+            reload();
+            lock.lock();
+        }
+    }
+}
+
+#endif
+
+} // namespace udp2docker
@@ -0,0 +1,302 @@
+#include "udp2docker/coroutine.h"
+#include "udp2docker/buffer_pool.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <charconv>
+#include <future>
+
+namespace udp2docker {
+
+namespace {
+
+// 顶层协程的外壳：创建后立即运行，结束时自行销毁协程帧
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+DetachedTask run_detached(Task<void> task) {
+    try {
+        co_await std::move(task);
+    } catch (const std::exception& e) {
+        LOG_ERROR_F("AsyncClient: coroutine terminated with exception: {}", e.what());
+    } catch (...) {
+        LOG_ERROR("AsyncClient: coroutine terminated with unknown exception");
+    }
+}
+
+} // anonymous namespace
+
+AsyncClient::AsyncClient(UdpClient& client, std::shared_ptr<EventLoop> loop, size_t inbox_capacity)
+    : client_(client)
+    , loop_(std::move(loop))
+    , owns_loop_(false)
+    , started_(false)
+    , closed_(false)
+    , inbox_capacity_(inbox_capacity) {
+    
+    if (!loop_) {
+        loop_ = std::make_shared<EventLoop>();
+        owns_loop_ = true;
+    }
+}
+
+AsyncClient::~AsyncClient() {
+    close();
+}
+
+ErrorCode AsyncClient::start() {
+    if (started_) {
+        return ErrorCode::SUCCESS;
+    }
+    
+    if (owns_loop_ && !loop_->is_running()) {
+        ErrorCode started = loop_->start();
+        if (started != ErrorCode::SUCCESS) {
+            return started;
+        }
+    }
+    
+    ErrorCode result = client_.set_event_loop(loop_);
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    
+    result = client_.start_receive_batch_async(
+        [this](const PacketView& packet) { on_packet(packet); },
+        [](ErrorCode error_code, const string_t& error_message) {
+            LOG_WARN_F("AsyncClient: receive error {}: {}", static_cast<int>(error_code), error_message);
+        });
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    
+    started_ = true;
+    closed_ = false;
+    return ErrorCode::SUCCESS;
+}
+
+void AsyncClient::close() {
+    if (started_) {
+        client_.stop_receive_async();
+        started_ = false;
+    }
+    
+    if (loop_->is_running() && !loop_->in_loop_thread()) {
+        std::promise<void> done;
+        std::future<void> finished = done.get_future();
+        loop_->post([this, &done]() {
+            closed_ = true;
+            fail_all();
+            done.set_value();
+        });
+        finished.wait();
+    } else {
+        closed_ = true;
+        fail_all();
+    }
+    
+    if (owns_loop_ && !loop_->in_loop_thread()) {
+        loop_->stop();
+        client_.set_event_loop(nullptr);
+    }
+}
+
+void AsyncClient::spawn(Task<void> task) {
+    // std::function要求可拷贝，Task只能移动
+    auto holder = std::make_shared<Task<void>>(std::move(task));
+    loop_->post([holder]() { run_detached(std::move(*holder)); });
+}
+
+AsyncClient::SendAwaiter AsyncClient::send(const Message& message) {
+    return SendAwaiter{send_message(message, Endpoint())};
+}
+
+AsyncClient::SendAwaiter AsyncClient::send(const Message& message, const Endpoint& to) {
+    return SendAwaiter{send_message(message, to)};
+}
+
+AsyncClient::RequestAwaiter AsyncClient::request(Message message, std::chrono::milliseconds timeout,
+                                                 const Endpoint& to) {
+    if (message.header.sequence_id == 0) {
+        message.header.sequence_id = protocol_.get_next_sequence_id();
+    }
+    
+    uint32_t sequence_id = message.header.sequence_id;
+    ErrorCode sent = ErrorCode::SUCCESS;
+    if (closed_) {
+        sent = ErrorCode::SOCKET_RECEIVE_FAILED;
+    } else if (requests_.count(sequence_id) != 0) {
+        LOG_ERROR_F("AsyncClient: request {} is already pending", sequence_id);
+        sent = ErrorCode::INVALID_PARAMETER;
+    } else {
+        sent = send_message(message, to);
+    }
+    return RequestAwaiter(*this, sent, sequence_id, timeout);
+}
+
+// 私有方法实现
+ErrorCode AsyncClient::send_message(const Message& message, const Endpoint& to) {
+    auto frame = protocol_.serialize_pooled(message);
+    if (!frame.is_success()) {
+        return frame.error_code();
+    }
+    
+    if (to.valid()) {
+        return client_.send_to(frame.value().view(), to);
+    }
+    return client_.send(frame.value());
+}
+
+bool AsyncClient::take_queued(Waiter& waiter) {
+    if (!inbox_.empty()) {
+        waiter.result = Result<ReceivedMessage>(std::move(inbox_.front()));
+        inbox_.pop_front();
+        return true;
+    }
+    
+    if (closed_) {
+        waiter.result = Result<ReceivedMessage>(ErrorCode::SOCKET_RECEIVE_FAILED);
+        return true;
+    }
+    return false;
+}
+
+void AsyncClient::wait_receive(Waiter& waiter, std::coroutine_handle<> handle, std::chrono::milliseconds timeout) {
+    waiter.handle = handle;
+    receivers_.push_back(&waiter);
+    if (timeout.count() > 0) {
+        Waiter* pending = &waiter;
+        waiter.timer = loop_->run_after(timeout, [this, pending]() { expire_receive(pending); });
+    }
+}
+
+void AsyncClient::wait_response(Waiter& waiter, std::coroutine_handle<> handle, std::chrono::milliseconds timeout) {
+    waiter.handle = handle;
+    requests_.emplace(waiter.sequence_id, &waiter);
+    if (timeout.count() > 0) {
+        uint32_t sequence_id = waiter.sequence_id;
+        waiter.timer = loop_->run_after(timeout, [this, sequence_id]() { expire_request(sequence_id); });
+    }
+}
+
+void AsyncClient::expire_receive(Waiter* waiter) {
+    auto it = std::find(receivers_.begin(), receivers_.end(), waiter);
+    if (it == receivers_.end()) {
+        return;
+    }
+    
+    receivers_.erase(it);
+    ++stats_.timeouts;
+    waiter->timer = 0;
+    complete(*waiter, Result<ReceivedMessage>(ErrorCode::TIMEOUT));
+    resume_ready();
+}
+
+void AsyncClient::expire_request(uint32_t sequence_id) {
+    auto it = requests_.find(sequence_id);
+    if (it == requests_.end()) {
+        return;
+    }
+    
+    Waiter* waiter = it->second;
+    requests_.erase(it);
+    ++stats_.timeouts;
+    LOG_DEBUG_F("AsyncClient: request {} timed out", sequence_id);
+    waiter->timer = 0;
+    complete(*waiter, Result<ReceivedMessage>(ErrorCode::TIMEOUT));
+    resume_ready();
+}
+
+void AsyncClient::on_packet(const PacketView& packet) {
+    auto result = protocol_.deserialize_each(packet.data, [this, &packet](const MessageView& view) {
+        deliver(view, packet.from);
+    });
+    if (!result.is_success()) {
+        ++stats_.invalid;
+    }
+    
+    // 协程恢复后可能再次使用protocol_，等本数据报解析完再恢复
+    resume_ready();
+}
+
+void AsyncClient::deliver(const MessageView& view, const Endpoint& from) {
+    ++stats_.received;
+    
+    if (view.header.type == MessageType::RESPONSE && !requests_.empty()) {
+        auto response_to = view.metadata.find("response_to");
+        uint32_t sequence_id = 0;
+        if (response_to &&
+            std::from_chars(response_to->data(), response_to->data() + response_to->size(), sequence_id).ec == std::errc()) {
+            auto it = requests_.find(sequence_id);
+            if (it != requests_.end()) {
+                Waiter* waiter = it->second;
+                requests_.erase(it);
+                ++stats_.responses;
+                complete(*waiter, Result<ReceivedMessage>(ReceivedMessage{view.to_message(), from}));
+                return;
+            }
+        }
+    }
+    
+    if (!receivers_.empty()) {
+        Waiter* waiter = receivers_.front();
+        receivers_.pop_front();
+        complete(*waiter, Result<ReceivedMessage>(ReceivedMessage{view.to_message(), from}));
+        return;
+    }
+    
+    if (inbox_.size() >= inbox_capacity_) {
+        ++stats_.dropped;
+        return;
+    }
+    inbox_.push_back(ReceivedMessage{view.to_message(), from});
+}
+
+void AsyncClient::complete(Waiter& waiter, Result<ReceivedMessage> result) {
+    if (waiter.timer != 0) {
+        // 在事件循环线程中取消，之后定时器不会再触发
+        loop_->cancel_timer(waiter.timer);
+        waiter.timer = 0;
+    }
+    waiter.result = std::move(result);
+    ready_.push_back(waiter.handle);
+}
+
+void AsyncClient::resume_ready() {
+    // 恢复的协程可能再次触发resume_ready()（例如调用close()），先取出本轮要恢复的协程
+    std::vector<std::coroutine_handle<>> ready;
+    ready.swap(ready_);
+    for (auto handle : ready) {
+        handle.resume();
+    }
+    
+    if (ready_.empty()) {
+        ready.clear();
+        ready_.swap(ready);
+    }
+}
+
+void AsyncClient::fail_all() {
+    while (!receivers_.empty()) {
+        Waiter* waiter = receivers_.front();
+        receivers_.pop_front();
+        complete(*waiter, Result<ReceivedMessage>(ErrorCode::SOCKET_RECEIVE_FAILED));
+    }
+    
+    while (!requests_.empty()) {
+        auto it = requests_.begin();
+        Waiter* waiter = it->second;
+        requests_.erase(it);
+        complete(*waiter, Result<ReceivedMessage>(ErrorCode::SOCKET_RECEIVE_FAILED));
+    }
+    
+    resume_ready();
+}
+
+} // namespace udp2docker
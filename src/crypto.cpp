@@ -0,0 +1,223 @@
+#include "udp2docker/crypto.h"
+#include "udp2docker/logger.h"
+#include <climits>
+#include <cstring>
+
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+// 密钥派生参数，收发双方必须一致
+constexpr const char* KEY_DERIVATION_SALT = "udp2docker-aead-v1";
+constexpr int KEY_DERIVATION_ITERATIONS = 10000;
+
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+
+const EVP_CIPHER* get_evp_cipher(CipherType type) {
+    switch (type) {
+        case CipherType::AES_256_GCM:
+            return EVP_aes_256_gcm();
+        case CipherType::CHACHA20_POLY1305:
+            return EVP_chacha20_poly1305();
+        default:
+            return nullptr;
+    }
+}
+
+#endif // UDP2DOCKER_HAVE_OPENSSL
+
+} // namespace
+
+// AeadCipher 实现
+AeadCipher::AeadCipher(CipherType type, evp_cipher_ctx_st* encrypt_ctx, evp_cipher_ctx_st* decrypt_ctx)
+    : type_(type)
+    , encrypt_ctx_(encrypt_ctx)
+    , decrypt_ctx_(decrypt_ctx)
+{
+}
+
+AeadCipher::~AeadCipher() {
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+    EVP_CIPHER_CTX_free(encrypt_ctx_);
+    EVP_CIPHER_CTX_free(decrypt_ctx_);
+#endif
+}
+
+std::unique_ptr<AeadCipher> AeadCipher::create(CipherType type, const byte* key) {
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+    const EVP_CIPHER* cipher = get_evp_cipher(type);
+    if (cipher == nullptr || key == nullptr) {
+        return nullptr;
+    }
+    
+    EVP_CIPHER_CTX* encrypt_ctx = EVP_CIPHER_CTX_new();
+    EVP_CIPHER_CTX* decrypt_ctx = EVP_CIPHER_CTX_new();
+    std::unique_ptr<AeadCipher> aead(new AeadCipher(type, encrypt_ctx, decrypt_ctx));
+    if (encrypt_ctx == nullptr || decrypt_ctx == nullptr) {
+        return nullptr;
+    }
+    
+    // 密钥扩展只在这里做一次，之后每条消息只重新设置nonce
+    if (EVP_EncryptInit_ex(encrypt_ctx, cipher, nullptr, key, nullptr) != 1 ||
+        EVP_DecryptInit_ex(decrypt_ctx, cipher, nullptr, key, nullptr) != 1) {
+        LOG_ERROR("Failed to initialize " + cipher_type_to_string(type));
+        return nullptr;
+    }
+    
+    return aead;
+#else
+    (void)type;
+    (void)key;
+    return nullptr;
+#endif
+}
+
+bool AeadCipher::seal(const byte* nonce, BufferView aad, BufferView plaintext, byte* ciphertext, byte* tag) {
+    return seal(nonce, aad, &plaintext, 1, ciphertext, tag);
+}
+
+bool AeadCipher::seal(const byte* nonce, BufferView aad, const BufferView* parts, size_t count,
+                      byte* ciphertext, byte* tag) {
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+    if (aad.size > static_cast<size_t>(INT_MAX)) {
+        return false;
+    }
+    
+    int length = 0;
+    if (EVP_EncryptInit_ex(encrypt_ctx_, nullptr, nullptr, nullptr, nonce) != 1) {
+        return false;
+    }
+    
+    if (!aad.empty() &&
+        EVP_EncryptUpdate(encrypt_ctx_, nullptr, &length, aad.data, static_cast<int>(aad.size)) != 1) {
+        return false;
+    }
+    
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (parts[i].empty()) {
+            continue;
+        }
+        if (parts[i].size > static_cast<size_t>(INT_MAX) ||
+            EVP_EncryptUpdate(encrypt_ctx_, ciphertext + written, &length,
+                              parts[i].data, static_cast<int>(parts[i].size)) != 1) {
+            return false;
+        }
+        written += static_cast<size_t>(length);
+    }
+    
+    if (EVP_EncryptFinal_ex(encrypt_ctx_, ciphertext + written, &length) != 1) {
+        return false;
+    }
+    
+    return EVP_CIPHER_CTX_ctrl(encrypt_ctx_, EVP_CTRL_AEAD_GET_TAG,
+                               static_cast<int>(AEAD_TAG_SIZE), tag) == 1;
+#else
+    (void)nonce;
+    (void)aad;
+    (void)parts;
+    (void)count;
+    (void)ciphertext;
+    (void)tag;
+    return false;
+#endif
+}
+
+bool AeadCipher::open(const byte* nonce, BufferView aad, BufferView ciphertext, const byte* tag, byte* plaintext) {
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+    if (ciphertext.size > static_cast<size_t>(INT_MAX) || aad.size > static_cast<size_t>(INT_MAX)) {
+        return false;
+    }
+    
+    int length = 0;
+    if (EVP_DecryptInit_ex(decrypt_ctx_, nullptr, nullptr, nullptr, nonce) != 1) {
+        return false;
+    }
+    
+    if (!aad.empty() &&
+        EVP_DecryptUpdate(decrypt_ctx_, nullptr, &length, aad.data, static_cast<int>(aad.size)) != 1) {
+        return false;
+    }
+    
+    int written = 0;
+    if (!ciphertext.empty()) {
+        if (EVP_DecryptUpdate(decrypt_ctx_, plaintext, &length,
+                              ciphertext.data, static_cast<int>(ciphertext.size)) != 1) {
+            return false;
+        }
+        written = length;
+    }
+    
+    if (EVP_CIPHER_CTX_ctrl(decrypt_ctx_, EVP_CTRL_AEAD_SET_TAG, static_cast<int>(AEAD_TAG_SIZE),
+                            const_cast<byte*>(tag)) != 1) {
+        return false;
+    }
+    
+    // 标签校验在Final中完成，失败时输出的明文不可使用
+    return EVP_DecryptFinal_ex(decrypt_ctx_, plaintext + written, &length) == 1;
+#else
+    (void)nonce;
+    (void)aad;
+    (void)ciphertext;
+    (void)tag;
+    (void)plaintext;
+    return false;
+#endif
+}
+
+bool is_cipher_available(CipherType type) {
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+    return get_evp_cipher(type) != nullptr;
+#else
+    (void)type;
+    return false;
+#endif
+}
+
+ErrorCode derive_encryption_key(const string_t& passphrase, byte* key) {
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+    if (passphrase.empty() || key == nullptr) {
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    int result = PKCS5_PBKDF2_HMAC(passphrase.data(), static_cast<int>(passphrase.size()),
+                                   reinterpret_cast<const unsigned char*>(KEY_DERIVATION_SALT),
+                                   static_cast<int>(std::strlen(KEY_DERIVATION_SALT)),
+                                   KEY_DERIVATION_ITERATIONS, EVP_sha256(),
+                                   static_cast<int>(AEAD_KEY_SIZE), key);
+    return result == 1 ? ErrorCode::SUCCESS : ErrorCode::INVALID_PARAMETER;
+#else
+    (void)passphrase;
+    (void)key;
+    (void)KEY_DERIVATION_SALT;
+    (void)KEY_DERIVATION_ITERATIONS;
+    LOG_ERROR("Encryption requires OpenSSL support");
+    return ErrorCode::INVALID_PARAMETER;
+#endif
+}
+
+bool secure_random_bytes(byte* out, size_t size) {
+#ifdef UDP2DOCKER_HAVE_OPENSSL
+    return size <= static_cast<size_t>(INT_MAX) && RAND_bytes(out, static_cast<int>(size)) == 1;
+#else
+    (void)out;
+    (void)size;
+    return false;
+#endif
+}
+
+string_t cipher_type_to_string(CipherType type) {
+    switch (type) {
+        case CipherType::NONE: return "NONE";
+        case CipherType::AES_256_GCM: return "AES-256-GCM";
+        case CipherType::CHACHA20_POLY1305: return "CHACHA20-POLY1305";
+        default: return "UNKNOWN";
+    }
+}
+
+} // namespace udp2docker
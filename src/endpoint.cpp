@@ -0,0 +1,176 @@
+#include "udp2docker/endpoint.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <net/if.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+// IPv4映射IPv6地址的前缀 ::ffff:0:0/96
+constexpr byte V4_MAPPED_PREFIX[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+
+} // namespace
+
+Endpoint Endpoint::from_sockaddr(const sockaddr* addr, size_t length) {
+    Endpoint result;
+    if (addr == nullptr) {
+        return result;
+    }
+    
+    if (addr->sa_family == AF_INET && length >= sizeof(sockaddr_in)) {
+        const auto* v4 = reinterpret_cast<const sockaddr_in*>(addr);
+        result.family_ = 4;
+        result.port_ = ntohs(v4->sin_port);
+        std::memcpy(result.address_, &v4->sin_addr, 4);
+    } else if (addr->sa_family == AF_INET6 && length >= sizeof(sockaddr_in6)) {
+        const auto* v6 = reinterpret_cast<const sockaddr_in6*>(addr);
+        const byte* bytes = reinterpret_cast<const byte*>(&v6->sin6_addr);
+        result.port_ = ntohs(v6->sin6_port);
+        if (std::memcmp(bytes, V4_MAPPED_PREFIX, sizeof(V4_MAPPED_PREFIX)) == 0) {
+            result.family_ = 4;
+            std::memcpy(result.address_, bytes + sizeof(V4_MAPPED_PREFIX), 4);
+        } else {
+            result.family_ = 6;
+            result.scope_id_ = v6->sin6_scope_id;
+            std::memcpy(result.address_, bytes, 16);
+        }
+    }
+    return result;
+}
+
+std::optional<Endpoint> Endpoint::parse(const string_t& host, int port) {
+    Endpoint result;
+    result.port_ = static_cast<uint16_t>(port);
+    
+    if (inet_pton(AF_INET, host.c_str(), result.address_) == 1) {
+        result.family_ = 4;
+        return result;
+    }
+    
+    string_t text = host;
+    if (text.size() >= 2 && text.front() == '[' && text.back() == ']') {
+        text = text.substr(1, text.size() - 2);
+    }
+    
+    // 链路本地地址可带接口后缀，如 fe80::1%eth0
+    size_t percent = text.find('%');
+    if (percent != string_t::npos) {
+        string_t scope = text.substr(percent + 1);
+        text.resize(percent);
+        char* end = nullptr;
+        unsigned long index = std::strtoul(scope.c_str(), &end, 10);
+#ifndef _WIN32
+        if (end == nullptr || *end != '\0') {
+            index = if_nametoindex(scope.c_str());
+        }
+#endif
+        if (index == 0) {
+            return std::nullopt;
+        }
+        result.scope_id_ = static_cast<uint32_t>(index);
+    }
+    
+    if (inet_pton(AF_INET6, text.c_str(), result.address_) == 1) {
+        result.family_ = 6;
+        return result;
+    }
+    return std::nullopt;
+}
+
+Endpoint Endpoint::any(bool ipv6, int port) {
+    Endpoint result;
+    result.family_ = ipv6 ? 6 : 4;
+    result.port_ = static_cast<uint16_t>(port);
+    return result;
+}
+
+string_t Endpoint::host() const {
+    string_t result;
+    format_host(result);
+    return result;
+}
+
+void Endpoint::format_host(string_t& out) const {
+    char text[INET6_ADDRSTRLEN] = {};
+    if (is_ipv4()) {
+        inet_ntop(AF_INET, const_cast<byte*>(address_), text, sizeof(text));
+    } else if (is_ipv6()) {
+        inet_ntop(AF_INET6, const_cast<byte*>(address_), text, sizeof(text));
+    }
+    out.assign(text);
+    if (is_ipv6() && scope_id_ != 0) {
+        out += '%';
+        out += std::to_string(scope_id_);
+    }
+}
+
+string_t Endpoint::to_string() const {
+    string_t address = host();
+    string_t port = std::to_string(port_);
+    string_t out;
+    out.reserve(address.size() + port.size() + 3);
+    if (is_ipv6()) {
+        out += '[';
+        out += address;
+        out += ']';
+    } else {
+        out += address;
+    }
+    out += ':';
+    out += port;
+    return out;
+}
+
+socklen_t Endpoint::to_sockaddr(sockaddr_storage& out, bool socket_ipv6) const {
+    std::memset(&out, 0, sizeof(out));
+    
+    if (is_ipv4() && !socket_ipv6) {
+        auto* v4 = reinterpret_cast<sockaddr_in*>(&out);
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(port_);
+        std::memcpy(&v4->sin_addr, address_, 4);
+        return static_cast<socklen_t>(sizeof(sockaddr_in));
+    }
+    
+    if (!valid() || !socket_ipv6) {
+        return 0;
+    }
+    
+    auto* v6 = reinterpret_cast<sockaddr_in6*>(&out);
+    v6->sin6_family = AF_INET6;
+    v6->sin6_port = htons(port_);
+    byte* bytes = reinterpret_cast<byte*>(&v6->sin6_addr);
+    if (is_ipv4()) {
+        // 双栈套接字通过IPv4映射地址收发IPv4数据包
+        std::memcpy(bytes, V4_MAPPED_PREFIX, sizeof(V4_MAPPED_PREFIX));
+        std::memcpy(bytes + sizeof(V4_MAPPED_PREFIX), address_, 4);
+    } else {
+        std::memcpy(bytes, address_, 16);
+        v6->sin6_scope_id = scope_id_;
+    }
+    return static_cast<socklen_t>(sizeof(sockaddr_in6));
+}
+
+size_t Endpoint::hash() const {
+    // FNV-1a
+    uint64_t value = 14695981039346656037ull;
+    auto mix = [&value](const void* data, size_t size) {
+        const byte* bytes = static_cast<const byte*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            value = (value ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    mix(&family_, sizeof(family_));
+    mix(&port_, sizeof(port_));
+    mix(&scope_id_, sizeof(scope_id_));
+    mix(address_, address_size());
+    return static_cast<size_t>(value);
+}
+
+} // namespace udp2docker
@@ -0,0 +1,589 @@
+#include "udp2docker/event_loop.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#else
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+// 单次等待最多处理的就绪事件数量
+constexpr int kMaxEvents = 64;
+
+} // namespace
+
+EventLoop::EventLoop()
+#ifdef _WIN32
+    : wakeup_socket_(INVALID_SOCKET)
+#elif defined(__linux__)
+    : poll_fd_(-1)
+    , wakeup_fd_(-1)
+#else
+    : poll_fd_(-1)
+    , wakeup_pipe_{-1, -1}
+#endif
+    , running_(false)
+    , stop_requested_(false)
+    , loop_thread_id_(std::thread::id())
+    , cpu_affinity_(-1)
+    , next_timer_id_(0)
+{
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        LOG_ERROR("EventLoop: WSAStartup failed");
+        return;
+    }
+    
+    // WSAPoll不支持事件对象，使用连接到自身的回环UDP套接字作为唤醒通道
+    wakeup_socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wakeup_socket_ == INVALID_SOCKET) {
+        LOG_ERROR("EventLoop: wakeup socket creation failed: " + std::to_string(WSAGetLastError()));
+        return;
+    }
+    
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int addr_len = sizeof(addr);
+    u_long non_blocking = 1;
+    if (bind(wakeup_socket_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(wakeup_socket_, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0 ||
+        connect(wakeup_socket_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ioctlsocket(wakeup_socket_, FIONBIO, &non_blocking) != 0) {
+        LOG_ERROR("EventLoop: wakeup socket setup failed: " + std::to_string(WSAGetLastError()));
+        closesocket(wakeup_socket_);
+        wakeup_socket_ = INVALID_SOCKET;
+    }
+#elif defined(__linux__)
+    poll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (poll_fd_ < 0) {
+        LOG_ERROR("EventLoop: epoll_create1 failed: " + std::string(strerror(errno)));
+        return;
+    }
+    
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        LOG_ERROR("EventLoop: eventfd failed: " + std::string(strerror(errno)));
+        return;
+    }
+    
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeup_fd_;
+    if (epoll_ctl(poll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) != 0) {
+        LOG_ERROR("EventLoop: failed to register eventfd: " + std::string(strerror(errno)));
+    }
+#else
+    poll_fd_ = kqueue();
+    if (poll_fd_ < 0) {
+        LOG_ERROR("EventLoop: kqueue failed: " + std::string(strerror(errno)));
+        return;
+    }
+    
+    if (pipe(wakeup_pipe_) != 0) {
+        LOG_ERROR("EventLoop: pipe failed: " + std::string(strerror(errno)));
+        return;
+    }
+    
+    for (int fd : wakeup_pipe_) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    
+    struct kevent change;
+    EV_SET(&change, wakeup_pipe_[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    if (kevent(poll_fd_, &change, 1, nullptr, 0, nullptr) != 0) {
+        LOG_ERROR("EventLoop: failed to register wakeup pipe: " + std::string(strerror(errno)));
+    }
+#endif
+    
+    LOG_DEBUG("EventLoop created");
+}
+
+EventLoop::~EventLoop() {
+    stop();
+
+#ifdef _WIN32
+    if (wakeup_socket_ != INVALID_SOCKET) {
+        closesocket(wakeup_socket_);
+    }
+    WSACleanup();
+#elif defined(__linux__)
+    if (wakeup_fd_ >= 0) {
+        ::close(wakeup_fd_);
+    }
+    if (poll_fd_ >= 0) {
+        ::close(poll_fd_);
+    }
+#else
+    for (int fd : wakeup_pipe_) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (poll_fd_ >= 0) {
+        ::close(poll_fd_);
+    }
+#endif
+    
+    LOG_DEBUG("EventLoop destroyed");
+}
+
+bool EventLoop::is_valid() const {
+#ifdef _WIN32
+    return wakeup_socket_ != INVALID_SOCKET;
+#elif defined(__linux__)
+    return poll_fd_ >= 0 && wakeup_fd_ >= 0;
+#else
+    return poll_fd_ >= 0 && wakeup_pipe_[0] >= 0;
+#endif
+}
+
+ErrorCode EventLoop::add_reader(socket_handle_t socket, IoHandler handler) {
+    if (!is_valid()) {
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    if (!handler) {
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (readers_.count(socket) != 0) {
+        LOG_WARN("EventLoop: socket already registered");
+        return ErrorCode::INVALID_PARAMETER;
+    }
+
+#if defined(__linux__)
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = socket;
+    if (epoll_ctl(poll_fd_, EPOLL_CTL_ADD, socket, &event) != 0) {
+        LOG_ERROR("EventLoop: epoll_ctl add failed: " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+#elif !defined(_WIN32)
+    struct kevent change;
+    EV_SET(&change, socket, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    if (kevent(poll_fd_, &change, 1, nullptr, 0, nullptr) != 0) {
+        LOG_ERROR("EventLoop: kevent add failed: " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+#endif
+    
+    readers_[socket] = std::make_shared<IoHandler>(std::move(handler));
+
+#ifdef _WIN32
+    // WSAPoll的套接字集合在每轮等待前重建，需要唤醒以纳入新套接字
+    wakeup();
+#endif
+    
+    return ErrorCode::SUCCESS;
+}
+
+void EventLoop::remove_reader(socket_handle_t socket) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        if (readers_.erase(socket) == 0) {
+            return;
+        }
+
+#if defined(__linux__)
+        epoll_ctl(poll_fd_, EPOLL_CTL_DEL, socket, nullptr);
+#elif !defined(_WIN32)
+        struct kevent change;
+        EV_SET(&change, socket, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+        kevent(poll_fd_, &change, 1, nullptr, 0, nullptr);
+#endif
+    }
+    
+    wait_for_loop();
+}
+
+TimerId EventLoop::run_after(std::chrono::milliseconds delay, TimerTask task) {
+    return add_timer(delay, std::chrono::milliseconds(0), std::move(task));
+}
+
+TimerId EventLoop::run_every(std::chrono::milliseconds interval, TimerTask task) {
+    return add_timer(interval, interval, std::move(task));
+}
+
+void EventLoop::cancel_timer(TimerId id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (timers_.erase(id) == 0) {
+            return;
+        }
+        // 堆中的过期条目在出堆时跳过
+    }
+    
+    wait_for_loop();
+}
+
+void EventLoop::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_tasks_.push_back(std::move(task));
+    }
+    wakeup();
+}
+
+void EventLoop::run() {
+    stop_requested_ = false;
+    run_loop();
+}
+
+ErrorCode EventLoop::start() {
+    if (!is_valid()) {
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    if (running_ || thread_.joinable()) {
+        LOG_WARN("EventLoop already running");
+        return ErrorCode::SUCCESS;
+    }
+    
+    stop_requested_ = false;
+    running_ = true;
+    thread_ = std::thread([this]() {
+        apply_cpu_affinity();
+        run_loop();
+    });
+    return ErrorCode::SUCCESS;
+}
+
+void EventLoop::stop() {
+    stop_requested_ = true;
+    wakeup();
+    
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+        thread_.join();
+    }
+}
+
+bool EventLoop::is_running() const {
+    return running_;
+}
+
+bool EventLoop::in_loop_thread() const {
+    return loop_thread_id_.load() == std::this_thread::get_id();
+}
+
+// 私有方法实现
+void EventLoop::apply_cpu_affinity() {
+    if (cpu_affinity_ < 0) {
+        return;
+    }
+    
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu_affinity_, &cpus);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (result != 0) {
+        LOG_WARN_F("EventLoop: failed to pin thread to CPU {}: {}", cpu_affinity_, std::strerror(result));
+    }
+#endif
+}
+
+void EventLoop::run_loop() {
+    running_ = true;
+    loop_thread_id_ = std::this_thread::get_id();
+    LOG_DEBUG("EventLoop started");
+    
+    std::vector<socket_handle_t> ready;
+    ready.reserve(kMaxEvents);
+    
+    while (!stop_requested_) {
+        ready.clear();
+        int count = poll_events(next_timeout_ms(), ready);
+        if (count < 0) {
+            break;
+        }
+        
+        for (socket_handle_t socket : ready) {
+            std::shared_ptr<IoHandler> handler;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = readers_.find(socket);
+                if (it != readers_.end()) {
+                    handler = it->second;
+                }
+            }
+            
+            if (handler) {
+                try {
+                    (*handler)();
+                } catch (const std::exception& e) {
+                    LOG_ERROR("EventLoop: reader exception: " + std::string(e.what()));
+                }
+            }
+        }
+        
+        run_expired_timers();
+        run_pending_tasks();
+    }
+    
+    // 退出前执行剩余任务，避免wait_for_loop的调用者永久等待
+    run_pending_tasks();
+    
+    loop_thread_id_ = std::thread::id();
+    running_ = false;
+    LOG_DEBUG("EventLoop stopped");
+}
+
+int EventLoop::poll_events(int timeout_ms, std::vector<socket_handle_t>& ready) {
+#ifdef _WIN32
+    std::vector<WSAPOLLFD> fds;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fds.reserve(readers_.size() + 1);
+        fds.push_back(WSAPOLLFD{wakeup_socket_, POLLRDNORM, 0});
+        for (const auto& pair : readers_) {
+            fds.push_back(WSAPOLLFD{pair.first, POLLRDNORM, 0});
+        }
+    }
+    
+    int result = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeout_ms);
+    if (result == SOCKET_ERROR) {
+        LOG_ERROR("EventLoop: WSAPoll failed: " + std::to_string(WSAGetLastError()));
+        return -1;
+    }
+    
+    for (const auto& fd : fds) {
+        if (fd.revents == 0) {
+            continue;
+        }
+        if (fd.fd == wakeup_socket_) {
+            drain_wakeup();
+        } else {
+            ready.push_back(fd.fd);
+        }
+    }
+    return static_cast<int>(ready.size());
+#elif defined(__linux__)
+    epoll_event events[kMaxEvents];
+    int result = epoll_wait(poll_fd_, events, kMaxEvents, timeout_ms);
+    if (result < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        LOG_ERROR("EventLoop: epoll_wait failed: " + std::string(strerror(errno)));
+        return -1;
+    }
+    
+    for (int i = 0; i < result; ++i) {
+        if (events[i].data.fd == wakeup_fd_) {
+            drain_wakeup();
+        } else {
+            ready.push_back(events[i].data.fd);
+        }
+    }
+    return static_cast<int>(ready.size());
+#else
+    struct kevent events[kMaxEvents];
+    timespec timeout{};
+    timespec* timeout_ptr = nullptr;
+    if (timeout_ms >= 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+        timeout_ptr = &timeout;
+    }
+    
+    int result = kevent(poll_fd_, nullptr, 0, events, kMaxEvents, timeout_ptr);
+    if (result < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        LOG_ERROR("EventLoop: kevent wait failed: " + std::string(strerror(errno)));
+        return -1;
+    }
+    
+    for (int i = 0; i < result; ++i) {
+        int fd = static_cast<int>(events[i].ident);
+        if (fd == wakeup_pipe_[0]) {
+            drain_wakeup();
+        } else {
+            ready.push_back(fd);
+        }
+    }
+    return static_cast<int>(ready.size());
+#endif
+}
+
+int EventLoop::next_timeout_ms() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (!pending_tasks_.empty()) {
+        return 0;
+    }
+    
+    // 丢弃已取消定时器留在堆顶的条目
+    while (!timer_queue_.empty() && timers_.count(timer_queue_.top().second) == 0) {
+        timer_queue_.pop();
+    }
+    
+    if (timer_queue_.empty()) {
+        return -1;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = timer_queue_.top().first;
+    if (deadline <= now) {
+        return 0;
+    }
+    
+    // 向上取整，避免在到期前1毫秒内反复空转
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds(1);
+    return static_cast<int>(std::min<std::chrono::milliseconds::rep>(wait.count(), 60000));
+}
+
+void EventLoop::run_expired_timers() {
+    auto now = std::chrono::steady_clock::now();
+    
+    while (true) {
+        std::shared_ptr<TimerTask> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (timer_queue_.empty() || timer_queue_.top().first > now) {
+                return;
+            }
+            
+            TimerId id = timer_queue_.top().second;
+            timer_queue_.pop();
+            
+            auto it = timers_.find(id);
+            if (it == timers_.end()) {
+                continue;
+            }
+            
+            task = it->second.task;
+            if (it->second.interval.count() > 0) {
+                timer_queue_.push(TimerEntry(now + it->second.interval, id));
+            } else {
+                timers_.erase(it);
+            }
+        }
+        
+        try {
+            (*task)();
+        } catch (const std::exception& e) {
+            LOG_ERROR("EventLoop: timer exception: " + std::string(e.what()));
+        }
+    }
+}
+
+void EventLoop::run_pending_tasks() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks.swap(pending_tasks_);
+    }
+    
+    for (auto& task : tasks) {
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LOG_ERROR("EventLoop: task exception: " + std::string(e.what()));
+        }
+    }
+}
+
+void EventLoop::wakeup() {
+#ifdef _WIN32
+    if (wakeup_socket_ != INVALID_SOCKET) {
+        char signal = 1;
+        ::send(wakeup_socket_, &signal, 1, 0);
+    }
+#elif defined(__linux__)
+    if (wakeup_fd_ >= 0) {
+        uint64_t value = 1;
+        ssize_t written = ::write(wakeup_fd_, &value, sizeof(value));
+        (void)written;
+    }
+#else
+    if (wakeup_pipe_[1] >= 0) {
+        char signal = 1;
+        ssize_t written = ::write(wakeup_pipe_[1], &signal, 1);
+        (void)written;
+    }
+#endif
+}
+
+void EventLoop::drain_wakeup() {
+#ifdef _WIN32
+    char buffer[64];
+    while (::recv(wakeup_socket_, buffer, sizeof(buffer), 0) > 0) {
+    }
+#elif defined(__linux__)
+    uint64_t value;
+    ssize_t result = ::read(wakeup_fd_, &value, sizeof(value));
+    (void)result;
+#else
+    char buffer[64];
+    while (::read(wakeup_pipe_[0], buffer, sizeof(buffer)) > 0) {
+    }
+#endif
+}
+
+void EventLoop::wait_for_loop() {
+    if (!running_ || in_loop_thread()) {
+        return;
+    }
+    
+    // 投递一个屏障任务：它执行时，本轮已取出的处理函数和定时器都已返回
+    struct Barrier {
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool reached = false;
+    };
+    auto barrier = std::make_shared<Barrier>();
+    
+    post([barrier]() {
+        std::lock_guard<std::mutex> lock(barrier->mutex);
+        barrier->reached = true;
+        barrier->condition.notify_one();
+    });
+    
+    std::unique_lock<std::mutex> lock(barrier->mutex);
+    while (!barrier->reached && running_) {
+        barrier->condition.wait_for(lock, std::chrono::milliseconds(100));
+    }
+}
+
+TimerId EventLoop::add_timer(std::chrono::milliseconds delay, std::chrono::milliseconds interval, TimerTask task) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = ++next_timer_id_;
+        timers_[id] = Timer{interval, std::make_shared<TimerTask>(std::move(task))};
+        timer_queue_.push(TimerEntry(std::chrono::steady_clock::now() + delay, id));
+    }
+    wakeup();
+    return id;
+}
+
+} // namespace udp2docker
@@ -0,0 +1,243 @@
+#include "udp2docker/fragmentation.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace udp2docker {
+
+namespace {
+
+uint32_t random_message_id() {
+    // 随机起点，避免发送方重启后与接收方残留的分片冲突
+    std::random_device device;
+    return static_cast<uint32_t>(device());
+}
+
+} // namespace
+
+// FragmentHeader 实现
+void FragmentHeader::serialize_to(byte* out) const {
+    std::memcpy(out + 0, &magic_number, sizeof(magic_number));
+    std::memcpy(out + 4, &version, sizeof(version));
+    std::memcpy(out + 6, &flags, sizeof(flags));
+    std::memcpy(out + 8, &message_id, sizeof(message_id));
+    std::memcpy(out + 12, &index, sizeof(index));
+    std::memcpy(out + 14, &count, sizeof(count));
+    std::memcpy(out + 16, &offset, sizeof(offset));
+    std::memcpy(out + 20, &total_size, sizeof(total_size));
+}
+
+std::optional<FragmentHeader> FragmentHeader::parse(BufferView data) {
+    if (!is_fragment(data)) {
+        return std::nullopt;
+    }
+    
+    FragmentHeader header;
+    std::memcpy(&header.version, data.data + 4, sizeof(header.version));
+    std::memcpy(&header.flags, data.data + 6, sizeof(header.flags));
+    std::memcpy(&header.message_id, data.data + 8, sizeof(header.message_id));
+    std::memcpy(&header.index, data.data + 12, sizeof(header.index));
+    std::memcpy(&header.count, data.data + 14, sizeof(header.count));
+    std::memcpy(&header.offset, data.data + 16, sizeof(header.offset));
+    std::memcpy(&header.total_size, data.data + 20, sizeof(header.total_size));
+    return header;
+}
+
+bool FragmentHeader::is_fragment(BufferView data) {
+    if (data.size < FRAGMENT_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t magic;
+    std::memcpy(&magic, data.data, sizeof(magic));
+    return magic == FRAGMENT_MAGIC;
+}
+
+// Fragmenter 实现
+Fragmenter::Fragmenter(size_t path_mtu)
+    : path_mtu_(DEFAULT_PATH_MTU)
+    , next_message_id_(random_message_id())
+{
+    set_path_mtu(path_mtu);
+}
+
+ErrorCode Fragmenter::set_path_mtu(size_t mtu) {
+    if (mtu < MIN_PATH_MTU || mtu > MAX_BUFFER_SIZE) {
+        LOG_ERROR("Invalid path MTU: " + std::to_string(mtu));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    path_mtu_ = mtu;
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode Fragmenter::fragment(BufferView frame, std::vector<BufferView>& datagrams) {
+    datagrams.clear();
+    
+    if (!needs_fragmentation(frame.size)) {
+        datagrams.push_back(frame);
+        return ErrorCode::SUCCESS;
+    }
+    
+    if (frame.size > max_frame_size()) {
+        LOG_ERROR("Frame too large to fragment: " + std::to_string(frame.size));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    size_t chunk = max_fragment_payload();
+    size_t count = (frame.size + chunk - 1) / chunk;
+    storage_.resize(frame.size + count * FRAGMENT_HEADER_SIZE);
+    datagrams.reserve(count);
+    
+    FragmentHeader header;
+    header.message_id = next_message_id_++;
+    header.count = static_cast<uint16_t>(count);
+    header.total_size = static_cast<uint32_t>(frame.size);
+    
+    byte* out = storage_.data();
+    for (size_t i = 0; i < count; ++i) {
+        size_t offset = i * chunk;
+        size_t length = std::min(chunk, frame.size - offset);
+        header.index = static_cast<uint16_t>(i);
+        header.offset = static_cast<uint32_t>(offset);
+        header.serialize_to(out);
+        std::memcpy(out + FRAGMENT_HEADER_SIZE, frame.data + offset, length);
+        datagrams.emplace_back(out, FRAGMENT_HEADER_SIZE + length);
+        out += FRAGMENT_HEADER_SIZE + length;
+    }
+    
+    return ErrorCode::SUCCESS;
+}
+
+// ReassemblyTable 实现
+ReassemblyTable::ReassemblyTable(const ReassemblyConfig& config)
+    : config_(config)
+    , buffered_bytes_(0)
+{
+}
+
+ReassemblyResult ReassemblyTable::add(BufferView datagram, const Endpoint& from, BufferView& frame,
+                                      clock_t::time_point now) {
+    auto header = FragmentHeader::parse(datagram);
+    if (!header) {
+        return ReassemblyResult::NOT_FRAGMENT;
+    }
+    
+    ++stats_.fragments_received;
+    expire(now);
+    
+    BufferView chunk(datagram.data + FRAGMENT_HEADER_SIZE, datagram.size - FRAGMENT_HEADER_SIZE);
+    if (header->count == 0 || header->index >= header->count ||
+        header->total_size == 0 || header->total_size > config_.max_message_size ||
+        static_cast<size_t>(header->offset) + chunk.size > header->total_size) {
+        ++stats_.rejected;
+        return ReassemblyResult::REJECTED;
+    }
+    
+    Key key{from, header->message_id};
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        if (!make_room(header->total_size)) {
+            ++stats_.rejected;
+            return ReassemblyResult::REJECTED;
+        }
+        
+        Entry entry;
+        entry.data.resize(header->total_size);
+        entry.received.assign((header->count + 63) / 64, 0);
+        entry.count = header->count;
+        entry.total_size = header->total_size;
+        entry.deadline = now + std::chrono::milliseconds(config_.timeout_ms);
+        entry.order = order_.insert(order_.end(), key);
+        it = entries_.emplace(key, std::move(entry)).first;
+        buffered_bytes_ += header->total_size;
+    }
+    
+    Entry& entry = it->second;
+    if (entry.count != header->count || entry.total_size != header->total_size) {
+        // 同一消息的分片头不一致，整个消息作废
+        erase(it);
+        ++stats_.rejected;
+        return ReassemblyResult::REJECTED;
+    }
+    
+    uint64_t bit = 1ull << (header->index % 64);
+    uint64_t& word = entry.received[header->index / 64];
+    if ((word & bit) != 0) {
+        ++stats_.duplicates;
+        return ReassemblyResult::DUPLICATE;
+    }
+    word |= bit;
+    
+    std::memcpy(entry.data.data() + header->offset, chunk.data, chunk.size);
+    ++entry.received_count;
+    entry.received_bytes += chunk.size;
+    
+    if (entry.received_count < entry.count) {
+        return ReassemblyResult::PENDING;
+    }
+    
+    if (entry.received_bytes != entry.total_size) {
+        erase(it);
+        ++stats_.rejected;
+        return ReassemblyResult::REJECTED;
+    }
+    
+    completed_ = std::move(entry.data);
+    erase(it);
+    ++stats_.messages_completed;
+    frame = BufferView(completed_);
+    return ReassemblyResult::COMPLETE;
+}
+
+size_t ReassemblyTable::expire(clock_t::time_point now) {
+    // 超时时间相同，order_的顺序也就是截止时间的顺序
+    size_t expired = 0;
+    while (!order_.empty()) {
+        auto it = entries_.find(order_.front());
+        if (it->second.deadline > now) {
+            break;
+        }
+        erase(it);
+        ++expired;
+    }
+    
+    if (expired != 0) {
+        stats_.expired += expired;
+        LOG_DEBUG_F("Reassembly expired {} incomplete messages", expired);
+    }
+    return expired;
+}
+
+void ReassemblyTable::clear() {
+    entries_.clear();
+    order_.clear();
+    buffered_bytes_ = 0;
+}
+
+ReassemblyTable::Statistics ReassemblyTable::get_statistics() const {
+    Statistics result = stats_;
+    result.pending_messages = entries_.size();
+    result.buffered_bytes = buffered_bytes_;
+    return result;
+}
+
+bool ReassemblyTable::make_room(size_t bytes) {
+    if (bytes > config_.max_buffered_bytes || config_.max_pending_messages == 0) {
+        return false;
+    }
+    
+    while (!order_.empty() && (buffered_bytes_ + bytes > config_.max_buffered_bytes ||
+                               entries_.size() >= config_.max_pending_messages)) {
+        erase(entries_.find(order_.front()));
+        ++stats_.evicted;
+    }
+    return true;
+}
+
+void ReassemblyTable::erase(std::unordered_map<Key, Entry, KeyHash>::iterator entry) {
+    buffered_bytes_ -= entry->second.total_size;
+    order_.erase(entry->second.order);
+    entries_.erase(entry);
+}
+
+} // namespace udp2docker
@@ -0,0 +1,488 @@
+#include "udp2docker/io_uring.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// 多次接收和io_uring_recvmsg_out需要6.0的头文件，提供缓冲区环（5.19）也包含在内；
+// 更旧的头文件编译为桩实现，运行时回退到套接字接收
+#ifdef IORING_RECV_MULTISHOT
+#define UDP2DOCKER_HAVE_IO_URING 1
+#endif
+
+#ifdef UDP2DOCKER_HAVE_IO_URING
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+// 完成事件的user_data
+constexpr uint64_t RECEIVE_REQUEST = 1;
+constexpr uint64_t CANCEL_REQUEST = 2;
+
+// 提供缓冲区组编号
+constexpr uint16_t BUFFER_GROUP = 0;
+
+// 提供缓冲区环最多32768项
+constexpr size_t MAX_BUFFERS = 32768;
+
+size_t round_up_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+#ifdef UDP2DOCKER_HAVE_IO_URING
+// glibc没有封装io_uring系统调用，直接调用避免依赖liburing
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+#endif
+
+} // namespace
+
+IoUringReceiver::IoUringReceiver(size_t buffer_count, size_t buffer_size, bool receive_control)
+    : buffer_count_(round_up_power_of_two(std::min(std::max<size_t>(buffer_count, 2), MAX_BUFFERS)))
+    , buffer_size_(std::max<size_t>(buffer_size, 1))
+    , control_size_(0)
+    , socket_(static_cast<socket_handle_t>(-1))
+    , ring_fd_(-1)
+    , event_fd_(-1)
+    , armed_(false)
+    , failed_(false)
+    , buffer_tail_(0)
+    , sq_ring_(nullptr)
+    , sq_ring_size_(0)
+    , sqes_(nullptr)
+    , sqes_size_(0)
+    , buffer_ring_(nullptr)
+    , buffer_ring_size_(0)
+    , sq_tail_(nullptr)
+    , sq_mask_(nullptr)
+    , sq_array_(nullptr)
+    , cq_head_(nullptr)
+    , cq_tail_(nullptr)
+    , cq_mask_(nullptr)
+    , cqes_(nullptr)
+{
+#ifdef __linux__
+    // 与ReceiveRing相同，足够容纳一个SCM_TIMESTAMPING
+    control_size_ = receive_control ? 64 : 0;
+    std::memset(&message_, 0, sizeof(message_));
+    message_.msg_namelen = sizeof(sockaddr_storage);
+    message_.msg_controllen = control_size_;
+#else
+    (void)receive_control;
+#endif
+}
+
+IoUringReceiver::~IoUringReceiver() {
+    close();
+}
+
+#ifdef UDP2DOCKER_HAVE_IO_URING
+
+bool IoUringReceiver::is_supported() {
+    io_uring_params params{};
+    int fd = io_uring_setup(2, &params);
+    if (fd < 0) {
+        return false;
+    }
+    ::close(fd);
+    return (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+}
+
+size_t IoUringReceiver::slot_size() const {
+    // 内核按io_uring_recvmsg_out、地址、控制消息、负载的顺序写入缓冲区
+    return sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_storage) + control_size_ + buffer_size_;
+}
+
+ErrorCode IoUringReceiver::open(socket_handle_t socket) {
+    close();
+    socket_ = socket;
+    failed_ = false;
+    
+    // 每个完成事件占用一个缓冲区，完成队列容纳所有缓冲区外加结束事件就不会溢出
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = static_cast<unsigned>(buffer_count_ * 2);
+    ring_fd_ = io_uring_setup(4, &params);
+    if (ring_fd_ < 0) {
+        LOG_WARN("io_uring_setup failed: " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+        LOG_WARN("io_uring without IORING_FEAT_SINGLE_MMAP is not supported");
+        close();
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    sq_ring_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                             params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ring_fd_, IORING_OFF_SQES);
+    if (sq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        LOG_WARN("Failed to map io_uring rings: " + std::string(strerror(errno)));
+        sq_ring_ = sq_ring_ == MAP_FAILED ? nullptr : sq_ring_;
+        sqes_ = sqes_ == MAP_FAILED ? nullptr : sqes_;
+        close();
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    byte* base = static_cast<byte*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes_ = base + params.cq_off.cqes;
+    
+    // 提供缓冲区环需要页对齐的内存
+    buffer_ring_size_ = buffer_count_ * sizeof(io_uring_buf);
+    buffer_ring_ = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer_ring_ == MAP_FAILED) {
+        buffer_ring_ = nullptr;
+        close();
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(buffer_ring_);
+    registration.ring_entries = static_cast<uint32_t>(buffer_count_);
+    registration.bgid = BUFFER_GROUP;
+    if (io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        LOG_WARN("Failed to register io_uring buffer ring: " + std::string(strerror(errno)));
+        close();
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    storage_.assign(buffer_count_ * slot_size(), 0);
+    consumed_.clear();
+    consumed_.reserve(buffer_count_);
+    buffer_tail_ = 0;
+    for (size_t i = 0; i < buffer_count_; ++i) {
+        provide(static_cast<uint16_t>(i));
+    }
+    publish_buffers();
+    
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd_ < 0 || io_uring_register(ring_fd_, IORING_REGISTER_EVENTFD, &event_fd_, 1) < 0) {
+        LOG_WARN("Failed to register io_uring eventfd: " + std::string(strerror(errno)));
+        close();
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    LOG_DEBUG_F("io_uring receiver opened with {} buffers of {} bytes", buffer_count_, buffer_size_);
+    return ErrorCode::SUCCESS;
+}
+
+void IoUringReceiver::close() {
+    if (ring_fd_ >= 0 && armed_) {
+        // 关闭io_uring后内核异步取消请求，期间到达的数据仍可能写入缓冲区，
+        // 先同步取消并等到请求的结束事件再释放内存。请求所属线程已退出时内核已经取消了请求
+        io_uring_sqe* sqe = static_cast<io_uring_sqe*>(next_sqe());
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = RECEIVE_REQUEST;
+        sqe->user_data = CANCEL_REQUEST;
+        if (enter(1, 0) == ErrorCode::SUCCESS) {
+            const io_uring_cqe* cqes = static_cast<const io_uring_cqe*>(cqes_);
+            for (int attempt = 0; attempt < 10 && armed_; ++attempt) {
+                unsigned head = *cq_head_;
+                unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+                for (; head != tail; ++head) {
+                    const io_uring_cqe& cqe = cqes[head & *cq_mask_];
+                    // 取消请求返回ENOENT说明接收请求已经结束
+                    if ((cqe.user_data == RECEIVE_REQUEST && (cqe.flags & IORING_CQE_F_MORE) == 0) ||
+                        (cqe.user_data == CANCEL_REQUEST && cqe.res == -ENOENT)) {
+                        armed_ = false;
+                    }
+                }
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                if (armed_) {
+                    pollfd waiter{ring_fd_, POLLIN, 0};
+                    poll(&waiter, 1, 100);
+                }
+            }
+        }
+        if (armed_) {
+            LOG_WARN("Timed out cancelling io_uring receive request");
+        }
+    }
+    armed_ = false;
+    
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    if (event_fd_ >= 0) {
+        ::close(event_fd_);
+        event_fd_ = -1;
+    }
+    if (sq_ring_ != nullptr) {
+        munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = nullptr;
+    }
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (buffer_ring_ != nullptr) {
+        munmap(buffer_ring_, buffer_ring_size_);
+        buffer_ring_ = nullptr;
+    }
+    storage_.clear();
+    storage_.shrink_to_fit();
+    consumed_.clear();
+}
+
+void* IoUringReceiver::next_sqe() {
+    // 只有一个多次触发请求和取消请求，提交队列不会用满
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+ErrorCode IoUringReceiver::enter(unsigned to_submit, unsigned min_complete) {
+    int result;
+    do {
+        result = io_uring_enter(ring_fd_, to_submit, min_complete, min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+    } while (result < 0 && errno == EINTR);
+    
+    if (result < 0) {
+        LOG_ERROR("io_uring_enter failed: " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_RECEIVE_FAILED;
+    }
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode IoUringReceiver::arm() {
+    if (ring_fd_ < 0 || failed_) {
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    if (armed_) {
+        return ErrorCode::SUCCESS;
+    }
+    
+    // 多次触发的RECVMSG只使用msghdr中的名字和控制消息长度，负载写入内核选中的提供缓冲区
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(next_sqe());
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = socket_;
+    sqe->addr = reinterpret_cast<uint64_t>(&message_);
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = RECEIVE_REQUEST;
+    
+    ErrorCode result = enter(1, 0);
+    if (result == ErrorCode::SUCCESS) {
+        armed_ = true;
+        ++stats_.arms;
+    }
+    return result;
+}
+
+void IoUringReceiver::acknowledge() {
+    uint64_t count;
+    if (event_fd_ >= 0 && read(event_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        LOG_WARN("Failed to read io_uring eventfd: " + std::string(strerror(errno)));
+    }
+}
+
+void IoUringReceiver::notify() {
+    uint64_t count = 1;
+    if (event_fd_ >= 0 && write(event_fd_, &count, sizeof(count)) < 0) {
+        LOG_WARN("Failed to signal io_uring eventfd: " + std::string(strerror(errno)));
+    }
+}
+
+bool IoUringReceiver::pending() const {
+    return ring_fd_ >= 0 && *cq_head_ != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+}
+
+size_t IoUringReceiver::reap(ReceiveRing& ring) {
+    ring.count_ = 0;
+    if (ring_fd_ < 0) {
+        return 0;
+    }
+    
+    const io_uring_cqe* cqes = static_cast<const io_uring_cqe*>(cqes_);
+    const size_t header_size = sizeof(io_uring_recvmsg_out) + message_.msg_namelen + message_.msg_controllen;
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    
+    while (head != tail && ring.count_ < ring.slot_count_) {
+        const io_uring_cqe& cqe = cqes[head & *cq_mask_];
+        ++head;
+        if (cqe.user_data != RECEIVE_REQUEST) {
+            continue;
+        }
+        ++stats_.completions;
+        
+        if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+            armed_ = false;
+        }
+        if ((cqe.flags & IORING_CQE_F_BUFFER) == 0) {
+            if (cqe.res == -ENOBUFS) {
+                ++stats_.buffer_exhausted;
+            } else if (cqe.res < 0 && cqe.res != -ECANCELED) {
+                LOG_ERROR("io_uring receive failed with error: " + std::string(strerror(-cqe.res)));
+                failed_ = true;
+            }
+            continue;
+        }
+        
+        uint16_t id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        consumed_.push_back(id);
+        if (cqe.res < static_cast<int>(header_size)) {
+            continue;
+        }
+        
+        byte* data = buffer(id);
+        io_uring_recvmsg_out out;
+        std::memcpy(&out, data, sizeof(out));
+        byte* name = data + sizeof(io_uring_recvmsg_out);
+        
+        PacketView& packet = ring.packets_[ring.count_++];
+        packet.data = BufferView(data + header_size,
+                                 std::min<size_t>(out.payloadlen, static_cast<size_t>(cqe.res) - header_size));
+        packet.truncated = (out.flags & MSG_TRUNC) != 0;
+        packet.from = Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(name),
+                                              std::min<size_t>(out.namelen, message_.msg_namelen));
+        packet.kernel_timestamp_ns = 0;
+        if (out.controllen > 0) {
+            msghdr control{};
+            control.msg_control = name + message_.msg_namelen;
+            control.msg_controllen = std::min<size_t>(out.controllen, message_.msg_controllen);
+            packet.kernel_timestamp_ns = ReceiveRing::kernel_timestamp(control);
+        }
+    }
+    
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    stats_.packets += ring.count_;
+    return ring.count_;
+}
+
+void IoUringReceiver::recycle() {
+    if (ring_fd_ < 0) {
+        return;
+    }
+    if (!consumed_.empty()) {
+        for (uint16_t id : consumed_) {
+            provide(id);
+        }
+        consumed_.clear();
+        publish_buffers();
+    }
+    
+    // 缓冲区用尽（或内核因其他原因）结束了请求，归还缓冲区后重新提交
+    if (!armed_ && !failed_) {
+        arm();
+    }
+}
+
+void IoUringReceiver::provide(uint16_t id) {
+    // C++中io_uring_buf_ring的柔性数组成员前多出一个空结构，不能直接使用bufs成员；
+    // 环就是io_uring_buf数组，尾指针覆盖在第一项的resv字段上
+    io_uring_buf* entries = static_cast<io_uring_buf*>(buffer_ring_);
+    io_uring_buf& entry = entries[buffer_tail_ & (buffer_count_ - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+    entry.len = static_cast<uint32_t>(slot_size());
+    entry.bid = id;
+    ++buffer_tail_;
+}
+
+void IoUringReceiver::publish_buffers() {
+    io_uring_buf* entries = static_cast<io_uring_buf*>(buffer_ring_);
+    __atomic_store_n(&entries[0].resv, buffer_tail_, __ATOMIC_RELEASE);
+}
+
+#else
+
+bool IoUringReceiver::is_supported() {
+    return false;
+}
+
+size_t IoUringReceiver::slot_size() const {
+    return buffer_size_;
+}
+
+ErrorCode IoUringReceiver::open(socket_handle_t socket) {
+    socket_ = socket;
+    LOG_WARN("io_uring multishot receive is not available in this build");
+    return ErrorCode::SOCKET_INIT_FAILED;
+}
+
+void IoUringReceiver::close() {
+}
+
+void* IoUringReceiver::next_sqe() {
+    return nullptr;
+}
+
+ErrorCode IoUringReceiver::enter(unsigned, unsigned) {
+    return ErrorCode::SOCKET_INIT_FAILED;
+}
+
+ErrorCode IoUringReceiver::arm() {
+    return ErrorCode::SOCKET_INIT_FAILED;
+}
+
+void IoUringReceiver::acknowledge() {
+}
+
+void IoUringReceiver::notify() {
+}
+
+bool IoUringReceiver::pending() const {
+    return false;
+}
+
+size_t IoUringReceiver::reap(ReceiveRing& ring) {
+    ring.count_ = 0;
+    return 0;
+}
+
+void IoUringReceiver::recycle() {
+}
+
+void IoUringReceiver::provide(uint16_t) {
+}
+
+void IoUringReceiver::publish_buffers() {
+}
+
+#endif
+
+} // namespace udp2docker
@@ -1,7 +1,9 @@
 #include "udp2docker/logger.h"
+#include "udp2docker/metrics.h"
 #include <iomanip>
 #include <ctime>
 #include <algorithm>
+#include <cstring>
 #include <map>
 #include <memory>
 
@@ -61,6 +63,140 @@
 
 namespace udp2docker {
 
+namespace {
+
+// 异步会话编号，所有Logger共用，保证线程缓存中的编号不会被误认
+std::atomic<uint64_t> next_async_session{1};
+
+// 预分配日志环时假定的平均每条日志槽位数（128字节）
+constexpr size_t SLOTS_PER_RECORD = 2;
+
+// 后台线程空闲时的轮询间隔
+constexpr auto ASYNC_IDLE_WAIT = std::chrono::milliseconds(1);
+
+// 当前线程在各个异步会话中使用的日志环
+struct ThreadRings {
+    std::vector<std::pair<uint64_t, std::shared_ptr<detail::LogRing>>> rings;
+};
+
+thread_local ThreadRings thread_rings;
+
+template<typename T>
+T read_arg(const byte*& data) {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return value;
+}
+
+// 解码一个参数并追加到output，数据不完整返回false
+bool append_log_arg(const byte*& data, const byte* end, string_t& output) {
+    if (data >= end) {
+        return false;
+    }
+    
+    auto type = static_cast<detail::LogArgType>(*data++);
+    size_t remaining = static_cast<size_t>(end - data);
+    switch (type) {
+        case detail::LogArgType::BOOL:
+        case detail::LogArgType::CHAR:
+            if (remaining < 1) {
+                return false;
+            }
+            if (type == detail::LogArgType::BOOL) {
+                output += *data ? "true" : "false";
+            } else {
+                output += static_cast<char>(*data);
+            }
+            data += 1;
+            return true;
+        case detail::LogArgType::INT:
+        case detail::LogArgType::UINT:
+        case detail::LogArgType::DOUBLE:
+        case detail::LogArgType::POINTER: {
+            if (remaining < sizeof(uint64_t)) {
+                return false;
+            }
+            if (type == detail::LogArgType::INT) {
+                output += std::to_string(read_arg<int64_t>(data));
+            } else if (type == detail::LogArgType::UINT) {
+                output += std::to_string(read_arg<uint64_t>(data));
+            } else if (type == detail::LogArgType::DOUBLE) {
+                std::ostringstream ss;
+                ss << read_arg<double>(data);
+                output += ss.str();
+            } else {
+                std::ostringstream ss;
+                ss << "0x" << std::hex << read_arg<uint64_t>(data);
+                output += ss.str();
+            }
+            return true;
+        }
+        case detail::LogArgType::STRING: {
+            if (remaining < sizeof(uint32_t)) {
+                return false;
+            }
+            uint32_t size = read_arg<uint32_t>(data);
+            if (size > remaining - sizeof(uint32_t)) {
+                return false;
+            }
+            output.append(reinterpret_cast<const char*>(data), size);
+            data += size;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// 按秒缓存格式化后的时间戳，同一秒内的日志不再调用localtime和strftime
+const string_t& cached_timestamp(time_point_t timestamp) {
+    thread_local std::time_t cached_second = static_cast<std::time_t>(-1);
+    thread_local string_t cached_text;
+    
+    std::time_t second = std::chrono::system_clock::to_time_t(timestamp);
+    if (second != cached_second) {
+        std::tm local_time{};
+#ifdef _WIN32
+        localtime_s(&local_time, &second);
+#else
+        localtime_r(&second, &local_time);
+#endif
+        char buffer[32];
+        size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local_time);
+        cached_text.assign(buffer, length);
+        cached_second = second;
+    }
+    return cached_text;
+}
+
+} // namespace
+
+namespace detail {
+
+string_t format_log_args(const char* format, const byte* args, size_t size) {
+    string_t output;
+    if (format == nullptr) {
+        return output;
+    }
+    
+    const byte* data = args;
+    const byte* end = args + size;
+    for (const char* p = format; *p != '\0'; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            if (!append_log_arg(data, end, output)) {
+                output += "{}";
+            }
+            ++p;
+        } else {
+            output += *p;
+        }
+    }
+    return output;
+}
+
+} // namespace detail
+
 // 全局辅助函数
 void replace_all(string_t& str, const string_t& from, const string_t& to) {
     if (from.empty()) return;
@@ -89,8 +225,7 @@ string_t LogRecord::format(const string_t& pattern) const {
     if (pattern.empty()) {
         // 默认格式
         std::stringstream ss;
-        auto time_t = std::chrono::system_clock::to_time_t(timestamp);
-        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+        ss << cached_timestamp(timestamp);
         ss << " [" << ::udp2docker::level_to_string(level) << "]";
         if (!logger_name.empty()) {
             ss << " [" << logger_name << "]";
@@ -106,15 +241,13 @@ string_t LogRecord::format(const string_t& pattern) const {
     string_t result = pattern;
     
     // 替换占位符
-    auto time_t = std::chrono::system_clock::to_time_t(timestamp);
-    std::stringstream time_ss;
-    time_ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    
     std::stringstream thread_ss;
     thread_ss << thread_id;
     
     // 执行替换（使用全局函数）
-    ::udp2docker::replace_all(result, "%d", time_ss.str());
+    if (result.find("%d") != string_t::npos) {
+        ::udp2docker::replace_all(result, "%d", cached_timestamp(timestamp));
+    }
     ::udp2docker::replace_all(result, "%l", ::udp2docker::level_to_string(level));
     ::udp2docker::replace_all(result, "%n", logger_name);
     ::udp2docker::replace_all(result, "%m", message);
@@ -140,6 +273,21 @@ string_t level_to_string(LogLevel level) {
     }
 }
 
+// 全局辅助函数：解析日志级别名称（配置文件中的log.level）
+std::optional<LogLevel> string_to_level(const string_t& name) {
+    string_t upper = name;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    
+    if (upper == "TRACE") return LogLevel::TRACE;
+    if (upper == "DEBUG") return LogLevel::DEBUG;
+    if (upper == "INFO") return LogLevel::INFO;
+    if (upper == "WARN" || upper == "WARNING") return LogLevel::WARN;
+    if (upper == "ERROR") return LogLevel::LOG_ERROR;
+    if (upper == "FATAL") return LogLevel::FATAL;
+    if (upper == "OFF") return LogLevel::OFF;
+    return std::nullopt;
+}
+
 // 全局辅助函数：从路径中提取文件名
 string_t extract_filename(const string_t& path) {
     size_t pos = path.find_last_of("/\\");
@@ -156,14 +304,33 @@ Logger::Logger(const string_t& name)
     , pattern_("[%d] [%l] [%n] %m")
     , max_file_size_mb_(100)
     , max_files_(5)
+    , file_bytes_(0)
+    , file_buffer_limit_(0)
+    , flush_interval_ms_(0)
+    , flush_stop_(false)
     , async_enabled_(false)
     , should_stop_(false)
+    , async_session_(0)
     , buffer_size_(1000)
+    , overflow_policy_(LogOverflowPolicy::DROP)
+    , retired_dropped_(0)
 {
+    metrics_collector_ = MetricsRegistry::global().add_collector([this](MetricsWriter& writer) {
+        MetricLabels labels = {{"logger", name_}};
+        writer.counter("udp2docker_log_records_dropped_total", "Asynchronous log records dropped on overflow",
+                       get_dropped_count(), labels);
+        writer.gauge("udp2docker_log_async_backlog_bytes", "Bytes waiting in asynchronous log rings",
+                     static_cast<double>(get_async_backlog_bytes()), labels);
+    });
 }
 
 Logger::~Logger() {
+    MetricsRegistry::global().remove_collector(metrics_collector_);
     disable_async();
+    stop_flush_thread();
+    
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    flush_file_buffer();
     if (file_stream_.is_open()) {
         file_stream_.close();
     }
@@ -171,6 +338,7 @@ Logger::~Logger() {
 
 void Logger::set_level(LogLevel level) {
     level_ = level;
+    LoggerManager::lower_level_floor(level);
 }
 
 LogLevel Logger::get_level() const {
@@ -185,6 +353,7 @@ void Logger::set_target(LogTarget target) {
 void Logger::set_file_output(const string_t& file_path, size_t max_size_mb, size_t max_files) {
     std::lock_guard<std::mutex> lock(log_mutex_);
     
+    flush_file_buffer();
     if (file_stream_.is_open()) {
         file_stream_.close();
     }
@@ -196,9 +365,11 @@ void Logger::set_file_output(const string_t& file_path, size_t max_size_mb, size
     // 创建目录（如果不存在）
     try {
         fs::path path(file_path_);
-        fs::create_directories(path.parent_path());
+        if (!path.parent_path().string().empty()) {
+            fs::create_directories(path.parent_path());
+        }
         
-        file_stream_.open(file_path_, std::ios::app);
+        open_file_stream();
         if (!file_stream_.is_open()) {
             // 如果无法打开文件，回退到控制台输出
             target_ = LogTarget::CONSOLE;
@@ -208,19 +379,36 @@ void Logger::set_file_output(const string_t& file_path, size_t max_size_mb, size
     }
 }
 
+void Logger::set_file_buffering(size_t buffer_size, int flush_interval_ms) {
+    stop_flush_thread();
+    
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    flush_file_buffer();
+    file_buffer_limit_ = buffer_size;
+    flush_interval_ms_ = flush_interval_ms;
+    file_buffer_.reserve(buffer_size);
+    
+    if (buffer_size > 0 && flush_interval_ms > 0) {
+        flush_stop_ = false;
+        flush_thread_ = std::thread([this]() { flush_worker(); });
+    }
+}
+
 void Logger::set_pattern(const string_t& pattern) {
     std::lock_guard<std::mutex> lock(log_mutex_);
     pattern_ = pattern;
 }
 
-void Logger::enable_async(size_t buffer_size) {
+void Logger::enable_async(size_t buffer_size, LogOverflowPolicy policy) {
     if (async_enabled_) {
         return;
     }
     
     buffer_size_ = buffer_size;
-    async_enabled_ = true;
+    overflow_policy_ = policy;
     should_stop_ = false;
+    async_session_.store(next_async_session.fetch_add(1), std::memory_order_relaxed);
+    async_enabled_.store(true, std::memory_order_release);
     
     async_thread_ = std::thread([this]() { async_worker(); });
 }
@@ -230,57 +418,98 @@ void Logger::disable_async() {
         return;
     }
     
+    async_enabled_.store(false, std::memory_order_release);
     should_stop_ = true;
-    queue_condition_.notify_all();
+    wakeup_condition_.notify_all();
     
     if (async_thread_.joinable()) {
         async_thread_.join();
     }
     
-    async_enabled_ = false;
+    // 后台线程退出前已写完所有日志，此后生产者不再使用这些日志环
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto& ring : rings_) {
+        ring->close();
+        retired_dropped_.fetch_add(ring->dropped(), std::memory_order_relaxed);
+    }
+    rings_.clear();
+}
+
+size_t Logger::get_async_backlog_bytes() const {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    size_t slots = 0;
+    for (const auto& ring : rings_) {
+        slots += ring->used_slots();
+    }
+    return slots * detail::LogRing::SLOT_SIZE;
+}
+
+uint64_t Logger::get_dropped_count() const {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    uint64_t dropped = retired_dropped_.load(std::memory_order_relaxed);
+    for (const auto& ring : rings_) {
+        dropped += ring->dropped();
+    }
+    return dropped;
 }
 
 void Logger::log(LogLevel level, const string_t& message,
-                const string_t& file, int line, const string_t& function) {
+                const char* file, int line, const char* function) {
     if (!is_enabled(level)) {
         return;
     }
     
-    LogRecord record(level, message, name_, file, line, function);
-    
-    if (async_enabled_) {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        if (log_queue_.size() < buffer_size_) {
-            log_queue_.push(record);
-            queue_condition_.notify_one();
+    if (async_enabled_.load(std::memory_order_acquire)) {
+        detail::LogRing* ring = nullptr;
+        size_t size = message.size();
+        detail::LogRing::Entry* entry = reserve_entry(ring, size);
+        if (entry == nullptr && ring != nullptr && size > ring->max_data_size()) {
+            // 超长消息截断
+            size = ring->max_data_size();
+            entry = reserve_entry(ring, size);
+        }
+        if (entry != nullptr) {
+            entry->level = static_cast<uint8_t>(level);
+            entry->has_format = 0;
+            entry->line = line;
+            entry->data_size = static_cast<uint32_t>(size);
+            entry->timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+            entry->file = file;
+            entry->function = function;
+            entry->format = nullptr;
+            std::memcpy(const_cast<byte*>(entry->data()), message.data(), size);
+            ring->commit();
+        }
+        if (ring != nullptr) {
+            return;
         }
-        // 如果队列满了，丢弃消息（防止内存泄露）
-    } else {
-        write_log(record);
     }
+    
+    write_log(LogRecord(level, message, name_, file != nullptr ? file : "", line,
+                        function != nullptr ? function : ""));
 }
 
-void Logger::trace(const string_t& message, const string_t& file, int line, const string_t& function) {
+void Logger::trace(const string_t& message, const char* file, int line, const char* function) {
     log(LogLevel::TRACE, message, file, line, function);
 }
 
-void Logger::debug(const string_t& message, const string_t& file, int line, const string_t& function) {
+void Logger::debug(const string_t& message, const char* file, int line, const char* function) {
     log(LogLevel::DEBUG, message, file, line, function);
 }
 
-void Logger::info(const string_t& message, const string_t& file, int line, const string_t& function) {
+void Logger::info(const string_t& message, const char* file, int line, const char* function) {
     log(LogLevel::INFO, message, file, line, function);
 }
 
-void Logger::warn(const string_t& message, const string_t& file, int line, const string_t& function) {
+void Logger::warn(const string_t& message, const char* file, int line, const char* function) {
     log(LogLevel::WARN, message, file, line, function);
 }
 
-void Logger::error(const string_t& message, const string_t& file, int line, const string_t& function) {
+void Logger::error(const string_t& message, const char* file, int line, const char* function) {
     log(LogLevel::LOG_ERROR, message, file, line, function);
 }
 
-void Logger::fatal(const string_t& message, const string_t& file, int line, const string_t& function) {
+void Logger::fatal(const string_t& message, const char* file, int line, const char* function) {
     log(LogLevel::FATAL, message, file, line, function);
 }
 
@@ -290,17 +519,23 @@ bool Logger::is_enabled(LogLevel level) const {
 
 void Logger::flush() {
     if (async_enabled_) {
-        // 等待异步队列清空
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        while (!log_queue_.empty()) {
+        // 等待后台线程写完所有日志环
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(rings_mutex_);
+                bool empty = std::all_of(rings_.begin(), rings_.end(),
+                                         [](const auto& ring) { return ring->empty(); });
+                if (empty) {
+                    break;
+                }
+            }
+            wakeup_condition_.notify_one();
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
     
     std::lock_guard<std::mutex> lock(log_mutex_);
-    if (file_stream_.is_open()) {
-        file_stream_.flush();
-    }
+    flush_file_buffer();
     std::cout.flush();
 }
 
@@ -309,15 +544,102 @@ const string_t& Logger::get_name() const {
 }
 
 void Logger::rotate_files() {
-    if (!should_rotate()) {
-        return;
-    }
-    
     std::lock_guard<std::mutex> lock(log_mutex_);
-    perform_rotation();
+    if (should_rotate()) {
+        perform_rotation();
+    }
 }
 
 // 私有方法实现
+detail::LogRing* Logger::thread_ring() {
+    uint64_t session = async_session_.load(std::memory_order_relaxed);
+    auto& rings = thread_rings.rings;
+    for (const auto& item : rings) {
+        if (item.first == session) {
+            return item.second.get();
+        }
+    }
+    
+    // 当前线程首次写日志：清理已结束会话的日志环，然后注册新的日志环
+    rings.erase(std::remove_if(rings.begin(), rings.end(),
+                               [](const auto& item) { return item.second->closed(); }),
+                rings.end());
+    
+    auto ring = std::make_shared<detail::LogRing>(buffer_size_ * SLOTS_PER_RECORD);
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        if (!async_enabled_.load(std::memory_order_acquire) ||
+            async_session_.load(std::memory_order_relaxed) != session) {
+            return nullptr;
+        }
+        rings_.push_back(ring);
+    }
+    rings.emplace_back(session, ring);
+    return ring.get();
+}
+
+detail::LogRing::Entry* Logger::reserve_entry(detail::LogRing*& ring, size_t data_size) {
+    ring = thread_ring();
+    if (ring == nullptr || data_size > ring->max_data_size()) {
+        return nullptr;
+    }
+    
+    detail::LogRing::Entry* entry = ring->try_reserve(data_size);
+    if (entry == nullptr && overflow_policy_ == LogOverflowPolicy::BLOCK) {
+        while (entry == nullptr && async_enabled_.load(std::memory_order_acquire)) {
+            wakeup_condition_.notify_one();
+            std::this_thread::yield();
+            entry = ring->try_reserve(data_size);
+        }
+    }
+    
+    if (entry == nullptr) {
+        ring->record_drop();
+    }
+    return entry;
+}
+
+bool Logger::drain_rings() {
+    bool processed = false;
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    
+    for (auto it = rings_.begin(); it != rings_.end();) {
+        detail::LogRing& ring = **it;
+        while (const detail::LogRing::Entry* entry = ring.peek()) {
+            write_entry(ring, *entry);
+            ring.release(entry);
+            processed = true;
+        }
+        
+        // 只剩这里的引用说明所属线程已经退出
+        if (it->use_count() == 1 && ring.empty()) {
+            retired_dropped_.fetch_add(ring.dropped(), std::memory_order_relaxed);
+            it = rings_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    return processed;
+}
+
+void Logger::write_entry(const detail::LogRing& ring, const detail::LogRing::Entry& entry) {
+    LogRecord record;
+    record.level = static_cast<LogLevel>(entry.level);
+    if (entry.has_format) {
+        record.message = detail::format_log_args(entry.format, entry.data(), entry.data_size);
+    } else {
+        record.message.assign(reinterpret_cast<const char*>(entry.data()), entry.data_size);
+    }
+    record.logger_name = name_;
+    record.file_name = entry.file != nullptr ? entry.file : "";
+    record.line_number = entry.line;
+    record.function_name = entry.function != nullptr ? entry.function : "";
+    record.timestamp = time_point_t(std::chrono::system_clock::duration(entry.timestamp));
+    record.thread_id = ring.thread_id();
+    write_log(record);
+}
+
 void Logger::write_log(const LogRecord& record) {
     string_t formatted_message = record.format(pattern_);
     
@@ -326,7 +648,7 @@ void Logger::write_log(const LogRecord& record) {
     }
     
     if (target_ == LogTarget::FILE || target_ == LogTarget::CONSOLE_AND_FILE) {
-        file_output(formatted_message);
+        file_output(formatted_message, record.level);
     }
 }
 
@@ -384,51 +706,103 @@ void Logger::console_output(const string_t& formatted_message, LogLevel level) {
 #endif
 }
 
-void Logger::file_output(const string_t& formatted_message) {
+void Logger::file_output(const string_t& formatted_message, LogLevel level) {
     std::lock_guard<std::mutex> lock(log_mutex_);
     
     if (!file_stream_.is_open() && !file_path_.empty()) {
-        file_stream_.open(file_path_, std::ios::app);
+        open_file_stream();
     }
     
-    if (file_stream_.is_open()) {
-        file_stream_ << formatted_message << std::endl;
+    if (!file_stream_.is_open()) {
+        return;
+    }
+    
+    if (file_buffer_limit_ == 0) {
+        file_stream_ << formatted_message << '\n';
         file_stream_.flush();
-        
-        // 检查是否需要轮转
-        if (should_rotate()) {
-            perform_rotation();
+    } else {
+        file_buffer_.append(formatted_message);
+        file_buffer_.push_back('\n');
+        // 错误日志立即落盘，避免进程随后崩溃时丢失
+        if (file_buffer_.size() >= file_buffer_limit_ || level >= LogLevel::LOG_ERROR) {
+            flush_file_buffer();
+        }
+    }
+    file_bytes_ += formatted_message.size() + 1;
+    
+    // 检查是否需要轮转
+    if (should_rotate()) {
+        perform_rotation();
+    }
+}
+
+void Logger::flush_file_buffer() {
+    if (!file_stream_.is_open()) {
+        return;
+    }
+    
+    if (!file_buffer_.empty()) {
+        file_stream_.write(file_buffer_.data(), static_cast<std::streamsize>(file_buffer_.size()));
+        file_buffer_.clear();
+    }
+    file_stream_.flush();
+}
+
+void Logger::stop_flush_thread() {
+    {
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        flush_stop_ = true;
+    }
+    flush_condition_.notify_all();
+    
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
+    }
+}
+
+void Logger::flush_worker() {
+    std::unique_lock<std::mutex> lock(log_mutex_);
+    while (!flush_stop_) {
+        flush_condition_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms_));
+        flush_file_buffer();
+    }
+}
+
+void Logger::open_file_stream() {
+    file_stream_.open(file_path_, std::ios::app);
+    
+    // 只在打开时查询一次文件大小，之后在内存中累计
+    file_bytes_ = 0;
+    try {
+        fs::path path(file_path_);
+        if (file_stream_.is_open() && fs::exists(path)) {
+            file_bytes_ = static_cast<uint64_t>(fs::file_size(path));
         }
+    } catch (...) {
+        file_bytes_ = 0;
     }
 }
 
 void Logger::async_worker() {
-    while (!should_stop_) {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
+    while (true) {
+        bool stopping = should_stop_.load(std::memory_order_acquire);
+        if (drain_rings()) {
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
         
-        queue_condition_.wait(lock, [this]() {
-            return !log_queue_.empty() || should_stop_;
+        // 生产者不发通知（避免写日志时的系统调用），空闲时短暂等待后再轮询
+        std::unique_lock<std::mutex> lock(wakeup_mutex_);
+        wakeup_condition_.wait_for(lock, ASYNC_IDLE_WAIT, [this]() {
+            return should_stop_.load(std::memory_order_acquire);
         });
-        
-        while (!log_queue_.empty()) {
-            LogRecord record = log_queue_.front();
-            log_queue_.pop();
-            lock.unlock();
-            
-            write_log(record);
-            
-            lock.lock();
-        }
     }
 }
 
 string_t Logger::get_current_timestamp() const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+    return cached_timestamp(std::chrono::system_clock::now());
 }
 
 
@@ -438,20 +812,11 @@ bool Logger::should_rotate() const {
         return false;
     }
     
-    try {
-        fs::path path(file_path_);
-        if (fs::exists(path)) {
-            auto file_size = fs::file_size(path);
-            return file_size > (max_file_size_mb_ * 1024 * 1024);
-        }
-    } catch (...) {
-        return false;
-    }
-    
-    return false;
+    return file_bytes_ > static_cast<uint64_t>(max_file_size_mb_) * 1024 * 1024;
 }
 
 void Logger::perform_rotation() {
+    flush_file_buffer();
     if (file_stream_.is_open()) {
         file_stream_.close();
     }
@@ -474,11 +839,11 @@ void Logger::perform_rotation() {
         }
         
         // 重新打开日志文件
-        file_stream_.open(file_path_, std::ios::app);
+        open_file_stream();
     } catch (...) {
         // 轮转失败，继续使用原文件
         if (!file_stream_.is_open()) {
-            file_stream_.open(file_path_, std::ios::app);
+            open_file_stream();
         }
     }
 }
@@ -493,7 +858,7 @@ string_t Logger::get_rotated_filename(size_t index) const {
     size_t dot_pos = stem.find_last_of('.');
     size_t slash_pos = stem.find_last_of("/\\");
     
-    if (dot_pos != string_t::npos && dot_pos > slash_pos) {
+    if (dot_pos != string_t::npos && (slash_pos == string_t::npos || dot_pos > slash_pos)) {
         extension = stem.substr(dot_pos);
         stem = stem.substr(0, dot_pos);
     }
@@ -515,6 +880,7 @@ std::map<string_t, std::unique_ptr<Logger>> LoggerManager::loggers_;
 std::mutex LoggerManager::manager_mutex_;
 LogLevel LoggerManager::global_level_ = LogLevel::INFO;
 string_t LoggerManager::global_pattern_ = "[%d] [%l] [%n] %m";
+std::atomic<int> LoggerManager::level_floor_{static_cast<int>(LogLevel::INFO)};
 
 Logger& LoggerManager::get_logger(const string_t& name) {
     std::lock_guard<std::mutex> lock(manager_mutex_);
@@ -542,6 +908,16 @@ void LoggerManager::set_global_level(LogLevel level) {
     for (auto& pair : loggers_) {
         pair.second->set_level(level);
     }
+    
+    // 所有受管理的日志器现在都是该级别，下限可以提高
+    level_floor_.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+void LoggerManager::lower_level_floor(LogLevel level) {
+    int value = static_cast<int>(level);
+    int current = level_floor_.load(std::memory_order_relaxed);
+    while (value < current && !level_floor_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
 }
 
 void LoggerManager::set_global_pattern(const string_t& pattern) {
@@ -556,12 +932,11 @@ void LoggerManager::set_global_pattern(const string_t& pattern) {
 void LoggerManager::shutdown() {
     std::lock_guard<std::mutex> lock(manager_mutex_);
     
+    // 调用点缓存了日志器引用，这里只停止后台线程，不销毁日志器
     for (auto& pair : loggers_) {
         pair.second->flush();
         pair.second->disable_async();
     }
-    
-    loggers_.clear();
 }
 
 } // namespace udp2docker 
\ No newline at end of file
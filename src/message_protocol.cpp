@@ -1,61 +1,133 @@
 #include "udp2docker/message_protocol.h"
 #include "udp2docker/logger.h"
+#include "udp2docker/checksum.h"
+#include "udp2docker/metrics.h"
 #include <cstring>
 #include <chrono>
 #include <algorithm>
 
 namespace udp2docker {
 
+namespace {
+
+// 压缩负载前缀：原始长度（uint32）
+constexpr size_t COMPRESSED_PREFIX_SIZE = sizeof(uint32_t);
+
+// 加密负载额外开销：nonce + 认证标签
+constexpr size_t ENCRYPTION_OVERHEAD = AEAD_NONCE_SIZE + AEAD_TAG_SIZE;
+
+constexpr size_t DEFAULT_COMPRESSION_THRESHOLD = 128;
+
+// 进程级协议指标，所有MessageProtocol实例共用
+struct ProtocolMetrics {
+    Counter& encoded;
+    Counter& decoded;
+    Counter& malformed;
+    Counter& checksum;
+    Counter& authentication;
+    Counter& decode;
+};
+
+ProtocolMetrics& protocol_metrics() {
+    static ProtocolMetrics metrics = []() {
+        MetricsRegistry& registry = MetricsRegistry::global();
+        const char* errors_help = "Frames rejected by MessageProtocol, by reason";
+        return ProtocolMetrics{
+            registry.counter("udp2docker_protocol_messages_encoded_total", "Messages serialized by MessageProtocol"),
+            registry.counter("udp2docker_protocol_messages_decoded_total", "Messages deserialized by MessageProtocol"),
+            registry.counter("udp2docker_protocol_errors_total", errors_help, {{"reason", "malformed"}}),
+            registry.counter("udp2docker_protocol_errors_total", errors_help, {{"reason", "checksum"}}),
+            registry.counter("udp2docker_protocol_errors_total", errors_help, {{"reason", "authentication"}}),
+            registry.counter("udp2docker_protocol_errors_total", errors_help, {{"reason", "decode"}}),
+        };
+    }();
+    return metrics;
+}
+
+bool copy_view(const MessageView& view, Message& message) {
+    message.header = view.header;
+    message.payload.assign(view.payload.begin(), view.payload.end());
+    message.header.payload_size = static_cast<uint32_t>(message.payload.size());
+    message.header.metadata_size = 0;
+    message.header.flags &= static_cast<uint16_t>(~MessageHeader::FLAG_METADATA);
+    if (!view.metadata.decode(message.metadata)) {
+        message.metadata.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
 // MessageHeader 实现
 buffer_t MessageHeader::serialize() const {
     buffer_t buffer(header_size());
+    serialize_to(buffer.data());
+    return buffer;
+}
+
+void MessageHeader::serialize_to(byte* out) const {
     size_t offset = 0;
     
     // 魔数
-    std::memcpy(buffer.data() + offset, &magic_number, sizeof(magic_number));
+    std::memcpy(out + offset, &magic_number, sizeof(magic_number));
     offset += sizeof(magic_number);
     
     // 版本
-    std::memcpy(buffer.data() + offset, &version, sizeof(version));
+    std::memcpy(out + offset, &version, sizeof(version));
     offset += sizeof(version);
     
     // 消息类型
     uint16_t type_val = static_cast<uint16_t>(type);
-    std::memcpy(buffer.data() + offset, &type_val, sizeof(type_val));
+    std::memcpy(out + offset, &type_val, sizeof(type_val));
     offset += sizeof(type_val);
     
     // 优先级
     uint16_t priority_val = static_cast<uint16_t>(priority);
-    std::memcpy(buffer.data() + offset, &priority_val, sizeof(priority_val));
+    std::memcpy(out + offset, &priority_val, sizeof(priority_val));
     offset += sizeof(priority_val);
     
     // 序列号
-    std::memcpy(buffer.data() + offset, &sequence_id, sizeof(sequence_id));
+    std::memcpy(out + offset, &sequence_id, sizeof(sequence_id));
     offset += sizeof(sequence_id);
     
     // 时间戳
-    std::memcpy(buffer.data() + offset, &timestamp, sizeof(timestamp));
+    std::memcpy(out + offset, &timestamp, sizeof(timestamp));
     offset += sizeof(timestamp);
     
     // 负载大小
-    std::memcpy(buffer.data() + offset, &payload_size, sizeof(payload_size));
+    std::memcpy(out + offset, &payload_size, sizeof(payload_size));
     offset += sizeof(payload_size);
     
     // 校验和
-    std::memcpy(buffer.data() + offset, &checksum, sizeof(checksum));
+    std::memcpy(out + offset, &checksum, sizeof(checksum));
+    offset += sizeof(checksum);
     
-    return buffer;
+    // 标志位
+    std::memcpy(out + offset, &flags, sizeof(flags));
+    offset += sizeof(flags);
+    
+    // 元数据段大小
+    std::memcpy(out + offset, &metadata_size, sizeof(metadata_size));
+    offset += sizeof(metadata_size);
+    
+    // 保留字段
+    std::memset(out + offset, 0, header_size() - offset);
 }
 
 bool MessageHeader::deserialize(const buffer_t& data) {
-    if (data.size() < header_size()) {
+    return deserialize(data.data(), data.size());
+}
+
+bool MessageHeader::deserialize(const byte* data, size_t size) {
+    if (size < header_size()) {
         return false;
     }
     
     size_t offset = 0;
     
     // 魔数
-    std::memcpy(&magic_number, data.data() + offset, sizeof(magic_number));
+    std::memcpy(&magic_number, data + offset, sizeof(magic_number));
     offset += sizeof(magic_number);
     
     if (magic_number != 0x55AA55AA) {
@@ -63,35 +135,43 @@ bool MessageHeader::deserialize(const buffer_t& data) {
     }
     
     // 版本
-    std::memcpy(&version, data.data() + offset, sizeof(version));
+    std::memcpy(&version, data + offset, sizeof(version));
     offset += sizeof(version);
     
     // 消息类型
     uint16_t type_val;
-    std::memcpy(&type_val, data.data() + offset, sizeof(type_val));
+    std::memcpy(&type_val, data + offset, sizeof(type_val));
     type = static_cast<MessageType>(type_val);
     offset += sizeof(type_val);
     
     // 优先级
     uint16_t priority_val;
-    std::memcpy(&priority_val, data.data() + offset, sizeof(priority_val));
+    std::memcpy(&priority_val, data + offset, sizeof(priority_val));
     priority = static_cast<Priority>(priority_val);
     offset += sizeof(priority_val);
     
     // 序列号
-    std::memcpy(&sequence_id, data.data() + offset, sizeof(sequence_id));
+    std::memcpy(&sequence_id, data + offset, sizeof(sequence_id));
     offset += sizeof(sequence_id);
     
     // 时间戳
-    std::memcpy(&timestamp, data.data() + offset, sizeof(timestamp));
+    std::memcpy(&timestamp, data + offset, sizeof(timestamp));
     offset += sizeof(timestamp);
     
     // 负载大小
-    std::memcpy(&payload_size, data.data() + offset, sizeof(payload_size));
+    std::memcpy(&payload_size, data + offset, sizeof(payload_size));
     offset += sizeof(payload_size);
     
     // 校验和
-    std::memcpy(&checksum, data.data() + offset, sizeof(checksum));
+    std::memcpy(&checksum, data + offset, sizeof(checksum));
+    offset += sizeof(checksum);
+    
+    // 标志位（早期版本写入0）
+    std::memcpy(&flags, data + offset, sizeof(flags));
+    offset += sizeof(flags);
+    
+    // 元数据段大小（早期版本写入0）
+    std::memcpy(&metadata_size, data + offset, sizeof(metadata_size));
     
     return true;
 }
@@ -120,12 +200,57 @@ bool Message::is_valid() const {
            header.payload_size == payload.size();
 }
 
+Message MessageView::to_message() const {
+    Message message;
+    copy_view(*this, message);
+    return message;
+}
+
+bool BatchReader::next(BufferView& frame) {
+    if (failed_ || offset_ >= body_.size) {
+        return false;
+    }
+    
+    // 负载大小位于消息头偏移18处
+    constexpr size_t PAYLOAD_SIZE_OFFSET = 18;
+    size_t remaining = body_.size - offset_;
+    if (remaining < MessageHeader::header_size()) {
+        failed_ = true;
+        return false;
+    }
+    
+    uint32_t payload_size;
+    std::memcpy(&payload_size, body_.data + offset_ + PAYLOAD_SIZE_OFFSET, sizeof(payload_size));
+    if (payload_size > remaining - MessageHeader::header_size()) {
+        failed_ = true;
+        return false;
+    }
+    
+    size_t frame_size = MessageHeader::header_size() + payload_size;
+    frame = BufferView(body_.data + offset_, frame_size);
+    offset_ += frame_size;
+    return true;
+}
+
+size_t MessageParts::total_size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += parts[i].size;
+    }
+    return total;
+}
+
 // MessageProtocol 实现
 MessageProtocol::MessageProtocol()
     : sequence_counter_(0)
     , protocol_version_(1)
     , compression_enabled_(false)
+    , compression_type_(CompressionType::LZ4)
+    , compression_threshold_(DEFAULT_COMPRESSION_THRESHOLD)
     , encryption_enabled_(false)
+    , nonce_salt_{}
+    , nonce_counter_(0)
+    , nonce_salt_interval_(UINT32_MAX)
     , max_message_size_(MAX_BUFFER_SIZE)
 {
     LOG_DEBUG("MessageProtocol initialized");
@@ -133,43 +258,22 @@ MessageProtocol::MessageProtocol()
 
 std::optional<buffer_t> MessageProtocol::serialize(const Message& message) {
     try {
-        if (message.payload.size() > max_message_size_) {
-            LOG_ERROR("Message payload too large: " + std::to_string(message.payload.size()));
+        BufferView metadata;
+        BufferView payload;
+        MessageHeader header;
+        if (prepare_header(message, metadata, payload, header) != ErrorCode::SUCCESS) {
             return std::nullopt;
         }
         
-        // 创建消息副本用于处理
-        Message msg = message;
-        msg.header.version = protocol_version_;
-        msg.header.timestamp = get_timestamp();
-        
-        // 处理负载数据
-        buffer_t processed_payload = msg.payload;
-        
-        if (compression_enabled_) {
-            processed_payload = compress_data(processed_payload);
-            LOG_DEBUG("Payload compressed: " + std::to_string(msg.payload.size()) + 
-                     " -> " + std::to_string(processed_payload.size()));
-        }
-        
-        if (encryption_enabled_) {
-            processed_payload = encrypt_data(processed_payload);
-            LOG_DEBUG("Payload encrypted");
+        // 一次分配，头部和负载都原地写入
+        buffer_t result(MessageHeader::header_size() + header.payload_size);
+        header.serialize_to(result.data());
+        if (write_payload(header, result.data(), metadata, payload,
+                          result.data() + MessageHeader::header_size()) != ErrorCode::SUCCESS) {
+            return std::nullopt;
         }
         
-        msg.header.payload_size = static_cast<uint32_t>(processed_payload.size());
-        msg.header.checksum = calculate_checksum(processed_payload);
-        
-        // 序列化头部
-        auto header_bytes = msg.header.serialize();
-        
-        // 组装完整消息
-        buffer_t result;
-        result.reserve(header_bytes.size() + processed_payload.size());
-        result.insert(result.end(), header_bytes.begin(), header_bytes.end());
-        result.insert(result.end(), processed_payload.begin(), processed_payload.end());
-        
-        LOG_DEBUG("Message serialized: " + std::to_string(result.size()) + " bytes");
+        LOG_DEBUG_F("Message serialized: {} bytes", result.size());
         return result;
         
     } catch (const std::exception& e) {
@@ -180,64 +284,284 @@ std::optional<buffer_t> MessageProtocol::serialize(const Message& message) {
 
 std::optional<Message> MessageProtocol::deserialize(const buffer_t& data) {
     try {
-        if (data.size() < MessageHeader::header_size()) {
-            LOG_ERROR("Data too small for message header");
+        auto view = deserialize_view(data);
+        if (!view) {
             return std::nullopt;
         }
         
+        // 完整反序列化时立即解码元数据，损坏的元数据视为无效消息
         Message message;
-        
-        // 反序列化头部
-        buffer_t header_data(data.begin(), data.begin() + MessageHeader::header_size());
-        if (!message.header.deserialize(header_data)) {
-            LOG_ERROR("Failed to deserialize message header");
+        if (!copy_view(*view, message)) {
+            LOG_ERROR("Malformed message metadata");
+            protocol_metrics().malformed.increment();
             return std::nullopt;
         }
         
-        // 验证版本兼容性
-        if (message.header.version > protocol_version_) {
-            LOG_WARN("Message version higher than supported: " + 
-                    std::to_string(message.header.version));
-        }
+        LOG_DEBUG_F("Message deserialized: {} bytes", data.size());
+        return message;
         
-        // 提取负载
-        if (data.size() < MessageHeader::header_size() + message.header.payload_size) {
-            LOG_ERROR("Data size mismatch with header payload size");
+    } catch (const std::exception& e) {
+        LOG_ERROR("Deserialization error: " + std::string(e.what()));
+        return std::nullopt;
+    }
+}
+
+Result<size_t> MessageProtocol::serialize_into(const Message& message, byte* out, size_t capacity) {
+    BufferView metadata;
+    BufferView payload;
+    MessageHeader header;
+    ErrorCode result = prepare_header(message, metadata, payload, header);
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    
+    size_t total_size = MessageHeader::header_size() + header.payload_size;
+    if (out == nullptr || capacity < total_size) {
+        LOG_ERROR("Output buffer too small: " + std::to_string(capacity) +
+                 " < " + std::to_string(total_size));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    // 加密时密文直接写入输出帧，不经过中间缓冲区
+    header.serialize_to(out);
+    result = write_payload(header, out, metadata, payload, out + MessageHeader::header_size());
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    
+    return total_size;
+}
+
+Result<PooledBuffer> MessageProtocol::serialize_pooled(const Message& message, size_t headroom) {
+    BufferView metadata;
+    BufferView payload;
+    MessageHeader header;
+    ErrorCode result = prepare_header(message, metadata, payload, header);
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    
+    PooledBuffer frame = PooledBuffer::allocate(MessageHeader::header_size() + header.payload_size, headroom);
+    header.serialize_to(frame.data());
+    result = write_payload(header, frame.data(), metadata, payload, frame.data() + MessageHeader::header_size());
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    
+    return Result<PooledBuffer>(std::move(frame));
+}
+
+ErrorCode MessageProtocol::frame(PooledBuffer& buffer, MessageType type, Priority priority) {
+    if (buffer.size() > max_message_size_) {
+        LOG_ERROR("Message payload too large: " + std::to_string(buffer.size()));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    bool encode = (encryption_enabled_ && cipher_) ||
+                  (compression_enabled_ && buffer.size() >= compression_threshold_);
+    if (encode || buffer.headroom() < MessageHeader::header_size() || !buffer.unique()) {
+        // 编码后的负载长度不同，只能写入新的帧
+        Message message;
+        message.header.type = type;
+        message.header.priority = priority;
+        message.header.sequence_id = get_next_sequence_id();
+        message.payload.assign(buffer.data(), buffer.data() + buffer.size());
+        auto framed = serialize_pooled(message);
+        if (!framed.is_success()) {
+            return framed.error_code();
+        }
+        buffer = framed.value();
+        return ErrorCode::SUCCESS;
+    }
+    
+    MessageHeader header;
+    header.version = protocol_version_;
+    header.type = type;
+    header.priority = priority;
+    header.sequence_id = get_next_sequence_id();
+    header.timestamp = get_timestamp();
+    header.payload_size = static_cast<uint32_t>(buffer.size());
+    header.checksum = calculate_checksum(buffer.data(), buffer.size());
+    header.serialize_to(buffer.prepend(MessageHeader::header_size()));
+    protocol_metrics().encoded.increment();
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode MessageProtocol::serialize_parts(const Message& message, byte* header_out, MessageParts& parts) {
+    if (header_out == nullptr) {
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    BufferView metadata;
+    BufferView payload;
+    MessageHeader header;
+    ErrorCode result = prepare_header(message, metadata, payload, header);
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    
+    header.serialize_to(header_out);
+    
+    parts.parts[0] = BufferView(header_out, MessageHeader::header_size());
+    parts.count = 1;
+    
+    // 加密后的负载不能引用原消息，元数据和负载一起加密写入内部缓冲区
+    if (header.cipher() != CipherType::NONE) {
+        encrypted_payload_.resize(header.payload_size);
+        result = write_payload(header, header_out, metadata, payload, encrypted_payload_.data());
+        if (result != ErrorCode::SUCCESS) {
+            return result;
+        }
+        parts.parts[parts.count++] = BufferView(encrypted_payload_);
+        return ErrorCode::SUCCESS;
+    }
+    
+    if (!metadata.empty()) {
+        parts.parts[parts.count++] = metadata;
+    }
+    if (!payload.empty()) {
+        parts.parts[parts.count++] = payload;
+    }
+    
+    return ErrorCode::SUCCESS;
+}
+
+std::optional<MessageView> MessageProtocol::deserialize_view(BufferView data) {
+    if (data.size < MessageHeader::header_size()) {
+        LOG_ERROR("Data too small for message header");
+        protocol_metrics().malformed.increment();
+        return std::nullopt;
+    }
+    
+    MessageView view;
+    
+    // 反序列化头部
+    if (!view.header.deserialize(data.data, data.size)) {
+        LOG_ERROR("Failed to deserialize message header");
+        protocol_metrics().malformed.increment();
+        return std::nullopt;
+    }
+    
+    // 验证版本兼容性
+    if (view.header.version > protocol_version_) {
+        LOG_WARN("Message version higher than supported: " + 
+                std::to_string(view.header.version));
+    }
+    
+    // 提取负载
+    if (data.size - MessageHeader::header_size() < view.header.payload_size) {
+        LOG_ERROR("Data size mismatch with header payload size");
+        protocol_metrics().malformed.increment();
+        return std::nullopt;
+    }
+    
+    // 消息体 = 元数据段 + 负载，校验和与加密都覆盖整个消息体
+    BufferView body(data.data + MessageHeader::header_size(), view.header.payload_size);
+    bool decrypted = false;
+    
+    // 加密消息由AEAD标签同时保证完整性和真实性，不再计算CRC
+    if (view.header.cipher() != CipherType::NONE) {
+        if (!decrypt_payload(data.data, view.header, body, decoded_payload_)) {
+            protocol_metrics().authentication.increment();
+            return std::nullopt;
+        }
+        body = BufferView(decoded_payload_);
+        decrypted = true;
+    } else {
+        // 容器帧本身不加密，其中的每条消息各自加密和认证
+        if (encryption_enabled_ && view.header.type != MessageType::BATCH) {
+            LOG_ERROR("Unencrypted message rejected");
+            protocol_metrics().authentication.increment();
             return std::nullopt;
         }
         
-        buffer_t payload_data(data.begin() + MessageHeader::header_size(),
-                             data.begin() + MessageHeader::header_size() + message.header.payload_size);
-        
-        // 验证校验和
-        uint32_t calculated_checksum = calculate_checksum(payload_data);
-        if (calculated_checksum != message.header.checksum) {
+        uint32_t calculated_checksum = calculate_checksum(body.data, body.size);
+        if (calculated_checksum != view.header.checksum) {
             LOG_ERROR("Checksum mismatch");
+            protocol_metrics().checksum.increment();
             return std::nullopt;
         }
-        
-        // 处理负载数据
-        buffer_t processed_payload = payload_data;
-        
-        if (encryption_enabled_) {
-            processed_payload = decrypt_data(processed_payload);
-            LOG_DEBUG("Payload decrypted");
+    }
+    
+    size_t metadata_size = (view.header.flags & MessageHeader::FLAG_METADATA) ? view.header.metadata_size : 0;
+    if (metadata_size != view.header.metadata_size || metadata_size > body.size) {
+        LOG_ERROR("Invalid metadata size: " + std::to_string(view.header.metadata_size));
+        protocol_metrics().malformed.increment();
+        return std::nullopt;
+    }
+    
+    view.metadata = MetadataReader(BufferView(body.data, metadata_size));
+    view.payload = BufferView(body.data + metadata_size, body.size - metadata_size);
+    
+    CompressionType compression = view.header.compression();
+    if (compression != CompressionType::NONE) {
+        // 解密结果（含元数据）与解压输出不能共用缓冲区
+        buffer_t& output = decrypted ? encoded_payload_ : decoded_payload_;
+        if (!decompress_data(compression, view.payload, output)) {
+            protocol_metrics().decode.increment();
+            return std::nullopt;
         }
-        
-        if (compression_enabled_) {
-            processed_payload = decompress_data(processed_payload);
-            LOG_DEBUG("Payload decompressed");
+        view.payload = BufferView(output);
+    }
+    
+    protocol_metrics().decoded.increment();
+    return view;
+}
+
+Result<size_t> MessageProtocol::deserialize_each(BufferView data,
+                                                 const std::function<void(const MessageView&)>& visitor) {
+    auto view = deserialize_view(data);
+    if (!view) {
+        return ErrorCode::PROTOCOL_ERROR;
+    }
+    
+    if (view->header.type != MessageType::BATCH) {
+        visitor(*view);
+        return static_cast<size_t>(1);
+    }
+    
+    // 容器负载必须直接位于data中，解出内层消息时不会被覆盖
+    if (view->header.compression() != CompressionType::NONE || view->header.cipher() != CipherType::NONE) {
+        LOG_ERROR("Encoded batch container rejected");
+        protocol_metrics().malformed.increment();
+        return ErrorCode::PROTOCOL_ERROR;
+    }
+    
+    BatchReader reader(view->payload);
+    BufferView frame;
+    size_t count = 0;
+    while (reader.next(frame)) {
+        auto inner = deserialize_view(frame);
+        if (!inner || inner->header.type == MessageType::BATCH) {
+            // 内层消息解析失败时deserialize_view()已计入错误
+            LOG_ERROR("Invalid message in batch container");
+            if (inner) {
+                protocol_metrics().malformed.increment();
+            }
+            return ErrorCode::PROTOCOL_ERROR;
         }
-        
-        message.payload = processed_payload;
-        
-        LOG_DEBUG("Message deserialized: " + std::to_string(data.size()) + " bytes");
-        return message;
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("Deserialization error: " + std::string(e.what()));
-        return std::nullopt;
+        visitor(*inner);
+        ++count;
+    }
+    
+    if (reader.failed()) {
+        LOG_ERROR("Malformed batch container");
+        protocol_metrics().malformed.increment();
+        return ErrorCode::PROTOCOL_ERROR;
     }
+    return count;
+}
+
+void MessageProtocol::write_batch_header(BufferView body, Priority priority, byte* header_out) {
+    MessageHeader header;
+    header.version = protocol_version_;
+    header.type = MessageType::BATCH;
+    header.priority = priority;
+    header.sequence_id = get_next_sequence_id();
+    header.timestamp = get_timestamp();
+    header.payload_size = static_cast<uint32_t>(body.size);
+    header.checksum = calculate_checksum(body.data, body.size);
+    header.serialize_to(header_out);
 }
 
 Message MessageProtocol::create_heartbeat() {
@@ -262,7 +586,7 @@ Message MessageProtocol::create_data_message(const buffer_t& payload, Priority p
     msg.payload = payload;
     msg.header.payload_size = static_cast<uint32_t>(msg.payload.size());
     
-    LOG_DEBUG("Created data message: " + std::to_string(payload.size()) + " bytes");
+    LOG_DEBUG_F("Created data message: {} bytes", payload.size());
     return msg;
 }
 
@@ -294,7 +618,7 @@ Message MessageProtocol::create_response_message(uint32_t response_to_seq, const
     msg.header.payload_size = static_cast<uint32_t>(msg.payload.size());
     
     // 在元数据中记录响应的序列号
-    msg.metadata["response_to"] = std::to_string(response_to_seq);
+    msg.metadata.set("response_to", std::to_string(response_to_seq));
     
     LOG_DEBUG("Created response message for sequence: " + std::to_string(response_to_seq));
     return msg;
@@ -326,12 +650,77 @@ void MessageProtocol::set_compression_enabled(bool enable) {
     LOG_INFO("Compression " + std::string(enable ? "enabled" : "disabled"));
 }
 
-void MessageProtocol::set_encryption_enabled(bool enable, const string_t& key) {
-    encryption_enabled_ = enable;
-    if (!key.empty()) {
-        encryption_key_ = key;
+ErrorCode MessageProtocol::set_compression(CompressionType type, int level) {
+    if (type == CompressionType::NONE) {
+        compression_enabled_ = false;
+        return ErrorCode::SUCCESS;
+    }
+    
+    auto codec = create_codec(type, level);
+    if (!codec) {
+        LOG_ERROR("Compression not available: " + compression_type_to_string(type));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    codecs_[static_cast<size_t>(type)] = std::move(codec);
+    compression_type_ = type;
+    compression_enabled_ = true;
+    LOG_INFO("Compression set to " + compression_type_to_string(type));
+    return ErrorCode::SUCCESS;
+}
+
+void MessageProtocol::set_compression_threshold(size_t bytes) {
+    compression_threshold_ = bytes;
+}
+
+ErrorCode MessageProtocol::set_compression_dictionary(CompressionType type, const buffer_t& dictionary) {
+    Codec* codec = get_codec(type);
+    if (codec == nullptr) {
+        LOG_ERROR("Compression not available: " + compression_type_to_string(type));
+        return ErrorCode::INVALID_PARAMETER;
     }
-    LOG_INFO("Encryption " + std::string(enable ? "enabled" : "disabled"));
+    return codec->set_dictionary(dictionary);
+}
+
+ErrorCode MessageProtocol::set_encryption_enabled(bool enable, const string_t& key, CipherType cipher) {
+    if (!enable) {
+        encryption_enabled_ = false;
+        LOG_INFO("Encryption disabled");
+        return ErrorCode::SUCCESS;
+    }
+    
+    if (key.empty() && !cipher_) {
+        LOG_ERROR("Encryption key required");
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    if (!key.empty() || cipher_->type() != cipher) {
+        if (key.empty()) {
+            LOG_ERROR("Encryption key required to change cipher");
+            return ErrorCode::INVALID_PARAMETER;
+        }
+        
+        // 密钥派生和密钥扩展只在这里做一次
+        byte derived_key[AEAD_KEY_SIZE];
+        ErrorCode result = derive_encryption_key(key, derived_key);
+        std::unique_ptr<AeadCipher> aead;
+        if (result == ErrorCode::SUCCESS) {
+            aead = AeadCipher::create(cipher, derived_key);
+        }
+        std::memset(derived_key, 0, sizeof(derived_key));
+        
+        if (!aead || !secure_random_bytes(nonce_salt_, sizeof(nonce_salt_))) {
+            LOG_ERROR("Encryption not available: " + cipher_type_to_string(cipher));
+            return ErrorCode::INVALID_PARAMETER;
+        }
+        
+        cipher_ = std::move(aead);
+        nonce_counter_ = 0;
+    }
+    
+    encryption_enabled_ = true;
+    LOG_INFO("Encryption enabled: " + cipher_type_to_string(cipher_->type()));
+    return ErrorCode::SUCCESS;
 }
 
 uint32_t MessageProtocol::get_next_sequence_id() {
@@ -356,23 +745,160 @@ size_t MessageProtocol::get_max_message_size() const {
     return max_message_size_;
 }
 
+ErrorCode MessageProtocol::set_max_message_size(size_t bytes) {
+    if (bytes == 0 || bytes > UINT32_MAX) {
+        LOG_ERROR("Invalid max message size: " + std::to_string(bytes));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    max_message_size_ = bytes;
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode MessageProtocol::set_nonce_salt_interval(uint32_t messages) {
+    if (messages == 0) {
+        LOG_ERROR("Invalid nonce salt interval: 0");
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    nonce_salt_interval_ = messages;
+    return ErrorCode::SUCCESS;
+}
+
 // 私有方法实现
-uint32_t MessageProtocol::calculate_checksum(const buffer_t& data) {
-    // 简单的CRC32校验和算法
-    uint32_t checksum = 0xFFFFFFFF;
-    
-    for (byte b : data) {
-        checksum ^= b;
-        for (int i = 0; i < 8; ++i) {
-            if (checksum & 1) {
-                checksum = (checksum >> 1) ^ 0xEDB88320;
-            } else {
-                checksum >>= 1;
-            }
+ErrorCode MessageProtocol::prepare_header(const Message& message, BufferView& metadata,
+                                          BufferView& payload, MessageHeader& header) {
+    if (message.payload.size() > max_message_size_) {
+        LOG_ERROR("Message payload too large: " + std::to_string(message.payload.size()));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    header = message.header;
+    header.version = protocol_version_;
+    header.timestamp = get_timestamp();
+    
+    header.flags &= static_cast<uint16_t>(~(MessageHeader::FLAG_COMPRESSION_MASK | MessageHeader::FLAG_CIPHER_MASK |
+                                            MessageHeader::FLAG_METADATA));
+    header.metadata_size = 0;
+    metadata = BufferView();
+    
+    // 元数据编码在负载之前，不参与压缩
+    if (!message.metadata.empty()) {
+        if (encode_metadata(message.metadata, metadata_buffer_) != ErrorCode::SUCCESS) {
+            LOG_ERROR("Message metadata too large");
+            return ErrorCode::INVALID_PARAMETER;
         }
+        metadata = BufferView(metadata_buffer_);
+        header.metadata_size = static_cast<uint16_t>(metadata.size);
+        header.flags |= MessageHeader::FLAG_METADATA;
     }
     
-    return ~checksum;
+    // 处理负载数据，只有压缩或加密时才需要复制
+    payload = BufferView(message.payload);
+    
+    if (compression_enabled_ && payload.size >= compression_threshold_) {
+        if (compress_data(payload, encoded_payload_)) {
+            payload = BufferView(encoded_payload_);
+            header.flags |= static_cast<uint16_t>(compression_type_);
+        }
+    }
+    
+    size_t body_size = metadata.size + payload.size;
+    if (encryption_enabled_ && cipher_) {
+        // 认证标签取代CRC校验和
+        header.flags |= static_cast<uint16_t>(static_cast<uint16_t>(cipher_->type()) << MessageHeader::FLAG_CIPHER_SHIFT);
+        header.payload_size = static_cast<uint32_t>(ENCRYPTION_OVERHEAD + body_size);
+        header.checksum = 0;
+    } else {
+        Crc32 checksum;
+        checksum.update(metadata);
+        checksum.update(payload);
+        header.payload_size = static_cast<uint32_t>(body_size);
+        header.checksum = checksum.value();
+    }
+    
+    protocol_metrics().encoded.increment();
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode MessageProtocol::write_payload(const MessageHeader& header, const byte* header_bytes,
+                                         BufferView metadata, BufferView payload, byte* out) {
+    if (header.cipher() == CipherType::NONE) {
+        if (!metadata.empty()) {
+            std::memcpy(out, metadata.data, metadata.size);
+        }
+        if (!payload.empty()) {
+            std::memcpy(out + metadata.size, payload.data, payload.size);
+        }
+        return ErrorCode::SUCCESS;
+    }
+    
+    // 加密负载布局：nonce + 密文(元数据 + 负载) + 认证标签，头部作为附加认证数据
+    if (!next_nonce(out)) {
+        LOG_ERROR("Nonce salt renewal failed, refusing to reuse nonces");
+        return ErrorCode::PROTOCOL_ERROR;
+    }
+    const BufferView body[] = {metadata, payload};
+    byte* ciphertext = out + AEAD_NONCE_SIZE;
+    byte* tag = ciphertext + metadata.size + payload.size;
+    if (!cipher_->seal(out, BufferView(header_bytes, MessageHeader::header_size()), body, 2, ciphertext, tag)) {
+        LOG_ERROR("Payload encryption failed");
+        return ErrorCode::PROTOCOL_ERROR;
+    }
+    
+    return ErrorCode::SUCCESS;
+}
+
+bool MessageProtocol::decrypt_payload(const byte* header_bytes, const MessageHeader& header,
+                                      BufferView payload, buffer_t& output) {
+    if (!cipher_ || cipher_->type() != header.cipher()) {
+        LOG_ERROR("Cannot decrypt message encrypted with " + cipher_type_to_string(header.cipher()));
+        return false;
+    }
+    
+    if (payload.size < ENCRYPTION_OVERHEAD) {
+        LOG_ERROR("Encrypted payload too small");
+        return false;
+    }
+    
+    const byte* nonce = payload.data;
+    size_t ciphertext_size = payload.size - ENCRYPTION_OVERHEAD;
+    BufferView ciphertext(payload.data + AEAD_NONCE_SIZE, ciphertext_size);
+    const byte* tag = ciphertext.end();
+    
+    output.resize(ciphertext_size);
+    if (!cipher_->open(nonce, BufferView(header_bytes, MessageHeader::header_size()),
+                       ciphertext, tag, output.data())) {
+        LOG_ERROR("Message authentication failed");
+        return false;
+    }
+    
+    return true;
+}
+
+bool MessageProtocol::next_nonce(byte* nonce) {
+    // nonce = 会话随机盐(8字节) + 递增计数器(4字节)，计数器用尽时更换盐
+    if (nonce_counter_ >= nonce_salt_interval_) {
+        // 换盐失败时不能重置计数器，否则会重复使用同一密钥下的nonce
+        byte salt[sizeof(nonce_salt_)];
+        if (!secure_random_bytes(salt, sizeof(salt))) {
+            return false;
+        }
+        std::memcpy(nonce_salt_, salt, sizeof(salt));
+        nonce_counter_ = 0;
+    }
+    
+    uint32_t counter = ++nonce_counter_;
+    std::memcpy(nonce, nonce_salt_, sizeof(nonce_salt_));
+    std::memcpy(nonce + sizeof(nonce_salt_), &counter, sizeof(counter));
+    return true;
+}
+
+uint32_t MessageProtocol::calculate_checksum(const buffer_t& data) {
+    return calculate_checksum(data.data(), data.size());
+}
+
+uint32_t MessageProtocol::calculate_checksum(const byte* data, size_t size) {
+    // CRC32，按CPU特性选择硬件加速或查表实现
+    return crc32(data, size);
 }
 
 uint32_t MessageProtocol::get_timestamp() {
@@ -381,30 +907,70 @@ uint32_t MessageProtocol::get_timestamp() {
     return static_cast<uint32_t>(timestamp.count());
 }
 
-buffer_t MessageProtocol::compress_data(const buffer_t& data) {
-    // 简单的压缩实现（这里只是占位符）
-    // 实际项目中应该使用真正的压缩算法如zlib
-    LOG_WARN("Compression not implemented, returning original data");
-    return data;
-}
-
-buffer_t MessageProtocol::decompress_data(const buffer_t& data) {
-    // 简单的解压缩实现（这里只是占位符）
-    LOG_WARN("Decompression not implemented, returning original data");
-    return data;
+Codec* MessageProtocol::get_codec(CompressionType type) {
+    size_t index = static_cast<size_t>(type);
+    if (index == 0 || index >= COMPRESSION_TYPE_COUNT) {
+        return nullptr;
+    }
+    
+    if (!codecs_[index]) {
+        codecs_[index] = create_codec(type);
+    }
+    return codecs_[index].get();
 }
 
-buffer_t MessageProtocol::encrypt_data(const buffer_t& data) {
-    // 简单的加密实现（这里只是占位符）
-    // 实际项目中应该使用真正的加密算法如AES
-    LOG_WARN("Encryption not implemented, returning original data");
-    return data;
+bool MessageProtocol::compress_data(BufferView input, buffer_t& output) {
+    Codec* codec = get_codec(compression_type_);
+    if (codec == nullptr) {
+        return false;
+    }
+    
+    // 压缩结果必须比原始数据小，否则直接发送原始数据
+    if (input.size <= COMPRESSED_PREFIX_SIZE + 1) {
+        return false;
+    }
+    size_t capacity = input.size - COMPRESSED_PREFIX_SIZE - 1;
+    output.resize(COMPRESSED_PREFIX_SIZE + capacity);
+    
+    auto result = codec->compress(input.data, input.size, output.data() + COMPRESSED_PREFIX_SIZE, capacity);
+    if (!result.is_success()) {
+        return false;
+    }
+    
+    uint32_t original_size = static_cast<uint32_t>(input.size);
+    std::memcpy(output.data(), &original_size, sizeof(original_size));
+    output.resize(COMPRESSED_PREFIX_SIZE + result.value());
+    return true;
 }
 
-buffer_t MessageProtocol::decrypt_data(const buffer_t& data) {
-    // 简单的解密实现（这里只是占位符）
-    LOG_WARN("Decryption not implemented, returning original data");
-    return data;
+bool MessageProtocol::decompress_data(CompressionType type, BufferView input, buffer_t& output) {
+    Codec* codec = get_codec(type);
+    if (codec == nullptr) {
+        LOG_ERROR("Unsupported compression: " + compression_type_to_string(type));
+        return false;
+    }
+    
+    if (input.size < COMPRESSED_PREFIX_SIZE) {
+        LOG_ERROR("Compressed payload too small");
+        return false;
+    }
+    
+    uint32_t original_size;
+    std::memcpy(&original_size, input.data, sizeof(original_size));
+    if (original_size > max_message_size_) {
+        LOG_ERROR("Decompressed size too large: " + std::to_string(original_size));
+        return false;
+    }
+    
+    output.resize(original_size);
+    auto result = codec->decompress(input.data + COMPRESSED_PREFIX_SIZE, input.size - COMPRESSED_PREFIX_SIZE,
+                                    output.data(), output.size());
+    if (!result.is_success() || result.value() != original_size) {
+        LOG_ERROR("Failed to decompress payload");
+        return false;
+    }
+    
+    return true;
 }
 
 template<typename T>
@@ -445,7 +1011,7 @@ MessageBuilder& MessageBuilder::set_payload(const string_t& payload) {
 }
 
 MessageBuilder& MessageBuilder::add_metadata(const string_t& key, const string_t& value) {
-    message_.metadata[key] = value;
+    message_.metadata.set(key, value);
     return *this;
 }
 
@@ -466,6 +1032,7 @@ string_t message_type_to_string(MessageType type) {
         case MessageType::CONTROL: return "CONTROL";
         case MessageType::RESPONSE: return "RESPONSE";
         case MessageType::MESSAGE_ERROR: return "ERROR";
+        case MessageType::BATCH: return "BATCH";
         default: return "UNKNOWN";
     }
 }
@@ -492,6 +1059,7 @@ string_t error_code_to_string(ErrorCode error) {
         case ErrorCode::TIMEOUT: return "TIMEOUT";
         case ErrorCode::INVALID_PARAMETER: return "INVALID_PARAMETER";
         case ErrorCode::PROTOCOL_ERROR: return "PROTOCOL_ERROR";
+        case ErrorCode::QUEUE_FULL: return "QUEUE_FULL";
         default: return "UNKNOWN_ERROR";
     }
 }
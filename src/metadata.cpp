@@ -0,0 +1,285 @@
+#include "udp2docker/metadata.h"
+
+namespace udp2docker {
+
+namespace {
+
+// 预定义键，ID即数组下标+1，已发布的ID不得修改，只能在末尾追加
+constexpr std::string_view WELL_KNOWN_KEYS[] = {
+    "response_to",
+    "correlation_id",
+    "reply_to",
+    "content_type",
+    "encoding",
+    "container_id",
+    "container_name",
+    "source",
+    "target",
+    "trace_id",
+    "span_id",
+    "timestamp",
+};
+
+constexpr size_t WELL_KNOWN_KEY_COUNT = sizeof(WELL_KNOWN_KEYS) / sizeof(WELL_KNOWN_KEYS[0]);
+
+constexpr uint8_t CUSTOM_KEY_TAG = 0;
+constexpr size_t MAX_CUSTOM_KEY_SIZE = 255;
+
+inline std::string_view as_string_view(const byte* data, size_t size) {
+    return std::string_view(reinterpret_cast<const char*>(data), size);
+}
+
+void write_varint(buffer_t& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<byte>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<byte>(value));
+}
+
+bool read_varint(BufferView data, size_t& offset, size_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 21; shift += 7) {
+        if (offset >= data.size) {
+            return false;
+        }
+        byte b = data.data[offset++];
+        value |= static_cast<size_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    // 元数据段不超过64KB，长度最多3字节
+    return false;
+}
+
+} // namespace
+
+// MetadataMap 实现
+void MetadataMap::set(std::string_view key, std::string_view value) {
+    // 参数可能指向自身存储（例如来自get()的结果），追加前先复制
+    const char* storage_begin = storage_.data();
+    const char* storage_end = storage_begin + storage_.size();
+    auto aliases = [&](std::string_view text) {
+        return !text.empty() && text.data() >= storage_begin && text.data() < storage_end;
+    };
+    if (aliases(key) || aliases(value)) {
+        string_t key_copy(key);
+        string_t value_copy(value);
+        set(key_copy, value_copy);
+        return;
+    }
+    
+    size_t index = find_index(key);
+    if (index != npos) {
+        Slot& slot = slots_[index];
+        if (value.size() <= slot.value_size) {
+            // 原位覆盖
+            storage_.replace(slot.value_offset, value.size(), value.data(), value.size());
+            garbage_bytes_ += slot.value_size - value.size();
+            slot.value_size = static_cast<uint32_t>(value.size());
+        } else {
+            garbage_bytes_ += slot.value_size;
+            slot.value_offset = append(value);
+            slot.value_size = static_cast<uint32_t>(value.size());
+        }
+        compact();
+        return;
+    }
+    
+    Slot slot;
+    slot.key_offset = append(key);
+    slot.key_size = static_cast<uint32_t>(key.size());
+    slot.value_offset = append(value);
+    slot.value_size = static_cast<uint32_t>(value.size());
+    slots_.push_back(slot);
+}
+
+std::optional<std::string_view> MetadataMap::get(std::string_view key) const {
+    size_t index = find_index(key);
+    if (index == npos) {
+        return std::nullopt;
+    }
+    return entry(index).second;
+}
+
+string_t MetadataMap::get_string(std::string_view key, const string_t& default_value) const {
+    auto value = get(key);
+    return value ? string_t(*value) : default_value;
+}
+
+bool MetadataMap::erase(std::string_view key) {
+    size_t index = find_index(key);
+    if (index == npos) {
+        return false;
+    }
+    
+    garbage_bytes_ += slots_[index].key_size + slots_[index].value_size;
+    slots_.erase(slots_.begin() + static_cast<std::ptrdiff_t>(index));
+    compact();
+    return true;
+}
+
+void MetadataMap::clear() {
+    slots_.clear();
+    storage_.clear();
+    garbage_bytes_ = 0;
+}
+
+void MetadataMap::reserve(size_t entries, size_t bytes) {
+    slots_.reserve(entries);
+    storage_.reserve(bytes);
+}
+
+bool MetadataMap::operator==(const MetadataMap& other) const {
+    if (size() != other.size()) {
+        return false;
+    }
+    for (const auto& item : *this) {
+        auto value = other.get(item.first);
+        if (!value || *value != item.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MetadataMap::Entry MetadataMap::entry(size_t index) const {
+    const Slot& slot = slots_[index];
+    std::string_view storage(storage_);
+    return Entry(storage.substr(slot.key_offset, slot.key_size),
+                 storage.substr(slot.value_offset, slot.value_size));
+}
+
+size_t MetadataMap::find_index(std::string_view key) const {
+    std::string_view storage(storage_);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        const Slot& slot = slots_[i];
+        if (slot.key_size == key.size() && storage.substr(slot.key_offset, slot.key_size) == key) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+uint32_t MetadataMap::append(std::string_view text) {
+    uint32_t offset = static_cast<uint32_t>(storage_.size());
+    storage_.append(text.data(), text.size());
+    return offset;
+}
+
+void MetadataMap::compact() {
+    // 废弃字节超过一半时重建存储
+    if (garbage_bytes_ * 2 <= storage_.size()) {
+        return;
+    }
+    
+    string_t storage;
+    storage.reserve(storage_.size() - garbage_bytes_);
+    for (Slot& slot : slots_) {
+        uint32_t key_offset = static_cast<uint32_t>(storage.size());
+        storage.append(storage_, slot.key_offset, slot.key_size);
+        uint32_t value_offset = static_cast<uint32_t>(storage.size());
+        storage.append(storage_, slot.value_offset, slot.value_size);
+        slot.key_offset = key_offset;
+        slot.value_offset = value_offset;
+    }
+    
+    storage_.swap(storage);
+    garbage_bytes_ = 0;
+}
+
+// MetadataReader 实现
+bool MetadataReader::next(size_t& offset, std::string_view& key, std::string_view& value) const {
+    if (offset >= data_.size) {
+        return false;
+    }
+    
+    uint8_t tag = data_.data[offset++];
+    if (tag == CUSTOM_KEY_TAG) {
+        if (offset >= data_.size) {
+            return false;
+        }
+        size_t key_size = data_.data[offset++];
+        if (key_size > data_.size - offset) {
+            return false;
+        }
+        key = as_string_view(data_.data + offset, key_size);
+        offset += key_size;
+    } else if (tag <= WELL_KNOWN_KEY_COUNT) {
+        key = WELL_KNOWN_KEYS[tag - 1];
+    } else {
+        return false;
+    }
+    
+    size_t value_size;
+    if (!read_varint(data_, offset, value_size) || value_size > data_.size - offset) {
+        return false;
+    }
+    value = as_string_view(data_.data + offset, value_size);
+    offset += value_size;
+    return true;
+}
+
+std::optional<std::string_view> MetadataReader::find(std::string_view key) const {
+    size_t offset = 0;
+    std::string_view entry_key;
+    std::string_view entry_value;
+    while (next(offset, entry_key, entry_value)) {
+        if (entry_key == key) {
+            return entry_value;
+        }
+    }
+    return std::nullopt;
+}
+
+bool MetadataReader::decode(MetadataMap& out) const {
+    size_t offset = 0;
+    std::string_view key;
+    std::string_view value;
+    while (offset < data_.size) {
+        if (!next(offset, key, value)) {
+            return false;
+        }
+        out.set(key, value);
+    }
+    return true;
+}
+
+ErrorCode encode_metadata(const MetadataMap& metadata, buffer_t& out) {
+    out.clear();
+    
+    for (const auto& item : metadata) {
+        uint8_t key_id = metadata_key_id(item.first);
+        if (key_id != CUSTOM_KEY_TAG) {
+            out.push_back(key_id);
+        } else {
+            if (item.first.size() > MAX_CUSTOM_KEY_SIZE) {
+                return ErrorCode::INVALID_PARAMETER;
+            }
+            out.push_back(CUSTOM_KEY_TAG);
+            out.push_back(static_cast<byte>(item.first.size()));
+            out.insert(out.end(), item.first.begin(), item.first.end());
+        }
+        
+        write_varint(out, item.second.size());
+        out.insert(out.end(), item.second.begin(), item.second.end());
+        
+        if (out.size() > MAX_METADATA_SIZE) {
+            return ErrorCode::INVALID_PARAMETER;
+        }
+    }
+    
+    return ErrorCode::SUCCESS;
+}
+
+uint8_t metadata_key_id(std::string_view key) {
+    for (size_t i = 0; i < WELL_KNOWN_KEY_COUNT; ++i) {
+        if (WELL_KNOWN_KEYS[i] == key) {
+            return static_cast<uint8_t>(i + 1);
+        }
+    }
+    return CUSTOM_KEY_TAG;
+}
+
+} // namespace udp2docker
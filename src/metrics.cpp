@@ -0,0 +1,592 @@
+#include "udp2docker/metrics.h"
+#include "udp2docker/config_manager.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define poll WSAPoll
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+// Prometheus summary导出的分位数
+const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+// 抓取请求的最大长度，超过后按已读取的部分处理
+constexpr size_t MAX_REQUEST_SIZE = 4096;
+
+#ifdef _WIN32
+const socket_handle_t INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+constexpr int SEND_FLAGS = 0;
+#else
+constexpr socket_handle_t INVALID_SOCKET_HANDLE = -1;
+// 抓取方提前断开时不产生SIGPIPE
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#endif
+
+void close_handle(socket_handle_t handle) {
+#ifdef _WIN32
+    closesocket(handle);
+#else
+    ::close(handle);
+#endif
+}
+
+string_t escape_label_value(const string_t& value) {
+    string_t result;
+    result.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': result += "\\\\"; break;
+            case '"': result += "\\\""; break;
+            case '\n': result += "\\n"; break;
+            default: result += c; break;
+        }
+    }
+    return result;
+}
+
+string_t escape_help(const string_t& help) {
+    string_t result;
+    result.reserve(help.size());
+    for (char c : help) {
+        if (c == '\\') {
+            result += "\\\\";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+void write_labels(std::ostringstream& out, const MetricLabels& labels, const char* quantile = nullptr) {
+    if (labels.empty() && quantile == nullptr) {
+        return;
+    }
+    
+    out << '{';
+    bool first = true;
+    for (const auto& label : labels) {
+        if (!first) {
+            out << ',';
+        }
+        out << label.first << "=\"" << escape_label_value(label.second) << '"';
+        first = false;
+    }
+    if (quantile != nullptr) {
+        if (!first) {
+            out << ',';
+        }
+        out << "quantile=\"" << quantile << '"';
+    }
+    out << '}';
+}
+
+const char* type_name(MetricType type) {
+    switch (type) {
+        case MetricType::COUNTER: return "counter";
+        case MetricType::GAUGE: return "gauge";
+        case MetricType::SUMMARY: return "summary";
+    }
+    return "untyped";
+}
+
+// StatsD名称只保留字母、数字、下划线和点，其余字符替换为下划线
+string_t statsd_name(const string_t& prefix, const MetricSample& sample, const char* suffix = nullptr) {
+    string_t name = prefix.empty() ? sample.name : prefix + "." + sample.name;
+    for (const auto& label : sample.labels) {
+        name += "." + label.first + "_" + label.second;
+    }
+    if (suffix != nullptr) {
+        name += ".";
+        name += suffix;
+    }
+    
+    for (char& c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') {
+            c = '_';
+        }
+    }
+    return name;
+}
+
+// 最短的可精确还原的十进制表示，计数器不会被写成科学计数法的近似值
+string_t format_number(double value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return string_t(buffer, result.ptr);
+}
+
+} // anonymous namespace
+
+// ========== MetricsWriter ==========
+
+void MetricsWriter::counter(const string_t& name, const string_t& help, uint64_t value, MetricLabels labels) {
+    MetricSample sample;
+    sample.type = MetricType::COUNTER;
+    sample.name = name;
+    sample.help = help;
+    sample.labels = std::move(labels);
+    sample.value = static_cast<double>(value);
+    samples_.push_back(std::move(sample));
+}
+
+void MetricsWriter::gauge(const string_t& name, const string_t& help, double value, MetricLabels labels) {
+    MetricSample sample;
+    sample.type = MetricType::GAUGE;
+    sample.name = name;
+    sample.help = help;
+    sample.labels = std::move(labels);
+    sample.value = value;
+    samples_.push_back(std::move(sample));
+}
+
+void MetricsWriter::summary(const string_t& name, const string_t& help, HistogramSnapshot snapshot,
+                            MetricLabels labels) {
+    MetricSample sample;
+    sample.type = MetricType::SUMMARY;
+    sample.name = name;
+    sample.help = help;
+    sample.labels = std::move(labels);
+    sample.histogram = std::move(snapshot);
+    samples_.push_back(std::move(sample));
+}
+
+// ========== MetricsRegistry ==========
+
+MetricsRegistry& MetricsRegistry::global() {
+    // 不析构：静态对象析构期间的日志器和客户端仍可能更新指标
+    static MetricsRegistry* registry = new MetricsRegistry();
+    return *registry;
+}
+
+MetricsRegistry::MetricsRegistry() : next_collector_id_(1) {
+}
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+Counter& MetricsRegistry::counter(const string_t& name, const string_t& help, const MetricLabels& labels) {
+    return *find_or_create(MetricType::COUNTER, name, help, labels).counter;
+}
+
+Gauge& MetricsRegistry::gauge(const string_t& name, const string_t& help, const MetricLabels& labels) {
+    return *find_or_create(MetricType::GAUGE, name, help, labels).gauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const string_t& name, const string_t& help, const MetricLabels& labels) {
+    return *find_or_create(MetricType::SUMMARY, name, help, labels).histogram;
+}
+
+CollectorId MetricsRegistry::add_collector(MetricsCollector collector) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CollectorId id = next_collector_id_++;
+    collectors_.emplace(id, std::move(collector));
+    return id;
+}
+
+void MetricsRegistry::remove_collector(CollectorId id) {
+    // 与collect()互斥，返回后回调不会再运行
+    std::lock_guard<std::mutex> lock(mutex_);
+    collectors_.erase(id);
+}
+
+std::vector<MetricSample> MetricsRegistry::collect() const {
+    std::vector<MetricSample> samples;
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples.reserve(entries_.size());
+        for (const auto& entry : entries_) {
+            MetricSample sample;
+            sample.type = entry->type;
+            sample.name = entry->name;
+            sample.help = entry->help;
+            sample.labels = entry->labels;
+            switch (entry->type) {
+                case MetricType::COUNTER:
+                    sample.value = static_cast<double>(entry->counter->value());
+                    break;
+                case MetricType::GAUGE:
+                    sample.value = static_cast<double>(entry->gauge->value());
+                    break;
+                case MetricType::SUMMARY:
+                    sample.histogram = entry->histogram->snapshot();
+                    break;
+            }
+            samples.push_back(std::move(sample));
+        }
+        
+        MetricsWriter writer(samples);
+        for (const auto& collector : collectors_) {
+            collector.second(writer);
+        }
+    }
+    
+    // 同名指标相邻输出，Prometheus要求同一指标族的样本连续
+    std::stable_sort(samples.begin(), samples.end(), [](const MetricSample& a, const MetricSample& b) {
+        return a.name < b.name;
+    });
+    return samples;
+}
+
+string_t MetricsRegistry::render_prometheus() const {
+    return format_prometheus(collect());
+}
+
+// 私有方法实现
+MetricsRegistry::Entry& MetricsRegistry::find_or_create(MetricType type, const string_t& name,
+                                                        const string_t& help, const MetricLabels& labels) {
+    // 日志器构造时会注册采集回调，持有mutex_时不能写日志
+    bool type_mismatch = false;
+    Entry* created = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : entries_) {
+            if (entry->name == name && entry->labels == labels) {
+                if (entry->type == type) {
+                    return *entry;
+                }
+                type_mismatch = true;
+            }
+        }
+        created = &create_entry(type, name, help, labels);
+    }
+    
+    if (type_mismatch) {
+        LOG_ERROR_F("MetricsRegistry: metric {} registered with a different type", name);
+    }
+    return *created;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::create_entry(MetricType type, const string_t& name,
+                                                      const string_t& help, const MetricLabels& labels) {
+    auto entry = std::make_unique<Entry>();
+    entry->type = type;
+    entry->name = name;
+    entry->help = help;
+    entry->labels = labels;
+    switch (type) {
+        case MetricType::COUNTER: entry->counter = std::make_unique<Counter>(); break;
+        case MetricType::GAUGE: entry->gauge = std::make_unique<Gauge>(); break;
+        case MetricType::SUMMARY: entry->histogram = std::make_unique<LatencyHistogram>(); break;
+    }
+    entries_.push_back(std::move(entry));
+    return *entries_.back();
+}
+
+string_t format_prometheus(const std::vector<MetricSample>& samples) {
+    std::ostringstream out;
+    const string_t* family = nullptr;
+    
+    for (const auto& sample : samples) {
+        if (family == nullptr || *family != sample.name) {
+            out << "# HELP " << sample.name << ' ' << escape_help(sample.help) << '\n';
+            out << "# TYPE " << sample.name << ' ' << type_name(sample.type) << '\n';
+            family = &sample.name;
+        }
+        
+        if (sample.type != MetricType::SUMMARY) {
+            out << sample.name;
+            write_labels(out, sample.labels);
+            out << ' ' << format_number(sample.value) << '\n';
+            continue;
+        }
+        
+        // 直方图记录的是纳秒，Prometheus约定以秒为单位
+        const HistogramSnapshot& histogram = sample.histogram;
+        for (double quantile : QUANTILES) {
+            out << sample.name;
+            write_labels(out, sample.labels, format_number(quantile).c_str());
+            out << ' ' << format_number(static_cast<double>(histogram.percentile(quantile)) / 1e9) << '\n';
+        }
+        out << sample.name << "_sum";
+        write_labels(out, sample.labels);
+        out << ' ' << format_number(histogram.mean() * static_cast<double>(histogram.count) / 1e9) << '\n';
+        out << sample.name << "_count";
+        write_labels(out, sample.labels);
+        out << ' ' << histogram.count << '\n';
+    }
+    return out.str();
+}
+
+MetricsExporterConfig make_metrics_exporter_config(const ConfigSnapshot& config, const MetricsExporterConfig& base) {
+    MetricsExporterConfig result = base;
+    
+    string_t format = config.get_string("metrics.format");
+    std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+    if (format == "prometheus") {
+        result.format = MetricsFormat::PROMETHEUS;
+    } else if (format == "statsd") {
+        result.format = MetricsFormat::STATSD;
+    } else if (!format.empty()) {
+        LOG_WARN("Unknown metrics.format value: " + format);
+    }
+    
+    result.host = config.get_string("metrics.host", base.host);
+    result.port = config.get_int("metrics.port", base.port);
+    result.push_interval_ms = config.get_int("metrics.push_interval_ms", base.push_interval_ms);
+    result.statsd_prefix = config.get_string("metrics.statsd_prefix", base.statsd_prefix);
+    return result;
+}
+
+// ========== MetricsExporter ==========
+
+MetricsExporter::MetricsExporter(const MetricsExporterConfig& config, MetricsRegistry& registry)
+    : config_(config)
+    , registry_(registry)
+    , socket_(INVALID_SOCKET_HANDLE)
+    , port_(0)
+    , running_(false) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+ErrorCode MetricsExporter::start() {
+    if (running_) {
+        return ErrorCode::SUCCESS;
+    }
+    
+    auto endpoint = Endpoint::parse(config_.host, config_.port);
+    if (!endpoint || config_.port < 0 || config_.port > 65535) {
+        LOG_ERROR_F("MetricsExporter: invalid address {}:{}", config_.host, config_.port);
+        return ErrorCode::INVALID_ADDRESS;
+    }
+    
+    int family = endpoint->is_ipv6() ? AF_INET6 : AF_INET;
+    sockaddr_storage address;
+    socklen_t length = endpoint->to_sockaddr(address, endpoint->is_ipv6());
+    
+    if (config_.format == MetricsFormat::STATSD) {
+        socket_ = ::socket(family, SOCK_DGRAM, IPPROTO_UDP);
+        if (socket_ == INVALID_SOCKET_HANDLE) {
+            LOG_ERROR("MetricsExporter: failed to create StatsD socket");
+            return ErrorCode::SOCKET_CREATE_FAILED;
+        }
+        if (::connect(socket_, reinterpret_cast<const sockaddr*>(&address), length) != 0) {
+            LOG_ERROR_F("MetricsExporter: failed to connect to StatsD server {}", endpoint->to_string());
+            close_socket();
+            return ErrorCode::INVALID_ADDRESS;
+        }
+        statsd_endpoint_ = *endpoint;
+        port_ = endpoint->port();
+        running_ = true;
+        thread_ = std::thread(&MetricsExporter::run_statsd, this);
+        LOG_INFO_F("MetricsExporter: pushing StatsD to {} every {} ms", endpoint->to_string(), config_.push_interval_ms);
+        return ErrorCode::SUCCESS;
+    }
+    
+    socket_ = ::socket(family, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_ == INVALID_SOCKET_HANDLE) {
+        LOG_ERROR("MetricsExporter: failed to create listen socket");
+        return ErrorCode::SOCKET_CREATE_FAILED;
+    }
+    
+    int reuse = 1;
+    setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    if (::bind(socket_, reinterpret_cast<const sockaddr*>(&address), length) != 0 || ::listen(socket_, 16) != 0) {
+        LOG_ERROR_F("MetricsExporter: failed to listen on {}", endpoint->to_string());
+        close_socket();
+        return ErrorCode::SOCKET_BIND_FAILED;
+    }
+    
+    sockaddr_storage bound;
+    socklen_t bound_length = sizeof(bound);
+    if (getsockname(socket_, reinterpret_cast<sockaddr*>(&bound), &bound_length) == 0) {
+        port_ = Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(&bound), bound_length).port();
+    }
+    
+    running_ = true;
+    thread_ = std::thread(&MetricsExporter::serve_prometheus, this);
+    LOG_INFO_F("MetricsExporter: serving Prometheus metrics on {}", endpoint->with_port(port_).to_string());
+    return ErrorCode::SUCCESS;
+}
+
+void MetricsExporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wakeup_mutex_);
+        if (!running_.exchange(false)) {
+            return;
+        }
+    }
+    wakeup_.notify_all();
+    
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close_socket();
+}
+
+std::vector<string_t> MetricsExporter::format_statsd(const std::vector<MetricSample>& samples) {
+    std::vector<string_t> datagrams;
+    string_t current;
+    
+    auto append = [&](const string_t& line) {
+        if (!current.empty() && current.size() + 1 + line.size() > config_.max_datagram_size) {
+            datagrams.push_back(std::move(current));
+            current.clear();
+        }
+        if (!current.empty()) {
+            current += '\n';
+        }
+        current += line;
+    };
+    
+    std::lock_guard<std::mutex> lock(push_mutex_);
+    for (const auto& sample : samples) {
+        switch (sample.type) {
+            case MetricType::COUNTER: {
+                // StatsD计数器是增量，重启后计数归零时直接发送当前值
+                string_t name = statsd_name(config_.statsd_prefix, sample);
+                uint64_t value = static_cast<uint64_t>(sample.value);
+                uint64_t& last = last_counters_[name];
+                uint64_t delta = value >= last ? value - last : value;
+                last = value;
+                if (delta != 0) {
+                    append(name + ":" + std::to_string(delta) + "|c");
+                }
+                break;
+            }
+            case MetricType::GAUGE:
+                append(statsd_name(config_.statsd_prefix, sample) + ":" + format_number(sample.value) + "|g");
+                break;
+            case MetricType::SUMMARY: {
+                // 延迟以毫秒为单位发送
+                const HistogramSnapshot& histogram = sample.histogram;
+                const char* suffixes[] = {"p50", "p90", "p99", "p999"};
+                for (size_t i = 0; i < sizeof(QUANTILES) / sizeof(QUANTILES[0]); ++i) {
+                    double value = static_cast<double>(histogram.percentile(QUANTILES[i])) / 1e6;
+                    append(statsd_name(config_.statsd_prefix, sample, suffixes[i]) + ":" + format_number(value) + "|g");
+                }
+                append(statsd_name(config_.statsd_prefix, sample, "count") + ":" +
+                       std::to_string(histogram.count) + "|g");
+                break;
+            }
+        }
+    }
+    
+    if (!current.empty()) {
+        datagrams.push_back(std::move(current));
+    }
+    return datagrams;
+}
+
+void MetricsExporter::push() {
+    if (config_.format != MetricsFormat::STATSD || socket_ == INVALID_SOCKET_HANDLE) {
+        return;
+    }
+    
+    for (const auto& datagram : format_statsd(registry_.collect())) {
+        if (::send(socket_, datagram.data(), static_cast<int>(datagram.size()), SEND_FLAGS) < 0) {
+            // StatsD服务器未启动时回环上会收到ICMP端口不可达，下一次推送照常进行
+            LOG_DEBUG("MetricsExporter: StatsD push failed");
+            break;
+        }
+    }
+}
+
+// 私有方法实现
+void MetricsExporter::serve_prometheus() {
+    while (running_) {
+        pollfd listener{};
+        listener.fd = socket_;
+        listener.events = POLLIN;
+        // 超时后检查running_，stop()最多等待一个周期
+        int ready = ::poll(&listener, 1, 200);
+        if (ready <= 0) {
+            continue;
+        }
+        
+        socket_handle_t connection = ::accept(socket_, nullptr, nullptr);
+        if (connection == INVALID_SOCKET_HANDLE) {
+            continue;
+        }
+        handle_scrape(connection);
+        close_handle(connection);
+    }
+}
+
+void MetricsExporter::run_statsd() {
+    std::unique_lock<std::mutex> lock(wakeup_mutex_);
+    while (running_) {
+        wakeup_.wait_for(lock, std::chrono::milliseconds(std::max(config_.push_interval_ms, 1)),
+                         [this]() { return !running_; });
+        if (!running_) {
+            break;
+        }
+        
+        lock.unlock();
+        push();
+        lock.lock();
+    }
+}
+
+void MetricsExporter::handle_scrape(socket_handle_t connection) {
+    // 抓取方读取太慢时不阻塞后续抓取
+#ifdef _WIN32
+    DWORD timeout = 1000;
+#else
+    timeval timeout{1, 0};
+#endif
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    
+    string_t request;
+    char buffer[1024];
+    while (request.size() < MAX_REQUEST_SIZE && request.find("\r\n\r\n") == string_t::npos) {
+        auto received = ::recv(connection, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+    
+    size_t line_end = request.find("\r\n");
+    string_t request_line = request.substr(0, line_end);
+    bool found = request_line.rfind("GET /metrics ", 0) == 0 || request_line.rfind("GET /metrics?", 0) == 0;
+    
+    string_t body = found ? registry_.render_prometheus() : "not found\n";
+    std::ostringstream response;
+    response << (found ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n")
+             << "Content-Type: " << (found ? "text/plain; version=0.0.4; charset=utf-8" : "text/plain") << "\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    
+    string_t data = response.str();
+    size_t sent = 0;
+    while (sent < data.size()) {
+        auto written = ::send(connection, data.data() + sent, static_cast<int>(data.size() - sent), SEND_FLAGS);
+        if (written <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(written);
+    }
+}
+
+void MetricsExporter::close_socket() {
+    if (socket_ != INVALID_SOCKET_HANDLE) {
+        close_handle(socket_);
+        socket_ = INVALID_SOCKET_HANDLE;
+    }
+}
+
+} // namespace udp2docker
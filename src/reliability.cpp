@@ -0,0 +1,548 @@
+#include "udp2docker/reliability.h"
+#include "udp2docker/udp_client.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <charconv>
+#include <random>
+
+namespace udp2docker {
+
+namespace {
+
+// 接收方认为对端已重置序列号的距离
+constexpr int32_t SEQUENCE_RESET_DISTANCE = 1 << 16;
+
+inline int32_t sequence_diff(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b);
+}
+
+uint32_t random_sequence() {
+    std::random_device device;
+    return static_cast<uint32_t>(device());
+}
+
+template<typename T>
+bool parse_number(std::string_view text, T& value, int base) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+} // namespace
+
+// TimerWheel 实现
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t slot_count)
+    : slots_(std::max<size_t>(slot_count, 1))
+    , tick_(std::max(tick, std::chrono::milliseconds(1)))
+    , origin_(clock_t::now())
+    , current_tick_(0)
+    , size_(0)
+{
+}
+
+void TimerWheel::schedule(clock_t::time_point deadline, uint64_t token) {
+    // 到期tick向上取整，保证不会提前触发
+    uint64_t expiry = 0;
+    if (deadline > origin_) {
+        auto elapsed = deadline - origin_;
+        expiry = static_cast<uint64_t>((elapsed + tick_ - clock_t::duration(1)) / tick_);
+    }
+    expiry = std::max(expiry, current_tick_);
+    
+    slots_[expiry % slots_.size()].push_back(Item{token, expiry});
+    ++size_;
+}
+
+void TimerWheel::advance(clock_t::time_point now, std::vector<uint64_t>& expired) {
+    if (now < origin_) {
+        return;
+    }
+    uint64_t target = static_cast<uint64_t>((now - origin_) / tick_);
+    if (target < current_tick_) {
+        return;
+    }
+    
+    // 落后超过一圈时每个槽位只需扫描一次
+    uint64_t steps = std::min<uint64_t>(target - current_tick_ + 1, slots_.size());
+    for (uint64_t i = 0; i < steps; ++i) {
+        auto& slot = slots_[(current_tick_ + i) % slots_.size()];
+        size_t kept = 0;
+        for (size_t j = 0; j < slot.size(); ++j) {
+            if (slot[j].expiry_tick <= target) {
+                expired.push_back(slot[j].token);
+            } else {
+                slot[kept++] = slot[j];
+            }
+        }
+        size_ -= slot.size() - kept;
+        slot.resize(kept);
+    }
+    current_tick_ = target + 1;
+}
+
+// RttEstimator 实现
+RttEstimator::RttEstimator(std::chrono::milliseconds initial_rto, std::chrono::milliseconds min_rto,
+                           std::chrono::milliseconds max_rto)
+    : srtt_(0)
+    , rttvar_(0)
+    , rto_(initial_rto)
+    , min_rto_(min_rto)
+    , max_rto_(max_rto)
+    , has_sample_(false)
+{
+}
+
+void RttEstimator::add_sample(std::chrono::microseconds rtt) {
+    if (!has_sample_) {
+        srtt_ = rtt;
+        rttvar_ = rtt / 2;
+        has_sample_ = true;
+    } else {
+        auto delta = srtt_ > rtt ? srtt_ - rtt : rtt - srtt_;
+        rttvar_ = (rttvar_ * 3 + delta) / 4;
+        srtt_ = (srtt_ * 7 + rtt) / 8;
+    }
+    
+    std::chrono::microseconds rto = srtt_ + 4 * rttvar_;
+    rto_ = std::min(std::max(rto, std::chrono::microseconds(min_rto_)), std::chrono::microseconds(max_rto_));
+}
+
+// AckInfo 实现
+bool AckInfo::acknowledges(uint32_t sequence_id) const {
+    int32_t diff = sequence_diff(sequence_id, cumulative);
+    if (diff < 0) {
+        return true;
+    }
+    if (diff == 0 || diff > static_cast<int32_t>(SACK_BITMAP_BITS)) {
+        return false;
+    }
+    return (bitmap & (1ull << (diff - 1))) != 0;
+}
+
+void AckInfo::write_to(MetadataMap& metadata) const {
+    metadata.set("ack", std::to_string(cumulative));
+    if (bitmap != 0) {
+        char text[17];
+        auto result = std::to_chars(text, text + sizeof(text), bitmap, 16);
+        metadata.set("sack", std::string_view(text, static_cast<size_t>(result.ptr - text)));
+    }
+}
+
+std::optional<AckInfo> AckInfo::read_from(const MetadataReader& metadata) {
+    auto ack = metadata.find("ack");
+    if (!ack) {
+        return std::nullopt;
+    }
+    
+    AckInfo info;
+    if (!parse_number(*ack, info.cumulative, 10)) {
+        return std::nullopt;
+    }
+    auto sack = metadata.find("sack");
+    if (sack && !parse_number(*sack, info.bitmap, 16)) {
+        return std::nullopt;
+    }
+    return info;
+}
+
+// ReliableChannel 实现
+ReliableChannel::SendState::SendState(const ReliabilityConfig& config)
+    : next_sequence(random_sequence())
+    , rtt(std::chrono::milliseconds(config.initial_rto_ms), std::chrono::milliseconds(config.min_rto_ms),
+          std::chrono::milliseconds(config.max_rto_ms))
+{
+}
+
+ReliableChannel::ReliableChannel(DatagramSender sender, const ReliabilityConfig& config)
+    : config_(config)
+    , sender_(std::move(sender))
+    , next_pending_id_(1)
+    , timers_(std::chrono::milliseconds(config.timer_tick_ms))
+{
+    config_.window_size = std::min(std::max<size_t>(config_.window_size, 1), SACK_BITMAP_BITS);
+}
+
+ReliableChannel::ReliableChannel(UdpClient& client, ReliabilityConfig config)
+    : ReliableChannel([&client](BufferView datagram, const Endpoint& peer) {
+                          return client.send_to(datagram, peer);
+                      },
+                      [&]() {
+                          config.max_retries = client.get_config().max_retries;
+                          return config;
+                      }())
+{
+}
+
+void ReliableChannel::configure_protocol(const std::function<void(MessageProtocol&)>& configure) {
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        configure(tx_protocol_);
+    }
+    std::lock_guard<std::mutex> lock(rx_mutex_);
+    configure(rx_protocol_);
+}
+
+void ReliableChannel::set_delivery_callback(DeliveryCallback callback) {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    delivery_callback_ = std::move(callback);
+}
+
+Result<uint32_t> ReliableChannel::send(const Message& message, const Endpoint& peer) {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    
+    if (!is_reliable(message.header.type)) {
+        std::optional<buffer_t> frame;
+        std::optional<AckInfo> ack;
+        if (message.header.type == MessageType::RESPONSE) {
+            ack = take_ack(peer, false);
+        }
+        if (ack) {
+            // 捎带确认，省掉一个单独的确认消息
+            Message response = message;
+            ack->write_to(response.metadata);
+            frame = tx_protocol_.serialize(response);
+            counters_.acks_sent.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            frame = tx_protocol_.serialize(message);
+        }
+        if (!frame) {
+            return Result<uint32_t>(ErrorCode::INVALID_PARAMETER);
+        }
+        
+        auto result = sender_(*frame, peer);
+        if (result != ErrorCode::SUCCESS) {
+            return Result<uint32_t>(result);
+        }
+        counters_.unreliable_sent.fetch_add(1, std::memory_order_relaxed);
+        return Result<uint32_t>(static_cast<uint32_t>(message.header.sequence_id));
+    }
+    
+    SendState& state = send_state(peer);
+    // 窗口按序列号跨度计算：最早未确认的消息与新消息的距离不能超出对端的确认位图
+    bool window_full = state.in_flight.size() >= config_.window_size;
+    for (auto it = state.in_flight.begin(); !window_full && it != state.in_flight.end(); ++it) {
+        window_full = sequence_diff(state.next_sequence, it->first) >= static_cast<int32_t>(config_.window_size);
+    }
+    if (window_full) {
+        counters_.window_full.fetch_add(1, std::memory_order_relaxed);
+        return Result<uint32_t>(ErrorCode::QUEUE_FULL);
+    }
+    
+    // 携带窗口起点（最早未确认的序列号），接收方据此确定窗口，
+    // 不会因为第一批消息乱序到达而把较早的消息当作重复
+    uint32_t window_base = state.next_sequence;
+    for (const auto& entry : state.in_flight) {
+        if (sequence_diff(entry.first, window_base) < 0) {
+            window_base = entry.first;
+        }
+    }
+    
+    Message reliable = message;
+    reliable.header.sequence_id = state.next_sequence;
+    reliable.header.flags |= MessageHeader::FLAG_RELIABLE;
+    reliable.metadata.set("base", std::to_string(window_base));
+    auto frame = tx_protocol_.serialize(reliable);
+    if (!frame) {
+        return Result<uint32_t>(ErrorCode::INVALID_PARAMETER);
+    }
+    
+    auto result = sender_(*frame, peer);
+    if (result != ErrorCode::SUCCESS) {
+        return Result<uint32_t>(result);
+    }
+    
+    // 发送成功后才占用序列号，失败的发送由调用方决定是否重试
+    uint32_t sequence_id = state.next_sequence++;
+    auto now = clock_t::now();
+    Pending pending;
+    pending.peer = peer;
+    pending.sequence_id = sequence_id;
+    pending.frame = std::move(*frame);
+    pending.sent_at = now;
+    pending.rto = state.rtt.rto();
+    pending.deadline = now + pending.rto;
+    
+    uint64_t id = next_pending_id_++;
+    timers_.schedule(pending.deadline, id);
+    pending_.emplace(id, std::move(pending));
+    state.in_flight.emplace(sequence_id, id);
+    
+    counters_.reliable_sent.fetch_add(1, std::memory_order_relaxed);
+    return Result<uint32_t>(static_cast<uint32_t>(sequence_id));
+}
+
+ErrorCode ReliableChannel::on_datagram(BufferView datagram, const Endpoint& from,
+                                       const ReliableMessageCallback& callback) {
+    auto now = clock_t::now();
+    std::optional<AckInfo> ack;
+    bool ack_now = false;
+    
+    {
+        std::lock_guard<std::mutex> lock(rx_mutex_);
+        auto view = rx_protocol_.deserialize_view(datagram);
+        if (!view) {
+            return ErrorCode::PROTOCOL_ERROR;
+        }
+        
+        bool deliver = true;
+        if (view->header.type == MessageType::RESPONSE) {
+            ack = AckInfo::read_from(view->metadata);
+            deliver = !(ack && view->payload.empty());
+        }
+        
+        if ((view->header.flags & MessageHeader::FLAG_RELIABLE) != 0) {
+            auto base_text = view->metadata.find("base");
+            uint32_t window_base = 0;
+            bool has_base = base_text && parse_number(*base_text, window_base, 10);
+            auto outcome = record_received(from, view->header.sequence_id, window_base, has_base, now, ack_now);
+            if (outcome == ReceiveOutcome::DUPLICATE) {
+                counters_.duplicates.fetch_add(1, std::memory_order_relaxed);
+            }
+            deliver = deliver && outcome == ReceiveOutcome::NEW;
+        }
+        
+        // 视图指向rx_protocol_的缓冲区，回调必须在持有rx_mutex_时调用
+        if (deliver && callback) {
+            callback(*view, from);
+        }
+    }
+    
+    if (ack) {
+        std::vector<Delivery> deliveries;
+        {
+            std::lock_guard<std::mutex> lock(tx_mutex_);
+            handle_ack(from, *ack, now, deliveries);
+        }
+        notify(deliveries);
+    }
+    
+    if (ack_now) {
+        auto info = take_ack(from, true);
+        if (info) {
+            send_ack(from, *info);
+        }
+    }
+    return ErrorCode::SUCCESS;
+}
+
+void ReliableChannel::tick(clock_t::time_point now) {
+    std::vector<Delivery> deliveries;
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        expired_.clear();
+        timers_.advance(now, expired_);
+        
+        for (uint64_t id : expired_) {
+            auto it = pending_.find(id);
+            // 已确认的消息不从时间轮删除，到期时在这里忽略
+            if (it == pending_.end() || it->second.deadline > now) {
+                continue;
+            }
+            
+            Pending& pending = it->second;
+            if (pending.retries >= config_.max_retries) {
+                auto state = send_states_.find(pending.peer);
+                if (state != send_states_.end()) {
+                    state->second.in_flight.erase(pending.sequence_id);
+                }
+                deliveries.push_back(Delivery{pending.sequence_id, pending.peer, ErrorCode::TIMEOUT});
+                counters_.timed_out.fetch_add(1, std::memory_order_relaxed);
+                LOG_WARN_F("Reliable message {} to {} timed out after {} retries",
+                           pending.sequence_id, pending.peer.to_string(), pending.retries);
+                pending_.erase(it);
+                continue;
+            }
+            
+            sender_(pending.frame, pending.peer);
+            ++pending.retries;
+            pending.rto = std::min(pending.rto * 2, std::chrono::microseconds(
+                std::chrono::milliseconds(config_.max_rto_ms)));
+            pending.sent_at = now;
+            pending.deadline = now + pending.rto;
+            timers_.schedule(pending.deadline, id);
+            counters_.retransmissions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    notify(deliveries);
+    
+    if (config_.ack_delay_ms <= 0) {
+        return;
+    }
+    
+    std::vector<std::pair<Endpoint, AckInfo>> acks;
+    {
+        std::lock_guard<std::mutex> lock(ack_mutex_);
+        for (auto& [peer, state] : receive_states_) {
+            if (state.ack_pending && state.ack_deadline <= now) {
+                state.ack_pending = false;
+                acks.emplace_back(peer, AckInfo{state.next_expected, state.bitmap});
+            }
+        }
+    }
+    for (const auto& [peer, ack] : acks) {
+        send_ack(peer, ack);
+    }
+}
+
+size_t ReliableChannel::in_flight(const Endpoint& peer) const {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    auto it = send_states_.find(peer);
+    return it == send_states_.end() ? 0 : it->second.in_flight.size();
+}
+
+std::chrono::microseconds ReliableChannel::smoothed_rtt(const Endpoint& peer) const {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    auto it = send_states_.find(peer);
+    return it == send_states_.end() ? std::chrono::microseconds(0) : it->second.rtt.smoothed_rtt();
+}
+
+ReliableChannel::Statistics ReliableChannel::get_statistics() const {
+    Statistics result;
+    result.reliable_sent = counters_.reliable_sent.load(std::memory_order_relaxed);
+    result.unreliable_sent = counters_.unreliable_sent.load(std::memory_order_relaxed);
+    result.retransmissions = counters_.retransmissions.load(std::memory_order_relaxed);
+    result.delivered = counters_.delivered.load(std::memory_order_relaxed);
+    result.timed_out = counters_.timed_out.load(std::memory_order_relaxed);
+    result.window_full = counters_.window_full.load(std::memory_order_relaxed);
+    result.duplicates = counters_.duplicates.load(std::memory_order_relaxed);
+    result.acks_sent = counters_.acks_sent.load(std::memory_order_relaxed);
+    result.acks_received = counters_.acks_received.load(std::memory_order_relaxed);
+    return result;
+}
+
+// 私有方法实现
+ReliableChannel::ReceiveOutcome ReliableChannel::record_received(const Endpoint& from, uint32_t sequence_id,
+                                                                 uint32_t window_base, bool has_base,
+                                                                 clock_t::time_point now, bool& ack_now) {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    auto [it, inserted] = receive_states_.try_emplace(from);
+    ReceiveState& state = it->second;
+    
+    // 窗口起点只在不晚于本消息、且在确认位图范围内时可信
+    int32_t base_offset = sequence_diff(sequence_id, window_base);
+    if (base_offset < 0 || base_offset > static_cast<int32_t>(SACK_BITMAP_BITS)) {
+        has_base = false;
+    }
+    
+    int32_t diff = sequence_diff(sequence_id, state.next_expected);
+    if (inserted || diff > SEQUENCE_RESET_DISTANCE || diff < -SEQUENCE_RESET_DISTANCE) {
+        // 第一次收到或对端重启后换了初始序列号：窗口从发送方的窗口起点开始
+        state.next_expected = has_base ? window_base : sequence_id;
+        state.bitmap = 0;
+    } else if (has_base && sequence_diff(window_base, state.next_expected) > 0) {
+        // 起点之前的消息发送方已收到确认或放弃重传，不会再到达
+        uint32_t shift = static_cast<uint32_t>(sequence_diff(window_base, state.next_expected));
+        bool base_received = shift <= SACK_BITMAP_BITS && (state.bitmap & (1ull << (shift - 1))) != 0;
+        state.bitmap = shift < SACK_BITMAP_BITS ? state.bitmap >> shift : 0;
+        state.next_expected = window_base;
+        if (base_received) {
+            advance_window(state);
+        }
+    }
+    diff = sequence_diff(sequence_id, state.next_expected);
+    
+    ReceiveOutcome outcome;
+    if (diff < 0) {
+        outcome = ReceiveOutcome::DUPLICATE;
+    } else if (diff == 0) {
+        advance_window(state);
+        outcome = ReceiveOutcome::NEW;
+    } else if (diff <= static_cast<int32_t>(SACK_BITMAP_BITS)) {
+        uint64_t bit = 1ull << (diff - 1);
+        outcome = (state.bitmap & bit) != 0 ? ReceiveOutcome::DUPLICATE : ReceiveOutcome::NEW;
+        state.bitmap |= bit;
+    } else {
+        return ReceiveOutcome::OUT_OF_WINDOW;
+    }
+    
+    // 重复消息说明对端没收到确认，立即重发
+    if (!state.ack_pending) {
+        state.ack_pending = true;
+        state.ack_deadline = now + std::chrono::milliseconds(config_.ack_delay_ms);
+    }
+    ack_now = config_.ack_delay_ms <= 0 || outcome == ReceiveOutcome::DUPLICATE;
+    return outcome;
+}
+
+void ReliableChannel::advance_window(ReceiveState& state) {
+    // next_expected已收到：前移窗口，吸收位图中已连续的部分
+    ++state.next_expected;
+    while ((state.bitmap & 1) != 0) {
+        state.bitmap >>= 1;
+        ++state.next_expected;
+    }
+    state.bitmap >>= 1;
+}
+
+std::optional<AckInfo> ReliableChannel::take_ack(const Endpoint& peer, bool force) {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    auto it = receive_states_.find(peer);
+    if (it == receive_states_.end() || (!force && !it->second.ack_pending)) {
+        return std::nullopt;
+    }
+    it->second.ack_pending = false;
+    return AckInfo{it->second.next_expected, it->second.bitmap};
+}
+
+void ReliableChannel::send_ack(const Endpoint& peer, const AckInfo& ack) {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    Message response = tx_protocol_.create_response_message(ack.cumulative - 1, buffer_t());
+    ack.write_to(response.metadata);
+    auto frame = tx_protocol_.serialize(response);
+    if (frame && sender_(*frame, peer) == ErrorCode::SUCCESS) {
+        counters_.acks_sent.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ReliableChannel::handle_ack(const Endpoint& from, const AckInfo& ack, clock_t::time_point now,
+                                 std::vector<Delivery>& deliveries) {
+    counters_.acks_received.fetch_add(1, std::memory_order_relaxed);
+    auto state = send_states_.find(from);
+    if (state == send_states_.end()) {
+        return;
+    }
+    
+    auto& in_flight = state->second.in_flight;
+    for (auto it = in_flight.begin(); it != in_flight.end();) {
+        if (!ack.acknowledges(it->first)) {
+            ++it;
+            continue;
+        }
+        
+        auto pending = pending_.find(it->second);
+        if (pending != pending_.end()) {
+            // Karn算法：重传过的消息无法区分确认对应哪一次发送，不采样
+            if (pending->second.retries == 0) {
+                state->second.rtt.add_sample(
+                    std::chrono::duration_cast<std::chrono::microseconds>(now - pending->second.sent_at));
+            }
+            pending_.erase(pending);
+        }
+        deliveries.push_back(Delivery{it->first, from, ErrorCode::SUCCESS});
+        counters_.delivered.fetch_add(1, std::memory_order_relaxed);
+        it = in_flight.erase(it);
+    }
+}
+
+void ReliableChannel::notify(const std::vector<Delivery>& deliveries) {
+    if (deliveries.empty()) {
+        return;
+    }
+    
+    DeliveryCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(tx_mutex_);
+        callback = delivery_callback_;
+    }
+    if (!callback) {
+        return;
+    }
+    for (const auto& delivery : deliveries) {
+        callback(delivery.sequence_id, delivery.peer, delivery.result);
+    }
+}
+
+ReliableChannel::SendState& ReliableChannel::send_state(const Endpoint& peer) {
+    return send_states_.try_emplace(peer, config_).first->second;
+}
+
+} // namespace udp2docker
@@ -0,0 +1,62 @@
+#include "udp2docker/send_scheduler.h"
+#include "udp2docker/message_protocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace udp2docker {
+
+// 消息头中优先级字段的偏移（魔数4字节 + 版本2字节 + 类型2字节）
+constexpr size_t PRIORITY_OFFSET = 8;
+
+Priority classify_priority(BufferView data) {
+    if (data.size < PRIORITY_OFFSET + sizeof(uint16_t)) {
+        return Priority::NORMAL;
+    }
+    
+    uint32_t magic;
+    std::memcpy(&magic, data.data, sizeof(magic));
+    if (magic != MessageHeader().magic_number) {
+        return Priority::NORMAL;
+    }
+    
+    uint16_t value;
+    std::memcpy(&value, data.data + PRIORITY_OFFSET, sizeof(value));
+    Priority priority = static_cast<Priority>(value);
+    return priority_index(priority) == static_cast<size_t>(value) - 1 ? priority : Priority::NORMAL;
+}
+
+// TokenBucket 实现
+TokenBucket::TokenBucket(double rate_bytes_per_sec, size_t burst_bytes)
+    : rate_(rate_bytes_per_sec)
+    , burst_(static_cast<double>(std::max<size_t>(burst_bytes, 1)))
+    , tokens_(static_cast<double>(std::max<size_t>(burst_bytes, 1)))
+    , started_(false)
+{
+}
+
+bool TokenBucket::try_consume(size_t bytes, clock_t::time_point now, std::chrono::nanoseconds& wait) {
+    if (unlimited()) {
+        return true;
+    }
+    
+    if (!started_) {
+        last_refill_ = now;
+        started_ = true;
+    } else if (now > last_refill_) {
+        double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+        tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+        last_refill_ = now;
+    }
+    
+    // 大于桶容量的数据包只需等到桶满
+    double needed = std::min(static_cast<double>(bytes), burst_);
+    if (tokens_ >= needed) {
+        tokens_ -= static_cast<double>(bytes);
+        return true;
+    }
+    
+    wait = std::chrono::nanoseconds(static_cast<int64_t>((needed - tokens_) / rate_ * 1e9) + 1);
+    return false;
+}
+
+} // namespace udp2docker
@@ -0,0 +1,171 @@
+#include "udp2docker/statistics.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <time.h>
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+inline size_t highest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<size_t>(__builtin_clzll(value));
+#else
+    size_t bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+uint64_t bucket_lower_bound(size_t index) {
+    if (index < LatencyHistogram::SUB_BUCKETS) {
+        return index;
+    }
+    size_t shift = index / LatencyHistogram::SUB_BUCKETS - 1;
+    uint64_t sub = index % LatencyHistogram::SUB_BUCKETS;
+    return (LatencyHistogram::SUB_BUCKETS + sub) << shift;
+}
+
+} // namespace
+
+time_point_t coarse_now() {
+#if defined(__linux__) && defined(CLOCK_REALTIME_COARSE)
+    timespec now;
+    if (clock_gettime(CLOCK_REALTIME_COARSE, &now) == 0) {
+        auto since_epoch = std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+        return time_point_t(std::chrono::duration_cast<time_point_t::duration>(since_epoch));
+    }
+#endif
+    return std::chrono::system_clock::now();
+}
+
+namespace detail {
+
+size_t stats_stripe_index() {
+    static std::atomic<size_t> next_index{0};
+    thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % STATS_STRIPES;
+    return index;
+}
+
+} // namespace detail
+
+// HistogramSnapshot 实现
+uint64_t HistogramSnapshot::percentile(double quantile) const {
+    if (count == 0) {
+        return 0;
+    }
+    
+    quantile = std::min(std::max(quantile, 0.0), 1.0);
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(count));
+    if (rank == 0) {
+        rank = 1;
+    }
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // 桶上界不超过实际观测到的最大值
+            return std::min(LatencyHistogram::bucket_upper_bound(i), max);
+        }
+    }
+    return max;
+}
+
+double HistogramSnapshot::mean() const {
+    if (count == 0) {
+        return 0.0;
+    }
+    
+    double total = 0.0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            double middle = (static_cast<double>(bucket_lower_bound(i)) +
+                             static_cast<double>(LatencyHistogram::bucket_upper_bound(i))) / 2.0;
+            total += middle * static_cast<double>(counts[i]);
+        }
+    }
+    return total / static_cast<double>(count);
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    if (counts.size() < other.counts.size()) {
+        counts.resize(other.counts.size(), 0);
+    }
+    for (size_t i = 0; i < other.counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+    count += other.count;
+    max = std::max(max, other.max);
+}
+
+// LatencyHistogram 实现
+LatencyHistogram::LatencyHistogram()
+    : max_(0)
+{
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot result;
+    result.counts.resize(BUCKET_COUNT);
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        result.counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        result.count += result.counts[i];
+    }
+    result.max = max_.load(std::memory_order_relaxed);
+    return result;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::assign(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        buckets_[i].store(other.buckets_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    max_.store(other.max_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    
+    size_t magnitude = highest_bit(value);
+    if (magnitude > MAX_MAGNITUDE) {
+        return BUCKET_COUNT - 1;
+    }
+    
+    // 最高位之后的4位选择子桶
+    size_t shift = magnitude - 4;
+    return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index + 1;
+    }
+    size_t shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub + 1) << shift;
+}
+
+void LatencyHistogram::update_max(uint64_t value) {
+    uint64_t current = max_.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace udp2docker
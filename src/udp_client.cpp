@@ -1,8 +1,11 @@
 #include "udp2docker/udp_client.h"
+#include "udp2docker/config_manager.h"
+#include "udp2docker/io_uring.h"
 #include "udp2docker/logger.h"
 #include <sstream>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -11,26 +14,271 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netdb.h>
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <netinet/udp.h>
+#include <linux/net_tstamp.h>
+#include <time.h>
+#endif
+#endif
+
+#ifndef _WIN32
+#ifndef SOCKET_ERROR
+#define SOCKET_ERROR (-1)
+#endif
+#endif
+
+#ifdef __linux__
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
 #endif
 
 namespace udp2docker {
 
+namespace {
+
+/**
+ * @brief 解析主机名（阻塞）
+ * @param host 主机名
+ * @param family 查询的地址族（AF_INET、AF_INET6或AF_UNSPEC）
+ * @param endpoint 解析结果（端口为0）
+ */
+ErrorCode resolve_host(const string_t& host, int family, Endpoint& endpoint) {
+    addrinfo hints{};
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+    
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &results) != 0 || results == nullptr) {
+        return ErrorCode::INVALID_ADDRESS;
+    }
+    
+    // AF_UNSPEC查询时优先IPv4结果，保持与纯IPv4部署相同的选址；只有AAAA记录时使用IPv6
+    endpoint = Endpoint();
+    for (addrinfo* item = results; item != nullptr; item = item->ai_next) {
+        Endpoint candidate = Endpoint::from_sockaddr(item->ai_addr, item->ai_addrlen);
+        if (candidate.is_ipv4() || (candidate.valid() && !endpoint.valid())) {
+            endpoint = candidate;
+        }
+        if (endpoint.is_ipv4()) {
+            break;
+        }
+    }
+    freeaddrinfo(results);
+    return endpoint.valid() ? ErrorCode::SUCCESS : ErrorCode::INVALID_ADDRESS;
+}
+
+// DSCP占TOS字节的高6位，低2位是ECN
+int dscp_to_tos(int dscp) {
+    return dscp >= 0 && dscp <= 63 ? dscp << 2 : -1;
+}
+
+bool operator!=(const SchedulerConfig& a, const SchedulerConfig& b) {
+    return a.queue_capacity != b.queue_capacity || a.weights != b.weights || a.quantum_bytes != b.quantum_bytes ||
+           a.rate_limits != b.rate_limits || a.burst_bytes != b.burst_bytes;
+}
+
+/**
+ * @brief 列出只在initialize()时生效、且两份配置不同的配置项
+ * @return 以逗号分隔的UdpConfig成员名，没有时为空
+ */
+string_t pending_fields(const UdpConfig& current, const UdpConfig& updated) {
+    std::ostringstream fields;
+    auto check = [&fields](bool changed, const char* name) {
+        if (changed) {
+            fields << (fields.tellp() > 0 ? ", " : "") << name;
+        }
+    };
+    check(current.enable_gso != updated.enable_gso, "enable_gso");
+    check(current.receive_batch_size != updated.receive_batch_size, "receive_batch_size");
+    check(current.max_batches_per_wakeup != updated.max_batches_per_wakeup, "max_batches_per_wakeup");
+    check(current.send_queue_capacity != updated.send_queue_capacity, "send_queue_capacity");
+    check(current.send_worker_threads != updated.send_worker_threads, "send_worker_threads");
+    check(current.send_backpressure != updated.send_backpressure, "send_backpressure");
+    check(current.enable_priority_scheduling != updated.enable_priority_scheduling, "enable_priority_scheduling");
+    check(current.scheduler != updated.scheduler, "scheduler");
+    check(current.local_host != updated.local_host, "local_host");
+    check(current.local_port != updated.local_port, "local_port");
+    check(current.reuse_port != updated.reuse_port, "reuse_port");
+    check(current.receive_cpu != updated.receive_cpu, "receive_cpu");
+    check(current.incoming_cpu != updated.incoming_cpu, "incoming_cpu");
+    check(current.enable_latency_histograms != updated.enable_latency_histograms, "enable_latency_histograms");
+    check(current.enable_metrics != updated.enable_metrics, "enable_metrics");
+    check(current.ip_family != updated.ip_family, "ip_family");
+    check(current.receive_buffer_size != updated.receive_buffer_size, "receive_buffer_size");
+    check(current.send_buffer_size != updated.send_buffer_size, "send_buffer_size");
+    check(current.busy_poll_us != updated.busy_poll_us, "busy_poll_us");
+    check(current.dscp != updated.dscp, "dscp");
+    check(current.priority_dscp != updated.priority_dscp, "priority_dscp");
+    check(current.receive_timestamps != updated.receive_timestamps, "receive_timestamps");
+    check(current.mtu_discovery != updated.mtu_discovery, "mtu_discovery");
+    check(current.io_engine != updated.io_engine, "io_engine");
+    check(current.io_uring_buffers != updated.io_uring_buffers, "io_uring_buffers");
+    check(current.capture_file != updated.capture_file, "capture_file");
+    check(current.capture_capacity_mb != updated.capture_capacity_mb, "capture_capacity_mb");
+    return fields.str();
+}
+
+} // namespace
+
+UdpConfig make_udp_config(const ConfigSnapshot& config, const UdpConfig& base) {
+    UdpConfig result = base;
+    result.server_host = config.get_string("server.host", base.server_host);
+    result.server_port = config.get_int("server.port", base.server_port);
+    result.timeout_ms = config.get_int("client.timeout_ms", base.timeout_ms);
+    result.max_retries = static_cast<size_t>(std::max(
+        config.get_int("client.max_retries", static_cast<int>(base.max_retries)), 0));
+    result.enable_keep_alive = config.get_bool("client.enable_keep_alive", base.enable_keep_alive);
+    result.enable_metrics = config.get_bool("client.enable_metrics", base.enable_metrics);
+    result.capture_file = config.get_string("client.capture_file", base.capture_file);
+    result.capture_capacity_mb = static_cast<size_t>(std::max(
+        config.get_int("client.capture_capacity_mb", static_cast<int>(base.capture_capacity_mb)), 1));
+    result.keep_alive_interval_ms = config.get_int("client.keep_alive_interval_ms", base.keep_alive_interval_ms);
+    
+    result.receive_buffer_size = config.get_int("socket.receive_buffer_size", base.receive_buffer_size);
+    result.send_buffer_size = config.get_int("socket.send_buffer_size", base.send_buffer_size);
+    result.busy_poll_us = config.get_int("socket.busy_poll_us", base.busy_poll_us);
+    result.dscp = config.get_int("socket.dscp", base.dscp);
+    const char* priority_keys[PRIORITY_LEVELS] = {
+        "socket.dscp_low", "socket.dscp_normal", "socket.dscp_high", "socket.dscp_critical"
+    };
+    for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+        result.priority_dscp[i] = config.get_int(priority_keys[i], base.priority_dscp[i]);
+    }
+    
+    string_t timestamps = config.get_string("socket.receive_timestamps");
+    std::transform(timestamps.begin(), timestamps.end(), timestamps.begin(), ::tolower);
+    if (timestamps == "none") {
+        result.receive_timestamps = ReceiveTimestamps::NONE;
+    } else if (timestamps == "software") {
+        result.receive_timestamps = ReceiveTimestamps::SOFTWARE;
+    } else if (timestamps == "hardware") {
+        result.receive_timestamps = ReceiveTimestamps::HARDWARE;
+    } else if (!timestamps.empty()) {
+        LOG_WARN("Unknown socket.receive_timestamps value: " + timestamps);
+    }
+    
+    string_t discovery = config.get_string("socket.mtu_discovery");
+    std::transform(discovery.begin(), discovery.end(), discovery.begin(), ::tolower);
+    if (discovery == "system") {
+        result.mtu_discovery = PathMtuDiscovery::SYSTEM;
+    } else if (discovery == "dont") {
+        result.mtu_discovery = PathMtuDiscovery::DONT;
+    } else if (discovery == "do") {
+        result.mtu_discovery = PathMtuDiscovery::DO;
+    } else if (discovery == "probe") {
+        result.mtu_discovery = PathMtuDiscovery::PROBE;
+    } else if (!discovery.empty()) {
+        LOG_WARN("Unknown socket.mtu_discovery value: " + discovery);
+    }
+    
+    string_t engine = config.get_string("socket.io_engine");
+    std::transform(engine.begin(), engine.end(), engine.begin(), ::tolower);
+    if (engine == "socket") {
+        result.io_engine = IoEngine::SOCKET;
+    } else if (engine == "io_uring") {
+        result.io_engine = IoEngine::IO_URING;
+    } else if (!engine.empty()) {
+        LOG_WARN("Unknown socket.io_engine value: " + engine);
+    }
+    result.io_uring_buffers = static_cast<size_t>(std::max(
+        config.get_int("socket.io_uring_buffers", static_cast<int>(base.io_uring_buffers)), 1));
+    
+    return result;
+}
+
+// ReceiveRing 实现
+ReceiveRing::ReceiveRing(size_t slot_count, size_t slot_size)
+    : slot_count_(std::max<size_t>(slot_count, 1))
+    , slot_size_(std::max<size_t>(slot_size, 1))
+    , count_(0)
+    , storage_(slot_count_ * slot_size_)
+    , packets_(slot_count_)
+    , names_(slot_count_)
+#ifdef __linux__
+    , msgs_(slot_count_)
+    , iovs_(slot_count_)
+    , controls_(slot_count_ * CONTROL_WORDS)
+#endif
+{
+#ifdef __linux__
+    // msghdr在两次接收之间只有长度字段会被内核改写，其余字段预先设置好
+    for (size_t i = 0; i < slot_count_; ++i) {
+        iovs_[i].iov_base = slot(i);
+        iovs_[i].iov_len = slot_size_;
+        msgs_[i].msg_hdr.msg_iov = &iovs_[i];
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+        msgs_[i].msg_hdr.msg_name = &names_[i];
+    }
+#endif
+}
+
+#ifdef __linux__
+uint64_t ReceiveRing::kernel_timestamp(const msghdr& header) {
+    // SCM_TIMESTAMPING携带三个时间戳：[0]软件，[2]网卡原始硬件时间
+    uint64_t timestamp = 0;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING &&
+            cmsg->cmsg_len >= CMSG_LEN(3 * sizeof(timespec))) {
+            timespec stamps[3];
+            std::memcpy(stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            const timespec& stamp = (stamps[2].tv_sec != 0 || stamps[2].tv_nsec != 0) ? stamps[2] : stamps[0];
+            timestamp = static_cast<uint64_t>(stamp.tv_sec) * 1000000000ull + static_cast<uint64_t>(stamp.tv_nsec);
+        }
+    }
+    return timestamp;
+}
+#endif
+
 UdpClient::UdpClient(const UdpConfig& config)
     : config_(config)
+    , config_live_(false)
+    , default_peer_(std::make_shared<DefaultPeer>())
 #ifdef _WIN32
     , socket_(INVALID_SOCKET)
 #else
     , socket_(-1)
 #endif
+    , socket_ipv6_(false)
+    , priority_tos_enabled_(false)
     , is_initialized_(false)
     , is_receiving_(false)
-    , should_stop_(false)
+    , gso_supported_(true)
+    , owns_event_loop_(false)
+    , keep_alive_timer_(0)
+    , idle_send_workers_(0)
+    , blocked_senders_(0)
+    , send_stopping_(false)
+    , send_workers_running_(false)
+    , metrics_collector_(0)
+    , capture_(std::make_unique<CaptureWriter>())
+    , capture_enabled_(false)
+    , default_state_(ResolveState::UNRESOLVED)
+    , default_connected_(false)
+    , connection_generation_(0)
+    , timeout_ms_(config.timeout_ms)
+    , resolve_generation_(0)
+    , address_refresher_stopping_(false)
 {
     LOG_DEBUG("UdpClient created with server: " + config_.server_host + ":" + std::to_string(config_.server_port));
-    stats_.last_activity = std::chrono::system_clock::now();
+    priority_tos_.fill(-1);
+    touch_activity(stats_[0]);
 }
 
 UdpClient::~UdpClient() {
@@ -39,40 +287,54 @@ UdpClient::~UdpClient() {
 }
 
 UdpClient::UdpClient(UdpClient&& other) noexcept
-    : config_(std::move(other.config_))
-    , socket_(other.socket_)
-    , is_initialized_(other.is_initialized_.load())
-    , is_receiving_(other.is_receiving_.load())
-    , should_stop_(other.should_stop_.load())
-    , stats_(std::move(other.stats_))
-    , receive_thread_(std::move(other.receive_thread_))
-    , keep_alive_thread_(std::move(other.keep_alive_thread_))
-    , message_callback_(std::move(other.message_callback_))
-    , error_callback_(std::move(other.error_callback_))
+    : UdpClient(other.config_)
 {
-#ifdef _WIN32
-    other.socket_ = INVALID_SOCKET;
-#else
-    other.socket_ = -1;
-#endif
-    other.is_initialized_ = false;
-    other.is_receiving_ = false;
+    *this = std::move(other);
 }
 
 UdpClient& UdpClient::operator=(UdpClient&& other) noexcept {
     if (this != &other) {
         close();
         
+        // 事件循环处理函数、发送线程和解析线程都绑定了对象地址，移动前必须先停止
+        other.stop_receive_async();
+        other.stop_send_workers();
+        other.stop_resolver();
+        other.stop_address_refresher();
+        other.unregister_metrics();
+        
+        // 抓包写入器随对象移动，被移动的对象换回本对象已关闭的写入器
+        capture_.swap(other.capture_);
+        capture_enabled_.store(other.capture_enabled_.exchange(false), std::memory_order_release);
+        
         config_ = std::move(other.config_);
+        pending_config_ = std::move(other.pending_config_);
+        config_live_ = other.config_live_;
+        other.config_live_ = false;
+        default_peer_ = other.default_peer_;
         socket_ = other.socket_;
+        socket_ipv6_ = other.socket_ipv6_;
+        priority_tos_ = other.priority_tos_;
+        priority_tos_enabled_ = other.priority_tos_enabled_;
         is_initialized_ = other.is_initialized_.load();
-        is_receiving_ = other.is_receiving_.load();
-        should_stop_ = other.should_stop_.load();
-        stats_ = std::move(other.stats_);
-        receive_thread_ = std::move(other.receive_thread_);
-        keep_alive_thread_ = std::move(other.keep_alive_thread_);
+        send_stopping_ = false;
+        is_receiving_ = false;
+        gso_supported_ = other.gso_supported_.load();
+        for (size_t i = 0; i < STATS_STRIPES; ++i) {
+            stats_[i].assign(other.stats_[i]);
+        }
+        send_latency_.assign(other.send_latency_);
+        callback_latency_.assign(other.callback_latency_);
+        event_loop_ = std::move(other.event_loop_);
+        owns_event_loop_ = other.owns_event_loop_;
         message_callback_ = std::move(other.message_callback_);
+        endpoint_callback_ = std::move(other.endpoint_callback_);
+        packet_callback_ = std::move(other.packet_callback_);
         error_callback_ = std::move(other.error_callback_);
+        default_state_ = other.default_state_.load();
+        default_connected_ = other.default_connected_.load();
+        connection_generation_ = other.connection_generation_;
+        timeout_ms_ = other.timeout_ms_.load();
         
 #ifdef _WIN32
         other.socket_ = INVALID_SOCKET;
@@ -80,12 +342,18 @@ UdpClient& UdpClient::operator=(UdpClient&& other) noexcept {
         other.socket_ = -1;
 #endif
         other.is_initialized_ = false;
-        other.is_receiving_ = false;
+        other.owns_event_loop_ = false;
+        
+        if (is_initialized_) {
+            register_metrics();
+        }
     }
     return *this;
 }
 
 ErrorCode UdpClient::initialize() {
+    // 初始化期间update_config()等待，不会与init_socket()等读取配置的代码并发
+    std::unique_lock<std::mutex> lock(config_mutex_);
     if (is_initialized_) {
         LOG_WARN("UdpClient already initialized");
         return ErrorCode::SUCCESS;
@@ -93,10 +361,27 @@ ErrorCode UdpClient::initialize() {
     
     LOG_INFO("Initializing UdpClient...");
     
+    if (pending_config_) {
+        config_ = std::move(*pending_config_);
+        pending_config_.reset();
+    }
+    
     auto result = init_socket();
     if (result == ErrorCode::SUCCESS) {
         is_initialized_ = true;
+        send_stopping_ = false;
+        config_live_ = true;
+        std::thread stale_resolver = start_default_resolution();
+        register_metrics();
+        if (!config_.capture_file.empty()) {
+            CaptureConfig capture;
+            capture.path = config_.capture_file;
+            capture.capacity_bytes = config_.capture_capacity_mb * 1024 * 1024;
+            start_capture(capture);
+        }
         LOG_INFO("UdpClient initialized successfully");
+        lock.unlock();
+        join_stale_resolver(stale_resolver);
     } else {
         LOG_ERROR("Failed to initialize UdpClient: " + std::to_string(static_cast<int>(result)));
     }
@@ -111,20 +396,25 @@ void UdpClient::close() {
     
     LOG_INFO("Closing UdpClient...");
     
-    should_stop_ = true;
-    stop_receive_async();
-    
-    // 等待线程结束
-    if (receive_thread_.joinable()) {
-        receive_thread_.join();
+    {
+        // 之后的update_config()只保存配置，不再重启解析线程、设置超时或修改心跳定时器
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        config_live_ = false;
     }
     
-    if (keep_alive_thread_.joinable()) {
-        keep_alive_thread_.join();
-    }
+    unregister_metrics();
+    stop_receive_async();
+    
+    // 先发送完队列中剩余的数据，再关闭套接字
+    stop_send_workers();
+    stop_resolver();
+    stop_address_refresher();
     
     cleanup_socket();
+    stop_capture();
     is_initialized_ = false;
+    default_state_ = ResolveState::UNRESOLVED;
+    default_connected_ = false;
     
     LOG_INFO("UdpClient closed");
 }
@@ -134,6 +424,14 @@ bool UdpClient::is_connected() const {
 }
 
 ErrorCode UdpClient::send(const buffer_t& data, const string_t& target_host, int target_port) {
+    return send_view(BufferView(data), target_host, target_port);
+}
+
+ErrorCode UdpClient::send(const PooledBuffer& data, const string_t& target_host, int target_port) {
+    return send_view(data.view(), target_host, target_port);
+}
+
+ErrorCode UdpClient::send_view(BufferView data, const string_t& target_host, int target_port) {
     if (!is_initialized_) {
         LOG_ERROR("UdpClient not initialized");
         return ErrorCode::SOCKET_INIT_FAILED;
@@ -144,16 +442,28 @@ ErrorCode UdpClient::send(const buffer_t& data, const string_t& target_host, int
         return ErrorCode::INVALID_PARAMETER;
     }
     
-    string_t host = target_host.empty() ? config_.server_host : target_host;
-    int port = target_port == 0 ? config_.server_port : target_port;
+    LOG_DEBUG_F("Sending {} bytes to {}:{}", data.size,
+                target_host.empty() ? default_peer()->host : target_host,
+                target_port == 0 ? default_peer()->port : target_port);
     
-    LOG_DEBUG("Sending " + std::to_string(data.size()) + " bytes to " + host + ":" + std::to_string(port));
+    SendTarget target;
+    auto resolved = resolve_target(target_host, target_port, target);
+    if (resolved != ErrorCode::SUCCESS) {
+        update_stats_error(true);
+        return resolved;
+    }
+    auto connection = hold_connection(target);
     
-    auto addr = create_address(host, port);
+    if (priority_tos_enabled_) {
+        // 按优先级设置DSCP需要随数据包携带控制消息
+        return send_gather_target(&data, 1, target);
+    }
     
-    int result = sendto(socket_, reinterpret_cast<const char*>(data.data()), 
-                       static_cast<int>(data.size()), 0,
-                       reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    uint64_t started = latency_start();
+    int result = sendto(socket_, reinterpret_cast<const char*>(data.data), 
+                       static_cast<int>(data.size), 0,
+                       target.name(), target.name_length());
+    record_latency(send_latency_, started);
     
     if (result == SOCKET_ERROR || result < 0) {
 #ifdef _WIN32
@@ -166,8 +476,11 @@ ErrorCode UdpClient::send(const buffer_t& data, const string_t& target_host, int
         return ErrorCode::SOCKET_SEND_FAILED;
     }
     
-    update_stats_sent(data.size());
-    LOG_DEBUG("Successfully sent " + std::to_string(result) + " bytes");
+    update_stats_sent(data.size);
+    if (capture_enabled_.load(std::memory_order_relaxed)) {
+        capture_sent(&data, 1, target);
+    }
+    LOG_DEBUG_F("Successfully sent {} bytes", result);
     
     return ErrorCode::SUCCESS;
 }
@@ -177,23 +490,314 @@ ErrorCode UdpClient::send_string(const string_t& message, const string_t& target
     return send(data, target_host, target_port);
 }
 
-void UdpClient::send_async(const buffer_t& data, std::function<void(ErrorCode)> callback,
-                          const string_t& target_host, int target_port) {
-    std::thread([this, data, callback, target_host, target_port]() {
-        auto result = send(data, target_host, target_port);
-        if (callback) {
-            callback(result);
+Result<size_t> UdpClient::send_batch(const BufferView* packets, size_t count,
+                                    const string_t& target_host, int target_port) {
+    if (!is_initialized_) {
+        LOG_ERROR("UdpClient not initialized");
+        return Result<size_t>(ErrorCode::SOCKET_INIT_FAILED);
+    }
+    
+    if (packets == nullptr || count == 0) {
+        LOG_ERROR("Cannot send empty batch");
+        return Result<size_t>(ErrorCode::INVALID_PARAMETER);
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        if (packets[i].empty()) {
+            LOG_ERROR("Cannot send empty packet in batch at index " + std::to_string(i));
+            return Result<size_t>(ErrorCode::INVALID_PARAMETER);
+        }
+    }
+    
+    LOG_DEBUG_F("Sending batch of {} packets to {}:{}", count,
+                target_host.empty() ? default_peer()->host : target_host,
+                target_port == 0 ? default_peer()->port : target_port);
+    
+    // 整批只解析一次目标地址
+    SendTarget target;
+    auto resolved = resolve_target(target_host, target_port, target);
+    if (resolved != ErrorCode::SUCCESS) {
+        update_stats_error(true);
+        return Result<size_t>(resolved);
+    }
+    auto connection = hold_connection(target);
+    
+    size_t sent = 0;
+    size_t bytes = 0;
+    bool failed = false;
+    
+#ifdef __linux__
+    while (sent < count) {
+        uint64_t started = latency_start();
+        int result = send_batch_chunk(packets + sent, count - sent, target);
+        record_latency(send_latency_, started);
+        if (result <= 0) {
+            failed = true;
+            break;
+        }
+        for (int i = 0; i < result; ++i) {
+            bytes += packets[sent + i].size;
+        }
+        if (capture_enabled_.load(std::memory_order_relaxed)) {
+            for (int i = 0; i < result; ++i) {
+                capture_sent(&packets[sent + i], 1, target);
+            }
+        }
+        sent += static_cast<size_t>(result);
+    }
+#else
+    for (; sent < count; ++sent) {
+        uint64_t started = latency_start();
+        int result = sendto(socket_, reinterpret_cast<const char*>(packets[sent].data),
+                           static_cast<int>(packets[sent].size), 0,
+                           target.name(), target.name_length());
+        record_latency(send_latency_, started);
+        if (result == SOCKET_ERROR || result < 0) {
+            failed = true;
+            break;
+        }
+        bytes += packets[sent].size;
+        if (capture_enabled_.load(std::memory_order_relaxed)) {
+            capture_sent(&packets[sent], 1, target);
+        }
+    }
+#endif
+    
+    if (failed) {
+#ifdef _WIN32
+        LOG_ERROR("Batch send failed with error: " + std::to_string(WSAGetLastError()));
+#else
+        LOG_ERROR("Batch send failed with error: " + std::string(strerror(errno)));
+#endif
+        update_stats_error(true);
+    }
+    
+    if (sent > 0) {
+        update_stats_sent(bytes, sent);
+    } else if (failed) {
+        return Result<size_t>(ErrorCode::SOCKET_SEND_FAILED);
+    }
+    
+    LOG_DEBUG_F("Successfully sent {} of {} packets", sent, count);
+    return Result<size_t>(static_cast<size_t>(sent));
+}
+
+Result<size_t> UdpClient::send_batch(const std::vector<buffer_t>& packets,
+                                    const string_t& target_host, int target_port) {
+    std::vector<BufferView> views(packets.begin(), packets.end());
+    return send_batch(views.data(), views.size(), target_host, target_port);
+}
+
+ErrorCode UdpClient::send_gather(const BufferView* parts, size_t count,
+                                 const string_t& target_host, int target_port) {
+    if (!is_initialized_) {
+        LOG_ERROR("UdpClient not initialized");
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    if (parts == nullptr || count == 0 || count > MAX_GATHER_PARTS) {
+        LOG_ERROR("Invalid gather part count: " + std::to_string(count));
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    SendTarget target;
+    auto resolved = resolve_target(target_host, target_port, target);
+    if (resolved != ErrorCode::SUCCESS) {
+        update_stats_error(true);
+        return resolved;
+    }
+    auto connection = hold_connection(target);
+    
+    return send_gather_target(parts, count, target);
+}
+
+ErrorCode UdpClient::send_to(BufferView data, const Endpoint& target) {
+    if (!is_initialized_) {
+        LOG_ERROR("UdpClient not initialized");
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    SendTarget resolved;
+    auto result = make_target(target, resolved);
+    if (result != ErrorCode::SUCCESS) {
+        update_stats_error(true);
+        return result;
+    }
+    
+    return send_gather_target(&data, 1, resolved);
+}
+
+ErrorCode UdpClient::send_gather_target(const BufferView* parts, size_t count, const SendTarget& target) {
+    size_t total_size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total_size += parts[i].size;
+    }
+    
+    if (total_size == 0) {
+        LOG_ERROR("Cannot send empty data");
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+#ifdef _WIN32
+    WSABUF buffers[MAX_GATHER_PARTS];
+    for (size_t i = 0; i < count; ++i) {
+        buffers[i].buf = reinterpret_cast<char*>(const_cast<byte*>(parts[i].data));
+        buffers[i].len = static_cast<ULONG>(parts[i].size);
+    }
+    
+    DWORD bytes_sent = 0;
+    uint64_t started = latency_start();
+    int result = WSASendTo(socket_, buffers, static_cast<DWORD>(count), &bytes_sent, 0,
+                           target.name(), target.name_length(), nullptr, nullptr);
+    record_latency(send_latency_, started);
+#else
+    iovec iovs[MAX_GATHER_PARTS];
+    for (size_t i = 0; i < count; ++i) {
+        iovs[i].iov_base = const_cast<byte*>(parts[i].data);
+        iovs[i].iov_len = parts[i].size;
+    }
+    
+    msghdr msg{};
+    msg.msg_name = const_cast<sockaddr*>(target.name());
+    msg.msg_namelen = target.name_length();
+    msg.msg_iov = iovs;
+    msg.msg_iovlen = count;
+    
+    // 双栈套接字发往IPv4映射地址时内核读取IP_TOS，发往IPv6地址时读取IPV6_TCLASS，不认识的层级被忽略
+    alignas(cmsghdr) char control[2 * CMSG_SPACE(sizeof(int))] = {};
+    int tos = tos_for(parts[0]);
+    if (tos >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = socket_ipv6_ ? sizeof(control) : CMSG_SPACE(sizeof(int));
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = IPPROTO_IP;
+        cmsg->cmsg_type = IP_TOS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &tos, sizeof(tos));
+        if (socket_ipv6_) {
+            cmsg = CMSG_NXTHDR(&msg, cmsg);
+            cmsg->cmsg_level = IPPROTO_IPV6;
+            cmsg->cmsg_type = IPV6_TCLASS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(cmsg), &tos, sizeof(tos));
+        }
+    }
+    
+    uint64_t started = latency_start();
+    ssize_t result = sendmsg(socket_, &msg, 0);
+    record_latency(send_latency_, started);
+#endif
+    
+    if (result == SOCKET_ERROR || result < 0) {
+#ifdef _WIN32
+        int error = WSAGetLastError();
+        LOG_ERROR("Gather send failed with error: " + std::to_string(error));
+#else
+        LOG_ERROR("Gather send failed with error: " + std::string(strerror(errno)));
+#endif
+        update_stats_error(true);
+        return ErrorCode::SOCKET_SEND_FAILED;
+    }
+    
+    update_stats_sent(total_size);
+    if (capture_enabled_.load(std::memory_order_relaxed)) {
+        capture_sent(parts, count, target);
+    }
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode UdpClient::send_async(buffer_t data, std::function<void(ErrorCode)> callback,
+                               const string_t& target_host, int target_port) {
+    SendRequest request;
+    request.data = std::move(data);
+    request.target_host = target_host;
+    request.target_port = target_port;
+    request.callback = std::move(callback);
+    return enqueue_send(request);
+}
+
+ErrorCode UdpClient::send_async(PooledBuffer data, std::function<void(ErrorCode)> callback,
+                               const string_t& target_host, int target_port) {
+    SendRequest request;
+    request.pooled = std::move(data);
+    request.target_host = target_host;
+    request.target_port = target_port;
+    request.callback = std::move(callback);
+    return enqueue_send(request);
+}
+
+ErrorCode UdpClient::enqueue_send(SendRequest& request) {
+    // 入队期间共享持有，stop_send_workers()独占后才释放队列，关闭开始后不再接受新的请求
+    std::shared_lock<std::shared_mutex> producing(send_producers_mutex_);
+    // 失败时先释放再回调，回调中可以调用close()
+    auto fail = [this, &producing, &request](ErrorCode error) {
+        producing.unlock();
+        return complete_send(request, error);
+    };
+    if (!is_initialized_) {
+        LOG_ERROR("UdpClient not initialized");
+        return fail(ErrorCode::SOCKET_INIT_FAILED);
+    }
+    if (send_stopping_ || (!send_workers_running_ && !start_send_workers())) {
+        return fail(ErrorCode::SOCKET_SEND_FAILED);
+    }
+    
+    Priority priority = send_scheduler_ ? classify_priority(request.view()) : Priority::NORMAL;
+    
+    while (!queue_try_push(request, priority)) {
+        switch (config_.send_backpressure) {
+            case BackpressurePolicy::FAIL:
+                return fail(ErrorCode::QUEUE_FULL);
+                
+            case BackpressurePolicy::DROP: {
+                local_stats().send_queue_drops.fetch_add(1, std::memory_order_relaxed);
+                return fail(ErrorCode::QUEUE_FULL);
+            }
+                
+            case BackpressurePolicy::BLOCK: {
+                std::unique_lock<std::mutex> lock(send_mutex_);
+                blocked_senders_++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                send_space_.wait(lock, [this, priority]() {
+                    return queue_has_space(priority) || send_stopping_;
+                });
+                blocked_senders_--;
+                if (send_stopping_) {
+                    lock.unlock();
+                    return fail(ErrorCode::SOCKET_SEND_FAILED);
+                }
+                break;
+            }
         }
-    }).detach();
+    }
+    
+    // 只有存在空闲发送线程时才需要加锁唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_send_workers_ > 0) {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        send_ready_.notify_one();
+    }
+    
+    return ErrorCode::SUCCESS;
 }
 
 Result<size_t> UdpClient::receive(buffer_t& buffer, string_t& from_host, int& from_port) {
+    Endpoint from;
+    auto result = receive(buffer, from);
+    if (result.is_success()) {
+        from.format_host(from_host);
+        from_port = from.port();
+    }
+    return result;
+}
+
+Result<size_t> UdpClient::receive(buffer_t& buffer, Endpoint& from) {
     if (!is_initialized_) {
         LOG_ERROR("UdpClient not initialized");
         return Result<size_t>(ErrorCode::SOCKET_INIT_FAILED);
     }
     
-    sockaddr_in from_addr{};
+    sockaddr_storage from_addr{};
     socklen_t addr_len = sizeof(from_addr);
     
     buffer.resize(MAX_BUFFER_SIZE);
@@ -220,39 +824,173 @@ Result<size_t> UdpClient::receive(buffer_t& buffer, string_t& from_host, int& fr
     }
     
     buffer.resize(result);
-    from_host = inet_ntoa(from_addr.sin_addr);
-    from_port = ntohs(from_addr.sin_port);
+    from = Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(&from_addr), addr_len);
     
     update_stats_received(result);
-    LOG_DEBUG("Received " + std::to_string(result) + " bytes from " + from_host + ":" + std::to_string(from_port));
+    if (capture_enabled_.load(std::memory_order_relaxed)) {
+        capture_->write(CaptureDirection::RECEIVED, from, BufferView(buffer), monotonic_ns());
+    }
+    LOG_DEBUG_F("Received {} bytes from {}", result, from.to_string());
     
     return Result<size_t>(static_cast<size_t>(result));
 }
 
-ErrorCode UdpClient::start_receive_async(MessageCallback message_callback, ErrorCallback error_callback) {
+Result<size_t> UdpClient::receive_batch(ReceiveRing& ring) {
+    return receive_batch_impl(ring, false);
+}
+
+Result<size_t> UdpClient::receive_batch_impl(ReceiveRing& ring, bool non_blocking) {
+    ring.count_ = 0;
+    
     if (!is_initialized_) {
         LOG_ERROR("UdpClient not initialized");
-        return ErrorCode::SOCKET_INIT_FAILED;
+        return Result<size_t>(ErrorCode::SOCKET_INIT_FAILED);
+    }
+    
+    size_t bytes = 0;
+    
+#ifdef __linux__
+    for (size_t i = 0; i < ring.slot_count_; ++i) {
+        ring.msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        ring.msgs_[i].msg_hdr.msg_flags = 0;
+        ring.msgs_[i].msg_hdr.msg_control = &ring.controls_[i * ReceiveRing::CONTROL_WORDS];
+        ring.msgs_[i].msg_hdr.msg_controllen = ReceiveRing::CONTROL_WORDS * sizeof(uint64_t);
+    }
+    
+    // MSG_WAITFORONE：第一个数据包按超时阻塞等待，之后只取已到达的数据包
+    int flags = non_blocking ? MSG_DONTWAIT : MSG_WAITFORONE;
+    int result;
+    do {
+        result = recvmmsg(socket_, ring.msgs_.data(), static_cast<unsigned int>(ring.slot_count_),
+                          flags, nullptr);
+    } while (result < 0 && errno == EINTR);
+    
+    if (result < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return Result<size_t>(ErrorCode::TIMEOUT);
+        }
+        LOG_ERROR("Batch receive failed with error: " + std::string(strerror(errno)));
+        update_stats_error(false);
+        return Result<size_t>(ErrorCode::SOCKET_RECEIVE_FAILED);
+    }
+    
+    for (int i = 0; i < result; ++i) {
+        PacketView& packet = ring.packets_[i];
+        packet.data = BufferView(ring.slot(i), ring.msgs_[i].msg_len);
+        packet.truncated = (ring.msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        packet.from = Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(&ring.names_[i]),
+                                              ring.msgs_[i].msg_hdr.msg_namelen);
+        packet.kernel_timestamp_ns = ReceiveRing::kernel_timestamp(ring.msgs_[i].msg_hdr);
+        bytes += ring.msgs_[i].msg_len;
+    }
+    ring.count_ = static_cast<size_t>(result);
+#else
+    // 阻塞模式只等待一个数据包；非阻塞模式（事件循环中）持续读取直到EAGAIN或槽位用尽
+    size_t max_packets = non_blocking ? ring.slot_count_ : 1;
+    
+    while (ring.count_ < max_packets) {
+        PacketView& packet = ring.packets_[ring.count_];
+        byte* slot = ring.slot(ring.count_);
+        sockaddr_storage& name = ring.names_[ring.count_];
+        socklen_t addr_len = sizeof(name);
+        
+#ifdef _WIN32
+        int flags = 0;  // 非阻塞由FIONBIO设置
+#else
+        int flags = non_blocking ? MSG_DONTWAIT : 0;
+#endif
+        int result = recvfrom(socket_, reinterpret_cast<char*>(slot),
+                             static_cast<int>(ring.slot_size_), flags,
+                             reinterpret_cast<sockaddr*>(&name), &addr_len);
+        
+        packet.truncated = false;
+        if (result == SOCKET_ERROR || result < 0) {
+#ifdef _WIN32
+            int error = WSAGetLastError();
+            if (error == WSAEMSGSIZE) {
+                // 数据报被截断，槽位中保留前slot_size字节
+                result = static_cast<int>(ring.slot_size_);
+                packet.truncated = true;
+            } else if (error == WSAETIMEDOUT || error == WSAEWOULDBLOCK) {
+                break;
+            } else {
+                if (ring.count_ > 0) {
+                    break;
+                }
+                LOG_ERROR("Receive failed with error: " + std::to_string(error));
+                update_stats_error(false);
+                return Result<size_t>(ErrorCode::SOCKET_RECEIVE_FAILED);
+            }
+#else
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || ring.count_ > 0) {
+                break;
+            }
+            LOG_ERROR("Receive failed with error: " + std::string(strerror(errno)));
+            update_stats_error(false);
+            return Result<size_t>(ErrorCode::SOCKET_RECEIVE_FAILED);
+#endif
+        }
+        
+        packet.data = BufferView(slot, static_cast<size_t>(result));
+        packet.from = Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(&name), addr_len);
+        bytes += static_cast<size_t>(result);
+        ++ring.count_;
+    }
+    
+    if (ring.count_ == 0) {
+        return Result<size_t>(ErrorCode::TIMEOUT);
+    }
+#endif
+    
+    update_stats_received(bytes, ring.count_);
+    if (capture_enabled_.load(std::memory_order_relaxed)) {
+        capture_received(ring);
     }
+    LOG_DEBUG_F("Received batch of {} packets, {} bytes", ring.count_, bytes);
     
+    return Result<size_t>(static_cast<size_t>(ring.count_));
+}
+
+ErrorCode UdpClient::start_receive_async(MessageCallback message_callback, ErrorCallback error_callback) {
     if (is_receiving_) {
         LOG_WARN("Already receiving asynchronously");
         return ErrorCode::SUCCESS;
     }
     
     message_callback_ = message_callback;
+    endpoint_callback_ = nullptr;
+    packet_callback_ = nullptr;
     error_callback_ = error_callback;
-    is_receiving_ = true;
-    should_stop_ = false;
-    
-    receive_thread_ = std::thread([this]() { receive_loop(); });
+    return begin_receive_async();
+}
+
+ErrorCode UdpClient::start_receive_async(EndpointCallback endpoint_callback, ErrorCallback error_callback) {
+    if (is_receiving_) {
+        LOG_WARN("Already receiving asynchronously");
+        return ErrorCode::SUCCESS;
+    }
     
-    if (config_.enable_keep_alive) {
-        keep_alive_thread_ = std::thread([this]() { keep_alive_loop(); });
+    message_callback_ = nullptr;
+    endpoint_callback_ = endpoint_callback;
+    packet_callback_ = nullptr;
+    error_callback_ = error_callback;
+    return begin_receive_async();
+}
+
+ErrorCode UdpClient::start_receive_batch_async(PacketCallback packet_callback, ErrorCallback error_callback) {
+    if (is_receiving_) {
+        LOG_WARN("Already receiving asynchronously");
+        return ErrorCode::SUCCESS;
     }
     
-    LOG_INFO("Started asynchronous receiving");
-    return ErrorCode::SUCCESS;
+    message_callback_ = nullptr;
+    endpoint_callback_ = nullptr;
+    packet_callback_ = packet_callback;
+    error_callback_ = error_callback;
+    return begin_receive_async();
 }
 
 void UdpClient::stop_receive_async() {
@@ -261,24 +999,81 @@ void UdpClient::stop_receive_async() {
     }
     
     LOG_INFO("Stopping asynchronous receiving");
-    should_stop_ = true;
-    is_receiving_ = false;
+    {
+        // update_config()在同一把锁下检查is_receiving_，之后不会再登记心跳定时器
+        std::lock_guard<std::mutex> lock(keep_alive_mutex_);
+        is_receiving_ = false;
+        if (keep_alive_timer_ != 0) {
+            event_loop_->cancel_timer(keep_alive_timer_);
+            keep_alive_timer_ = 0;
+        }
+    }
+    
+    // 注销后事件循环保证不会再调用本客户端的处理函数
+    event_loop_->remove_reader(socket_);
+    if (io_uring_ && io_uring_->is_open()) {
+        event_loop_->remove_reader(io_uring_->event_fd());
+    }
     
-    if (receive_thread_.joinable()) {
-        receive_thread_.join();
+    if (owns_event_loop_) {
+        event_loop_->stop();
+        event_loop_.reset();
+        owns_event_loop_ = false;
     }
     
-    if (keep_alive_thread_.joinable()) {
-        keep_alive_thread_.join();
+    // 取消io_uring请求要在事件循环停止之后：请求所属的线程退出时内核已经取消了它
+    if (io_uring_) {
+        io_uring_->close();
     }
     
+#ifdef _WIN32
+    u_long non_blocking = 0;
+    ioctlsocket(socket_, FIONBIO, &non_blocking);
+#endif
+    
     LOG_INFO("Stopped asynchronous receiving");
 }
 
+int UdpClient::get_local_port() const {
+    if (!is_initialized_) {
+        return 0;
+    }
+    
+    return get_local_endpoint().port();
+}
+
+Endpoint UdpClient::get_local_endpoint() const {
+    if (!is_initialized_) {
+        return Endpoint();
+    }
+    
+    sockaddr_storage local_addr{};
+    socklen_t addr_len = sizeof(local_addr);
+    if (getsockname(socket_, reinterpret_cast<sockaddr*>(&local_addr), &addr_len) != 0) {
+        return Endpoint();
+    }
+    return Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(&local_addr), addr_len);
+}
+
 void UdpClient::set_timeout(int timeout_ms) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    if (pending_config_) {
+        pending_config_->timeout_ms = timeout_ms;
+    }
+    apply_timeout(timeout_ms);
+}
+
+void UdpClient::apply_timeout(int timeout_ms) {
+    // 调用方持有config_mutex_；等待默认地址解析的发送线程不加此锁，读取timeout_ms_
     config_.timeout_ms = timeout_ms;
+    timeout_ms_.store(timeout_ms, std::memory_order_relaxed);
     
-    if (is_initialized_) {
+    // init_socket期间is_initialized_尚未置位，因此以套接字是否有效为准
+#ifdef _WIN32
+    if (socket_ != INVALID_SOCKET) {
+#else
+    if (socket_ >= 0) {
+#endif
 #ifdef _WIN32
         DWORD timeout = timeout_ms;
         setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
@@ -295,33 +1090,144 @@ void UdpClient::set_timeout(int timeout_ms) {
     LOG_DEBUG("Set timeout to " + std::to_string(timeout_ms) + " ms");
 }
 
-const UdpConfig& UdpClient::get_config() const {
-    return config_;
+UdpConfig UdpClient::get_config() const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return pending_config_ ? *pending_config_ : config_;
 }
 
 ErrorCode UdpClient::update_config(const UdpConfig& config) {
-    config_ = config;
+    std::unique_lock<std::mutex> lock(config_mutex_);
     
-    if (is_initialized_) {
-        set_timeout(config_.timeout_ms);
+    if (!config_live_) {
+        // 未初始化时没有其他线程读取配置
+        config_ = config;
+        pending_config_.reset();
+        LOG_INFO("Configuration updated");
+        return ErrorCode::SUCCESS;
+    }
+    
+    bool peer_changed = config.server_host != config_.server_host ||
+                        config.server_port != config_.server_port ||
+                        config.connect_default_peer != config_.connect_default_peer;
+    bool keep_alive_changed = config.enable_keep_alive != config_.enable_keep_alive ||
+                              config.keep_alive_interval_ms != config_.keep_alive_interval_ms;
+    
+    // 收发线程直接读取的创建时设置不能在这里修改，完整配置留到下次initialize()
+    string_t pending = pending_fields(config_, config);
+    pending_config_ = config;
+    config_.server_host = config.server_host;
+    config_.server_port = config.server_port;
+    config_.connect_default_peer = config.connect_default_peer;
+    config_.max_retries = config.max_retries;
+    
+    apply_timeout(config.timeout_ms);
+    std::thread stale_resolver;
+    if (peer_changed) {
+        stale_resolver = start_default_resolution();
+    }
+    
+    {
+        std::lock_guard<std::mutex> keep_alive_lock(keep_alive_mutex_);
+        config_.enable_keep_alive = config.enable_keep_alive;
+        config_.keep_alive_interval_ms = config.keep_alive_interval_ms;
+        if (is_receiving_ && keep_alive_changed) {
+            if (keep_alive_timer_ != 0) {
+                event_loop_->cancel_timer(keep_alive_timer_);
+                keep_alive_timer_ = 0;
+            }
+            if (config_.enable_keep_alive) {
+                keep_alive_timer_ = event_loop_->run_every(
+                    std::chrono::milliseconds(config_.keep_alive_interval_ms), [this]() { send_keep_alive(); });
+            }
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> cache_lock(address_cache_mutex_);
+        config_.address_cache_size = config.address_cache_size;
+        config_.address_cache_ttl_ms = config.address_cache_ttl_ms;
+        while (address_cache_.size() > config_.address_cache_size) {
+            address_index_.erase(address_cache_.back().first);
+            address_cache_.pop_back();
+        }
     }
     
-    LOG_INFO("Configuration updated");
+    // 旧的解析可能还在等待DNS，释放config_mutex_后再等待它结束，get_config()等不受影响
+    lock.unlock();
+    join_stale_resolver(stale_resolver);
+    
+    if (!pending.empty()) {
+        LOG_WARN_F("Configuration updated; changes to {} take effect after the next initialize()", pending);
+    } else {
+        LOG_INFO("Configuration updated");
+    }
     return ErrorCode::SUCCESS;
 }
 
 UdpClient::Statistics UdpClient::get_statistics() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    return stats_;
+    Statistics result;
+    int64_t last_activity = 0;
+    for (const StatsStripe& stripe : stats_) {
+        result.packets_sent += stripe.packets_sent.load(std::memory_order_relaxed);
+        result.packets_received += stripe.packets_received.load(std::memory_order_relaxed);
+        result.bytes_sent += stripe.bytes_sent.load(std::memory_order_relaxed);
+        result.bytes_received += stripe.bytes_received.load(std::memory_order_relaxed);
+        result.send_errors += stripe.send_errors.load(std::memory_order_relaxed);
+        result.receive_errors += stripe.receive_errors.load(std::memory_order_relaxed);
+        result.send_queue_drops += stripe.send_queue_drops.load(std::memory_order_relaxed);
+        last_activity = std::max(last_activity, stripe.last_activity.load(std::memory_order_relaxed));
+    }
+    result.last_activity = time_point_t(time_point_t::duration(last_activity));
+    return result;
+}
+
+HistogramSnapshot UdpClient::get_send_latency() const {
+    return send_latency_.snapshot();
+}
+
+HistogramSnapshot UdpClient::get_callback_latency() const {
+    return callback_latency_.snapshot();
 }
 
 void UdpClient::reset_statistics() {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_ = Statistics{};
-    stats_.last_activity = std::chrono::system_clock::now();
+    for (StatsStripe& stripe : stats_) {
+        stripe.packets_sent.store(0, std::memory_order_relaxed);
+        stripe.packets_received.store(0, std::memory_order_relaxed);
+        stripe.bytes_sent.store(0, std::memory_order_relaxed);
+        stripe.bytes_received.store(0, std::memory_order_relaxed);
+        stripe.send_errors.store(0, std::memory_order_relaxed);
+        stripe.receive_errors.store(0, std::memory_order_relaxed);
+        stripe.send_queue_drops.store(0, std::memory_order_relaxed);
+        stripe.last_activity.store(0, std::memory_order_relaxed);
+    }
+    touch_activity(stats_[0]);
+    send_latency_.reset();
+    callback_latency_.reset();
     LOG_INFO("Statistics reset");
 }
 
+ErrorCode UdpClient::start_capture(const CaptureConfig& config) {
+    capture_enabled_.store(false, std::memory_order_release);
+    auto result = capture_->open(config);
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    capture_enabled_.store(true, std::memory_order_release);
+    return ErrorCode::SUCCESS;
+}
+
+void UdpClient::stop_capture() {
+    if (!capture_enabled_.exchange(false)) {
+        return;
+    }
+    // 仍在写入的收发线程持有写入器的锁，close()等待其完成；之后的write()被忽略
+    capture_->close();
+}
+
+CaptureWriter::Statistics UdpClient::get_capture_statistics() const {
+    return capture_->get_statistics();
+}
+
 // 私有方法实现
 ErrorCode UdpClient::init_socket() {
 #ifdef _WIN32
@@ -330,26 +1236,251 @@ ErrorCode UdpClient::init_socket() {
         return ErrorCode::SOCKET_INIT_FAILED;
     }
     
-    socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    socket_ipv6_ = config_.ip_family != IpFamily::IPV4;
+    socket_ = socket(socket_ipv6_ ? AF_INET6 : AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_ == INVALID_SOCKET && config_.ip_family == IpFamily::AUTO) {
+        LOG_WARN("IPv6 sockets unavailable, falling back to IPv4");
+        socket_ipv6_ = false;
+        socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    }
     if (socket_ == INVALID_SOCKET) {
         LOG_ERROR("Socket creation failed with error: " + std::to_string(WSAGetLastError()));
         WSACleanup();
         return ErrorCode::SOCKET_CREATE_FAILED;
     }
 #else
-    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    socket_ipv6_ = config_.ip_family != IpFamily::IPV4;
+    socket_ = socket(socket_ipv6_ ? AF_INET6 : AF_INET, SOCK_DGRAM, 0);
+    if (socket_ < 0 && config_.ip_family == IpFamily::AUTO) {
+        LOG_WARN("IPv6 sockets unavailable, falling back to IPv4: " + std::string(strerror(errno)));
+        socket_ipv6_ = false;
+        socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    }
     if (socket_ < 0) {
         LOG_ERROR("Socket creation failed: " + std::string(strerror(errno)));
         return ErrorCode::SOCKET_CREATE_FAILED;
     }
 #endif
     
-    set_timeout(config_.timeout_ms);
+    if (socket_ipv6_) {
+        // AUTO使用双栈：IPv4对端以::ffff:a.b.c.d映射地址出现在同一个套接字上
+        int v6only = config_.ip_family == IpFamily::IPV6 ? 1 : 0;
+        if (setsockopt(socket_, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&v6only),
+                       sizeof(v6only)) != 0) {
+            LOG_WARN("Failed to set IPV6_V6ONLY=" + std::to_string(v6only));
+        }
+    }
+    
+    apply_timeout(config_.timeout_ms);
+    apply_socket_options();
+    
+    auto result = bind_socket();
+    if (result != ErrorCode::SUCCESS) {
+        cleanup_socket();
+        return result;
+    }
     
     LOG_DEBUG("Socket created successfully");
     return ErrorCode::SUCCESS;
 }
 
+void UdpClient::apply_socket_options() {
+    // 调优选项设置失败只记录警告，套接字仍可正常收发
+#ifdef __linux__
+    apply_buffer_size(SO_RCVBUF, SO_RCVBUFFORCE, config_.receive_buffer_size, "SO_RCVBUF");
+    apply_buffer_size(SO_SNDBUF, SO_SNDBUFFORCE, config_.send_buffer_size, "SO_SNDBUF");
+#else
+    apply_buffer_size(SO_RCVBUF, -1, config_.receive_buffer_size, "SO_RCVBUF");
+    apply_buffer_size(SO_SNDBUF, -1, config_.send_buffer_size, "SO_SNDBUF");
+#endif
+    
+    if (config_.dscp >= 0) {
+        int tos = dscp_to_tos(config_.dscp);
+        if (tos < 0) {
+            LOG_WARN("Ignoring invalid DSCP value " + std::to_string(config_.dscp));
+        } else {
+            bool applied = setsockopt(socket_, IPPROTO_IP, IP_TOS, reinterpret_cast<const char*>(&tos),
+                                      sizeof(tos)) == 0;
+            if (socket_ipv6_) {
+                applied = setsockopt(socket_, IPPROTO_IPV6, IPV6_TCLASS, reinterpret_cast<const char*>(&tos),
+                                     sizeof(tos)) == 0 || applied;
+            }
+            if (!applied) {
+                LOG_WARN("Failed to set DSCP " + std::to_string(config_.dscp));
+            }
+        }
+    }
+    
+    priority_tos_enabled_ = false;
+    for (size_t i = 0; i < PRIORITY_LEVELS; ++i) {
+        priority_tos_[i] = dscp_to_tos(config_.priority_dscp[i]);
+        if (config_.priority_dscp[i] >= 0 && priority_tos_[i] < 0) {
+            LOG_WARN("Ignoring invalid DSCP value " + std::to_string(config_.priority_dscp[i]));
+        }
+#ifndef _WIN32
+        priority_tos_enabled_ = priority_tos_enabled_ || priority_tos_[i] >= 0;
+#endif
+    }
+    
+#ifdef __linux__
+    if (config_.busy_poll_us > 0) {
+        int busy_poll = config_.busy_poll_us;
+        if (setsockopt(socket_, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll)) != 0) {
+            // 超过net.core.busy_read需要CAP_NET_ADMIN
+            LOG_WARN("Failed to set SO_BUSY_POLL: " + std::string(strerror(errno)));
+        }
+    }
+    
+    if (config_.receive_timestamps != ReceiveTimestamps::NONE) {
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (config_.receive_timestamps == ReceiveTimestamps::HARDWARE) {
+            flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+        }
+        if (setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) != 0) {
+            LOG_WARN("Failed to enable SO_TIMESTAMPING: " + std::string(strerror(errno)));
+        }
+    }
+    
+    if (config_.mtu_discovery != PathMtuDiscovery::SYSTEM) {
+        int mode = IP_PMTUDISC_DO;
+        int mode_v6 = IPV6_PMTUDISC_DO;
+        if (config_.mtu_discovery == PathMtuDiscovery::DONT) {
+            mode = IP_PMTUDISC_DONT;
+            mode_v6 = IPV6_PMTUDISC_DONT;
+        } else if (config_.mtu_discovery == PathMtuDiscovery::PROBE) {
+            mode = IP_PMTUDISC_PROBE;
+            mode_v6 = IPV6_PMTUDISC_PROBE;
+        }
+        
+        bool applied = setsockopt(socket_, IPPROTO_IP, IP_MTU_DISCOVER, &mode, sizeof(mode)) == 0;
+        if (socket_ipv6_) {
+            applied = setsockopt(socket_, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &mode_v6, sizeof(mode_v6)) == 0 || applied;
+        }
+        if (!applied) {
+            LOG_WARN("Failed to set IP_MTU_DISCOVER: " + std::string(strerror(errno)));
+        }
+    }
+#else
+    if (config_.busy_poll_us > 0 || config_.receive_timestamps != ReceiveTimestamps::NONE ||
+        config_.mtu_discovery != PathMtuDiscovery::SYSTEM) {
+        LOG_WARN("busy_poll_us, receive_timestamps and mtu_discovery are only supported on Linux");
+    }
+#endif
+}
+
+void UdpClient::apply_buffer_size(int option, int force_option, int requested, const char* name) {
+    if (requested <= 0) {
+        return;
+    }
+    
+    if (setsockopt(socket_, SOL_SOCKET, option, reinterpret_cast<const char*>(&requested), sizeof(requested)) != 0) {
+        LOG_WARN(string_t("Failed to set ") + name);
+        return;
+    }
+    
+    // Linux把设置值翻倍记账，并按net.core.rmem_max/wmem_max截断；截断时尝试需要CAP_NET_ADMIN的FORCE选项
+#ifdef __linux__
+    int expected = requested * 2;
+#else
+    int expected = requested;
+#endif
+    int actual = socket_int_option(SOL_SOCKET, option);
+    if (actual < expected && force_option >= 0 &&
+        setsockopt(socket_, SOL_SOCKET, force_option, reinterpret_cast<const char*>(&requested), sizeof(requested)) == 0) {
+        actual = socket_int_option(SOL_SOCKET, option);
+    }
+    
+    if (actual < expected) {
+        LOG_WARN_F("{} limited by the kernel: requested {}, got {} (raise net.core.rmem_max/wmem_max)",
+                   name, requested, actual);
+    } else {
+        LOG_DEBUG_F("{} set to {} (kernel reports {})", name, requested, actual);
+    }
+}
+
+int UdpClient::socket_int_option(int level, int option) const {
+    int value = 0;
+    socklen_t length = sizeof(value);
+    if (getsockopt(socket_, level, option, reinterpret_cast<char*>(&value), &length) != 0) {
+        return -1;
+    }
+    return value;
+}
+
+int UdpClient::tos_for(BufferView first) const {
+    if (!priority_tos_enabled_) {
+        return -1;
+    }
+    return priority_tos_[priority_index(classify_priority(first))];
+}
+
+int UdpClient::get_receive_buffer_size() const {
+    return is_initialized_ ? socket_int_option(SOL_SOCKET, SO_RCVBUF) : -1;
+}
+
+int UdpClient::get_send_buffer_size() const {
+    return is_initialized_ ? socket_int_option(SOL_SOCKET, SO_SNDBUF) : -1;
+}
+
+IoEngine UdpClient::get_io_engine() const {
+    return io_uring_ && io_uring_->is_open() ? IoEngine::IO_URING : IoEngine::SOCKET;
+}
+
+ErrorCode UdpClient::bind_socket() {
+    if (config_.reuse_port) {
+        int enable = 1;
+        setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&enable), sizeof(enable));
+#ifdef SO_REUSEPORT
+        if (setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&enable), sizeof(enable)) != 0) {
+            LOG_ERROR("Failed to enable SO_REUSEPORT: " + std::string(strerror(errno)));
+            return ErrorCode::SOCKET_BIND_FAILED;
+        }
+#else
+        LOG_WARN("SO_REUSEPORT is not supported on this platform");
+#endif
+    }
+    
+#ifdef __linux__
+    if (config_.incoming_cpu >= 0) {
+        // 仅作提示：内核按处理软中断的CPU选择套接字，设置失败不影响收发
+        int cpu = config_.incoming_cpu;
+        if (setsockopt(socket_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) != 0) {
+            LOG_WARN("Failed to set SO_INCOMING_CPU: " + std::string(strerror(errno)));
+        }
+    }
+#endif
+    
+    // reuseport组的成员必须显式绑定，否则内核不会把它们放进同一个组
+    if (config_.local_port == 0 && config_.local_host.empty() && !config_.reuse_port) {
+        return ErrorCode::SUCCESS;
+    }
+    
+    Endpoint local = Endpoint::any(socket_ipv6_, config_.local_port);
+    if (!config_.local_host.empty()) {
+        auto parsed = Endpoint::parse(config_.local_host, config_.local_port);
+        if (!parsed) {
+            LOG_ERROR("Invalid local address: " + config_.local_host);
+            return ErrorCode::INVALID_ADDRESS;
+        }
+        local = *parsed;
+    }
+    
+    sockaddr_storage local_addr;
+    socklen_t addr_len = local.to_sockaddr(local_addr, socket_ipv6_);
+    if (addr_len == 0) {
+        LOG_ERROR("Local address " + config_.local_host + " does not match the socket address family");
+        return ErrorCode::INVALID_ADDRESS;
+    }
+    
+    if (bind(socket_, reinterpret_cast<sockaddr*>(&local_addr), addr_len) != 0) {
+        LOG_ERROR("Failed to bind " + config_.local_host + ":" + std::to_string(config_.local_port) +
+                  ": " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_BIND_FAILED;
+    }
+    
+    return ErrorCode::SUCCESS;
+}
+
 void UdpClient::cleanup_socket() {
     if (socket_ != 
 #ifdef _WIN32
@@ -370,113 +1501,886 @@ void UdpClient::cleanup_socket() {
     }
 }
 
-void UdpClient::receive_loop() {
-    LOG_INFO("Receive loop started");
+ErrorCode UdpClient::set_event_loop(std::shared_ptr<EventLoop> loop) {
+    if (is_receiving_) {
+        LOG_ERROR("Cannot change event loop while receiving asynchronously");
+        return ErrorCode::INVALID_PARAMETER;
+    }
     
-    while (!should_stop_) {
-        buffer_t buffer;
-        string_t from_host;
-        int from_port;
-        
-        auto result = receive(buffer, from_host, from_port);
+    if (loop && !loop->is_valid()) {
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    event_loop_ = std::move(loop);
+    owns_event_loop_ = false;
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode UdpClient::begin_receive_async() {
+    if (!is_initialized_) {
+        LOG_ERROR("UdpClient not initialized");
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    if (!event_loop_) {
+        event_loop_ = std::make_shared<EventLoop>();
+        event_loop_->set_cpu_affinity(config_.receive_cpu);
+        owns_event_loop_ = true;
+    }
+    
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    ioctlsocket(socket_, FIONBIO, &non_blocking);
+#endif
+    
+    ErrorCode result = ErrorCode::SOCKET_INIT_FAILED;
+    if (config_.io_engine == IoEngine::IO_URING) {
+        result = begin_io_uring_receive();
+        if (result != ErrorCode::SUCCESS) {
+            LOG_WARN("io_uring receive engine unavailable, falling back to socket engine");
+        }
+    }
+    if (result != ErrorCode::SUCCESS) {
+        prepare_receive_ring(MAX_BUFFER_SIZE);
+        result = event_loop_->add_reader(socket_, [this]() { handle_readable(); });
+    }
+    if (result != ErrorCode::SUCCESS) {
+        LOG_ERROR("Failed to register socket with event loop");
+        if (owns_event_loop_) {
+            event_loop_.reset();
+            owns_event_loop_ = false;
+        }
+        return result;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(keep_alive_mutex_);
+        if (config_.enable_keep_alive) {
+            keep_alive_timer_ = event_loop_->run_every(
+                std::chrono::milliseconds(config_.keep_alive_interval_ms), [this]() { send_keep_alive(); });
+        }
+        is_receiving_ = true;
+    }
+    
+    if (owns_event_loop_) {
+        event_loop_->start();
+    }
+    
+    LOG_INFO("Started asynchronous receiving");
+    return ErrorCode::SUCCESS;
+}
+
+void UdpClient::handle_readable() {
+    // 水平触发：单次唤醒限制批次数，剩余数据在下一轮继续读取，避免饿死同一循环上的其他客户端
+    for (size_t round = 0; round < config_.max_batches_per_wakeup; ++round) {
+        auto result = receive_batch_impl(*receive_ring_, true);
         
         if (result.is_success()) {
-            if (message_callback_) {
-                try {
-                    message_callback_(buffer, from_host, from_port);
-                } catch (const std::exception& e) {
-                    LOG_ERROR("Message callback exception: " + std::string(e.what()));
-                }
+            dispatch_packets(*receive_ring_);
+            if (receive_ring_->size() < receive_ring_->capacity()) {
+                break;  // 未填满说明已读到EAGAIN
+            }
+            continue;
+        }
+        
+        if (result.error_code() != ErrorCode::TIMEOUT && error_callback_) {
+            try {
+                error_callback_(result.error_code(), "Receive error");
+            } catch (const std::exception& e) {
+                LOG_ERROR("Error callback exception: " + std::string(e.what()));
             }
-        } else if (result.error_code() != ErrorCode::TIMEOUT) {
-            if (error_callback_) {
-                try {
-                    error_callback_(result.error_code(), "Receive error");
-                } catch (const std::exception& e) {
-                    LOG_ERROR("Error callback exception: " + std::string(e.what()));
+        }
+        break;
+    }
+}
+
+void UdpClient::prepare_receive_ring(size_t slot_size) {
+    if (!receive_ring_ || receive_ring_->capacity() != config_.receive_batch_size ||
+        receive_ring_->slot_size() != slot_size) {
+        receive_ring_ = std::make_unique<ReceiveRing>(config_.receive_batch_size, slot_size);
+    }
+}
+
+ErrorCode UdpClient::begin_io_uring_receive() {
+    io_uring_ = std::make_unique<IoUringReceiver>(config_.io_uring_buffers, MAX_BUFFER_SIZE,
+                                                  config_.receive_timestamps != ReceiveTimestamps::NONE);
+    ErrorCode result = io_uring_->open(socket_);
+    if (result == ErrorCode::SUCCESS) {
+        result = event_loop_->add_reader(io_uring_->event_fd(), [this]() { handle_io_uring_readable(); });
+    }
+    if (result != ErrorCode::SUCCESS) {
+        io_uring_.reset();
+        return result;
+    }
+    
+    // 数据直接写入提供缓冲区，接收环只保存数据包视图
+    prepare_receive_ring(1);
+    
+    // 网络完成事件在提交请求的线程上执行，请求由事件循环线程提交。
+    // stop_receive_async()中remove_reader()投递的屏障保证该任务已经执行完
+    event_loop_->post([this]() {
+        if (io_uring_ && io_uring_->arm() != ErrorCode::SUCCESS) {
+            fall_back_to_socket_engine();
+        }
+    });
+    
+    LOG_INFO("Using io_uring receive engine");
+    return ErrorCode::SUCCESS;
+}
+
+void UdpClient::handle_io_uring_readable() {
+    io_uring_->acknowledge();
+    
+    for (size_t round = 0; round < config_.max_batches_per_wakeup; ++round) {
+        size_t count = io_uring_->reap(*receive_ring_);
+        if (count > 0) {
+            size_t bytes = 0;
+            for (const PacketView& packet : *receive_ring_) {
+                bytes += packet.data.size;
+            }
+            update_stats_received(bytes, count);
+            if (capture_enabled_.load(std::memory_order_relaxed)) {
+                capture_received(*receive_ring_);
+            }
+            dispatch_packets(*receive_ring_);
+        }
+        io_uring_->recycle();
+        
+        if (io_uring_->failed()) {
+            fall_back_to_socket_engine();
+            return;
+        }
+        if (count < receive_ring_->capacity()) {
+            break;
+        }
+    }
+    
+    // 与套接字引擎相同限制单次唤醒的批次数，剩余的完成事件留到下一轮
+    if (io_uring_->pending()) {
+        io_uring_->notify();
+    }
+}
+
+void UdpClient::fall_back_to_socket_engine() {
+    if (!is_receiving_ || !io_uring_ || !io_uring_->is_open()) {
+        return;
+    }
+    
+    LOG_WARN("io_uring receive failed, falling back to socket engine");
+    event_loop_->remove_reader(io_uring_->event_fd());
+    io_uring_->close();
+    
+    prepare_receive_ring(MAX_BUFFER_SIZE);
+    ErrorCode result = event_loop_->add_reader(socket_, [this]() { handle_readable(); });
+    if (result != ErrorCode::SUCCESS && error_callback_) {
+        try {
+            error_callback_(result, "Failed to register socket with event loop");
+        } catch (const std::exception& e) {
+            LOG_ERROR("Error callback exception: " + std::string(e.what()));
+        }
+    }
+}
+
+void UdpClient::dispatch_packets(const ReceiveRing& ring) {
+    for (const PacketView& packet : ring) {
+        uint64_t started = latency_start();
+        try {
+            if (packet_callback_) {
+                packet_callback_(packet);
+            } else if (endpoint_callback_) {
+                receive_buffer_.assign(packet.data.begin(), packet.data.end());
+                endpoint_callback_(receive_buffer_, packet.from);
+            } else if (message_callback_) {
+                receive_buffer_.assign(packet.data.begin(), packet.data.end());
+                packet.from.format_host(receive_host_);
+                message_callback_(receive_buffer_, receive_host_, packet.from_port());
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("Message callback exception: " + std::string(e.what()));
+        }
+        record_latency(callback_latency_, started);
+    }
+}
+
+bool UdpClient::start_send_workers() {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    if (send_workers_running_) {
+        return true;
+    }
+    if (send_stopping_) {
+        return false;
+    }
+    
+    if (config_.enable_priority_scheduling) {
+        send_scheduler_ = std::make_unique<PriorityScheduler<SendRequest>>(config_.scheduler);
+    } else {
+        send_queue_ = std::make_unique<BoundedQueue<SendRequest>>(config_.send_queue_capacity);
+    }
+    
+    size_t worker_count = std::max<size_t>(config_.send_worker_threads, 1);
+    for (size_t i = 0; i < worker_count; ++i) {
+        send_workers_.emplace_back([this]() { send_worker(); });
+    }
+    
+    send_workers_running_ = true;
+    LOG_DEBUG("Started " + std::to_string(worker_count) + " send worker(s)");
+    return true;
+}
+
+void UdpClient::stop_send_workers() {
+    // 之后的send_async()直接以失败完成，直到下次initialize()；阻塞等待空位的发送者被唤醒后退出
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        send_stopping_ = true;
+    }
+    send_ready_.notify_all();
+    send_space_.notify_all();
+    
+    // 等待正在入队的发送者离开，之后没有人再访问队列
+    std::unique_lock<std::shared_mutex> producers(send_producers_mutex_);
+    if (!send_workers_running_) {
+        return;
+    }
+    
+    for (auto& worker : send_workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    
+    send_workers_.clear();
+    
+    // 发送线程退出后才入队的请求不再发送，以失败完成回调
+    SendRequest request;
+    std::chrono::nanoseconds wait(0);
+    while (send_scheduler_ ? send_scheduler_->try_pop(request, wait, true) : send_queue_->try_pop(request)) {
+        complete_send(request, ErrorCode::SOCKET_SEND_FAILED);
+        request = SendRequest();
+    }
+    
+    // 指标采集在send_mutex_下读取队列深度
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    send_queue_.reset();
+    send_scheduler_.reset();
+    send_workers_running_ = false;
+    LOG_DEBUG("Send workers stopped");
+}
+
+ErrorCode UdpClient::complete_send(SendRequest& request, ErrorCode result) {
+    if (request.callback) {
+        try {
+            request.callback(result);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Send callback exception: " + std::string(e.what()));
+        }
+    }
+    return result;
+}
+
+void UdpClient::send_worker() {
+    SendRequest request;
+    
+    while (true) {
+        // 被限速时等待的时间；关闭时忽略限速，尽快排空队列
+        std::chrono::nanoseconds wait(0);
+        // 调度器被限速时队首也会移出队列，没取到元素也可能腾出了空位
+        bool freed = false;
+        bool popped = false;
+        if (send_scheduler_) {
+            popped = send_scheduler_->try_pop(request, wait, send_stopping_, &freed);
+        } else {
+            popped = send_queue_->try_pop(request);
+            freed = popped;
+        }
+        if (freed) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (blocked_senders_ > 0) {
+                // 调度器下各优先级的发送者等待不同的队列，只唤醒一个可能落到
+                // 队列仍满的低优先级发送者，而腾出空位的高优先级发送者继续阻塞
+                std::lock_guard<std::mutex> lock(send_mutex_);
+                if (send_scheduler_) {
+                    send_space_.notify_all();
+                } else {
+                    send_space_.notify_one();
                 }
             }
         }
         
-        // 短暂休眠以避免过度占用CPU
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (popped) {
+            complete_send(request, send_view(request.view(), request.target_host, request.target_port));
+            request = SendRequest();
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(send_mutex_);
+        if (send_stopping_ && queue_empty()) {
+            break;
+        }
+        
+        idle_send_workers_++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (wait.count() > 0) {
+            // 队列不空但都被限速，等到令牌足够或有新数据入队
+            send_ready_.wait_for(lock, wait);
+        } else {
+            send_ready_.wait(lock, [this]() {
+                return !queue_empty() || send_stopping_;
+            });
+        }
+        idle_send_workers_--;
+    }
+}
+
+bool UdpClient::queue_try_push(SendRequest& request, Priority priority) {
+    if (send_scheduler_) {
+        return send_scheduler_->try_push(request, priority, request.view().size);
+    }
+    return send_queue_->try_push(request);
+}
+
+bool UdpClient::queue_has_space(Priority priority) const {
+    if (send_scheduler_) {
+        return send_scheduler_->has_space(priority);
+    }
+    return send_queue_->approx_size() < send_queue_->capacity();
+}
+
+bool UdpClient::queue_empty() const {
+    return send_scheduler_ ? send_scheduler_->approx_empty() : send_queue_->approx_empty();
+}
+
+void UdpClient::send_keep_alive() {
+    // 在事件循环线程中由定时器周期调用。事件循环可能由多个客户端共享，
+    // 不能像send()那样等待默认服务器解析，否则会阻塞其他客户端的接收
+    auto peer = default_peer();
+    ErrorCode result = ErrorCode::INVALID_ADDRESS;
+    if (peer->resolved) {
+        const byte heartbeat[] = {'H', 'B'};
+        BufferView view(heartbeat, sizeof(heartbeat));
+        SendTarget target = peer->target;
+        auto connection = hold_connection(target);
+        result = send_gather_target(&view, 1, target);
+    } else if (default_state_ == ResolveState::RESOLVING) {
+        LOG_DEBUG("Default peer still resolving, skipping keep-alive heartbeat");
+        return;
     }
     
-    LOG_INFO("Receive loop stopped");
+    if (result != ErrorCode::SUCCESS) {
+        LOG_WARN("Keep-alive heartbeat send failed");
+        if (error_callback_) {
+            try {
+                error_callback_(result, "Keep-alive failed");
+            } catch (const std::exception& e) {
+                LOG_ERROR("Error callback exception: " + std::string(e.what()));
+            }
+        }
+    } else {
+        LOG_DEBUG("Keep-alive heartbeat sent");
+    }
 }
 
-void UdpClient::keep_alive_loop() {
-    LOG_INFO("Keep-alive loop started");
+#ifdef __linux__
+int UdpClient::send_batch_chunk(const BufferView* packets, size_t count, const SendTarget& target) {
+    // 单次系统调用最多提交的数据包数量，同时也是旧内核UDP_MAX_SEGMENTS的取值
+    constexpr size_t kMaxChunk = 64;
+    // 单个UDP数据报的最大负载：IPv4扣除20字节IP头，IPv6的负载长度只扣除UDP头
+    constexpr size_t kMaxGsoBytesV4 = 65507;
+    constexpr size_t kMaxGsoBytesV6 = 65527;
     
-    while (!should_stop_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(config_.keep_alive_interval_ms));
+    size_t n = std::min(count, kMaxChunk);
+    
+    // GSO：连续等长的数据包（最后一个可以更短）由内核在一次sendmsg中切分
+    if (config_.enable_gso && gso_supported_ && n > 1) {
+        // 双栈套接字上IPv4映射地址仍按IPv4发送
+        const auto* addr6 = reinterpret_cast<const sockaddr_in6*>(&target.addr);
+        bool ipv6 = target.addr.ss_family == AF_INET6 && !IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr);
+        size_t max_gso_bytes = ipv6 ? kMaxGsoBytesV6 : kMaxGsoBytesV4;
         
-        if (should_stop_) break;
+        size_t segment_size = packets[0].size;
+        size_t segments = 1;
+        size_t total = segment_size;
         
-        // 发送心跳包
-        buffer_t heartbeat{'H', 'B'};
-        auto result = send(heartbeat);
+        while (segments < n && packets[segments].size <= segment_size &&
+               total + packets[segments].size <= max_gso_bytes) {
+            total += packets[segments].size;
+            ++segments;
+            if (packets[segments - 1].size < segment_size) {
+                break;
+            }
+        }
         
-        if (result != ErrorCode::SUCCESS) {
-            LOG_WARN("Keep-alive heartbeat send failed");
-            if (error_callback_) {
-                try {
-                    error_callback_(result, "Keep-alive failed");
-                } catch (const std::exception& e) {
-                    LOG_ERROR("Error callback exception: " + std::string(e.what()));
-                }
+        if (segments > 1) {
+            iovec iovs[kMaxChunk];
+            for (size_t i = 0; i < segments; ++i) {
+                iovs[i].iov_base = const_cast<byte*>(packets[i].data);
+                iovs[i].iov_len = packets[i].size;
+            }
+            
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+            msghdr msg{};
+            msg.msg_name = const_cast<sockaddr*>(target.name());
+            msg.msg_namelen = target.name_length();
+            msg.msg_iov = iovs;
+            msg.msg_iovlen = segments;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso_size = static_cast<uint16_t>(segment_size);
+            std::memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+            
+            ssize_t result;
+            do {
+                result = sendmsg(socket_, &msg, 0);
+            } while (result < 0 && errno == EINTR);
+            
+            if (result >= 0) {
+                return static_cast<int>(segments);
+            }
+            
+            if (errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+                // 内核或网卡不支持GSO，后续改用sendmmsg
+                LOG_WARN("UDP GSO unavailable, falling back to sendmmsg: " + std::string(strerror(errno)));
+                gso_supported_ = false;
+            } else if (errno == EINVAL) {
+                // 分段超过路径MTU等只与本次调用有关的问题，只有这一组改用sendmmsg
+                LOG_DEBUG_F("UDP GSO rejected {} segments of {} bytes, sending them with sendmmsg",
+                            segments, segment_size);
+                n = segments;
+            } else {
+                return -1;
             }
-        } else {
-            LOG_DEBUG("Keep-alive heartbeat sent");
         }
     }
     
-    LOG_INFO("Keep-alive loop stopped");
+    mmsghdr msgs[kMaxChunk];
+    iovec iovs[kMaxChunk];
+    std::memset(msgs, 0, sizeof(mmsghdr) * n);
+    
+    for (size_t i = 0; i < n; ++i) {
+        iovs[i].iov_base = const_cast<byte*>(packets[i].data);
+        iovs[i].iov_len = packets[i].size;
+        msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(target.name());
+        msgs[i].msg_hdr.msg_namelen = target.name_length();
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    int result;
+    do {
+        result = sendmmsg(socket_, msgs, static_cast<unsigned int>(n), 0);
+    } while (result < 0 && errno == EINTR);
+    
+    return result;
 }
+#endif
 
-void UdpClient::update_stats_sent(size_t bytes) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.packets_sent++;
-    stats_.bytes_sent += bytes;
-    stats_.last_activity = std::chrono::system_clock::now();
+void UdpClient::capture_sent(const BufferView* parts, size_t count, const SendTarget& target) {
+    // 已connect()的默认目标同样保存了地址，只是发送时不传给内核
+    Endpoint peer = Endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(&target.addr), target.length);
+    capture_->write(CaptureDirection::SENT, peer, parts, count, monotonic_ns());
 }
 
-void UdpClient::update_stats_received(size_t bytes) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    stats_.packets_received++;
-    stats_.bytes_received += bytes;
-    stats_.last_activity = std::chrono::system_clock::now();
+void UdpClient::capture_received(const ReceiveRing& ring) {
+    uint64_t timestamp = monotonic_ns();
+    for (const PacketView& packet : ring) {
+        capture_->write(CaptureDirection::RECEIVED, packet.from, packet.data, timestamp);
+    }
+}
+
+void UdpClient::update_stats_sent(size_t bytes, size_t packets) {
+    StatsStripe& stripe = local_stats();
+    stripe.packets_sent.fetch_add(packets, std::memory_order_relaxed);
+    stripe.bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+    touch_activity(stripe);
+}
+
+void UdpClient::update_stats_received(size_t bytes, size_t packets) {
+    StatsStripe& stripe = local_stats();
+    stripe.packets_received.fetch_add(packets, std::memory_order_relaxed);
+    stripe.bytes_received.fetch_add(bytes, std::memory_order_relaxed);
+    touch_activity(stripe);
 }
 
 void UdpClient::update_stats_error(bool is_send_error) {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
+    StatsStripe& stripe = local_stats();
     if (is_send_error) {
-        stats_.send_errors++;
+        stripe.send_errors.fetch_add(1, std::memory_order_relaxed);
     } else {
-        stats_.receive_errors++;
+        stripe.receive_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void UdpClient::StatsStripe::assign(const StatsStripe& other) {
+    packets_sent.store(other.packets_sent.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    packets_received.store(other.packets_received.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bytes_sent.store(other.bytes_sent.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bytes_received.store(other.bytes_received.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    send_errors.store(other.send_errors.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    receive_errors.store(other.receive_errors.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    send_queue_drops.store(other.send_queue_drops.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    last_activity.store(other.last_activity.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void UdpClient::touch_activity(StatsStripe& stripe) {
+    stripe.last_activity.store(coarse_now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void UdpClient::record_latency(LatencyHistogram& histogram, uint64_t started) {
+    if (started != 0) {
+        histogram.record(monotonic_ns() - started);
     }
 }
 
-sockaddr_in UdpClient::create_address(const string_t& host, int port) {
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
+std::thread UdpClient::start_default_resolution() {
+    // 调用方持有config_mutex_（initialize()或update_config()）。旧的解析线程可能正阻塞在
+    // DNS上，不在这里等待，而是交给调用方在释放config_mutex_后回收；代数变化后它的结果被丢弃
+    std::thread stale = std::move(resolver_thread_);
     
-#ifdef _WIN32
-    addr.sin_addr.s_addr = inet_addr(host.c_str());
-    if (addr.sin_addr.s_addr == INADDR_NONE) {
-        // 可能是域名，需要解析
-        LOG_WARN("Host resolution not implemented for: " + host);
-        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    auto peer = std::make_shared<DefaultPeer>();
+    peer->host = config_.server_host;
+    peer->port = config_.server_port;
+    peer->connect = config_.connect_default_peer;
+    
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> publishing(publish_mutex_);
+        generation = ++resolve_generation_;
     }
-#else
-    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) <= 0) {
-        LOG_WARN("Invalid address: " + host);
-        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    
+    // IP字面量直接解析，只有主机名才需要后台线程；发送线程在替换前后看到的都是完整的解析结果
+    auto literal = Endpoint::parse(peer->host, peer->port);
+    if (literal) {
+        publish_default_address(*peer, generation, ErrorCode::SUCCESS, *literal);
+        return stale;
+    }
+    
+    {
+        // 先进入RESOLVING再发布未解析的快照，发送线程看到未解析的快照时总会等待
+        std::lock_guard<std::mutex> publishing(publish_mutex_);
+        if (generation != resolve_generation_) {
+            return stale;
+        }
+        {
+            std::lock_guard<std::mutex> lock(resolve_mutex_);
+            default_state_ = ResolveState::RESOLVING;
+        }
+        std::atomic_store(&default_peer_, std::shared_ptr<const DefaultPeer>(peer));
+    }
+    
+    int family = resolve_family();
+    resolver_thread_ = std::thread([this, peer, generation, family]() {
+        Endpoint endpoint;
+        auto result = resolve_host(peer->host, family, endpoint);
+        publish_default_address(*peer, generation, result, endpoint.with_port(peer->port));
+    });
+    return stale;
+}
+
+void UdpClient::publish_default_address(const DefaultPeer& peer, uint64_t generation,
+                                        ErrorCode result, const Endpoint& endpoint) {
+    // 已被更新的默认服务器取代的解析结果不再发布
+    std::lock_guard<std::mutex> publishing(publish_mutex_);
+    if (generation != resolve_generation_) {
+        return;
+    }
+    
+    SendTarget target;
+    if (result == ErrorCode::SUCCESS) {
+        result = make_target(endpoint, target);
+    }
+    if (result != ErrorCode::SUCCESS) {
+        LOG_ERROR("Failed to resolve server host: " + peer.host);
+    }
+    
+    auto published = std::make_shared<DefaultPeer>(peer);
+    published->resolved = result == ErrorCode::SUCCESS;
+    published->endpoint = endpoint;
+    {
+        // 改变连接状态时等待不带地址的发送完成；持有旧快照的发送线程之后改用显式地址
+        std::unique_lock<std::shared_mutex> connection(connection_mutex_, std::defer_lock);
+        bool connecting = result == ErrorCode::SUCCESS && peer.connect;
+        if (connecting || default_connected_) {
+            connection.lock();
+            ++connection_generation_;
+        }
+        if (connecting) {
+            target.connected = connect(socket_, reinterpret_cast<const sockaddr*>(&target.addr), target.length) == 0;
+            target.connection = connection_generation_;
+            if (!target.connected) {
+                LOG_WARN("Failed to connect to default peer, sending with explicit address");
+            }
+        } else if (default_connected_) {
+            // 解除之前的连接，恢复接收任意对端的数据
+            sockaddr_storage unspecified{};
+            unspecified.ss_family = AF_UNSPEC;
+            connect(socket_, reinterpret_cast<const sockaddr*>(&unspecified),
+                    socket_ipv6_ ? sizeof(sockaddr_in6) : sizeof(sockaddr_in));
+        }
+        published->target = target;
+        std::atomic_store(&default_peer_, std::shared_ptr<const DefaultPeer>(std::move(published)));
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(resolve_mutex_);
+        default_connected_ = target.connected;
+        default_state_ = result == ErrorCode::SUCCESS ? ResolveState::READY : ResolveState::FAILED;
+    }
+    resolve_ready_.notify_all();
+}
+
+void UdpClient::stop_resolver() {
+    if (resolver_thread_.joinable()) {
+        resolver_thread_.join();
+    }
+}
+
+void UdpClient::join_stale_resolver(std::thread& resolver) {
+    if (resolver.joinable()) {
+        resolver.join();
+    }
+}
+
+void UdpClient::register_metrics() {
+    if (!config_.enable_metrics || metrics_collector_ != 0) {
+        return;
     }
-#endif
     
-    return addr;
+    // UdpClientGroup的分片共用同一端口，client标签区分同一进程中的各个客户端
+    static std::atomic<uint64_t> next_client_id{0};
+    MetricLabels labels = {
+        {"port", std::to_string(get_local_port())},
+        {"client", std::to_string(next_client_id.fetch_add(1, std::memory_order_relaxed))}
+    };
+    metrics_collector_ = MetricsRegistry::global().add_collector([this, labels](MetricsWriter& writer) {
+        collect_metrics(writer, labels);
+    });
+}
+
+void UdpClient::unregister_metrics() {
+    if (metrics_collector_ != 0) {
+        MetricsRegistry::global().remove_collector(metrics_collector_);
+        metrics_collector_ = 0;
+    }
+}
+
+void UdpClient::collect_metrics(MetricsWriter& writer, const MetricLabels& labels) {
+    Statistics stats = get_statistics();
+    writer.counter("udp2docker_client_packets_sent_total", "Datagrams sent", stats.packets_sent, labels);
+    writer.counter("udp2docker_client_packets_received_total", "Datagrams received", stats.packets_received, labels);
+    writer.counter("udp2docker_client_bytes_sent_total", "Bytes sent", stats.bytes_sent, labels);
+    writer.counter("udp2docker_client_bytes_received_total", "Bytes received", stats.bytes_received, labels);
+    writer.counter("udp2docker_client_send_errors_total", "Failed send calls", stats.send_errors, labels);
+    writer.counter("udp2docker_client_receive_errors_total", "Failed receive calls", stats.receive_errors, labels);
+    writer.counter("udp2docker_client_send_queue_drops_total", "Asynchronous sends dropped by backpressure",
+                   stats.send_queue_drops, labels);
+    
+    size_t depth = 0;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (send_scheduler_) {
+            depth = send_scheduler_->approx_size();
+        } else if (send_queue_) {
+            depth = send_queue_->approx_size();
+        }
+    }
+    writer.gauge("udp2docker_client_send_queue_depth", "Requests waiting in the asynchronous send queue",
+                 static_cast<double>(depth), labels);
+    
+    if (config_.enable_latency_histograms) {
+        writer.summary("udp2docker_client_send_latency_seconds", "Duration of send system calls",
+                       get_send_latency(), labels);
+        writer.summary("udp2docker_client_callback_latency_seconds", "Duration of asynchronous receive callbacks",
+                       get_callback_latency(), labels);
+    }
+}
+
+ErrorCode UdpClient::wait_default_address() {
+    std::unique_lock<std::mutex> lock(resolve_mutex_);
+    resolve_ready_.wait_for(lock, std::chrono::milliseconds(timeout_ms_.load(std::memory_order_relaxed)), [this]() {
+        return default_state_ != ResolveState::RESOLVING;
+    });
+    
+    switch (default_state_.load()) {
+        case ResolveState::READY:
+            return ErrorCode::SUCCESS;
+        case ResolveState::RESOLVING:
+            return ErrorCode::TIMEOUT;
+        default:
+            return ErrorCode::INVALID_ADDRESS;
+    }
+}
+
+int UdpClient::resolve_family() const {
+    if (!socket_ipv6_) {
+        return AF_INET;
+    }
+    return config_.ip_family == IpFamily::IPV6 ? AF_INET6 : AF_UNSPEC;
+}
+
+ErrorCode UdpClient::make_target(const Endpoint& endpoint, SendTarget& target) const {
+    target.connected = false;
+    target.length = endpoint.to_sockaddr(target.addr, socket_ipv6_);
+    if (target.length == 0) {
+        LOG_ERROR("Address " + endpoint.to_string() + " is not reachable from this socket");
+        return ErrorCode::INVALID_ADDRESS;
+    }
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode UdpClient::resolve_target(const string_t& host, int port, SendTarget& target) {
+    // 默认目标从同一个快照中复制，不会混合两次解析的地址、长度和连接标志
+    auto peer = default_peer();
+    if (host.empty() || host == peer->host) {
+        while (!peer->resolved) {
+            auto result = wait_default_address();
+            if (result != ErrorCode::SUCCESS) {
+                return result;
+            }
+            peer = default_peer();
+        }
+        
+        if (port == 0 || port == peer->port) {
+            target = peer->target;
+            return ErrorCode::SUCCESS;
+        }
+        return make_target(peer->endpoint.with_port(port), target);
+    }
+    
+    int target_port = port == 0 ? peer->port : port;
+    
+    // IP字面量的解析比查缓存（加锁+哈希）更快
+    auto literal = Endpoint::parse(host, target_port);
+    if (literal) {
+        return make_target(*literal, target);
+    }
+    
+    Endpoint endpoint;
+    auto result = lookup_host(host, endpoint);
+    if (result != ErrorCode::SUCCESS) {
+        return result;
+    }
+    return make_target(endpoint.with_port(target_port), target);
+}
+
+std::shared_lock<std::shared_mutex> UdpClient::hold_connection(SendTarget& target) {
+    if (!target.connected) {
+        return std::shared_lock<std::shared_mutex>();
+    }
+    
+    std::shared_lock<std::shared_mutex> lock(connection_mutex_);
+    if (target.connection != connection_generation_) {
+        // 套接字已重新连接或解除连接，不带地址会发往新的对端或失败
+        target.connected = false;
+        lock.unlock();
+    }
+    return lock;
+}
+
+ErrorCode UdpClient::lookup_host(const string_t& host, Endpoint& endpoint) {
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(address_cache_mutex_);
+        auto it = address_index_.find(host);
+        if (it != address_index_.end()) {
+            address_cache_.splice(address_cache_.begin(), address_cache_, it->second);
+            CachedAddress& cached = it->second->second;
+            endpoint = cached.endpoint;
+            
+            // 过期的条目继续使用，由刷新线程重新解析，发送线程不会因此阻塞
+            if (config_.address_cache_ttl_ms > 0 && now >= cached.expires && !cached.refreshing &&
+                !address_refresher_stopping_) {
+                cached.refreshing = true;
+                address_refresh_queue_.push_back(host);
+                if (!address_refresher_.joinable()) {
+                    address_refresher_ = std::thread([this]() { address_refresh_loop(); });
+                }
+                address_refresh_ready_.notify_one();
+            }
+            return ErrorCode::SUCCESS;
+        }
+    }
+    
+    // 解析期间不持有锁，同一主机名并发未命中时可能重复解析，结果相同
+    auto result = resolve_host(host, resolve_family(), endpoint);
+    if (result != ErrorCode::SUCCESS) {
+        LOG_ERROR("Failed to resolve host: " + host);
+        return result;
+    }
+    
+    std::lock_guard<std::mutex> lock(address_cache_mutex_);
+    if (config_.address_cache_size == 0 || address_index_.count(host) != 0) {
+        return ErrorCode::SUCCESS;
+    }
+    CachedAddress cached;
+    cached.endpoint = endpoint;
+    cached.expires = now + std::chrono::milliseconds(config_.address_cache_ttl_ms);
+    address_cache_.emplace_front(host, cached);
+    address_index_[host] = address_cache_.begin();
+    if (address_cache_.size() > config_.address_cache_size) {
+        address_index_.erase(address_cache_.back().first);
+        address_cache_.pop_back();
+    }
+    return ErrorCode::SUCCESS;
+}
+
+void UdpClient::address_refresh_loop() {
+    std::unique_lock<std::mutex> lock(address_cache_mutex_);
+    while (true) {
+        address_refresh_ready_.wait(lock, [this]() {
+            return !address_refresh_queue_.empty() || address_refresher_stopping_;
+        });
+        if (address_refresher_stopping_) {
+            return;
+        }
+        
+        string_t host = std::move(address_refresh_queue_.back());
+        address_refresh_queue_.pop_back();
+        lock.unlock();
+        Endpoint endpoint;
+        auto result = resolve_host(host, resolve_family(), endpoint);
+        lock.lock();
+        
+        // 条目可能已被淘汰；解析失败时保留旧地址，下一个有效期后再试
+        auto it = address_index_.find(host);
+        if (it == address_index_.end()) {
+            continue;
+        }
+        CachedAddress& cached = it->second->second;
+        if (result == ErrorCode::SUCCESS) {
+            cached.endpoint = endpoint;
+        } else {
+            LOG_WARN("Failed to refresh cached address for host: " + host);
+        }
+        cached.expires = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.address_cache_ttl_ms);
+        cached.refreshing = false;
+    }
+}
+
+void UdpClient::stop_address_refresher() {
+    // 线程对象在锁内移出，停止期间并发的发送不会再启动新的刷新线程
+    std::thread refresher;
+    {
+        std::lock_guard<std::mutex> lock(address_cache_mutex_);
+        if (!address_refresher_.joinable()) {
+            return;
+        }
+        address_refresher_stopping_ = true;
+        refresher = std::move(address_refresher_);
+    }
+    address_refresh_ready_.notify_all();
+    refresher.join();
+    
+    // 未处理的刷新请求作废，条目在下次命中时重新排队
+    std::lock_guard<std::mutex> lock(address_cache_mutex_);
+    address_refresher_stopping_ = false;
+    address_refresh_queue_.clear();
+    for (auto& entry : address_cache_) {
+        entry.second.refreshing = false;
+    }
 }
 
 } // namespace udp2docker 
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "udp2docker/udp_client_group.h"
+#include "udp2docker/logger.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <errno.h>
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+#endif
+
+namespace udp2docker {
+
+namespace {
+
+// 本进程可以运行的CPU编号（升序）。受亲和性掩码或cpuset限制时编号不一定从0连续
+std::vector<int> usable_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        unsigned int count = std::max(std::thread::hardware_concurrency(), 1u);
+        for (unsigned int cpu = 0; cpu < count; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+// first_cpu在可用CPU列表中的位置；不在列表中时按列表长度取模
+size_t first_cpu_index(int first_cpu, const std::vector<int>& cpus) {
+    auto it = std::find(cpus.begin(), cpus.end(), first_cpu);
+    if (it != cpus.end()) {
+        return static_cast<size_t>(it - cpus.begin());
+    }
+    int count = static_cast<int>(cpus.size());
+    return static_cast<size_t>(((first_cpu % count) + count) % count);
+}
+
+} // namespace
+
+UdpClientGroup::UdpClientGroup(const UdpGroupConfig& config)
+    : config_(config)
+{
+}
+
+UdpClientGroup::~UdpClientGroup() {
+    close();
+}
+
+ErrorCode UdpClientGroup::initialize() {
+    if (is_initialized()) {
+        LOG_WARN("UdpClientGroup already initialized");
+        return ErrorCode::SUCCESS;
+    }
+    
+#ifndef __linux__
+    if (config_.steering == ReuseportSteering::CPU_BPF) {
+        LOG_ERROR("CPU_BPF steering is only supported on Linux");
+        return ErrorCode::INVALID_PARAMETER;
+    }
+#endif
+    
+    // 分片i绑定到可用CPU列表中first之后的第i个，转向程序按同一映射的逆映射选择分片
+    std::vector<int> cpus = usable_cpus();
+    size_t count = config_.shard_count != 0 ? config_.shard_count : cpus.size();
+    size_t first = first_cpu_index(config_.first_cpu, cpus);
+    int port = config_.client.local_port;
+    
+    for (size_t i = 0; i < count; ++i) {
+        UdpConfig shard_config = config_.client;
+        shard_config.reuse_port = true;
+        // 后续分片绑定到第一个分片实际获得的端口
+        shard_config.local_port = port;
+        
+        int cpu = cpus[(first + i) % cpus.size()];
+        shard_config.receive_cpu = config_.pin_threads ? cpu : -1;
+        shard_config.incoming_cpu = config_.steering == ReuseportSteering::INCOMING_CPU ? cpu : -1;
+        
+        auto shard = std::make_unique<UdpClient>(shard_config);
+        auto result = shard->initialize();
+        if (result != ErrorCode::SUCCESS) {
+            LOG_ERROR_F("Failed to initialize shard {} of UdpClientGroup", i);
+            close();
+            return result;
+        }
+        
+        if (port == 0) {
+            port = shard->get_local_port();
+        }
+        shards_.push_back(std::move(shard));
+    }
+    
+    if (config_.steering == ReuseportSteering::CPU_BPF) {
+        auto result = attach_steering_program(cpus, first);
+        if (result != ErrorCode::SUCCESS) {
+            close();
+            return result;
+        }
+    }
+    
+    LOG_INFO_F("UdpClientGroup initialized with {} shards on port {}", shards_.size(), port);
+    return ErrorCode::SUCCESS;
+}
+
+void UdpClientGroup::close() {
+    if (shards_.empty()) {
+        return;
+    }
+    
+    stop_receive_async();
+    for (auto& shard : shards_) {
+        shard->close();
+    }
+    shards_.clear();
+}
+
+template<typename Start>
+ErrorCode UdpClientGroup::start_all(Start start) {
+    if (!is_initialized()) {
+        LOG_ERROR("UdpClientGroup not initialized");
+        return ErrorCode::SOCKET_INIT_FAILED;
+    }
+    
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        auto result = start(*shards_[i]);
+        if (result != ErrorCode::SUCCESS) {
+            LOG_ERROR_F("Failed to start receiving on shard {}", i);
+            stop_receive_async();
+            return result;
+        }
+    }
+    return ErrorCode::SUCCESS;
+}
+
+ErrorCode UdpClientGroup::start_receive_async(MessageCallback message_callback,
+                                              ErrorCallback error_callback) {
+    return start_all([&](UdpClient& shard) {
+        return shard.start_receive_async(message_callback, error_callback);
+    });
+}
+
+ErrorCode UdpClientGroup::start_receive_async(EndpointCallback endpoint_callback,
+                                              ErrorCallback error_callback) {
+    return start_all([&](UdpClient& shard) {
+        return shard.start_receive_async(endpoint_callback, error_callback);
+    });
+}
+
+ErrorCode UdpClientGroup::start_receive_batch_async(PacketCallback packet_callback,
+                                                    ErrorCallback error_callback) {
+    return start_all([&](UdpClient& shard) {
+        return shard.start_receive_batch_async(packet_callback, error_callback);
+    });
+}
+
+void UdpClientGroup::stop_receive_async() {
+    for (auto& shard : shards_) {
+        shard->stop_receive_async();
+    }
+}
+
+int UdpClientGroup::get_local_port() const {
+    return shards_.empty() ? 0 : shards_.front()->get_local_port();
+}
+
+UdpClient::Statistics UdpClientGroup::get_statistics() const {
+    UdpClient::Statistics total;
+    for (const auto& shard : shards_) {
+        UdpClient::Statistics stats = shard->get_statistics();
+        total.packets_sent += stats.packets_sent;
+        total.packets_received += stats.packets_received;
+        total.bytes_sent += stats.bytes_sent;
+        total.bytes_received += stats.bytes_received;
+        total.send_errors += stats.send_errors;
+        total.receive_errors += stats.receive_errors;
+        total.send_queue_drops += stats.send_queue_drops;
+        if (stats.last_activity > total.last_activity) {
+            total.last_activity = stats.last_activity;
+        }
+    }
+    return total;
+}
+
+HistogramSnapshot UdpClientGroup::get_send_latency() const {
+    HistogramSnapshot total;
+    for (const auto& shard : shards_) {
+        total.merge(shard->get_send_latency());
+    }
+    return total;
+}
+
+HistogramSnapshot UdpClientGroup::get_callback_latency() const {
+    HistogramSnapshot total;
+    for (const auto& shard : shards_) {
+        total.merge(shard->get_callback_latency());
+    }
+    return total;
+}
+
+ErrorCode UdpClientGroup::attach_steering_program(const std::vector<int>& cpus, size_t first) {
+#ifdef __linux__
+    // 可用CPU列表中位置p的CPU上绑定的是分片 (p - first) mod CPU数，逐个比较CPU编号返回该分片：
+    //   A = 当前CPU; if (A == cpus[p]) return shard(p); ...
+    // 返回值是套接字在组内按绑定顺序的下标。没有分片绑定的CPU（CPU数多于分片数，或软中断
+    // 运行在亲和性掩码之外的CPU上）按 A % 分片数 分给各分片
+    size_t shard_count = shards_.size();
+    if (cpus.size() * 2 + 3 > BPF_MAXINSNS) {
+        LOG_ERROR_F("Too many CPUs for the reuseport steering program: {}", cpus.size());
+        return ErrorCode::INVALID_PARAMETER;
+    }
+    
+    std::vector<sock_filter> code;
+    code.reserve(cpus.size() * 2 + 3);
+    code.push_back({ BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) });
+    for (size_t p = 0; p < cpus.size(); ++p) {
+        size_t shard = ((p + cpus.size() - first) % cpus.size()) % shard_count;
+        code.push_back({ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(cpus[p]) });
+        code.push_back({ BPF_RET | BPF_K, 0, 0, static_cast<uint32_t>(shard) });
+    }
+    code.push_back({ BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(shard_count) });
+    code.push_back({ BPF_RET | BPF_A, 0, 0, 0 });
+    
+    sock_fprog program{};
+    program.len = static_cast<unsigned short>(code.size());
+    program.filter = code.data();
+    
+    // 程序作用于整个reuseport组，挂载到任一成员即可
+    if (setsockopt(shards_.front()->native_handle(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                   &program, sizeof(program)) != 0) {
+        LOG_ERROR("Failed to attach reuseport steering program: " + std::string(strerror(errno)));
+        return ErrorCode::SOCKET_BIND_FAILED;
+    }
+    return ErrorCode::SUCCESS;
+#else
+    (void)cpus;
+    (void)first;
+    return ErrorCode::INVALID_PARAMETER;
+#endif
+}
+
+} // namespace udp2docker
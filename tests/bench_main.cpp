@@ -0,0 +1,317 @@
+#include "udp2docker/udp_client.h"
+#include "udp2docker/message_protocol.h"
+#include "udp2docker/checksum.h"
+#include "udp2docker/config_manager.h"
+#include "udp2docker/logger.h"
+#include "udp2docker/statistics.h"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+using namespace udp2docker;
+
+// 用法：udp2docker_bench --benchmark_format=json --benchmark_out=bench.json
+// 可用--benchmark_filter=Loopback只运行端到端测试
+
+namespace {
+
+const std::vector<int64_t> PAYLOAD_SIZES = {64, 512, 1400, 8192};
+
+buffer_t make_payload(size_t size) {
+    buffer_t payload(size);
+    for (size_t i = 0; i < size; ++i) {
+        payload[i] = static_cast<byte>(i * 31 + 7);
+    }
+    return payload;
+}
+
+// 日志文件放在临时目录下，main()结束时删除
+std::filesystem::path g_log_dir;
+
+/**
+ * @brief 回环回显服务器，在私有的事件循环线程中原样返回收到的数据报
+ */
+class EchoServer {
+public:
+    EchoServer() {
+        UdpConfig config;
+        config.enable_keep_alive = false;
+        config.ip_family = IpFamily::IPV4;
+        config.local_host = "127.0.0.1";
+        config.receive_batch_size = 32;
+        config.receive_buffer_size = 4 * 1024 * 1024;
+        server_ = std::make_unique<UdpClient>(config);
+        
+        if (server_->initialize() == ErrorCode::SUCCESS) {
+            UdpClient* server = server_.get();
+            server_->start_receive_batch_async([server](const PacketView& packet) {
+                server->send_to(packet.data, packet.from);
+            });
+        }
+    }
+    
+    ~EchoServer() {
+        server_->stop_receive_async();
+    }
+    
+    int port() const { return server_->get_local_port(); }
+
+private:
+    std::unique_ptr<UdpClient> server_;
+};
+
+EchoServer* g_echo = nullptr;
+
+// ========== 消息协议 ==========
+
+void BM_Serialize(benchmark::State& state) {
+    MessageProtocol protocol;
+    Message message(MessageType::DATA, make_payload(static_cast<size_t>(state.range(0))));
+    
+    for (auto _ : state) {
+        auto frame = protocol.serialize(message);
+        benchmark::DoNotOptimize(frame);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Serialize)->ArgsProduct({PAYLOAD_SIZES});
+
+void BM_SerializeInto(benchmark::State& state) {
+    MessageProtocol protocol;
+    Message message(MessageType::DATA, make_payload(static_cast<size_t>(state.range(0))));
+    buffer_t frame(MAX_BUFFER_SIZE);
+    
+    for (auto _ : state) {
+        auto written = protocol.serialize_into(message, frame.data(), frame.size());
+        benchmark::DoNotOptimize(written);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializeInto)->ArgsProduct({PAYLOAD_SIZES});
+
+void BM_Deserialize(benchmark::State& state) {
+    MessageProtocol protocol;
+    auto frame = protocol.serialize(Message(MessageType::DATA, make_payload(static_cast<size_t>(state.range(0)))));
+    
+    for (auto _ : state) {
+        auto message = protocol.deserialize(*frame);
+        benchmark::DoNotOptimize(message);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Deserialize)->ArgsProduct({PAYLOAD_SIZES});
+
+void BM_DeserializeView(benchmark::State& state) {
+    MessageProtocol protocol;
+    auto frame = protocol.serialize(Message(MessageType::DATA, make_payload(static_cast<size_t>(state.range(0)))));
+    BufferView data(frame->data(), frame->size());
+    
+    for (auto _ : state) {
+        auto count = protocol.deserialize_each(data, [](const MessageView& view) {
+            benchmark::DoNotOptimize(view.payload.data);
+        });
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DeserializeView)->ArgsProduct({PAYLOAD_SIZES});
+
+// MessageProtocol::calculate_checksum是私有的，内部直接调用crc32()
+void BM_Checksum(benchmark::State& state) {
+    buffer_t data = make_payload(static_cast<size_t>(state.range(0)));
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(crc32(data.data(), data.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    state.SetLabel(crc32_implementation());
+}
+BENCHMARK(BM_Checksum)->ArgsProduct({{64, 1400, 8192, 65536}});
+
+// ========== 日志 ==========
+
+Logger& bench_logger(bool async) {
+    auto make = [](const char* name, bool enable_async) {
+        auto logger = std::make_unique<Logger>(name);
+        logger->set_level(LogLevel::INFO);
+        logger->set_target(LogTarget::FILE);
+        logger->set_file_output((g_log_dir / (string_t(name) + ".log")).string(), 1024, 1);
+        logger->set_file_buffering(64 * 1024, 1000);
+        if (enable_async) {
+            logger->enable_async(64 * 1024, LogOverflowPolicy::DROP);
+        }
+        return logger;
+    };
+    
+    // 多线程测试共用同一个日志器，保留到进程退出
+    static std::unique_ptr<Logger> sync_logger = make("bench_sync", false);
+    static std::unique_ptr<Logger> async_logger = make("bench_async", true);
+    return async ? *async_logger : *sync_logger;
+}
+
+void BM_LoggerLog(benchmark::State& state) {
+    Logger& logger = bench_logger(state.range(0) != 0);
+    const string_t message = "benchmark log line with a fixed payload";
+    
+    for (auto _ : state) {
+        logger.log(LogLevel::INFO, message, __FILE__, __LINE__, __func__);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerLog)->ArgNames({"async"})->Arg(0)->Arg(1)->Threads(1)->Threads(4);
+
+void BM_LoggerFormat(benchmark::State& state) {
+    Logger& logger = bench_logger(state.range(0) != 0);
+    uint64_t sequence = 0;
+    
+    for (auto _ : state) {
+        logger.logf(LogLevel::INFO, __FILE__, __LINE__, __func__,
+                    "packet {} from {}:{} size {}", ++sequence, "127.0.0.1", 9000, 1400);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerFormat)->ArgNames({"async"})->Arg(0)->Arg(1)->Threads(1)->Threads(4);
+
+void BM_LoggerDisabled(benchmark::State& state) {
+    Logger& logger = bench_logger(false);
+    
+    for (auto _ : state) {
+        logger.logf(LogLevel::DEBUG, __FILE__, __LINE__, __func__, "filtered {}", 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerDisabled);
+
+// ========== 配置 ==========
+
+ConfigManager& bench_config() {
+    static std::unique_ptr<ConfigManager> config = []() {
+        auto manager = std::make_unique<ConfigManager>();
+        manager->import_config("[client]\nserver_host = 127.0.0.1\ntimeout_ms = 5000\n"
+                               "[socket]\nreceive_batch_size = 32\n", "ini");
+        return manager;
+    }();
+    return *config;
+}
+
+void BM_ConfigGetInt(benchmark::State& state) {
+    ConfigManager& config = bench_config();
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(config.get_int("client.timeout_ms"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConfigGetInt)->Threads(1)->Threads(4);
+
+void BM_ConfigGetString(benchmark::State& state) {
+    ConfigManager& config = bench_config();
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(config.get_string("client.server_host"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConfigGetString)->Threads(1)->Threads(4);
+
+void BM_ConfigHandle(benchmark::State& state) {
+    ConfigHandle<int> timeout = bench_config().int_handle("client.timeout_ms");
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(timeout.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConfigHandle)->Threads(1)->Threads(4);
+
+// ========== 端到端回环 ==========
+
+/**
+ * @brief 每个线程用自己的套接字向回显服务器发送请求并等待回显（一问一答）
+ *
+ * RTT分位数为各线程分位数的平均值（纳秒）。
+ */
+void BM_LoopbackRoundTrip(benchmark::State& state) {
+    UdpConfig config;
+    config.enable_keep_alive = false;
+    config.ip_family = IpFamily::IPV4;
+    config.timeout_ms = 1000;
+    UdpClient client(config);
+    if (client.initialize() != ErrorCode::SUCCESS) {
+        state.SkipWithError("failed to initialize client socket");
+        return;
+    }
+    
+    Endpoint echo = *Endpoint::parse("127.0.0.1", g_echo->port());
+    MessageProtocol protocol;
+    Message message(MessageType::DATA, make_payload(static_cast<size_t>(state.range(0))));
+    buffer_t frame(MAX_BUFFER_SIZE);
+    ReceiveRing ring(1);
+    LatencyHistogram rtt;
+    
+    for (auto _ : state) {
+        uint64_t start = monotonic_ns();
+        auto written = protocol.serialize_into(message, frame.data(), frame.size());
+        if (!written.is_success() ||
+            client.send_to(BufferView(frame.data(), written.value()), echo) != ErrorCode::SUCCESS) {
+            state.SkipWithError("send failed");
+            break;
+        }
+        
+        auto received = client.receive_batch(ring);
+        if (!received.is_success() || received.value() == 0) {
+            state.SkipWithError("echo timed out");
+            break;
+        }
+        auto count = protocol.deserialize_each(ring[0].data, [](const MessageView& view) {
+            benchmark::DoNotOptimize(view.payload.data);
+        });
+        benchmark::DoNotOptimize(count);
+        rtt.record(monotonic_ns() - start);
+    }
+    
+    HistogramSnapshot snapshot = rtt.snapshot();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0) * 2);
+    state.counters["rtt_p50_ns"] = benchmark::Counter(static_cast<double>(snapshot.percentile(0.50)),
+                                                       benchmark::Counter::kAvgThreads);
+    state.counters["rtt_p99_ns"] = benchmark::Counter(static_cast<double>(snapshot.percentile(0.99)),
+                                                       benchmark::Counter::kAvgThreads);
+    state.counters["rtt_p999_ns"] = benchmark::Counter(static_cast<double>(snapshot.percentile(0.999)),
+                                                        benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_LoopbackRoundTrip)
+    ->ArgNames({"payload"})
+    ->ArgsProduct({PAYLOAD_SIZES})
+    ->Threads(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->UseRealTime();
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    
+    // 库内部的INFO日志会混入基准测试的输出
+    LoggerManager::set_global_level(LogLevel::WARN);
+    
+    g_log_dir = std::filesystem::temp_directory_path() / "udp2docker_bench";
+    std::filesystem::create_directories(g_log_dir);
+    
+    {
+        EchoServer echo;
+        g_echo = &echo;
+        benchmark::RunSpecifiedBenchmarks();
+        g_echo = nullptr;
+    }
+    
+    benchmark::Shutdown();
+    std::error_code ignored;
+    std::filesystem::remove_all(g_log_dir, ignored);
+    return 0;
+}